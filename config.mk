@@ -1,9 +1,63 @@
 # config.mk - Build configuration for os-dev
 # Cross-compiler toolchain settings
 
+# Target architecture: i686 (default, 32-bit protected mode) or x86_64
+# (long mode). Select with `make ARCH=x86_64`.
+ARCH ?= i686
+
+ifeq ($(ARCH),x86_64)
+
+# Cross-compiler prefix
+CROSS := x86_64-elf-
+
+# Machine flags shared by C and assembly sources
+# -mno-red-zone: interrupt frames would clobber the 128-byte red zone
+# -mno-sse etc.: no FPU/SIMD context is saved in the kernel
+ARCH_CFLAGS := -m64 -mcmodel=small -mno-red-zone
+ARCH_CFLAGS += -mno-mmx -mno-sse -mno-sse2
+
+# Assembler flags
+ASFLAGS := --64
+
+# Linker flags
+LDFLAGS := -m elf_x86_64 -nostdlib
+
+# Kernel linker script
+KERNEL_LD := scripts/kernel_x86_64.ld
+
+# Stage 2 is assembled as a 64-bit object so it can contain .code64
+STAGE2_CFLAGS := -m64 -DBOOT_LONG_MODE
+STAGE2_LDFLAGS := -m elf_x86_64
+
+# Emulator
+QEMU := qemu-system-x86_64
+
+else
+
 # Cross-compiler prefix
 CROSS := i686-elf-
 
+# Machine flags shared by C and assembly sources
+ARCH_CFLAGS := -m32
+
+# Assembler flags
+ASFLAGS := --32
+
+# Linker flags
+LDFLAGS := -m elf_i386 -nostdlib
+
+# Kernel linker script
+KERNEL_LD := scripts/kernel.ld
+
+# Stage 2 is a 16/32-bit object
+STAGE2_CFLAGS := -m16
+STAGE2_LDFLAGS :=
+
+# Emulator
+QEMU := qemu-system-i386
+
+endif
+
 # Toolchain
 CC := $(CROSS)gcc
 AS := $(CROSS)as
@@ -11,16 +65,10 @@ LD := $(CROSS)ld
 OBJCOPY := $(CROSS)objcopy
 
 # C compiler flags
-CFLAGS := -m32 -std=gnu99 -ffreestanding -nostdlib
+CFLAGS := $(ARCH_CFLAGS) -std=gnu99 -ffreestanding -nostdlib
 CFLAGS += -fno-builtin -fno-stack-protector -fno-pic
 CFLAGS += -Wall -Wextra -Werror
 CFLAGS += -g -O0
 
 # Include paths
 CFLAGS += -I$(ROOT)/kernel/include
-
-# Assembler flags
-ASFLAGS := --32
-
-# Linker flags
-LDFLAGS := -m elf_i386 -nostdlib
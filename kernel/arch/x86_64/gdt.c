@@ -0,0 +1,78 @@
+/*
+ * kernel/arch/x86_64/gdt.c - Global Descriptor Table (long mode)
+ *
+ * Long mode counterpart of gdt_init() in kernel/init/gdt.c. The 8-byte
+ * descriptor encoding is unchanged, so gdt_set_gate() is shared; only
+ * the flag nibbles and the TSS descriptor size differ:
+ *
+ *   - Code segments set L=1 and D=0 (64-bit code)
+ *   - Base and limit are ignored for code/data segments
+ *   - The TSS descriptor is 16 bytes and takes two GDT slots
+ *
+ * Selectors are identical to i686 (see gdt.h), so code using KERNEL_CS
+ * and friends does not need to care which architecture it runs on.
+ *
+ * References:
+ *   - Intel SDM Vol 3, Section 3.4.5: Segment Descriptors
+ *   - Intel SDM Vol 3, Section 7.2.3: TSS Descriptor in 64-bit mode
+ */
+
+#include <gdt.h>
+
+/*
+ * GDT_ENTRIES - Number of GDT slots
+ *
+ *   0: Null descriptor
+ *   1: Kernel code segment (64-bit)
+ *   2: Kernel data segment
+ *   3: User code segment (64-bit, placeholder)
+ *   4: User data segment (placeholder)
+ *   5-6: TSS descriptor (16 bytes, placeholder)
+ */
+#define GDT_ENTRIES 7
+
+static struct gdt_entry gdt[GDT_ENTRIES];
+static struct gdt_ptr64 gdt_pointer;
+
+/*
+ * gdt_flush - Load GDT and reload segment registers (assembly)
+ *
+ * Defined in kernel/arch/x86_64/gdt_flush.S.
+ *
+ * @gdt_ptr: Linear address of gdt_ptr64 structure
+ */
+extern void gdt_flush(uint64_t gdt_ptr);
+
+/*
+ * gdt_init - Initialize the Global Descriptor Table
+ *
+ * Entry 1 - Kernel Code (selector 0x08)
+ *   Access 0x9A, Flags 0xA: G=1, D=0, L=1 (64-bit code)
+ *
+ * Entry 2 - Kernel Data (selector 0x10)
+ *   Access 0x92, Flags 0xC (flags ignored in long mode)
+ *
+ * Entry 3 - User Code (selector 0x18 | 3)
+ *   Access 0xFA, Flags 0xA
+ *
+ * Entry 4 - User Data (selector 0x20 | 3)
+ *   Access 0xF2, Flags 0xC
+ *
+ * Entries 5-6 - TSS (selector 0x28)
+ *   Left empty until tss_init() fills in the 16-byte descriptor.
+ */
+void gdt_init(void)
+{
+    gdt_pointer.limit = (uint16_t)(sizeof(gdt) - 1);
+    gdt_pointer.base  = (uint64_t)(uintptr_t)&gdt;
+
+    gdt_set_gate(&gdt[0], 0, 0, 0, 0);
+    gdt_set_gate(&gdt[1], 0, 0xFFFFF, 0x9A, 0xA);
+    gdt_set_gate(&gdt[2], 0, 0xFFFFF, 0x92, 0xC);
+    gdt_set_gate(&gdt[3], 0, 0xFFFFF, 0xFA, 0xA);
+    gdt_set_gate(&gdt[4], 0, 0xFFFFF, 0xF2, 0xC);
+    gdt_set_gate(&gdt[5], 0, 0, 0, 0);
+    gdt_set_gate(&gdt[6], 0, 0, 0, 0);
+
+    gdt_flush((uint64_t)(uintptr_t)&gdt_pointer);
+}
@@ -0,0 +1,279 @@
+/*
+ * kernel/drivers/apic.c - Local APIC and I/O APIC
+ *
+ * Enabling the local APIC, EOI, self-IPIs, the LAPIC timer, and
+ * programming I/O APIC redirection entries. Multi-CPU IPIs build on
+ * these registers later.
+ *
+ * References:
+ *   - Intel SDM Vol 3, Section 10.4: Local APIC
+ *   - Intel 82093AA I/O APIC datasheet, Section 3.2
+ */
+
+#include <apic.h>
+
+/*
+ * ioapic_redir_entry - Build a redirection table entry
+ *
+ * Low dword: vector[7:0], delivery mode[10:8] = 0 (fixed), destination
+ * mode[11] = 0 (physical), polarity[13], trigger[15], mask[16].
+ * High dword: destination APIC ID in bits 24-31.
+ */
+uint64_t ioapic_redir_entry(uint8_t vector, uint8_t dest, uint32_t flags)
+{
+    uint32_t low = vector | (flags & (IOAPIC_ACTIVE_LOW | IOAPIC_LEVEL |
+                                      IOAPIC_MASKED));
+    uint32_t high = (uint32_t)dest << 24;
+
+    return ((uint64_t)high << 32) | low;
+}
+
+/*
+ * Everything below touches hardware. Host tests only need the
+ * redirection entry encoder.
+ */
+#ifndef HOST_TEST
+
+#include <asm.h>
+#include <errno.h>
+#include <ktime.h>
+
+static volatile uint32_t *lapic_base;
+static volatile uint32_t *ioapic_base;
+static uint32_t ioapic_npins;
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return lapic_base[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic_base[reg / 4] = value;
+}
+
+static inline uint32_t ioapic_read(uint32_t reg)
+{
+    ioapic_base[IOAPIC_REGSEL / 4] = reg;
+    return ioapic_base[IOAPIC_WIN / 4];
+}
+
+static inline void ioapic_write(uint32_t reg, uint32_t value)
+{
+    ioapic_base[IOAPIC_REGSEL / 4] = reg;
+    ioapic_base[IOAPIC_WIN / 4] = value;
+}
+
+/*
+ * lapic_present - Check CPUID for an on-chip local APIC
+ *
+ * The APIC base MSR is needed too, so require MSR support as well.
+ */
+bool lapic_present(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    return (edx & CPUID_EDX_APIC) && (edx & CPUID_EDX_MSR);
+}
+
+/*
+ * lapic_init - Enable this CPU's local APIC
+ *
+ * The base comes from IA32_APIC_BASE rather than being assumed, since
+ * firmware may relocate it.
+ */
+int lapic_init(void)
+{
+    uint64_t msr;
+
+    if (!lapic_present()) {
+        return -ENODEV;
+    }
+
+    msr = rdmsr(MSR_APIC_BASE);
+    if (!(msr & APIC_BASE_ENABLE)) {
+        wrmsr(MSR_APIC_BASE, msr | APIC_BASE_ENABLE);
+    }
+    lapic_base = (volatile uint32_t *)(uintptr_t)(msr & APIC_BASE_ADDR_MASK);
+
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+
+    /* Clear stale errors (ESR needs a write before it is read) */
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_ESR, 0);
+
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+
+    /* Drop anything left in service by firmware */
+    lapic_eoi();
+
+    return 0;
+}
+
+/*
+ * lapic_id - This CPU's local APIC ID
+ */
+uint8_t lapic_id(void)
+{
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/*
+ * lapic_eoi - Acknowledge the highest-priority in-service interrupt
+ *
+ * The value written is ignored; this is one uncached store.
+ */
+void lapic_eoi(void)
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/*
+ * lapic_send_self_ipi - Raise a fixed interrupt on this CPU
+ */
+void lapic_send_self_ipi(uint8_t vector)
+{
+    lapic_write(LAPIC_ICR_HIGH, 0);
+    lapic_write(LAPIC_ICR_LOW, LAPIC_ICR_SELF | vector);
+
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        /* spin */
+    }
+}
+
+/*
+ * lapic_timer_calibrate - Measure the LAPIC timer rate against the TSC
+ *
+ * Counts down from the maximum over 10 ms of TSC time. The TSC is only
+ * used across this short window, so it need not be invariant.
+ */
+uint32_t lapic_timer_calibrate(void)
+{
+    uint64_t start, wait;
+    uint32_t elapsed;
+
+    if (lapic_base == NULL || tsc_khz == 0) {
+        return 0;
+    }
+
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+
+    wait = (uint64_t)tsc_khz * 10;
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    start = rdtsc();
+    while (rdtsc() - start < wait) {
+        /* spin */
+    }
+    elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    return elapsed / 10;
+}
+
+/*
+ * lapic_timer_periodic - Fire @vector every @count timer ticks
+ *
+ * The LVT entry is written before the initial count, which starts the
+ * timer.
+ */
+void lapic_timer_periodic(uint8_t vector, uint32_t count)
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | vector);
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+/*
+ * lapic_timer_oneshot - Fire @vector once after @count timer ticks
+ */
+void lapic_timer_oneshot(uint8_t vector, uint32_t count)
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, vector);
+    lapic_write(LAPIC_TIMER_INIT, count ? count : 1);
+}
+
+/*
+ * lapic_timer_stop - Stop and mask the timer
+ *
+ * Writing an initial count of 0 stops the countdown.
+ */
+void lapic_timer_stop(void)
+{
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+/*
+ * ioapic_init - Probe an I/O APIC and mask all its pins
+ *
+ * An absent device reads back as all ones on the bus.
+ */
+int ioapic_init(uintptr_t base)
+{
+    uint32_t ver;
+    uint32_t pin;
+
+    ioapic_base = (volatile uint32_t *)base;
+    ver = ioapic_read(IOAPIC_REG_VER);
+    if (ver == 0xFFFFFFFF || ver == 0) {
+        ioapic_base = NULL;
+        ioapic_npins = 0;
+        return -ENODEV;
+    }
+
+    ioapic_npins = ((ver >> 16) & 0xFF) + 1;
+    for (pin = 0; pin < ioapic_npins; pin++) {
+        ioapic_route(pin, ioapic_redir_entry(0, 0, IOAPIC_MASKED));
+    }
+
+    return 0;
+}
+
+/*
+ * ioapic_pins - Number of redirection entries
+ */
+uint32_t ioapic_pins(void)
+{
+    return ioapic_npins;
+}
+
+/*
+ * ioapic_route - Program a pin's redirection entry
+ *
+ * The high dword (destination) goes first so the entry is never live
+ * with a stale destination; the low dword carries the mask bit.
+ */
+void ioapic_route(uint8_t pin, uint64_t entry)
+{
+    ioapic_write(IOAPIC_REDTBL(pin) + 1, (uint32_t)(entry >> 32));
+    ioapic_write(IOAPIC_REDTBL(pin), (uint32_t)entry);
+}
+
+/*
+ * ioapic_mask - Set a pin's mask bit
+ */
+void ioapic_mask(uint8_t pin)
+{
+    uint32_t low = ioapic_read(IOAPIC_REDTBL(pin));
+
+    ioapic_write(IOAPIC_REDTBL(pin), low | IOAPIC_MASKED);
+}
+
+/*
+ * ioapic_unmask - Clear a pin's mask bit
+ */
+void ioapic_unmask(uint8_t pin)
+{
+    uint32_t low = ioapic_read(IOAPIC_REDTBL(pin));
+
+    ioapic_write(IOAPIC_REDTBL(pin), low & ~IOAPIC_MASKED);
+}
+
+#endif /* !HOST_TEST */
@@ -0,0 +1,72 @@
+/*
+ * kernel/drivers/debugcon.c - QEMU/Bochs debug console (port 0xE9)
+ *
+ * Output only: each byte is a single outb, which QEMU hands to the
+ * chardev without emulating any transmitter timing. There is nothing
+ * to wait for, so the console needs no queue and no interrupt, and
+ * prints the same way before and after a panic.
+ */
+
+#include <debugcon.h>
+#include <console.h>
+#include <printk.h>
+#include <asm.h>
+#include <errno.h>
+
+static bool present;
+
+static void debugcon_console_write(struct console *con, const char *text,
+                                   size_t len);
+
+static struct console debugcon_console = {
+    .name = "debugcon",
+    .write = debugcon_console_write,
+    .level = LOG_DEBUG,
+    .enabled = true,
+};
+
+/*
+ * debugcon_console_write - Console write(): send a record to port 0xE9
+ */
+static void debugcon_console_write(struct console *con, const char *text,
+                                   size_t len)
+{
+    (void)con;
+    debugcon_write(text, len);
+}
+
+/*
+ * debugcon_init - Register the debug console if the port is there
+ */
+int debugcon_init(void)
+{
+    if (inb(DEBUGCON_PORT) != DEBUGCON_READBACK) {
+        return -ENODEV;
+    }
+    present = true;
+    return console_register(&debugcon_console);
+}
+
+/*
+ * debugcon_present - Whether debugcon_init() found the port
+ */
+bool debugcon_present(void)
+{
+    return present;
+}
+
+/*
+ * debugcon_write - Write raw bytes to the debug console
+ */
+void debugcon_write(const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    size_t i;
+
+    if (!present) {
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        outb(DEBUGCON_PORT, p[i]);
+    }
+}
@@ -0,0 +1,504 @@
+/*
+ * kernel/drivers/fbcon.c - Framebuffer text console
+ *
+ * The screen is a grid of cells, each a character and VGA attribute
+ * like a text-mode cell, kept in a ring of rows so a scroll only moves
+ * the top row index. Each row tracks a dirty column span. fbcon_flush()
+ * first moves the framebuffer up by the lines scrolled since the last
+ * flush, in one pass, then draws the dirty spans.
+ *
+ * A cell is drawn by copying its glyph from the glyph cache: each of
+ * FBCON_CACHE_ATTRS attribute slots holds the 256 glyphs rendered to
+ * 32-bit pixels in one color pair, filled in the first time a glyph is
+ * drawn. Drawing is then 16 rows of 8 pixels copied a machine word at
+ * a time; clearing fills whole scan lines the same way.
+ *
+ * Only the drain writes, one record at a time (see console.h), so no
+ * locking is needed.
+ */
+
+#include <fbcon.h>
+#include <vga.h>
+#include <vbe.h>
+#include <errno.h>
+
+#ifndef HOST_TEST
+#include <console.h>
+#include <printk.h>
+#endif
+
+/*
+ * =============================================================================
+ * Private State
+ * =============================================================================
+ */
+
+#define GLYPH_W         VBE_FONT_WIDTH
+#define GLYPH_H         VBE_FONT_HEIGHT
+#define GLYPH_PIXELS    (GLYPH_W * GLYPH_H)
+
+/* The unit fills and copies use: a machine word, aliasing the pixels */
+typedef unsigned long __attribute__((may_alias)) fb_word_t;
+#define PIXELS_PER_WORD (sizeof(fb_word_t) / sizeof(uint32_t))
+#define GLYPH_ROW_WORDS (GLYPH_W / PIXELS_PER_WORD)
+
+/* Standard VGA palette as 0xRRGGBB */
+static const uint32_t vga_rgb[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA,
+    0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF,
+    0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+static struct fb_info fb;
+static bool active;
+static uint32_t palette[16];            /* vga_rgb[] in the pixel layout */
+
+/* Text grid: screen row r is slot (top + r) % rows */
+static uint16_t cells[FBCON_MAX_ROWS][FBCON_MAX_COLS];
+static uint32_t cols, rows;
+static uint32_t top;
+
+/* Columns [dirty_lo, dirty_hi) of each slot are not drawn yet */
+static uint16_t dirty_lo[FBCON_MAX_ROWS];
+static uint16_t dirty_hi[FBCON_MAX_ROWS];
+
+/* Rows scrolled since the framebuffer was last moved */
+static uint32_t pending_scroll;
+
+static uint32_t cursor_row, cursor_col;
+static uint8_t current_attr = VGA_COLOR_DEFAULT;
+
+/* Glyph cache: rendered glyphs per attribute slot */
+static uint32_t glyphs[FBCON_CACHE_ATTRS][256][GLYPH_PIXELS]
+    __attribute__((aligned(sizeof(fb_word_t))));
+static uint32_t glyph_valid[FBCON_CACHE_ATTRS][256 / 32];
+static uint16_t glyph_attr[FBCON_CACHE_ATTRS];  /* 0x100 = slot unused */
+static uint32_t glyph_last;             /* Slot used most recently */
+
+/*
+ * =============================================================================
+ * Private Helper Functions
+ * =============================================================================
+ */
+
+/*
+ * rgb_to_pixel - Convert 0xRRGGBB to the framebuffer's pixel layout
+ */
+static uint32_t rgb_to_pixel(uint32_t rgb)
+{
+    uint32_t r = (rgb >> 16) & 0xFF;
+    uint32_t g = (rgb >> 8) & 0xFF;
+    uint32_t b = rgb & 0xFF;
+
+    return ((r >> (8 - fb.red_size)) << fb.red_pos) |
+           ((g >> (8 - fb.green_size)) << fb.green_pos) |
+           ((b >> (8 - fb.blue_size)) << fb.blue_pos);
+}
+
+/*
+ * fill_word - A machine word of @pixel repeated
+ */
+static inline fb_word_t fill_word(uint32_t pixel)
+{
+    fb_word_t word = 0;
+
+    for (uint32_t i = 0; i < PIXELS_PER_WORD; i++) {
+        word = (word << 16 << 16) | pixel;
+    }
+    return word;
+}
+
+/*
+ * fill_lines - Fill scan lines [first, first + count) with @pixel
+ *
+ * Covers the whole width, including any columns the text grid leaves.
+ */
+static void fill_lines(uint32_t first, uint32_t count, uint32_t pixel)
+{
+    fb_word_t word = fill_word(pixel);
+    uint32_t words = fb.width / PIXELS_PER_WORD;
+
+    for (uint32_t y = first; y < first + count; y++) {
+        volatile fb_word_t *dst = (volatile fb_word_t *)(fb.base + y * fb.pitch);
+        volatile uint32_t *tail = (volatile uint32_t *)dst;
+
+        for (uint32_t i = 0; i < words; i++) {
+            dst[i] = word;
+        }
+        for (uint32_t x = words * PIXELS_PER_WORD; x < fb.width; x++) {
+            tail[x] = pixel;
+        }
+    }
+}
+
+/*
+ * glyph_get - Pixels of character @c in attribute @attr
+ *
+ * Renders the glyph into the cache on first use. An attribute with no
+ * slot takes the slot used least recently, dropping its glyphs.
+ */
+static const uint32_t *glyph_get(uint8_t c, uint8_t attr)
+{
+    uint32_t slot, *pixels;
+    const uint8_t *bits;
+
+    for (slot = 0; slot < FBCON_CACHE_ATTRS; slot++) {
+        if (glyph_attr[slot] == attr) {
+            break;
+        }
+    }
+    if (slot == FBCON_CACHE_ATTRS) {
+        slot = (glyph_last + 1) % FBCON_CACHE_ATTRS;
+        glyph_attr[slot] = attr;
+        for (uint32_t i = 0; i < 256 / 32; i++) {
+            glyph_valid[slot][i] = 0;
+        }
+    }
+    glyph_last = slot;
+
+    pixels = glyphs[slot][c];
+    if (glyph_valid[slot][c / 32] & (1U << (c % 32))) {
+        return pixels;
+    }
+
+    bits = &fb.font[c * GLYPH_H];
+    for (uint32_t y = 0; y < GLYPH_H; y++) {
+        for (uint32_t x = 0; x < GLYPH_W; x++) {
+            pixels[y * GLYPH_W + x] = (bits[y] & (0x80 >> x)) ?
+                palette[attr & 0x0F] : palette[attr >> 4];
+        }
+    }
+    glyph_valid[slot][c / 32] |= 1U << (c % 32);
+    return pixels;
+}
+
+/*
+ * draw_cell - Draw a cell at screen position (@row, @col)
+ */
+static void draw_cell(uint32_t row, uint32_t col, uint16_t cell)
+{
+    const fb_word_t *src = (const fb_word_t *)glyph_get(cell & 0xFF,
+                                                        cell >> 8);
+    uint8_t *line = fb.base + row * GLYPH_H * fb.pitch +
+                    col * GLYPH_W * sizeof(uint32_t);
+
+    for (uint32_t y = 0; y < GLYPH_H; y++) {
+        volatile fb_word_t *dst = (volatile fb_word_t *)line;
+
+        for (uint32_t i = 0; i < GLYPH_ROW_WORDS; i++) {
+            dst[i] = src[i];
+        }
+        src += GLYPH_ROW_WORDS;
+        line += fb.pitch;
+    }
+}
+
+/*
+ * move_up - Move the text area of the framebuffer up by @lines rows
+ */
+static void move_up(uint32_t lines)
+{
+    uint32_t shift = lines * GLYPH_H;
+    uint32_t words = cols * GLYPH_W / PIXELS_PER_WORD;
+
+    for (uint32_t y = 0; y + shift < rows * GLYPH_H; y++) {
+        volatile fb_word_t *dst = (volatile fb_word_t *)(fb.base + y * fb.pitch);
+        volatile fb_word_t *src = (volatile fb_word_t *)
+            (fb.base + (y + shift) * fb.pitch);
+
+        for (uint32_t i = 0; i < words; i++) {
+            dst[i] = src[i];
+        }
+    }
+}
+
+/*
+ * slot_of - Slot holding screen row @row
+ */
+static inline uint32_t slot_of(uint32_t row)
+{
+    uint32_t slot = top + row;
+
+    return slot >= rows ? slot - rows : slot;
+}
+
+/*
+ * mark_dirty - Note that columns [lo, hi) of a slot changed
+ */
+static inline void mark_dirty(uint32_t slot, uint32_t lo, uint32_t hi)
+{
+    if (dirty_lo[slot] >= dirty_hi[slot]) {
+        dirty_lo[slot] = (uint16_t)lo;
+        dirty_hi[slot] = (uint16_t)hi;
+        return;
+    }
+    if (lo < dirty_lo[slot]) {
+        dirty_lo[slot] = (uint16_t)lo;
+    }
+    if (hi > dirty_hi[slot]) {
+        dirty_hi[slot] = (uint16_t)hi;
+    }
+}
+
+/*
+ * clear_slot - Fill a slot with blanks in the current attribute
+ */
+static void clear_slot(uint32_t slot)
+{
+    uint16_t blank = (uint16_t)(current_attr << 8) | ' ';
+
+    for (uint32_t col = 0; col < cols; col++) {
+        cells[slot][col] = blank;
+    }
+    mark_dirty(slot, 0, cols);
+}
+
+/*
+ * scroll - Scroll the grid up one row; the framebuffer follows at flush
+ */
+static void scroll(void)
+{
+    clear_slot(top);
+    top = top + 1 == rows ? 0 : top + 1;
+    if (pending_scroll < rows) {
+        pending_scroll++;
+    }
+    cursor_row = rows - 1;
+}
+
+/*
+ * put - Put a character into the grid, without drawing
+ */
+static void put(char c)
+{
+    if (c == '\n') {
+        cursor_col = 0;
+        cursor_row++;
+    } else if (c == '\r') {
+        cursor_col = 0;
+    } else {
+        uint32_t slot = slot_of(cursor_row);
+
+        cells[slot][cursor_col] = (uint16_t)(current_attr << 8) | (uint8_t)c;
+        mark_dirty(slot, cursor_col, cursor_col + 1);
+        if (++cursor_col == cols) {
+            cursor_col = 0;
+            cursor_row++;
+        }
+    }
+
+    if (cursor_row == rows) {
+        scroll();
+    }
+}
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * fbcon_setup - Start drawing on a framebuffer
+ */
+int fbcon_setup(const struct fb_info *info)
+{
+    if (info->font == NULL || info->width < GLYPH_W ||
+        info->height < GLYPH_H) {
+        return -EINVAL;
+    }
+
+    fb = *info;
+    cols = fb.width / GLYPH_W;
+    rows = fb.height / GLYPH_H;
+    if (cols > FBCON_MAX_COLS) {
+        cols = FBCON_MAX_COLS;
+    }
+    if (rows > FBCON_MAX_ROWS) {
+        rows = FBCON_MAX_ROWS;
+    }
+
+    for (uint32_t i = 0; i < 16; i++) {
+        palette[i] = rgb_to_pixel(vga_rgb[i]);
+    }
+    for (uint32_t slot = 0; slot < FBCON_CACHE_ATTRS; slot++) {
+        glyph_attr[slot] = 0x100;
+    }
+
+    /* Black outside the grid too */
+    fill_lines(0, fb.height, palette[VGA_COLOR_BLACK]);
+    active = true;
+    fbcon_clear();
+    return 0;
+}
+
+/*
+ * fbcon_active - Whether output goes to a framebuffer
+ */
+bool fbcon_active(void)
+{
+    return active;
+}
+
+/*
+ * fbcon_cols - Characters per line
+ */
+uint32_t fbcon_cols(void)
+{
+    return cols;
+}
+
+/*
+ * fbcon_rows - Lines on screen
+ */
+uint32_t fbcon_rows(void)
+{
+    return rows;
+}
+
+/*
+ * fbcon_set_attr - Set the attribute of characters written from now on
+ */
+void fbcon_set_attr(uint8_t attr)
+{
+    current_attr = attr;
+}
+
+/*
+ * fbcon_write - Print a buffer of characters
+ */
+void fbcon_write(const char *buf, size_t len)
+{
+    if (!active) {
+        return;
+    }
+    while (len--) {
+        put(*buf++);
+    }
+    fbcon_flush();
+}
+
+/*
+ * fbcon_flush - Draw everything printed so far
+ */
+void fbcon_flush(void)
+{
+    if (!active) {
+        return;
+    }
+
+    /* Whole screen scrolled away: the dirty spans redraw it all */
+    if (pending_scroll > 0 && pending_scroll < rows) {
+        move_up(pending_scroll);
+    }
+    pending_scroll = 0;
+
+    for (uint32_t row = 0; row < rows; row++) {
+        uint32_t slot = slot_of(row);
+
+        for (uint32_t col = dirty_lo[slot]; col < dirty_hi[slot]; col++) {
+            draw_cell(row, col, cells[slot][col]);
+        }
+        dirty_lo[slot] = 0;
+        dirty_hi[slot] = 0;
+    }
+}
+
+/*
+ * fbcon_clear - Clear the screen in the current attribute's background
+ */
+void fbcon_clear(void)
+{
+    uint16_t blank = (uint16_t)(current_attr << 8) | ' ';
+
+    if (!active) {
+        return;
+    }
+
+    for (uint32_t slot = 0; slot < rows; slot++) {
+        for (uint32_t col = 0; col < cols; col++) {
+            cells[slot][col] = blank;
+        }
+        dirty_lo[slot] = 0;
+        dirty_hi[slot] = 0;
+    }
+    top = 0;
+    pending_scroll = 0;
+    cursor_row = 0;
+    cursor_col = 0;
+
+    fill_lines(0, rows * GLYPH_H, palette[current_attr >> 4]);
+}
+
+#ifndef HOST_TEST
+
+/*
+ * =============================================================================
+ * Console
+ * =============================================================================
+ */
+
+extern uint32_t boot_vbe_ptr;
+
+static void fbcon_console_write(struct console *con, const char *text,
+                                size_t len)
+{
+    (void)con;
+    while (len--) {
+        put(*text++);
+    }
+}
+
+static void fbcon_console_flush(struct console *con)
+{
+    (void)con;
+    fbcon_flush();
+}
+
+/* printk() sink; prints every level until told otherwise */
+static struct console fbcon_console = {
+    .name = "fb",
+    .write = fbcon_console_write,
+    .flush = fbcon_console_flush,
+    .level = LOG_DEBUG,
+    .enabled = true,
+};
+
+/*
+ * fbcon_init - Take over the display if stage 2 set a framebuffer mode
+ */
+int fbcon_init(void)
+{
+    const struct vbe_mode_info *mode;
+    struct fb_info info;
+    int ret;
+
+    if (boot_vbe_ptr == 0) {
+        return -ENODEV;
+    }
+    mode = (const struct vbe_mode_info *)(uintptr_t)boot_vbe_ptr;
+    if (mode->bpp != 32 || !(mode->attributes & VBE_ATTR_LFB)) {
+        return -ENODEV;
+    }
+
+    info.base = (uint8_t *)(uintptr_t)mode->framebuffer;
+    info.pitch = mode->pitch;
+    info.width = mode->width;
+    info.height = mode->height;
+    info.red_pos = mode->red_pos;
+    info.red_size = mode->red_size;
+    info.green_pos = mode->green_pos;
+    info.green_size = mode->green_size;
+    info.blue_pos = mode->blue_pos;
+    info.blue_size = mode->blue_size;
+    info.font = (const uint8_t *)VBE_FONT_ADDR;
+
+    ret = fbcon_setup(&info);
+    if (ret < 0) {
+        return ret;
+    }
+    return console_register(&fbcon_console);
+}
+
+#endif /* !HOST_TEST */
@@ -0,0 +1,96 @@
+/*
+ * kernel/drivers/pic.c - 8259A Programmable Interrupt Controller
+ *
+ * The BIOS leaves the master PIC on vectors 8-15, which collide with
+ * CPU exceptions, so the chips are always reinitialized: either as the
+ * interrupt controller (no local APIC) or just to be remapped and
+ * silenced before the IOAPIC takes over.
+ *
+ * References:
+ *   - Intel 8259A datasheet, Initialization Command Words
+ */
+
+#include <pic.h>
+#include <asm.h>
+
+/* Cached masks, so mask/unmask need no read back from the chip */
+static uint8_t pic1_mask = 0xFF;
+static uint8_t pic2_mask = 0xFF;
+
+/*
+ * pic_init - Remap both PICs and mask every line
+ *
+ * ICW1-ICW4 must be written in order to each chip:
+ *   ICW1: start init, cascade mode, ICW4 follows
+ *   ICW2: vector offset
+ *   ICW3: master - bitmask of slave lines; slave - its cascade identity
+ *   ICW4: 8086 mode
+ */
+void pic_init(uint8_t vector_base)
+{
+    outb(PIC1_CMD, PIC_ICW1_INIT);
+    io_wait();
+    outb(PIC2_CMD, PIC_ICW1_INIT);
+    io_wait();
+
+    outb(PIC1_DATA, vector_base);
+    io_wait();
+    outb(PIC2_DATA, vector_base + 8);
+    io_wait();
+
+    outb(PIC1_DATA, 1 << PIC_CASCADE_IRQ);
+    io_wait();
+    outb(PIC2_DATA, PIC_CASCADE_IRQ);
+    io_wait();
+
+    outb(PIC1_DATA, PIC_ICW4_8086);
+    io_wait();
+    outb(PIC2_DATA, PIC_ICW4_8086);
+    io_wait();
+
+    pic1_mask = 0xFF;
+    pic2_mask = 0xFF;
+    outb(PIC1_DATA, pic1_mask);
+    outb(PIC2_DATA, pic2_mask);
+}
+
+/*
+ * pic_mask - Disable one IRQ line
+ */
+void pic_mask(uint8_t irq)
+{
+    if (irq < 8) {
+        pic1_mask |= 1 << irq;
+        outb(PIC1_DATA, pic1_mask);
+    } else {
+        pic2_mask |= 1 << (irq - 8);
+        outb(PIC2_DATA, pic2_mask);
+    }
+}
+
+/*
+ * pic_unmask - Enable one IRQ line
+ */
+void pic_unmask(uint8_t irq)
+{
+    if (irq < 8) {
+        pic1_mask &= ~(1 << irq);
+        outb(PIC1_DATA, pic1_mask);
+    } else {
+        pic2_mask &= ~(1 << (irq - 8));
+        outb(PIC2_DATA, pic2_mask);
+        pic1_mask &= ~(1 << PIC_CASCADE_IRQ);
+        outb(PIC1_DATA, pic1_mask);
+    }
+}
+
+/*
+ * pic_eoi - Acknowledge an IRQ
+ */
+void pic_eoi(uint8_t irq)
+{
+    if (irq >= 8) {
+        outb(PIC2_CMD, PIC_EOI);
+    }
+    outb(PIC1_CMD, PIC_EOI);
+}
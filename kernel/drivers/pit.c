@@ -0,0 +1,102 @@
+/*
+ * kernel/drivers/pit.c - 8253/8254 Programmable Interval Timer
+ *
+ * Polled use only; the PIT's IRQ 0 stays masked.
+ *
+ * References:
+ *   - Intel 8254 datasheet
+ */
+
+#include <pit.h>
+#include <asm.h>
+
+/* Safety bound on the channel 2 poll loop (far longer than 55 ms) */
+#define PIT_POLL_LIMIT  100000000U
+
+static uint16_t ch0_last;
+static uint64_t ch0_ticks;
+
+/*
+ * pit_measure_tsc - Count TSC cycles over a channel 2 countdown
+ *
+ * Mode 0 drives OUT2 low when the count is loaded and high when it
+ * reaches zero, which is polled through port 0x61. The TSC is read
+ * right after raising the gate and right after OUT2 goes high, so the
+ * port I/O on either side is about equal and cancels out.
+ */
+uint64_t pit_measure_tsc(uint16_t ticks)
+{
+    uint8_t gate;
+    uint64_t start, end;
+    uint32_t spins = 0;
+
+    /* Gate off, speaker off while programming */
+    gate = inb(PIT_GATE) & ~(PIT_GATE_CH2 | PIT_SPEAKER);
+    outb(PIT_GATE, gate);
+
+    outb(PIT_CMD, PIT_SEL_CH2 | PIT_ACCESS_LOHI | PIT_MODE0);
+    outb(PIT_CH2, ticks & 0xFF);
+    outb(PIT_CH2, ticks >> 8);
+
+    /* Rising gate edge starts the countdown */
+    outb(PIT_GATE, gate | PIT_GATE_CH2);
+    start = rdtsc();
+
+    while (!(inb(PIT_GATE) & PIT_OUT_CH2)) {
+        if (++spins == PIT_POLL_LIMIT) {
+            outb(PIT_GATE, gate);
+            return 0;
+        }
+    }
+    end = rdtsc();
+
+    outb(PIT_GATE, gate);
+    return end - start;
+}
+
+/*
+ * read_ch0 - Latch and read channel 0's current count
+ */
+static uint16_t read_ch0(void)
+{
+    uint8_t low, high;
+
+    outb(PIT_CMD, PIT_SEL_CH0 | PIT_LATCH);
+    low = inb(PIT_CH0);
+    high = inb(PIT_CH0);
+    return ((uint16_t)high << 8) | low;
+}
+
+/*
+ * pit_clocksource_init - Start channel 0 as a free-running counter
+ *
+ * Mode 2 with a reload of 0 (65536) counts down continuously.
+ */
+void pit_clocksource_init(void)
+{
+    outb(PIT_CMD, PIT_SEL_CH0 | PIT_ACCESS_LOHI | PIT_MODE2);
+    outb(PIT_CH0, 0);
+    outb(PIT_CH0, 0);
+
+    ch0_ticks = 0;
+    ch0_last = read_ch0();
+}
+
+/*
+ * pit_read_ticks - Ticks since pit_clocksource_init(), extended to 64 bits
+ *
+ * The counter counts down, so elapsed ticks are last - now modulo 2^16.
+ */
+uint64_t pit_read_ticks(void)
+{
+    unsigned long flags = irq_save();
+    uint16_t now = read_ch0();
+    uint64_t ticks;
+
+    ch0_ticks += (uint16_t)(ch0_last - now);
+    ch0_last = now;
+    ticks = ch0_ticks;
+
+    irq_restore(flags);
+    return ticks;
+}
@@ -1,84 +1,744 @@
 /*
  * kernel/drivers/serial.c - Serial Port (UART) Driver Implementation
  *
- * Implements polling-based serial I/O on COM1 for kernel debug output.
- * Uses the 16550A UART interface available on standard PC hardware.
+ * Implements serial I/O on the 8250/16550A UARTs available on standard
+ * PC hardware. Kernel debug output goes to COM1, the console.
  *
- * This driver is intentionally simple:
- *   - Polling-based (no interrupts) for reliability during early boot
- *   - Output only (no input handling yet)
- *   - Single port (COM1) hardcoded
+ *   - Output is polled during early boot, so it works before interrupts
+ *   - Interrupt-driven output after serial_irq_init(): writers fill a
+ *     port's TX ring, and each transmitter-empty interrupt moves up to
+ *     one FIFO load (16 bytes on a 16550A) from the ring to the UART
+ *   - Console output is polled again from panic(), via serial_set_sync()
+ *   - Input on every port in use: each received-data interrupt empties
+ *     the UART's FIFO into that port's RX ring
  *
- * The polling approach ensures output works even before interrupts are
- * enabled, making it suitable for debug output during all boot stages.
+ * Even at 115200 baud a byte takes ~87 us on the wire; polling made
+ * every printk line cost milliseconds of CPU time.
+ *
+ * The rings are only touched with interrupts disabled. head and tail
+ * run freely and are masked on access.
+ *
+ * The RX ring code has no hardware dependencies and is unit-tested on
+ * the host.
  */
 
 #include <serial.h>
+#include <errno.h>
+
+/*
+ * serial_rx_ring_init - Empty a ring
+ */
+void serial_rx_ring_init(struct serial_rx_ring *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->lines = 0;
+    ring->last_cr = false;
+}
+
+/*
+ * serial_rx_ring_put - Queue one received byte
+ *
+ * Terminals send CR for Enter, some CR LF; both become one LF.
+ */
+bool serial_rx_ring_put(struct serial_rx_ring *ring, uint8_t c)
+{
+    if (c == '\n' && ring->last_cr) {
+        ring->last_cr = false;
+        return true;
+    }
+    ring->last_cr = c == '\r';
+    if (c == '\r') {
+        c = '\n';
+    }
+
+    if (ring->head - ring->tail == SERIAL_RX_RING_SIZE) {
+        return false;
+    }
+    ring->buf[ring->head++ & (SERIAL_RX_RING_SIZE - 1)] = c;
+    if (c == '\n') {
+        ring->lines++;
+    }
+    return true;
+}
+
+/*
+ * serial_rx_ring_count - Bytes queued
+ */
+uint32_t serial_rx_ring_count(const struct serial_rx_ring *ring)
+{
+    return ring->head - ring->tail;
+}
+
+/*
+ * serial_rx_ring_read - Dequeue up to @len bytes
+ */
+size_t serial_rx_ring_read(struct serial_rx_ring *ring, void *buf,
+                           size_t len)
+{
+    uint8_t *p = (uint8_t *)buf;
+    size_t n = 0;
+    uint8_t c;
+
+    while (n < len && ring->tail != ring->head) {
+        c = ring->buf[ring->tail++ & (SERIAL_RX_RING_SIZE - 1)];
+        if (c == '\n') {
+            ring->lines--;
+        }
+        p[n++] = c;
+    }
+    return n;
+}
+
+/*
+ * serial_rx_ring_getline - Dequeue one line
+ *
+ * Also returns a piece as soon as @size - 1 bytes are queued, since the
+ * line is then known not to fit. The LF right after a piece that fills
+ * @buf is consumed with it, so a line of exactly @size - 1 bytes is
+ * not followed by an empty one.
+ */
+int serial_rx_ring_getline(struct serial_rx_ring *ring, char *buf,
+                           size_t size)
+{
+    uint32_t count = serial_rx_ring_count(ring);
+    size_t n = 0;
+    uint8_t c;
+
+    if (size == 0) {
+        return -EINVAL;
+    }
+    if (ring->lines == 0 && count < SERIAL_RX_RING_SIZE &&
+        count < size - 1) {
+        return -EAGAIN;
+    }
+
+    while (ring->tail != ring->head) {
+        c = ring->buf[ring->tail & (SERIAL_RX_RING_SIZE - 1)];
+        if (c == '\n') {
+            ring->tail++;
+            ring->lines--;
+            break;
+        }
+        if (n == size - 1) {
+            break;
+        }
+        buf[n++] = (char)c;
+        ring->tail++;
+    }
+    buf[n] = '\0';
+    return (int)n;
+}
+
+/*
+ * Everything below drives the UARTs. Host tests drive a struct
+ * serial_rx_ring directly.
+ */
+#ifndef HOST_TEST
+
+#include <irq.h>
+#include <tick.h>
 #include <asm.h>
+#include <printk.h>
+#include <console.h>
+
+/* Where each COM port is wired on a PC */
+static const struct {
+    uint16_t base;
+    uint8_t irq;
+} port_hw[SERIAL_PORTS] = {
+    [SERIAL_COM1] = { COM1_PORT, IRQ_COM1 },
+    [SERIAL_COM2] = { COM2_PORT, IRQ_COM2 },
+    [SERIAL_COM3] = { COM3_PORT, IRQ_COM1 },
+    [SERIAL_COM4] = { COM4_PORT, IRQ_COM2 },
+};
+
+static struct serial_port ports[SERIAL_PORTS];
+
+/* The console is COM1 */
+static struct serial_port *const console = &ports[SERIAL_COM1];
+static bool console_sync = true;        /* Poll console output */
+
+static bool irq_ready;                  /* serial_irq_init() has run */
+static uint32_t irq_lines;              /* IRQs requested, by bit */
+
+static void serial_console_write(struct console *con, const char *text,
+                                 size_t len);
+
+/* printk() sinks, one per port; COM1's is registered by serial_init() */
+static struct console serial_consoles[SERIAL_PORTS] = {
+    [SERIAL_COM1] = { .name = "com1", .write = serial_console_write },
+    [SERIAL_COM2] = { .name = "com2", .write = serial_console_write },
+    [SERIAL_COM3] = { .name = "com3", .write = serial_console_write },
+    [SERIAL_COM4] = { .name = "com4", .write = serial_console_write },
+};
 
 /*
- * serial_init - Initialize COM1 for serial communication
+ * baud_divisor - Divisor latch value for a baud rate
+ *
+ * Returns: The divisor, or 0 if @baud is not SERIAL_BASE_BAUD / n
+ */
+static uint32_t baud_divisor(uint32_t baud)
+{
+    if (baud == 0 || baud > SERIAL_BASE_BAUD ||
+        SERIAL_BASE_BAUD % baud != 0) {
+        return 0;
+    }
+    return SERIAL_BASE_BAUD / baud;
+}
+
+/*
+ * port_set_divisor - Program the divisor latch, keeping 8N1
+ */
+static void port_set_divisor(struct serial_port *p, uint32_t divisor)
+{
+    outb(p->base + SERIAL_LINE_CTRL, SERIAL_LCR_DLAB);
+    outb(p->base + SERIAL_DIV_LSB, (uint8_t)divisor);
+    outb(p->base + SERIAL_DIV_MSB, (uint8_t)(divisor >> 8));
+    outb(p->base + SERIAL_LINE_CTRL, SERIAL_LCR_8N1);
+}
+
+/*
+ * port_configure - Program a UART for 8N1 at @baud
  *
  * Initialization sequence:
  *   1. Disable all UART interrupts
- *   2. Enable DLAB to set baud rate divisor
- *   3. Set divisor for 38400 baud
- *   4. Clear DLAB and configure 8N1
- *   5. Enable and clear FIFOs
- *   6. Set modem control lines (DTR, RTS, OUT2)
+ *   2. Set the baud rate divisor (DLAB on, then off again for 8N1)
+ *   3. Enable and clear FIFOs
+ *   4. Size the TX FIFO: IIR bits 7:6 read 11 only on a 16550A, whose
+ *      FIFO works; older parts send one byte per TX-empty
+ *   5. Set modem control lines (DTR, RTS, OUT2)
  */
-void serial_init(void)
+static void port_configure(struct serial_port *p, uint32_t baud)
 {
     /* Disable all interrupts */
-    outb(COM1_PORT + SERIAL_INT_ENABLE, 0x00);
-
-    /* Enable DLAB (Divisor Latch Access Bit) to set baud rate */
-    outb(COM1_PORT + SERIAL_LINE_CTRL, SERIAL_LCR_DLAB);
+    p->ier = 0;
+    p->tx_armed = false;
+    outb(p->base + SERIAL_INT_ENABLE, 0x00);
 
-    /* Set divisor to 3 (38400 baud) */
-    outb(COM1_PORT + SERIAL_DIV_LSB, SERIAL_DEFAULT_BAUD);
-    outb(COM1_PORT + SERIAL_DIV_MSB, 0x00);
-
-    /* Clear DLAB and set 8N1 (8 data bits, no parity, 1 stop bit) */
-    outb(COM1_PORT + SERIAL_LINE_CTRL, SERIAL_LCR_8N1);
+    port_set_divisor(p, baud_divisor(baud));
+    p->baud = baud;
 
     /* Enable FIFO, clear both FIFOs, set 14-byte threshold */
-    outb(COM1_PORT + SERIAL_FIFO_CTRL,
+    outb(p->base + SERIAL_FIFO_CTRL,
          SERIAL_FCR_ENABLE | SERIAL_FCR_CLEAR_RX |
          SERIAL_FCR_CLEAR_TX | SERIAL_FCR_TRIGGER_14);
 
-    /* Set DTR, RTS, and OUT2 (OUT2 enables IRQs if we want them later) */
-    outb(COM1_PORT + SERIAL_MODEM_CTRL,
+    if ((inb(p->base + SERIAL_FIFO_CTRL) & SERIAL_IIR_FIFO_MASK) ==
+        SERIAL_IIR_FIFO_MASK) {
+        p->fifo_size = SERIAL_FIFO_SIZE;
+    } else {
+        p->fifo_size = SERIAL_NO_FIFO_SIZE;
+    }
+
+    /* Set DTR, RTS, and OUT2 (OUT2 gates the UART's IRQ line) */
+    outb(p->base + SERIAL_MODEM_CTRL,
          SERIAL_MCR_DTR | SERIAL_MCR_RTS | SERIAL_MCR_OUT2);
 }
 
 /*
- * serial_is_transmit_empty - Check if transmit buffer is empty
- *
- * Reads the Line Status Register and checks the TX empty bit.
+ * uart_probe - Check for a UART at @base
  *
- * Returns: non-zero if transmit buffer is empty, 0 if busy
+ * An empty I/O port reads back 0xFF, so two complementary patterns
+ * surviving the scratch register means something is there.
  */
-static int serial_is_transmit_empty(void)
+static bool uart_probe(uint16_t base)
+{
+    outb(base + SERIAL_SCRATCH, 0x5A);
+    if (inb(base + SERIAL_SCRATCH) != 0x5A) {
+        return false;
+    }
+    outb(base + SERIAL_SCRATCH, 0xA5);
+    return inb(base + SERIAL_SCRATCH) == 0xA5;
+}
+
+static void port_set_ier(struct serial_port *p, uint8_t ier)
 {
-    return inb(COM1_PORT + SERIAL_LINE_STATUS) & SERIAL_LSR_TX_EMPTY;
+    p->ier = ier;
+    outb(p->base + SERIAL_INT_ENABLE, ier);
 }
 
 /*
- * serial_putchar - Write a single character to serial port
+ * port_lsr - Read the line status, accounting any receive errors
  *
- * Spins waiting for the transmit holding register to be empty,
- * then writes the character. This is a blocking operation.
+ * Reading LSR clears the error bits, so every read goes through here;
+ * otherwise the TX path could swallow an overrun.
  */
-void serial_putchar(char c)
+static uint8_t port_lsr(struct serial_port *p)
+{
+    uint8_t lsr = inb(p->base + SERIAL_LINE_STATUS);
+
+    if (lsr & SERIAL_LSR_OVERRUN) {
+        p->rx_stats.hw_overruns++;
+    }
+    if (lsr & (SERIAL_LSR_ERRORS & ~SERIAL_LSR_OVERRUN)) {
+        p->rx_stats.errors++;
+    }
+    return lsr;
+}
+
+/*
+ * port_putchar_polled - Send one byte, spinning until the UART takes it
+ */
+static void port_putchar_polled(struct serial_port *p, uint8_t c)
 {
     /* Wait for transmit buffer to be empty */
-    while (!serial_is_transmit_empty()) {
+    while (!(port_lsr(p) & SERIAL_LSR_TX_EMPTY)) {
         /* spin */
     }
 
     /* Send the character */
-    outb(COM1_PORT + SERIAL_DATA, c);
+    outb(p->base + SERIAL_DATA, c);
+}
+
+/*
+ * tx_set_armed - Enable or disable the TX-empty interrupt
+ */
+static void tx_set_armed(struct serial_port *p, bool armed)
+{
+    p->tx_armed = armed;
+    port_set_ier(p, armed ? p->ier | SERIAL_IER_THRE :
+                            p->ier & ~SERIAL_IER_THRE);
+}
+
+/*
+ * tx_burst - Move up to one FIFO load from the ring to the UART
+ *
+ * Only writes once the UART reports its FIFO empty, so it can never
+ * overrun it. Interrupts must be off.
+ */
+static void tx_burst(struct serial_port *p)
+{
+    uint32_t n = 0;
+
+    if (!(port_lsr(p) & SERIAL_LSR_TX_EMPTY)) {
+        return;
+    }
+    while (n < p->fifo_size && p->tx_tail != p->tx_head) {
+        outb(p->base + SERIAL_DATA,
+             p->tx_ring[p->tx_tail++ & (SERIAL_TX_RING_SIZE - 1)]);
+        n++;
+    }
+    if (n != 0) {
+        p->tx_stats.bursts++;
+    }
+}
+
+/*
+ * port_rx - Move everything in a UART's RX FIFO to its ring
+ */
+static void port_rx(struct serial_port *p)
+{
+    uint8_t c;
+
+    while (port_lsr(p) & SERIAL_LSR_DATA_READY) {
+        c = inb(p->base + SERIAL_DATA);
+        p->rx_stats.bytes++;
+        if (!serial_rx_ring_put(&p->rx, c)) {
+            p->rx_stats.sw_overruns++;
+        }
+    }
+}
+
+/*
+ * port_service - Handle every interrupt source pending on one UART
+ *
+ * Returns: true if anything was pending
+ */
+static bool port_service(struct serial_port *p)
+{
+    bool handled = false;
+    uint8_t iir;
+
+    for (;;) {
+        iir = inb(p->base + SERIAL_FIFO_CTRL);
+        if (iir & SERIAL_IIR_NONE) {
+            break;
+        }
+        handled = true;
+
+        switch (iir & SERIAL_IIR_ID_MASK) {
+        case SERIAL_IIR_RX:
+        case SERIAL_IIR_RX_TIMEOUT:
+        case SERIAL_IIR_LSR:
+            p->rx_stats.irqs++;
+            port_rx(p);
+            break;
+        case SERIAL_IIR_THRE:
+            /* Reading IIR cleared it */
+            p->tx_stats.irqs++;
+            tx_burst(p);
+            break;
+        default:
+            inb(p->base + SERIAL_MODEM_STATUS);
+            break;
+        }
+    }
+
+    if (p->tx_tail == p->tx_head && p->tx_armed) {
+        tx_set_armed(p, false);
+    }
+    return handled;
+}
+
+/*
+ * serial_interrupt - IRQ 4 and IRQ 3 handler
+ *
+ * The edge-triggered line only rises again once every UART on it has
+ * nothing pending, so the ports sharing the line are serviced until a
+ * full pass finds nothing.
+ */
+static void serial_interrupt(struct interrupt_frame *frame)
+{
+    uint8_t irq = (uint8_t)(frame->vector - IRQ_VECTOR_BASE);
+    struct serial_port *p;
+    bool again;
+
+    do {
+        again = false;
+        for (p = ports; p < ports + SERIAL_PORTS; p++) {
+            if (p->irq_active && p->irq == irq && port_service(p)) {
+                again = true;
+            }
+        }
+    } while (again);
+}
+
+/*
+ * tx_queue - Put one byte on the ring, making room if it is full
+ *
+ * A full ring is drained one FIFO load at a time by polling, which
+ * also covers writers running with interrupts disabled. Interrupts
+ * must be off.
+ */
+static void tx_queue(struct serial_port *p, uint8_t c)
+{
+    if (p->tx_head - p->tx_tail == SERIAL_TX_RING_SIZE) {
+        p->tx_stats.full_waits++;
+        while (p->tx_head - p->tx_tail == SERIAL_TX_RING_SIZE) {
+            tx_burst(p);
+        }
+    }
+    p->tx_ring[p->tx_head++ & (SERIAL_TX_RING_SIZE - 1)] = c;
+    p->tx_stats.queued++;
+}
+
+/*
+ * tx_kick - Start transmitting after bytes were queued
+ *
+ * Writes the first burst directly and arms the interrupt for the rest.
+ * Interrupts must be off.
+ */
+static void tx_kick(struct serial_port *p)
+{
+    if (!p->tx_armed) {
+        tx_burst(p);
+        if (p->tx_tail != p->tx_head) {
+            tx_set_armed(p, true);
+        }
+    }
+}
+
+/*
+ * port_flush - Poll a port's TX ring out with the interrupt masked
+ *
+ * Interrupts must be off.
+ */
+static void port_flush(struct serial_port *p)
+{
+    if (p->tx_armed) {
+        tx_set_armed(p, false);
+    }
+    while (p->tx_tail != p->tx_head) {
+        tx_burst(p);
+    }
+}
+
+/*
+ * port_drain - Flush a port and wait until the line is idle
+ *
+ * Lets the last FIFO load out before the line settings change.
+ * Interrupts must be off.
+ */
+static void port_drain(struct serial_port *p)
+{
+    port_flush(p);
+    while (!(port_lsr(p) & SERIAL_LSR_TX_IDLE)) {
+        /* spin */
+    }
+}
+
+/*
+ * port_enable_irq - Move a configured port to interrupts
+ *
+ * Interrupts must be off.
+ */
+static int port_enable_irq(struct serial_port *p)
+{
+    int ret;
+
+    if (!(irq_lines & (1U << p->irq))) {
+        ret = irq_request(p->irq, serial_interrupt);
+        if (ret < 0) {
+            return ret;
+        }
+        irq_lines |= 1U << p->irq;
+    }
+
+    if (!p->irq_active) {
+        serial_rx_ring_init(&p->rx);
+        p->irq_active = true;
+    }
+    port_set_ier(p, p->ier | SERIAL_IER_RX | SERIAL_IER_LSR);
+    return 0;
+}
+
+/*
+ * port_write - Queue bytes on a port, or poll them out
+ *
+ * @crlf: Send '\n' as "\r\n"
+ * @sync: Poll even if the port is on interrupts
+ */
+static void port_write(struct serial_port *p, const uint8_t *buf,
+                       size_t len, bool crlf, bool sync)
+{
+    unsigned long flags;
+
+    if (sync || !p->irq_active) {
+        while (len--) {
+            if (crlf && *buf == '\n') {
+                port_putchar_polled(p, '\r');
+            }
+            port_putchar_polled(p, *buf++);
+        }
+        return;
+    }
+
+    flags = irq_save();
+    while (len--) {
+        if (crlf && *buf == '\n') {
+            tx_queue(p, '\r');
+        }
+        tx_queue(p, *buf++);
+    }
+    tx_kick(p);
+    irq_restore(flags);
+}
+
+/*
+ * serial_console_write - Console write(): queue a record on the port
+ *
+ * Polled like the COM1 console while it is in sync mode, so every
+ * serial console keeps printing after a panic.
+ */
+static void serial_console_write(struct console *con, const char *text,
+                                 size_t len)
+{
+    struct serial_port *p = &ports[con - serial_consoles];
+
+    if (p->present) {
+        port_write(p, (const uint8_t *)text, len, true, console_sync);
+    }
+}
+
+/*
+ * serial_init - Initialize COM1 for serial communication
+ *
+ * Output is polled until serial_irq_init().
+ */
+void serial_init(void)
+{
+    console->base = port_hw[SERIAL_COM1].base;
+    console->irq = port_hw[SERIAL_COM1].irq;
+    port_configure(console, SERIAL_DEFAULT_BAUD);
+    console->present = true;
+
+    serial_console_register(SERIAL_COM1, LOG_DEBUG);
+}
+
+/*
+ * serial_irq_init - Switch output to the TX ring and enable input
+ */
+int serial_irq_init(void)
+{
+    unsigned long flags = irq_save();
+    struct serial_port *p;
+    unsigned int i;
+    int ret;
+
+    irq_ready = true;
+
+    ret = port_enable_irq(console);
+    if (ret < 0) {
+        irq_restore(flags);
+        return ret;
+    }
+    console_sync = false;
+    irq_restore(flags);
+
+    for (i = SERIAL_COM2; i < SERIAL_PORTS; i++) {
+        p = &ports[i];
+        if (!p->present) {
+            serial_port_init(i, SERIAL_DEFAULT_BAUD);
+        }
+    }
+    return 0;
+}
+
+/*
+ * serial_port_init - Configure a COM port at runtime
+ */
+int serial_port_init(unsigned int port, uint32_t baud)
+{
+    struct serial_port *p;
+    unsigned long flags;
+    int ret = 0;
+
+    if (port >= SERIAL_PORTS || baud_divisor(baud) == 0) {
+        return -EINVAL;
+    }
+    p = &ports[port];
+
+    flags = irq_save();
+    if (p->present) {
+        port_drain(p);
+    } else if (uart_probe(port_hw[port].base)) {
+        p->base = port_hw[port].base;
+        p->irq = port_hw[port].irq;
+    } else {
+        irq_restore(flags);
+        return -ENODEV;
+    }
+
+    port_configure(p, baud);
+    p->present = true;
+    if (irq_ready) {
+        ret = port_enable_irq(p);
+    }
+    irq_restore(flags);
+    return ret;
+}
+
+/*
+ * serial_set_baud - Change a configured port's baud rate
+ */
+int serial_set_baud(unsigned int port, uint32_t baud)
+{
+    uint32_t divisor = baud_divisor(baud);
+    struct serial_port *p;
+    unsigned long flags;
+
+    if (divisor == 0) {
+        return -EINVAL;
+    }
+    if (port >= SERIAL_PORTS || !ports[port].present) {
+        return -ENODEV;
+    }
+    p = &ports[port];
+
+    flags = irq_save();
+    port_drain(p);
+    port_set_divisor(p, divisor);
+    p->baud = baud;
+    irq_restore(flags);
+
+    klog(LOG_SYS_SERIAL, LOG_DEBUG, "serial: COM%u at %u baud\n", port + 1,
+         baud);
+    return 0;
+}
+
+/*
+ * serial_console_register - Print kernel messages on a port
+ */
+int serial_console_register(unsigned int port, int level)
+{
+    struct console *con;
+    int ret;
+
+    if (port >= SERIAL_PORTS) {
+        return -EINVAL;
+    }
+    if (!ports[port].present) {
+        return -ENODEV;
+    }
+    con = &serial_consoles[port];
+
+    ret = console_set_level(con, level);
+    if (ret < 0) {
+        return ret;
+    }
+    con->enabled = true;
+
+    /* Registering again just applies the new level */
+    ret = console_register(con);
+    return ret == -EEXIST ? 0 : ret;
+}
+
+/*
+ * serial_port_get - A port's state and counters
+ */
+const struct serial_port *serial_port_get(unsigned int port)
+{
+    return port < SERIAL_PORTS ? &ports[port] : NULL;
+}
+
+/*
+ * serial_port_write - Write raw bytes to a port
+ */
+int serial_port_write(unsigned int port, const void *buf, size_t len)
+{
+    if (port >= SERIAL_PORTS || !ports[port].present) {
+        return -ENODEV;
+    }
+    port_write(&ports[port], (const uint8_t *)buf, len, false, false);
+    return 0;
+}
+
+/*
+ * serial_flush - Wait until everything queued on the console is in the
+ * UART
+ */
+void serial_flush(void)
+{
+    unsigned long flags = irq_save();
+
+    if (console->present) {
+        port_flush(console);
+    }
+    irq_restore(flags);
+}
+
+/*
+ * serial_set_sync - Select polled or interrupt-driven console output
+ */
+void serial_set_sync(bool sync)
+{
+    unsigned long flags = irq_save();
+
+    if (sync) {
+        serial_flush();
+    }
+    console_sync = sync;
+    irq_restore(flags);
+}
+
+/*
+ * serial_get_tx_stats - Console TX ring counters
+ */
+const struct serial_tx_stats *serial_get_tx_stats(void)
+{
+    return &console->tx_stats;
+}
+
+/*
+ * serial_putchar - Write a single character to serial port
+ *
+ * Queues the character on the TX ring, or spins until the UART takes
+ * it in sync mode.
+ */
+void serial_putchar(char c)
+{
+    serial_write(&c, 1);
 }
 
 /*
@@ -89,12 +749,13 @@ void serial_putchar(char c)
  */
 void serial_puts(const char *str)
 {
-    while (*str) {
-        if (*str == '\n') {
-            serial_putchar('\r');
-        }
-        serial_putchar(*str);
-        str++;
+    size_t len = 0;
+
+    while (str[len]) {
+        len++;
+    }
+    if (console->present) {
+        port_write(console, (const uint8_t *)str, len, true, console_sync);
     }
 }
 
@@ -106,9 +767,81 @@ void serial_puts(const char *str)
  */
 void serial_write(const void *buf, size_t len)
 {
-    const uint8_t *p = (const uint8_t *)buf;
+    if (console->present) {
+        port_write(console, (const uint8_t *)buf, len, false, console_sync);
+    }
+}
 
-    while (len--) {
-        serial_putchar(*p++);
+/*
+ * serial_port_present - Check whether a port was found
+ */
+bool serial_port_present(unsigned int port)
+{
+    return port < SERIAL_PORTS && ports[port].present;
+}
+
+/*
+ * serial_read - Read received bytes
+ *
+ * Checked with interrupts off, and cpu_idle() halts with "sti; hlt",
+ * so a byte arriving in between still ends the halt.
+ */
+int serial_read(unsigned int port, void *buf, size_t len, int flags)
+{
+    unsigned long irq_flags;
+    size_t n;
+
+    if (port >= SERIAL_PORTS || !ports[port].irq_active) {
+        return -ENODEV;
+    }
+    if (len == 0) {
+        return 0;
     }
+
+    irq_flags = irq_save();
+    while ((n = serial_rx_ring_read(&ports[port].rx, buf, len)) == 0 &&
+           !(flags & SERIAL_NONBLOCK)) {
+        cpu_idle();
+        cli();
+    }
+    irq_restore(irq_flags);
+
+    return n != 0 ? (int)n : -EAGAIN;
+}
+
+/*
+ * serial_read_line - Read one line of input
+ */
+int serial_read_line(unsigned int port, char *buf, size_t size, int flags)
+{
+    unsigned long irq_flags;
+    int ret;
+
+    if (port >= SERIAL_PORTS || !ports[port].irq_active) {
+        return -ENODEV;
+    }
+    if (size == 0) {
+        return -EINVAL;
+    }
+
+    irq_flags = irq_save();
+    while ((ret = serial_rx_ring_getline(&ports[port].rx, buf, size)) ==
+               -EAGAIN &&
+           !(flags & SERIAL_NONBLOCK)) {
+        cpu_idle();
+        cli();
+    }
+    irq_restore(irq_flags);
+
+    return ret;
+}
+
+/*
+ * serial_get_rx_stats - Receive counters for a port
+ */
+const struct serial_rx_stats *serial_get_rx_stats(unsigned int port)
+{
+    return port < SERIAL_PORTS ? &ports[port].rx_stats : NULL;
 }
+
+#endif /* !HOST_TEST */
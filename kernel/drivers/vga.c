@@ -10,10 +10,33 @@
  * VGA text buffer is at 0xB8000, each cell is 2 bytes:
  *   - Low byte: ASCII character
  *   - High byte: Attribute (fg | bg << 4)
+ *
+ * Text is rendered into a shadow copy of the screen in RAM and copied
+ * to the VGA buffer by vga_flush(), one dirty span per row, a machine
+ * word at a time. The hardware cursor (four port writes) is also only
+ * moved at a flush, and only if it changed.
+ *
+ * Scrolling is done by the CRT controller: the screen is a 25-row
+ * window onto the whole 32KB of text memory (204 rows), and a scroll
+ * moves the window's start address down one row. Only the new bottom
+ * row is written. When the window reaches the end of text memory, the
+ * newest VGA_SCROLLBACK_KEEP rows above it are copied to the start and
+ * the window continues from there. The rows above the window are the
+ * scrollback that vga_scrollback() shows.
+ *
+ * The shadow is a ring of rows that moves with the window, so a slot
+ * keeps its row of text memory until it scrolls off the top.
+ *
+ * When the boot loader set a framebuffer mode (make VBE=1), text memory
+ * is not displayed: vga_init() hands the screen to fbcon.c and disables
+ * the "vga" console, and vga_set_color() sets the framebuffer's colors.
  */
 
 #include <vga.h>
+#include <fbcon.h>
 #include <asm.h>
+#include <console.h>
+#include <printk.h>
 
 /*
  * =============================================================================
@@ -21,16 +44,57 @@
  * =============================================================================
  */
 
+/* The unit vga_flush() copies: a machine word, aliasing the cells */
+typedef unsigned long __attribute__((may_alias)) vga_word_t;
+#define VGA_WORD_CELLS  (sizeof(vga_word_t) / sizeof(uint16_t))
+
 /* VGA text buffer - volatile because hardware may change it */
 static volatile uint16_t *vga_buffer = (volatile uint16_t *)VGA_BUFFER_ADDR;
 
+/*
+ * Shadow of the screen: screen row r is shadow slot (shadow_top + r) %
+ * VGA_HEIGHT. Word-aligned so rows copy as whole words.
+ */
+static uint16_t shadow[VGA_HEIGHT][VGA_WIDTH]
+    __attribute__((aligned(sizeof(vga_word_t))));
+static int shadow_top;
+
+/* Columns [dirty_lo, dirty_hi) of each slot differ from text memory */
+static uint8_t dirty_lo[VGA_HEIGHT];
+static uint8_t dirty_hi[VGA_HEIGHT];
+
+/* Row of text memory holding screen row 0 */
+static int vram_top;
+
+/* Rows the view is scrolled back from the live screen */
+static int view_back;
+
+/* Start address last programmed into the CRTC */
+static uint16_t hw_start = 0xFFFF;
+
 /* Current cursor position */
 static int cursor_row = 0;
 static int cursor_col = 0;
 
+/* Cursor position last programmed into the CRTC */
+static uint16_t hw_cursor = 0xFFFF;
+
 /* Current text color attribute */
 static uint8_t current_color = VGA_COLOR_DEFAULT;
 
+static void vga_console_write(struct console *con, const char *text,
+                              size_t len);
+static void vga_console_flush(struct console *con);
+
+/* printk() sink; prints every level until told otherwise */
+static struct console vga_console = {
+    .name = "vga",
+    .write = vga_console_write,
+    .flush = vga_console_flush,
+    .level = LOG_DEBUG,
+    .enabled = true,
+};
+
 /*
  * =============================================================================
  * Private Helper Functions
@@ -53,11 +117,117 @@ static inline uint16_t vga_entry(char c, uint8_t color)
     return (uint16_t)c | ((uint16_t)color << 8);
 }
 
+/*
+ * slot_of - Shadow slot holding screen row @row
+ */
+static inline int slot_of(int row)
+{
+    int slot = shadow_top + row;
+
+    return slot >= VGA_HEIGHT ? slot - VGA_HEIGHT : slot;
+}
+
+/*
+ * mark_dirty - Note that columns [lo, hi) of a slot changed
+ */
+static inline void mark_dirty(int slot, int lo, int hi)
+{
+    if (dirty_lo[slot] >= dirty_hi[slot]) {
+        dirty_lo[slot] = (uint8_t)lo;
+        dirty_hi[slot] = (uint8_t)hi;
+        return;
+    }
+    if (lo < dirty_lo[slot]) {
+        dirty_lo[slot] = (uint8_t)lo;
+    }
+    if (hi > dirty_hi[slot]) {
+        dirty_hi[slot] = (uint8_t)hi;
+    }
+}
+
+/*
+ * mark_all_dirty - Note that every cell on screen changed
+ */
+static void mark_all_dirty(void)
+{
+    for (int slot = 0; slot < VGA_HEIGHT; slot++) {
+        dirty_lo[slot] = 0;
+        dirty_hi[slot] = VGA_WIDTH;
+    }
+}
+
+/*
+ * flush_slot - Copy a slot's dirty span to row @vram_row of text memory
+ *
+ * Returns: true if anything was dirty
+ */
+static bool flush_slot(int slot, int vram_row)
+{
+    const vga_word_t *src;
+    volatile vga_word_t *dst;
+    int lo = dirty_lo[slot];
+    int hi = dirty_hi[slot];
+
+    if (lo >= hi) {
+        return false;
+    }
+
+    /* Widen the span to whole words; rows start word-aligned */
+    lo -= lo % VGA_WORD_CELLS;
+    hi += (VGA_WORD_CELLS - hi % VGA_WORD_CELLS) % VGA_WORD_CELLS;
+
+    src = (const vga_word_t *)&shadow[slot][lo];
+    dst = (volatile vga_word_t *)&vga_buffer[vram_row * VGA_WIDTH + lo];
+    for (int i = 0; i < (hi - lo) / (int)VGA_WORD_CELLS; i++) {
+        dst[i] = src[i];
+    }
+
+    dirty_lo[slot] = 0;
+    dirty_hi[slot] = 0;
+    return true;
+}
+
+/*
+ * vga_update_start - Point the CRTC at the first row in view
+ *
+ * CRT controller registers:
+ *   0x0C: Start address high byte
+ *   0x0D: Start address low byte
+ */
+static void vga_update_start(void)
+{
+    uint16_t start = (vram_top - view_back) * VGA_WIDTH;
+
+    if (start == hw_start) {
+        return;
+    }
+
+    outb(VGA_CRTC_INDEX, VGA_START_HIGH);
+    outb(VGA_CRTC_DATA, (start >> 8) & 0xFF);
+    outb(VGA_CRTC_INDEX, VGA_START_LOW);
+    outb(VGA_CRTC_DATA, start & 0xFF);
+    hw_start = start;
+}
+
+/*
+ * clear_row - Fill a shadow row with blanks in the current color
+ */
+static void clear_row(uint16_t *cells)
+{
+    uint16_t blank = vga_entry(' ', current_color);
+
+    for (int col = 0; col < VGA_WIDTH; col++) {
+        cells[col] = blank;
+    }
+}
+
 /*
  * vga_update_cursor - Update hardware cursor position
  *
  * Programs the VGA CRT controller to move the blinking cursor
- * to match our software cursor position.
+ * to match our software cursor position. The location counts from
+ * the start of text memory, not of the screen. Skipped when it is
+ * already there, and the high byte only written when it changes.
  *
  * CRT controller registers:
  *   0x0E: Cursor location high byte
@@ -65,65 +235,75 @@ static inline uint16_t vga_entry(char c, uint8_t color)
  */
 static void vga_update_cursor(void)
 {
-    uint16_t pos = cursor_row * VGA_WIDTH + cursor_col;
+    uint16_t pos = (vram_top + cursor_row) * VGA_WIDTH + cursor_col;
+
+    if (pos == hw_cursor) {
+        return;
+    }
 
     outb(VGA_CRTC_INDEX, VGA_CURSOR_LOW);
     outb(VGA_CRTC_DATA, pos & 0xFF);
-    outb(VGA_CRTC_INDEX, VGA_CURSOR_HIGH);
-    outb(VGA_CRTC_DATA, (pos >> 8) & 0xFF);
+    if ((pos >> 8) != (hw_cursor >> 8)) {
+        outb(VGA_CRTC_INDEX, VGA_CURSOR_HIGH);
+        outb(VGA_CRTC_DATA, (pos >> 8) & 0xFF);
+    }
+    hw_cursor = pos;
 }
 
 /*
- * vga_scroll - Scroll screen up by one line
+ * vga_wrap - Move the window back to the start of text memory
  *
- * Copies rows 1-24 to rows 0-23, then clears row 24.
- * Called when cursor reaches row 25 (off screen).
+ * Copies the newest VGA_SCROLLBACK_KEEP rows of scrollback to the
+ * start, so they stay above the window, and redraws the screen below
+ * them at the next flush.
  */
-static void vga_scroll(void)
+static void vga_wrap(void)
 {
-    /* Move rows 1-24 up to rows 0-23 */
-    for (int i = 0; i < VGA_WIDTH * (VGA_HEIGHT - 1); i++) {
-        vga_buffer[i] = vga_buffer[i + VGA_WIDTH];
-    }
+    const int words = VGA_SCROLLBACK_KEEP * VGA_WIDTH / VGA_WORD_CELLS;
+    volatile vga_word_t *dst = (volatile vga_word_t *)vga_buffer;
+    volatile vga_word_t *src = (volatile vga_word_t *)
+        &vga_buffer[(vram_top - VGA_SCROLLBACK_KEEP) * VGA_WIDTH];
 
-    /* Clear the last row */
-    for (int i = VGA_WIDTH * (VGA_HEIGHT - 1); i < VGA_WIDTH * VGA_HEIGHT; i++) {
-        vga_buffer[i] = vga_entry(' ', current_color);
+    /* Forward copy: the destination lies below the source */
+    for (int i = 0; i < words; i++) {
+        dst[i] = src[i];
     }
 
-    /* Move cursor to last row */
-    cursor_row = VGA_HEIGHT - 1;
+    vram_top = VGA_SCROLLBACK_KEEP;
+    mark_all_dirty();
 }
 
 /*
- * =============================================================================
- * Public Functions
- * =============================================================================
- */
-
-/*
- * vga_init - Initialize VGA driver and clear screen
+ * vga_scroll - Scroll screen up by one line
+ *
+ * The top screen row scrolls into the scrollback: its slot is written
+ * out if it has to be, then becomes the new, blank bottom row one row
+ * further down text memory. The other rows stay where they are in
+ * text memory; only the CRTC start address moves, at the next flush.
+ * Called when cursor reaches row 25 (off screen).
  */
-void vga_init(void)
+static void vga_scroll(void)
 {
-    /* Reset cursor to top-left */
-    cursor_row = 0;
-    cursor_col = 0;
+    int slot = shadow_top;
 
-    /* Set default color: light grey on black */
-    current_color = VGA_COLOR_DEFAULT;
+    flush_slot(slot, vram_top);
+    clear_row(shadow[slot]);
+    mark_dirty(slot, 0, VGA_WIDTH);
+    shadow_top = shadow_top == VGA_HEIGHT - 1 ? 0 : shadow_top + 1;
 
-    /* Clear entire screen */
-    vga_clear();
+    vram_top++;
+    if (vram_top > VGA_VRAM_ROWS - VGA_HEIGHT) {
+        vga_wrap();
+    }
 
-    /* Sync hardware cursor */
-    vga_update_cursor();
+    /* Move cursor to last row */
+    cursor_row = VGA_HEIGHT - 1;
 }
 
 /*
- * vga_putchar - Print a single character at cursor position
+ * vga_put - Put a character into the shadow, without flushing
  */
-void vga_putchar(char c)
+static void vga_put(char c)
 {
     /* Handle special characters */
     if (c == '\n') {
@@ -134,9 +314,11 @@ void vga_putchar(char c)
         /* Carriage return: move to start of current line */
         cursor_col = 0;
     } else {
-        /* Printable character: write to buffer */
-        int pos = cursor_row * VGA_WIDTH + cursor_col;
-        vga_buffer[pos] = vga_entry(c, current_color);
+        /* Printable character: write to shadow */
+        int slot = slot_of(cursor_row);
+
+        shadow[slot][cursor_col] = vga_entry(c, current_color);
+        mark_dirty(slot, cursor_col, cursor_col + 1);
 
         /* Advance cursor */
         cursor_col++;
@@ -152,9 +334,67 @@ void vga_putchar(char c)
     if (cursor_row >= VGA_HEIGHT) {
         vga_scroll();
     }
+}
 
-    /* Update hardware cursor */
-    vga_update_cursor();
+/*
+ * vga_console_write - Console write(): render a record's text
+ */
+static void vga_console_write(struct console *con, const char *text,
+                              size_t len)
+{
+    (void)con;
+    while (len--) {
+        vga_put(*text++);
+    }
+}
+
+/*
+ * vga_console_flush - Console flush(): show the record once it is whole
+ */
+static void vga_console_flush(struct console *con)
+{
+    (void)con;
+    vga_flush();
+}
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * vga_init - Initialize VGA driver and clear screen
+ */
+void vga_init(void)
+{
+    /* Reset cursor to top-left */
+    cursor_row = 0;
+    cursor_col = 0;
+
+    /* Set default color: light grey on black */
+    current_color = VGA_COLOR_DEFAULT;
+
+    /* Clear entire screen and sync start address and cursor */
+    hw_start = 0xFFFF;
+    hw_cursor = 0xFFFF;
+    vga_clear();
+
+    console_register(&vga_console);
+
+    /* Text memory is not on screen in a framebuffer mode */
+    if (fbcon_init() == 0) {
+        console_set_enabled(&vga_console, false);
+    }
+}
+
+/*
+ * vga_putchar - Print a single character at cursor position
+ */
+void vga_putchar(char c)
+{
+    vga_put(c);
+    vga_flush();
 }
 
 /*
@@ -163,8 +403,64 @@ void vga_putchar(char c)
 void vga_puts(const char *str)
 {
     while (*str) {
-        vga_putchar(*str++);
+        vga_put(*str++);
+    }
+    vga_flush();
+}
+
+/*
+ * vga_write - Print @len characters, then flush once
+ */
+void vga_write(const char *buf, size_t len)
+{
+    vga_console_write(NULL, buf, len);
+    vga_flush();
+}
+
+/*
+ * vga_flush - Copy the dirty parts of the shadow to the screen
+ */
+void vga_flush(void)
+{
+    bool wrote = false;
+
+    for (int row = 0; row < VGA_HEIGHT; row++) {
+        if (flush_slot(slot_of(row), vram_top + row)) {
+            wrote = true;
+        }
     }
+
+    /* New output brings a scrolled-back view back to the live screen */
+    if (wrote) {
+        view_back = 0;
+    }
+    vga_update_start();
+    vga_update_cursor();
+}
+
+/*
+ * vga_scrollback - Scroll the view back (or forward) through history
+ */
+int vga_scrollback(int rows)
+{
+    view_back += rows;
+    if (view_back > vram_top) {
+        view_back = vram_top;
+    }
+    if (view_back < 0) {
+        view_back = 0;
+    }
+
+    vga_update_start();
+    return view_back;
+}
+
+/*
+ * vga_screen_offset - Cell of text memory shown at the top-left
+ */
+uint16_t vga_screen_offset(void)
+{
+    return (vram_top - view_back) * VGA_WIDTH;
 }
 
 /*
@@ -172,16 +468,21 @@ void vga_puts(const char *str)
  */
 void vga_clear(void)
 {
-    for (int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
-        vga_buffer[i] = vga_entry(' ', current_color);
+    for (int slot = 0; slot < VGA_HEIGHT; slot++) {
+        clear_row(shadow[slot]);
     }
+    shadow_top = 0;
+    mark_all_dirty();
+
+    /* Back to the start of text memory, dropping the scrollback */
+    vram_top = 0;
+    view_back = 0;
 
     /* Reset cursor to top-left */
     cursor_row = 0;
     cursor_col = 0;
 
-    /* Update hardware cursor */
-    vga_update_cursor();
+    vga_flush();
 }
 
 /*
@@ -190,4 +491,5 @@ void vga_clear(void)
 void vga_set_color(uint8_t fg, uint8_t bg)
 {
     current_color = fg | (bg << 4);
+    fbcon_set_attr(current_color);
 }
@@ -0,0 +1,188 @@
+/*
+ * kernel/include/apic.h - Local APIC and I/O APIC
+ *
+ * The local APIC (one per CPU) receives interrupts and is acknowledged
+ * with a single MMIO write to its EOI register. The I/O APIC turns
+ * device interrupt pins (GSIs) into messages to a chosen local APIC,
+ * with per-pin vector, destination, trigger mode and mask in one
+ * 64-bit redirection entry.
+ *
+ * Both are accessed through their physical MMIO addresses: paging is
+ * off on i686 and the x86_64 boot map identity-maps the first 4GB.
+ *
+ * References:
+ *   - Intel SDM Vol 3, Chapter 10: Advanced Programmable Interrupt
+ *     Controller (APIC)
+ *   - Intel 82093AA I/O APIC datasheet
+ */
+
+#ifndef KERNEL_INCLUDE_APIC_H
+#define KERNEL_INCLUDE_APIC_H
+
+#include <types.h>
+
+/*
+ * =============================================================================
+ * Local APIC
+ * =============================================================================
+ */
+#define MSR_APIC_BASE           0x1B
+#define APIC_BASE_ENABLE        (1U << 11)  /* Global enable */
+#define APIC_BASE_ADDR_MASK     0xFFFFF000U
+
+/* Register offsets from the LAPIC base */
+#define LAPIC_ID                0x020
+#define LAPIC_VERSION           0x030
+#define LAPIC_TPR               0x080       /* Task priority */
+#define LAPIC_EOI               0x0B0
+#define LAPIC_SVR               0x0F0       /* Spurious interrupt vector */
+#define LAPIC_ESR               0x280       /* Error status */
+#define LAPIC_ICR_LOW           0x300       /* Interrupt command */
+#define LAPIC_ICR_HIGH          0x310
+#define LAPIC_LVT_TIMER         0x320
+#define LAPIC_LVT_LINT0         0x350
+#define LAPIC_LVT_LINT1         0x360
+#define LAPIC_LVT_ERROR         0x370
+#define LAPIC_TIMER_INIT        0x380       /* Timer initial count */
+#define LAPIC_TIMER_CURRENT     0x390       /* Timer current count */
+#define LAPIC_TIMER_DIVIDE      0x3E0       /* Timer divide configuration */
+
+#define LAPIC_SVR_ENABLE        (1U << 8)   /* Software enable */
+#define LAPIC_LVT_MASKED        (1U << 16)
+#define LAPIC_ICR_PENDING       (1U << 12)  /* Delivery status */
+#define LAPIC_ICR_SELF          (1U << 18)  /* Destination shorthand: self */
+#define LAPIC_TIMER_PERIODIC    (1U << 17)  /* LVT timer mode (0 = one-shot) */
+#define LAPIC_TIMER_DIV_16      0x3         /* Divide bus clock by 16 */
+
+/* Vector for LAPIC spurious interrupts (low nibble must be all ones) */
+#define APIC_SPURIOUS_VECTOR    0xFF
+
+/* Vector for the LAPIC timer (high priority class, below spurious) */
+#define APIC_TIMER_VECTOR       0xEC
+
+/*
+ * =============================================================================
+ * I/O APIC
+ * =============================================================================
+ */
+#define IOAPIC_DEFAULT_BASE     0xFEC00000U
+
+/* Indirect access: write register index to REGSEL, then use WIN */
+#define IOAPIC_REGSEL           0x00
+#define IOAPIC_WIN              0x10
+
+#define IOAPIC_REG_ID           0x00
+#define IOAPIC_REG_VER          0x01
+#define IOAPIC_REDTBL(pin)      (0x10 + 2 * (pin))
+
+/* Redirection entry flag bits (low dword) */
+#define IOAPIC_ACTIVE_LOW       (1U << 13)
+#define IOAPIC_LEVEL            (1U << 15)
+#define IOAPIC_MASKED           (1U << 16)
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * ioapic_redir_entry - Build a redirection table entry
+ *
+ * Fixed delivery, physical destination mode. Exposed for host-side
+ * testing of the encoding.
+ *
+ * @vector: IDT vector to deliver
+ * @dest: Destination local APIC ID
+ * @flags: IOAPIC_ACTIVE_LOW, IOAPIC_LEVEL, IOAPIC_MASKED
+ *
+ * Returns: 64-bit entry (low dword at REDTBL, high at REDTBL + 1)
+ */
+uint64_t ioapic_redir_entry(uint8_t vector, uint8_t dest, uint32_t flags);
+
+/*
+ * lapic_present - Check CPUID for an on-chip local APIC
+ */
+bool lapic_present(void);
+
+/*
+ * lapic_init - Enable this CPU's local APIC
+ *
+ * Masks the LINT0/LINT1/error/timer LVT entries, accepts all
+ * priorities and software-enables the APIC with APIC_SPURIOUS_VECTOR.
+ *
+ * Returns: 0 on success, -ENODEV without a local APIC
+ */
+int lapic_init(void);
+
+/*
+ * lapic_id - This CPU's local APIC ID
+ */
+uint8_t lapic_id(void);
+
+/*
+ * lapic_eoi - Acknowledge the highest-priority in-service interrupt
+ */
+void lapic_eoi(void);
+
+/*
+ * lapic_send_self_ipi - Raise a fixed interrupt on this CPU
+ *
+ * @vector: Vector to deliver (>= 32)
+ */
+void lapic_send_self_ipi(uint8_t vector);
+
+/*
+ * lapic_timer_calibrate - Measure the LAPIC timer rate against the TSC
+ *
+ * Uses divide-by-16 (as do the other timer functions). Needs tsc_khz.
+ *
+ * Returns: Timer ticks per millisecond, or 0 if the local APIC is not
+ *          enabled or the TSC is not calibrated
+ */
+uint32_t lapic_timer_calibrate(void);
+
+/*
+ * lapic_timer_periodic - Fire @vector every @count timer ticks
+ */
+void lapic_timer_periodic(uint8_t vector, uint32_t count);
+
+/*
+ * lapic_timer_oneshot - Fire @vector once after @count timer ticks
+ */
+void lapic_timer_oneshot(uint8_t vector, uint32_t count);
+
+/*
+ * lapic_timer_stop - Stop and mask the timer
+ */
+void lapic_timer_stop(void);
+
+/*
+ * ioapic_init - Probe an I/O APIC and mask all its pins
+ *
+ * @base: Physical MMIO address
+ *
+ * Returns: 0 on success, -ENODEV if nothing answers at @base
+ */
+int ioapic_init(uintptr_t base);
+
+/*
+ * ioapic_pins - Number of redirection entries (0 before ioapic_init)
+ */
+uint32_t ioapic_pins(void);
+
+/*
+ * ioapic_route - Program a pin's redirection entry
+ *
+ * @pin: Input pin (GSI)
+ * @entry: Value from ioapic_redir_entry()
+ */
+void ioapic_route(uint8_t pin, uint64_t entry);
+
+/*
+ * ioapic_mask / ioapic_unmask - Set or clear a pin's mask bit
+ */
+void ioapic_mask(uint8_t pin);
+void ioapic_unmask(uint8_t pin);
+
+#endif /* KERNEL_INCLUDE_APIC_H */
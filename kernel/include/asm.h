@@ -5,6 +5,7 @@
  * expressed in pure C. These are used throughout the kernel for:
  *   - I/O port access (inb, outb, etc.)
  *   - CPU control (halt, interrupt enable/disable)
+ *   - CPU identification and control registers
  *   - Memory barriers
  *
  * All functions are static inline to avoid function call overhead.
@@ -148,4 +149,134 @@ static inline void hlt(void)
     __asm__ volatile ("hlt");
 }
 
+/* EFLAGS/RFLAGS interrupt enable bit */
+#define EFLAGS_IF       (1UL << 9)
+
+/*
+ * irq_save - Disable interrupts, returning the previous flags
+ *
+ * Returns: EFLAGS/RFLAGS before the CLI, for irq_restore()
+ */
+static inline unsigned long irq_save(void)
+{
+    unsigned long flags;
+    __asm__ volatile ("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/*
+ * irq_restore - Re-enable interrupts if they were on at irq_save()
+ *
+ * @flags: Value returned by irq_save()
+ */
+static inline void irq_restore(unsigned long flags)
+{
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile ("sti" : : : "memory");
+    }
+}
+
+/*
+ * =============================================================================
+ * CPU Identification and Control Registers
+ * =============================================================================
+ */
+
+/* CPUID leaf 1 EDX feature bits */
+#define CPUID_EDX_PSE   (1U << 3)   /* 4MB pages (CR4.PSE) */
+#define CPUID_EDX_MSR   (1U << 5)   /* RDMSR/WRMSR */
+#define CPUID_EDX_APIC  (1U << 9)   /* On-chip local APIC */
+
+/* CR4 bits */
+#define CR4_PSE         (1U << 4)   /* Page size extensions */
+
+/*
+ * cpuid - Execute CPUID for a leaf (subleaf 0)
+ *
+ * @leaf: Value for EAX
+ * @eax, @ebx, @ecx, @edx: Output registers
+ */
+static inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx,
+                         uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ volatile ("cpuid"
+                      : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                      : "a"(leaf), "c"(0));
+}
+
+/*
+ * read_cr4 - Read control register 4
+ *
+ * Returns: CR4 (register width: 32 bits on i686, 64 on x86_64)
+ */
+static inline unsigned long read_cr4(void)
+{
+    unsigned long value;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+/*
+ * write_cr4 - Write control register 4
+ *
+ * @value: New CR4 value
+ */
+static inline void write_cr4(unsigned long value)
+{
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+/*
+ * rdmsr - Read a model-specific register
+ *
+ * @msr: MSR index (ECX)
+ *
+ * Returns: EDX:EAX as a 64-bit value
+ */
+static inline uint64_t rdmsr(uint32_t msr)
+{
+    uint32_t lo, hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * wrmsr - Write a model-specific register
+ *
+ * @msr: MSR index (ECX)
+ * @value: New value (EDX:EAX)
+ */
+static inline void wrmsr(uint32_t msr, uint64_t value)
+{
+    __asm__ volatile ("wrmsr"
+                      : : "c"(msr), "a"((uint32_t)value),
+                          "d"((uint32_t)(value >> 32))
+                      : "memory");
+}
+
+/*
+ * invlpg - Invalidate the TLB entry for one virtual address
+ *
+ * @addr: Any address inside the page (a 4MB page is flushed whole)
+ */
+static inline void invlpg(uintptr_t addr)
+{
+    __asm__ volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+/*
+ * rdtsc - Read the time-stamp counter
+ *
+ * Not serializing: earlier instructions may still be in flight. Good
+ * enough for cycle accounting over whole handlers.
+ *
+ * Returns: 64-bit cycle count since reset
+ */
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
 #endif /* KERNEL_INCLUDE_ASM_H */
@@ -0,0 +1,110 @@
+/*
+ * kernel/include/console.h - Console sink registry
+ *
+ * printk() output goes to every registered console whose level admits
+ * the message. Drivers register their own struct console (VGA in
+ * vga_init(), COM1 in serial_init(), other COM ports on request), each
+ * with the highest log level it prints; a console can be disabled or
+ * given a new level at any time.
+ *
+ * Consoles are also configured on the kernel command line:
+ *   console.<name>=<level>   e.g. console.vga=error
+ *   console.<name>=off
+ *
+ * Usage:
+ *   console_set_level(console_find("vga"), LOG_ERROR);
+ *   serial_console_register(SERIAL_COM2, LOG_DEBUG);
+ */
+
+#ifndef KERNEL_INCLUDE_CONSOLE_H
+#define KERNEL_INCLUDE_CONSOLE_H
+
+#include <types.h>
+
+/*
+ * struct console - One output sink for kernel messages
+ */
+struct console {
+    const char *name;                   /* For console_find(), e.g. "vga" */
+
+    /*
+     * write - Print @len characters of @text
+     *
+     * Called with one record at a time, never concurrently with
+     * itself. '\n' ends a line; the sink adds any '\r' it needs.
+     */
+    void (*write)(struct console *con, const char *text, size_t len);
+
+    /*
+     * flush - Show what write() buffered (optional)
+     *
+     * Called once a whole record has been written, so a sink that
+     * renders into memory updates the device once per record.
+     */
+    void (*flush)(struct console *con);
+
+    int level;                          /* Highest level printed */
+    bool enabled;
+    uint32_t records;                   /* Records printed */
+    struct console *next;               /* Registry link */
+};
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * console_register - Add a console to the registry
+ *
+ * The console keeps its level and enabled flag. Not for interrupt
+ * context: registration is not atomic against another registration.
+ *
+ * @con: Console, with name and write set
+ *
+ * Returns: 0, -EINVAL if incomplete, -EEXIST if the name is taken
+ */
+int console_register(struct console *con);
+
+/*
+ * console_unregister - Remove a console from the registry
+ *
+ * A write already under way on another context may still finish.
+ */
+void console_unregister(struct console *con);
+
+/*
+ * console_find - Registered console named @name, or NULL
+ */
+struct console *console_find(const char *name);
+
+/*
+ * console_set_level - Set the highest level a console prints
+ *
+ * @con: Console, or NULL
+ * @level: LOG_ERROR..LOG_DEBUG
+ *
+ * Returns: 0, or -EINVAL for a NULL console or a bad level
+ */
+int console_set_level(struct console *con, int level);
+
+/*
+ * console_set_enabled - Turn a console on or off
+ */
+void console_set_enabled(struct console *con, bool enabled);
+
+/*
+ * console_write - Print a record on every console that takes @level
+ *
+ * @level: Record's level; messages without one go to every console
+ * @prefix: Level prefix such as "[INFO]  ", or NULL
+ * @text: Message text
+ * @len: Length of @text
+ *
+ * Returns: Number of consoles written
+ */
+uint32_t console_write(int level, const char *prefix, const char *text,
+                       size_t len);
+
+#endif /* KERNEL_INCLUDE_CONSOLE_H */
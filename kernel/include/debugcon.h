@@ -0,0 +1,54 @@
+/*
+ * kernel/include/debugcon.h - QEMU/Bochs debug console (port 0xE9)
+ *
+ * Under QEMU with -debugcon (and Bochs with port_e9_hack), every byte
+ * written to port 0xE9 goes straight to the host: one outb, with no
+ * line status polling and no baud rate, so it is far faster than COM1
+ * for verbose logs. Reading the port returns 0xE9 when the device is
+ * there; on real hardware it floats to 0xFF and nothing is registered.
+ *
+ * The console is named "debugcon" and prints every level. To keep
+ * bulk output off the slower sinks, lower them on the command line:
+ *   make DEBUGCON=1 CMDLINE="console.com1=info console.vga=warn" qemu
+ * leaves debug messages in build/debug.log only.
+ */
+
+#ifndef KERNEL_INCLUDE_DEBUGCON_H
+#define KERNEL_INCLUDE_DEBUGCON_H
+
+#include <types.h>
+
+#define DEBUGCON_PORT       0xE9
+#define DEBUGCON_READBACK   0xE9        /* Value read when present */
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * debugcon_init - Register the debug console if the port is there
+ *
+ * Call before log_parse_cmdline() so console.debugcon= applies.
+ *
+ * Returns: 0, or -ENODEV when not running with a debug console
+ */
+int debugcon_init(void);
+
+/*
+ * debugcon_present - Whether debugcon_init() found the port
+ */
+bool debugcon_present(void);
+
+/*
+ * debugcon_write - Write raw bytes to the debug console
+ *
+ * Does nothing when the port is absent. No '\n' translation.
+ *
+ * @buf: Bytes to write
+ * @len: Number of bytes
+ */
+void debugcon_write(const void *buf, size_t len);
+
+#endif /* KERNEL_INCLUDE_DEBUGCON_H */
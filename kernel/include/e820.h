@@ -0,0 +1,36 @@
+/*
+ * kernel/include/e820.h - BIOS E820 Memory Map
+ *
+ * Stage 2 queries INT 0x15, EAX=0xE820 and stores the entries at 0x504
+ * (count at 0x500). entry.S passes them to C as boot_mmap_ptr and
+ * boot_mmap_count.
+ */
+
+#ifndef KERNEL_INCLUDE_E820_H
+#define KERNEL_INCLUDE_E820_H
+
+#include <types.h>
+
+/*
+ * E820 region types
+ */
+#define E820_USABLE         1   /* Usable RAM */
+#define E820_RESERVED       2   /* Reserved, do not use */
+#define E820_ACPI_RECLAIM   3   /* ACPI tables, reclaimable after parsing */
+#define E820_ACPI_NVS       4   /* ACPI non-volatile storage */
+#define E820_BAD            5   /* Defective memory */
+
+/*
+ * struct e820_entry - One memory map entry (24 bytes)
+ *
+ * Layout matches what stage 2 stores: base(8), length(8), type(4),
+ * extended attributes(4).
+ */
+struct e820_entry {
+    uint64_t base;          /* Physical start address */
+    uint64_t length;        /* Region length in bytes */
+    uint32_t type;          /* E820_* region type */
+    uint32_t extended;      /* ACPI 3.0 extended attributes */
+} __attribute__((packed));
+
+#endif /* KERNEL_INCLUDE_E820_H */
@@ -0,0 +1,29 @@
+/*
+ * kernel/include/errno.h - Kernel Error Codes
+ *
+ * Functions that can fail return a negative errno (e.g. -ENOMEM);
+ * zero or a positive value means success. Values match Linux/POSIX so
+ * they can be passed through to userspace unchanged.
+ */
+
+#ifndef KERNEL_INCLUDE_ERRNO_H
+#define KERNEL_INCLUDE_ERRNO_H
+
+#define EPERM       1   /* Operation not permitted */
+#define ENOENT      2   /* No such entry */
+#define ESRCH       3   /* No such process */
+#define EINTR       4   /* Interrupted call */
+#define EIO         5   /* I/O error */
+#define EAGAIN      11  /* Try again / would block */
+#define ENOMEM      12  /* Out of memory */
+#define EFAULT      14  /* Bad address */
+#define EBUSY       16  /* Resource busy */
+#define EEXIST      17  /* Already exists */
+#define ENODEV      19  /* No such device */
+#define EINVAL      22  /* Invalid argument */
+#define ENOSPC      28  /* No space left */
+#define ERANGE      34  /* Result out of range */
+#define ENOSYS      38  /* Function not implemented */
+#define ETIMEDOUT   110 /* Timed out */
+
+#endif /* KERNEL_INCLUDE_ERRNO_H */
@@ -0,0 +1,119 @@
+/*
+ * kernel/include/fbcon.h - Framebuffer text console
+ *
+ * Draws kernel messages on a 32-bit linear framebuffer (make VBE=1, see
+ * vbe.h) with an 8x16 font: 128x48 characters at 1024x768 instead of
+ * VGA text mode's 80x25. Characters take the same attribute byte as
+ * VGA text mode, and vga_set_color() sets it, so the vga.h color API
+ * keeps working.
+ *
+ * Like the VGA driver, text is rendered into a shadow grid of cells
+ * and drawn at fbcon_flush(): dirty spans only, and scrolls applied as
+ * one framebuffer move however many lines scrolled. Each glyph is drawn
+ * from a cache of glyphs already rendered to pixels in its colors, a
+ * row at a time with machine-word stores, so the font bits are only
+ * tested the first time a glyph is drawn in a color pair.
+ *
+ * Under HOST_TEST only the renderer is built, drawing into a buffer
+ * given to fbcon_setup().
+ */
+
+#ifndef KERNEL_INCLUDE_FBCON_H
+#define KERNEL_INCLUDE_FBCON_H
+
+#include <types.h>
+
+/* Largest text grid; bigger modes leave the rest of the screen black */
+#define FBCON_MAX_COLS      256
+#define FBCON_MAX_ROWS      128
+
+/* Color pairs with glyphs cached at once */
+#define FBCON_CACHE_ATTRS   2
+
+/*
+ * struct fb_info - A 32-bit linear framebuffer and the font to draw with
+ */
+struct fb_info {
+    uint8_t *base;                      /* First pixel */
+    uint32_t pitch;                     /* Bytes per scan line */
+    uint32_t width;                     /* Pixels */
+    uint32_t height;
+    uint8_t red_pos, red_size;          /* Pixel layout, as VBE reports it */
+    uint8_t green_pos, green_size;
+    uint8_t blue_pos, blue_size;
+    const uint8_t *font;                /* 256 glyphs of 16 rows, MSB left */
+};
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * fbcon_setup - Start drawing on a framebuffer
+ *
+ * Clears the screen to black and homes the cursor.
+ *
+ * @info: Framebuffer; copied
+ *
+ * Returns: 0, or -EINVAL without a font or room for one character
+ */
+int fbcon_setup(const struct fb_info *info);
+
+/*
+ * fbcon_active - Whether output goes to a framebuffer
+ */
+bool fbcon_active(void);
+
+/*
+ * fbcon_cols - Characters per line
+ */
+uint32_t fbcon_cols(void);
+
+/*
+ * fbcon_rows - Lines on screen
+ */
+uint32_t fbcon_rows(void);
+
+/*
+ * fbcon_set_attr - Set the attribute of characters written from now on
+ *
+ * @attr: VGA attribute byte, foreground | background << 4
+ */
+void fbcon_set_attr(uint8_t attr);
+
+/*
+ * fbcon_write - Print a buffer of characters
+ *
+ * Handles '\n', '\r', wrapping and scrolling like vga_write(), and
+ * flushes once at the end.
+ *
+ * @buf: Characters to print, need not be NUL-terminated
+ * @len: Number of characters
+ */
+void fbcon_write(const char *buf, size_t len);
+
+/*
+ * fbcon_flush - Draw everything printed so far
+ */
+void fbcon_flush(void);
+
+/*
+ * fbcon_clear - Clear the screen in the current attribute's background
+ */
+void fbcon_clear(void);
+
+#ifndef HOST_TEST
+/*
+ * fbcon_init - Take over the display if stage 2 set a framebuffer mode
+ *
+ * Reads the VBE mode info passed by the boot loader and registers the
+ * "fb" console, which prints every log level.
+ *
+ * Returns: 0, or -ENODEV in text mode or for an unusable mode
+ */
+int fbcon_init(void);
+#endif
+
+#endif /* KERNEL_INCLUDE_FBCON_H */
@@ -5,7 +5,8 @@
  * dependencies. These can be tested on the host and used by printk.
  *
  * All functions write to a provided buffer and return the number of
- * characters written (excluding null terminator).
+ * characters written (excluding null terminator). None of them divide,
+ * so 64-bit values format on i686 without libgcc.
  */
 
 #ifndef KERNEL_INCLUDE_FORMAT_H
@@ -13,16 +14,47 @@
 
 #include <types.h>
 
+/*
+ * format_u64 - Format 64-bit unsigned integer to buffer
+ *
+ * Converts an unsigned integer to a string representation in the
+ * specified base. Bases 8 and 16 are supported; any other base
+ * formats in decimal.
+ *
+ * @buf: Destination buffer (must be at least 21 bytes for base 10)
+ * @size: Buffer size
+ * @num: Number to format
+ * @base: Number base (8, 10 or 16)
+ * @uppercase: Use uppercase hex digits (A-F) if true
+ *
+ * Returns: Number of characters written (excluding null terminator)
+ */
+int format_u64(char *buf, size_t size, uint64_t num, int base, int uppercase);
+
+/*
+ * format_s64 - Format 64-bit signed integer to buffer
+ *
+ * Converts a signed integer to a decimal string representation.
+ * Handles INT64_MIN correctly without overflow.
+ *
+ * @buf: Destination buffer (must be at least 21 bytes)
+ * @size: Buffer size
+ * @num: Number to format
+ *
+ * Returns: Number of characters written (excluding null terminator)
+ */
+int format_s64(char *buf, size_t size, int64_t num);
+
 /*
  * format_unsigned - Format unsigned integer to buffer
  *
  * Converts an unsigned integer to a string representation in the
- * specified base (10 or 16).
+ * specified base, like format_u64().
  *
  * @buf: Destination buffer (must be at least 12 bytes for base 10)
  * @size: Buffer size
  * @num: Number to format
- * @base: Number base (10 or 16)
+ * @base: Number base (8, 10 or 16)
  * @uppercase: Use uppercase hex digits (A-F) if true
  *
  * Returns: Number of characters written (excluding null terminator)
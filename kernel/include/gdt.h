@@ -15,6 +15,10 @@
  *   Index 3 (0x18): User code segment (ring 3) - placeholder
  *   Index 4 (0x20): User data segment (ring 3) - placeholder
  *   Index 5 (0x28): TSS descriptor - placeholder
+ *
+ * The x86_64 build (kernel/arch/x86_64/gdt.c) keeps the same selectors;
+ * code segments set the L flag instead of D/B, and the TSS descriptor
+ * is 16 bytes so it occupies indices 5 and 6.
  */
 
 #ifndef KERNEL_INCLUDE_GDT_H
@@ -88,6 +92,16 @@ struct gdt_ptr {
     uint32_t base;          /* Linear address of GDT */
 } __attribute__((packed));
 
+/*
+ * struct gdt_ptr64 - GDT pointer for LGDT in long mode (10 bytes)
+ *
+ * In 64-bit mode LGDT reads a 2-byte limit followed by an 8-byte base.
+ */
+struct gdt_ptr64 {
+    uint16_t limit;         /* Size of GDT in bytes minus 1 */
+    uint64_t base;          /* Linear address of GDT */
+} __attribute__((packed));
+
 /*
  * gdt_init - Initialize the Global Descriptor Table
  *
@@ -0,0 +1,234 @@
+/*
+ * kernel/include/hrtimer.h - High-resolution timers
+ *
+ * Nanosecond timers on ktime, for deadlines finer than a jiffy. Each
+ * CPU keeps its queued hrtimers in a red-black tree ordered by expiry,
+ * with the leftmost (earliest) node cached, and the LAPIC one-shot is
+ * programmed for that node through tick_program_event().
+ *
+ * Callbacks run from the timer interrupt with interrupts disabled, so
+ * they must be short: wake something up, or re-arm and return
+ * HRTIMER_RESTART for a periodic timer.
+ *
+ * Each expiry's lateness (interrupt time minus requested expiry) is
+ * recorded in a log2 histogram; nanosleep() keeps a second histogram
+ * of wakeup lateness as seen by the sleeper.
+ *
+ * The per-CPU base (struct hrtimer_cpu_base and the hrtimer_base_*()
+ * calls) has no hardware dependencies and is unit-tested on the host.
+ */
+
+#ifndef KERNEL_INCLUDE_HRTIMER_H
+#define KERNEL_INCLUDE_HRTIMER_H
+
+#include <types.h>
+#include <rbtree.h>
+#include <ktime.h>
+
+/* Bucket 0: < 1024 ns; bucket n: [2^(n+9), 2^(n+10)) ns; last: the rest */
+#define HRTIMER_HIST_BUCKETS    24
+#define HRTIMER_HIST_MIN_SHIFT  10
+
+enum hrtimer_restart {
+    HRTIMER_NORESTART,          /* Timer is done */
+    HRTIMER_RESTART,            /* Callback moved expires; queue again */
+};
+
+enum hrtimer_mode {
+    HRTIMER_MODE_ABS,           /* Expiry is absolute ktime */
+    HRTIMER_MODE_REL,           /* Expiry is relative to now */
+};
+
+struct hrtimer;
+
+typedef enum hrtimer_restart (*hrtimer_fn)(struct hrtimer *timer);
+
+/*
+ * struct hrtimer - A nanosecond timer
+ *
+ * Embed in the owning object and recover it with container_of().
+ */
+struct hrtimer {
+    struct rb_node node;
+    uint64_t expires;           /* Absolute ktime in ns */
+    hrtimer_fn function;
+    bool queued;
+};
+
+/*
+ * struct hrtimer_latency_hist - Lateness distribution
+ */
+struct hrtimer_latency_hist {
+    uint64_t buckets[HRTIMER_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+/*
+ * struct hrtimer_cpu_base - One CPU's queued hrtimers
+ */
+struct hrtimer_cpu_base {
+    struct rb_root active;
+    struct rb_node *leftmost;   /* Earliest timer, NULL when empty */
+    uint32_t count;
+    struct hrtimer_latency_hist expiry;
+};
+
+/*
+ * kernel_timespec - Seconds and nanoseconds, as passed to nanosleep(2)
+ */
+struct kernel_timespec {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+};
+
+/*
+ * hrtimer_setup - Prepare a timer for first use
+ */
+static inline void hrtimer_setup(struct hrtimer *timer, hrtimer_fn fn)
+{
+    timer->expires = 0;
+    timer->function = fn;
+    timer->queued = false;
+}
+
+/*
+ * hrtimer_active - Check whether a timer is queued
+ */
+static inline bool hrtimer_active(const struct hrtimer *timer)
+{
+    return timer->queued;
+}
+
+/*
+ * =============================================================================
+ * Per-CPU Base
+ * =============================================================================
+ */
+
+/*
+ * hrtimer_base_init - Empty a base
+ */
+void hrtimer_base_init(struct hrtimer_cpu_base *base);
+
+/*
+ * hrtimer_base_enqueue - Queue a timer at timer->expires
+ *
+ * Equal expiries run in the order they were queued.
+ *
+ * Returns: true if the timer is now the earliest
+ */
+bool hrtimer_base_enqueue(struct hrtimer_cpu_base *base,
+                          struct hrtimer *timer);
+
+/*
+ * hrtimer_base_remove - Dequeue a timer
+ *
+ * Returns: true if the timer was queued
+ */
+bool hrtimer_base_remove(struct hrtimer_cpu_base *base,
+                         struct hrtimer *timer);
+
+/*
+ * hrtimer_base_next - Earliest expiry in the base
+ *
+ * Returns: Absolute ktime in ns, or KTIME_MAX if empty
+ */
+uint64_t hrtimer_base_next(const struct hrtimer_cpu_base *base);
+
+/*
+ * hrtimer_base_run - Run every timer due by @now, in expiry order
+ *
+ * Records each timer's lateness in base->expiry. A callback returning
+ * HRTIMER_RESTART is queued again at its new expiry.
+ *
+ * Returns: The next expiry after the run, or KTIME_MAX
+ */
+uint64_t hrtimer_base_run(struct hrtimer_cpu_base *base, uint64_t now);
+
+/*
+ * hrtimer_forward - Push a periodic timer's expiry past @now
+ *
+ * Returns: Number of periods added (more than 1 means overruns)
+ */
+uint64_t hrtimer_forward(struct hrtimer *timer, uint64_t now,
+                         uint64_t interval);
+
+/*
+ * hrtimer_latency_bucket - Histogram bucket for a lateness in ns
+ */
+uint32_t hrtimer_latency_bucket(uint64_t ns);
+
+/*
+ * hrtimer_hist_add - Record one lateness sample
+ */
+void hrtimer_hist_add(struct hrtimer_latency_hist *hist, uint64_t ns);
+
+/*
+ * =============================================================================
+ * Kernel hrtimers
+ * =============================================================================
+ */
+
+/*
+ * hrtimers_init - Set up this CPU's base and take over timer events
+ *
+ * Needs tick_init(). Without a LAPIC timer, hrtimers never fire and
+ * nanosleep() busy-waits on ktime instead.
+ */
+void hrtimers_init(void);
+
+/*
+ * hrtimer_start - (Re)queue a timer
+ *
+ * @timer: Timer, queued or not
+ * @expires: Expiry in ns, absolute or relative per @mode
+ * @mode: HRTIMER_MODE_ABS or HRTIMER_MODE_REL
+ */
+void hrtimer_start(struct hrtimer *timer, uint64_t expires,
+                   enum hrtimer_mode mode);
+
+/*
+ * hrtimer_cancel - Dequeue a timer
+ *
+ * Returns: true if the timer was queued (and will now not run)
+ */
+bool hrtimer_cancel(struct hrtimer *timer);
+
+/*
+ * nanosleep - Sleep for @ns nanoseconds
+ *
+ * Halts between interrupts until the deadline's hrtimer fires.
+ *
+ * Returns: Wakeup lateness in ns
+ */
+uint64_t nanosleep(uint64_t ns);
+
+/*
+ * sys_nanosleep - nanosleep(2)
+ *
+ * The handler the syscall table will dispatch to. Sleeps are never
+ * interrupted early, so @rem (if given) is always set to zero.
+ *
+ * Returns: 0 on success, -EINVAL for a negative or unnormalized @req
+ */
+int sys_nanosleep(const struct kernel_timespec *req,
+                  struct kernel_timespec *rem);
+
+/*
+ * hrtimer_get_expiry_hist - Expiry lateness histogram of this CPU
+ */
+const struct hrtimer_latency_hist *hrtimer_get_expiry_hist(void);
+
+/*
+ * hrtimer_get_wakeup_hist - nanosleep() wakeup lateness histogram
+ */
+const struct hrtimer_latency_hist *hrtimer_get_wakeup_hist(void);
+
+/*
+ * hrtimer_dump_latency - Print both histograms via printk
+ */
+void hrtimer_dump_latency(void);
+
+#endif /* KERNEL_INCLUDE_HRTIMER_H */
@@ -0,0 +1,163 @@
+/*
+ * kernel/include/hugepage.h - Transparent 4MB Large Pages
+ *
+ * Maps virtual ranges into a 32-bit (non-PAE) page directory, using a
+ * 4MB PSE page directory entry wherever a 4MB slot is aligned, fully
+ * covered by the range, and a 4MB-aligned physical block is free.
+ * Everything else falls back to 4KB pages. One 4MB entry replaces 1024
+ * TLB entries, so large mappings take far fewer TLB misses.
+ *
+ * Large pages are split back into 1024 4KB pages (same frames, same
+ * permissions) when an unmap or protection change covers only part of
+ * the 4MB slot.
+ *
+ * Frames and page tables come from a struct hugepage_ops so the same
+ * code runs on the kernel frame allocator and in host-side tests.
+ *
+ * Usage:
+ *   struct hugepage_stats st = { 0 };
+ *   hugepage_map(pd, start, end, PTE_WRITE | PTE_USER, &st,
+ *                &hugepage_kernel_ops);
+ *   printk(LOG_INFO, "%u huge, %u small\n", st.huge, st.small);
+ */
+
+#ifndef KERNEL_INCLUDE_HUGEPAGE_H
+#define KERNEL_INCLUDE_HUGEPAGE_H
+
+#include <types.h>
+
+/*
+ * =============================================================================
+ * Page Table Entry Bits (32-bit paging)
+ * =============================================================================
+ */
+#define PTE_PRESENT     0x001   /* Entry is valid */
+#define PTE_WRITE       0x002   /* Writable */
+#define PTE_USER        0x004   /* Accessible from ring 3 */
+#define PDE_LARGE       0x080   /* PDE maps a 4MB page (needs CR4.PSE) */
+
+/* Permission bits callers may pass as @prot */
+#define PTE_PROT_MASK   (PTE_WRITE | PTE_USER)
+
+#define PTE_ADDR_MASK   0xFFFFF000U     /* Frame or page table address */
+#define PDE_LARGE_MASK  0xFFC00000U     /* 4MB frame address */
+
+#define PT_ENTRIES      1024
+#define LARGE_PAGE_SHIFT 22
+#define LARGE_PAGE_SIZE (1U << LARGE_PAGE_SHIFT)
+#define LARGE_PAGE_ORDER (LARGE_PAGE_SHIFT - 12)   /* 4MB = 2^10 frames */
+
+/*
+ * struct hugepage_stats - Per-mapping page size counters
+ *
+ * Updated by every call that takes the mapping's stats pointer.
+ */
+struct hugepage_stats {
+    uint32_t huge;          /* 4MB pages currently mapped */
+    uint32_t small;         /* 4KB pages currently mapped */
+    uint32_t splits;        /* 4MB pages split into 4KB pages */
+};
+
+/*
+ * struct hugepage_ops - Physical memory backend
+ *
+ * @alloc_frames: Allocate 2^order aligned frames, return physical
+ *                address or 0 on failure
+ * @free_frames: Release a block from alloc_frames (or one split frame)
+ * @split_frames: Turn a 2^order block into independently freeable frames
+ * @table_virt: Address at which a page table frame can be accessed
+ * @flush: Invalidate TLB entries for [start, end); may be NULL
+ */
+struct hugepage_ops {
+    uint32_t (*alloc_frames)(uint32_t order);
+    void (*free_frames)(uint32_t phys, uint32_t order);
+    void (*split_frames)(uint32_t phys, uint32_t order);
+    uint32_t *(*table_virt)(uint32_t phys);
+    void (*flush)(uint32_t start, uint32_t end);
+};
+
+/* True once CR4.PSE is on; when false every mapping uses 4KB pages */
+extern bool hugepage_enabled;
+
+#ifndef HOST_TEST
+/* Backend built on page_alloc() with identity-mapped page tables */
+extern const struct hugepage_ops hugepage_kernel_ops;
+#endif
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * hugepage_map - Map a virtual range with fresh frames
+ *
+ * @pd: Page directory (1024 entries)
+ * @start: First virtual address (page aligned)
+ * @end: End virtual address (page aligned, exclusive)
+ * @prot: PTE_WRITE and/or PTE_USER
+ * @stats: Counters for this mapping
+ * @ops: Physical memory backend
+ *
+ * Returns: 0 on success, -EINVAL for a bad range, -EEXIST if part of
+ *          the range is already mapped, -ENOMEM if out of frames. On
+ *          error nothing from this call is left mapped.
+ */
+int hugepage_map(uint32_t *pd, uint32_t start, uint32_t end, uint32_t prot,
+                 struct hugepage_stats *stats, const struct hugepage_ops *ops);
+
+/*
+ * hugepage_split - Split the 4MB page covering an address into 4KB pages
+ *
+ * @pd: Page directory
+ * @addr: Any address in the 4MB slot
+ * @stats: Counters for this mapping
+ * @ops: Physical memory backend
+ *
+ * Returns: 0 on success (or if the slot is not a large page), -ENOMEM
+ *          if no frame is available for the page table
+ */
+int hugepage_split(uint32_t *pd, uint32_t addr,
+                   struct hugepage_stats *stats,
+                   const struct hugepage_ops *ops);
+
+/*
+ * hugepage_unmap - Unmap a virtual range and free its frames
+ *
+ * Large pages only partly inside the range are split first. Page
+ * tables left empty are freed. Unmapped holes are skipped.
+ *
+ * @pd, @start, @end, @stats, @ops: As for hugepage_map()
+ *
+ * Returns: 0 on success, -EINVAL for a bad range, -ENOMEM if a split
+ *          needed a page table and none was available
+ */
+int hugepage_unmap(uint32_t *pd, uint32_t start, uint32_t end,
+                   struct hugepage_stats *stats,
+                   const struct hugepage_ops *ops);
+
+/*
+ * hugepage_protect - Change permissions on a virtual range
+ *
+ * Large pages only partly inside the range are split first. Unmapped
+ * holes are skipped.
+ *
+ * @pd, @start, @end, @prot, @stats, @ops: As for hugepage_map()
+ *
+ * Returns: 0 on success, -EINVAL for a bad range, -ENOMEM as for
+ *          hugepage_unmap()
+ */
+int hugepage_protect(uint32_t *pd, uint32_t start, uint32_t end,
+                     uint32_t prot, struct hugepage_stats *stats,
+                     const struct hugepage_ops *ops);
+
+/*
+ * hugepage_init - Enable 4MB pages if the CPU supports PSE
+ *
+ * Sets CR4.PSE and hugepage_enabled on i686. Large pages stay disabled
+ * on x86_64, whose 4-level tables use a different format.
+ */
+void hugepage_init(void);
+
+#endif /* KERNEL_INCLUDE_HUGEPAGE_H */
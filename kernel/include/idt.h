@@ -0,0 +1,221 @@
+/*
+ * kernel/include/idt.h - Interrupt Descriptor Table and ISR dispatch
+ *
+ * Every vector has an assembly entry stub (isr_stubs.S) that builds a
+ * struct interrupt_frame and calls isr_dispatch(). Dispatch is one
+ * indirect call through a 256-entry handler table; unclaimed vectors
+ * point at a default handler, so there is no per-vector branching.
+ *
+ * Every vector also keeps a hit count and the total TSC cycles spent
+ * in its handler (struct isr_stats).
+ *
+ * Fast path: vectors 32-255 may instead register a fast handler. The
+ * IDT gate is then pointed at a second stub set that saves only the
+ * caller-saved registers (the C ABI preserves the rest) and skips the
+ * segment reloads and the frame, for latency-sensitive interrupts such
+ * as timers and IPIs. Fast handlers get only the vector number.
+ *
+ * Exceptions (0-31) always take the full path: they need the error
+ * code and faulting context.
+ *
+ * References:
+ *   - Intel SDM Vol 3, Section 6.10: Interrupt Descriptor Table
+ *   - Intel SDM Vol 3, Section 6.14.1: 64-Bit Mode IDT
+ */
+
+#ifndef KERNEL_INCLUDE_IDT_H
+#define KERNEL_INCLUDE_IDT_H
+
+#include <types.h>
+
+#define IDT_ENTRIES         256
+#define ISR_EXCEPTIONS      32      /* Vectors 0-31 are CPU exceptions */
+
+/*
+ * Gate type/attribute byte: P | DPL | 0 | Type
+ *
+ * Interrupt gates clear IF on entry; trap gates leave it alone.
+ * The 32-bit and 64-bit type values are the same (0xE / 0xF).
+ */
+#define IDT_GATE_INTERRUPT  0x8E    /* Present, DPL 0, interrupt gate */
+#define IDT_GATE_TRAP       0x8F    /* Present, DPL 0, trap gate */
+#define IDT_GATE_USER       0x60    /* OR in for DPL 3 (INT n from ring 3) */
+
+/* Size of one entry stub in isr_stubs.S; stub N is at base + N * size */
+#define ISR_STUB_SIZE       16
+
+/* Exception vectors the handlers care about by name */
+#define VEC_DIVIDE_ERROR    0
+#define VEC_BREAKPOINT      3
+#define VEC_INVALID_OPCODE  6
+#define VEC_DOUBLE_FAULT    8
+#define VEC_GP_FAULT        13
+#define VEC_PAGE_FAULT      14
+
+/*
+ * struct idt_entry - 32-bit interrupt/trap gate (8 bytes)
+ *
+ * Intel SDM Vol 3, Figure 6-2.
+ */
+struct idt_entry {
+    uint16_t offset_low;    /* Handler address bits 0-15 */
+    uint16_t selector;      /* Code segment selector (KERNEL_CS) */
+    uint8_t  zero;          /* Reserved, must be 0 */
+    uint8_t  type_attr;     /* P, DPL, gate type */
+    uint16_t offset_high;   /* Handler address bits 16-31 */
+} __attribute__((packed));
+
+/*
+ * struct idt_entry64 - 64-bit interrupt/trap gate (16 bytes)
+ *
+ * Intel SDM Vol 3, Figure 6-8. Same first 8 bytes as the 32-bit gate
+ * except byte 4 holds the IST index, followed by offset bits 32-63.
+ */
+struct idt_entry64 {
+    uint16_t offset_low;    /* Handler address bits 0-15 */
+    uint16_t selector;      /* Code segment selector (KERNEL_CS) */
+    uint8_t  ist;           /* Interrupt stack table index (0 = none) */
+    uint8_t  type_attr;     /* P, DPL, gate type */
+    uint16_t offset_mid;    /* Handler address bits 16-31 */
+    uint32_t offset_high;   /* Handler address bits 32-63 */
+    uint32_t reserved;      /* Must be 0 */
+} __attribute__((packed));
+
+/*
+ * struct idt_ptr - IDT pointer for LIDT (6 bytes, 10 in long mode)
+ *
+ * The 64-bit form has the same layout as struct gdt_ptr64.
+ */
+struct idt_ptr {
+    uint16_t limit;         /* Size of IDT in bytes minus 1 */
+    uint32_t base;          /* Linear address of IDT */
+} __attribute__((packed));
+
+struct idt_ptr64 {
+    uint16_t limit;         /* Size of IDT in bytes minus 1 */
+    uint64_t base;          /* Linear address of IDT */
+} __attribute__((packed));
+
+/*
+ * struct interrupt_frame - Register state saved by the full entry path
+ *
+ * Lowest address first, i.e. the reverse of the push order in
+ * isr_stubs.S. The CPU pushes the fields from ip onward; the stub
+ * pushes a 0 error code for vectors where the CPU does not.
+ */
+#ifdef __x86_64__
+struct interrupt_frame {
+    uint64_t r15, r14, r13, r12, r11, r10, r9, r8;
+    uint64_t rbp, rdi, rsi, rdx, rcx, rbx, rax;
+    uint64_t vector;
+    uint64_t error_code;
+    uint64_t ip, cs, flags, sp, ss;
+};
+#else
+struct interrupt_frame {
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebp, esp_unused, ebx, edx, ecx, eax;   /* PUSHAL */
+    uint32_t vector;
+    uint32_t error_code;
+    uint32_t ip, cs, flags;
+    uint32_t sp, ss;        /* Only pushed on a privilege change */
+};
+#endif
+
+/*
+ * isr_handler_t - Full-path handler
+ *
+ * May read and modify the saved registers; changes take effect on IRET.
+ */
+typedef void (*isr_handler_t)(struct interrupt_frame *frame);
+
+/*
+ * isr_fast_handler_t - Fast-path handler
+ *
+ * Runs with interrupts disabled and must not touch segment registers.
+ * Fast vectors are for hardware interrupts only: pending softirqs run
+ * on the way out.
+ */
+typedef void (*isr_fast_handler_t)(uint32_t vector);
+
+/*
+ * struct isr_stats - Per-vector counters
+ */
+struct isr_stats {
+    uint64_t count;         /* Times the vector was dispatched */
+    uint64_t cycles;        /* Total TSC cycles spent in its handler */
+};
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * idt_init - Build the IDT and load it
+ *
+ * Points every vector at its full-path stub with a KERNEL_CS interrupt
+ * gate, installs the default handlers and executes LIDT. Interrupts
+ * stay disabled.
+ */
+void idt_init(void);
+
+/*
+ * idt_set_gate - Fill a 32-bit gate
+ *
+ * Exposed for host-side testing of the encoding logic.
+ *
+ * @entry:     Entry to fill
+ * @handler:   Entry point address
+ * @selector:  Code segment selector
+ * @type_attr: P, DPL and gate type (e.g. IDT_GATE_INTERRUPT)
+ */
+void idt_set_gate(struct idt_entry *entry, uint32_t handler,
+                  uint16_t selector, uint8_t type_attr);
+
+/*
+ * idt_set_gate64 - Fill a 64-bit gate (IST 0)
+ *
+ * Same parameters as idt_set_gate(), with a 64-bit handler address.
+ */
+void idt_set_gate64(struct idt_entry64 *entry, uint64_t handler,
+                    uint16_t selector, uint8_t type_attr);
+
+/*
+ * isr_register - Install a full-path handler
+ *
+ * Replaces any previous handler for the vector, including a fast one.
+ *
+ * @vector: Interrupt vector
+ * @handler: Handler, or NULL to restore the default
+ */
+void isr_register(uint8_t vector, isr_handler_t handler);
+
+/*
+ * isr_register_fast - Install a fast-path handler
+ *
+ * @vector: Interrupt vector, >= ISR_EXCEPTIONS
+ * @handler: Handler, or NULL to go back to the default full path
+ *
+ * Returns: 0 on success, -EINVAL for an exception vector
+ */
+int isr_register_fast(uint8_t vector, isr_fast_handler_t handler);
+
+/*
+ * isr_get_stats - Read a vector's counters
+ */
+const struct isr_stats *isr_get_stats(uint8_t vector);
+
+/*
+ * isr_reset_stats - Zero all counters
+ */
+void isr_reset_stats(void);
+
+/*
+ * isr_dispatch / isr_fast_dispatch - C entry points (called from isr_stubs.S)
+ */
+void isr_dispatch(struct interrupt_frame *frame);
+void isr_fast_dispatch(uint32_t vector);
+
+#endif /* KERNEL_INCLUDE_IDT_H */
@@ -0,0 +1,119 @@
+/*
+ * kernel/include/irq.h - Hardware IRQ routing
+ *
+ * Device drivers deal in ISA IRQ numbers (0-15) and never touch the
+ * interrupt controller directly. irq_init() picks one controller:
+ *
+ *   - IOAPIC + local APIC when both are present. IRQs are routed
+ *     through a table of ISA IRQ -> IOAPIC pin (GSI) and trigger mode,
+ *     and EOI is a single MMIO store to the local APIC.
+ *   - 8259A PIC otherwise. EOI is one or two port writes.
+ *
+ * IRQ n is always delivered on vector IRQ_VECTOR_BASE + n, so the
+ * choice is invisible to handlers. The EOI path is timed on every
+ * interrupt (struct irq_eoi_stats) so the two controllers can be
+ * compared on real hardware.
+ *
+ * Routing uses the standard PC defaults (IRQ 0 on pin 2, the rest
+ * identity, edge triggered, active high) until ACPI MADT overrides are
+ * parsed.
+ */
+
+#ifndef KERNEL_INCLUDE_IRQ_H
+#define KERNEL_INCLUDE_IRQ_H
+
+#include <types.h>
+#include <idt.h>
+
+#define IRQ_VECTOR_BASE     32      /* Vector for IRQ 0 */
+#define IRQ_LINES           16      /* ISA IRQs */
+
+/* Well-known ISA IRQs */
+#define IRQ_TIMER           0
+#define IRQ_KEYBOARD        1
+#define IRQ_COM2            3
+#define IRQ_COM1            4
+
+/*
+ * struct irq_route - Where an ISA IRQ arrives on the IOAPIC
+ */
+struct irq_route {
+    uint8_t gsi;            /* IOAPIC input pin */
+    uint32_t flags;         /* IOAPIC_ACTIVE_LOW / IOAPIC_LEVEL */
+};
+
+/*
+ * struct irq_chip - Interrupt controller operations
+ */
+struct irq_chip {
+    const char *name;
+    void (*mask)(uint8_t irq);
+    void (*unmask)(uint8_t irq);
+    void (*eoi)(uint8_t irq);
+};
+
+/*
+ * struct irq_eoi_stats - EOI cost for the active controller
+ */
+struct irq_eoi_stats {
+    uint64_t count;         /* EOIs issued */
+    uint64_t cycles;        /* Total TSC cycles spent issuing them */
+};
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * irq_init - Select and initialize the interrupt controller
+ *
+ * Always remaps and masks the PICs first. All IRQ lines start masked;
+ * interrupts stay disabled.
+ */
+void irq_init(void);
+
+/*
+ * irq_get_chip - The controller irq_init() selected
+ */
+const struct irq_chip *irq_get_chip(void);
+
+/*
+ * irq_request - Install a handler and unmask the line
+ *
+ * The handler runs on the full ISR path; EOI is sent after it returns.
+ *
+ * @irq: ISA IRQ (0-15)
+ * @handler: Handler
+ *
+ * Returns: 0 on success, -EINVAL for a bad IRQ or NULL handler,
+ *          -EBUSY if the line already has a handler
+ */
+int irq_request(uint8_t irq, isr_handler_t handler);
+
+/*
+ * irq_free - Mask the line and remove its handler
+ */
+void irq_free(uint8_t irq);
+
+/*
+ * irq_mask / irq_unmask - Disable or enable a line at the controller
+ */
+void irq_mask(uint8_t irq);
+void irq_unmask(uint8_t irq);
+
+/*
+ * irq_eoi - Acknowledge an IRQ (timed)
+ *
+ * Called automatically for irq_request() handlers. Fast-path handlers
+ * registered directly with isr_register_fast() must call it themselves.
+ */
+void irq_eoi(uint8_t irq);
+
+/*
+ * irq_get_eoi_stats - EOI count and cycles since boot
+ */
+const struct irq_eoi_stats *irq_get_eoi_stats(void);
+
+#endif /* KERNEL_INCLUDE_IRQ_H */
@@ -0,0 +1,127 @@
+/*
+ * kernel/include/jump_label.h - Patchable branches
+ *
+ * static_branch_unlikely(&key) compiles to a 5-byte NOP and records
+ * the NOP's address, the address of the code it guards and the key in
+ * the __jump_table section. While the key is off the branch costs that
+ * NOP: no load, no compare. static_key_enable() rewrites every NOP of
+ * the key into a JMP to the guarded code, static_key_disable() writes
+ * the NOPs back.
+ *
+ * Usage:
+ *   struct static_key verbose;
+ *
+ *   if (static_branch_unlikely(&verbose)) {
+ *       dump_state();
+ *   }
+ *
+ * The key must be a global or static object (its address goes into
+ * the table at link time). Keys start off.
+ *
+ * Kernel text is writable (no paging on i686, an RW identity map on
+ * x86_64), so patching needs no mapping tricks; it runs with
+ * interrupts off, and only the boot CPU runs.
+ */
+
+#ifndef KERNEL_INCLUDE_JUMP_LABEL_H
+#define KERNEL_INCLUDE_JUMP_LABEL_H
+
+#include <types.h>
+
+#define JUMP_LABEL_SIZE     5           /* NOP and JMP rel32 alike */
+#define JUMP_LABEL_JMP      0xE9
+
+/* The NOP the compiler emits: nopl 0x0(%eax,%eax,1) */
+#define JUMP_LABEL_NOP      { 0x0F, 0x1F, 0x44, 0x00, 0x00 }
+
+/*
+ * struct static_key - A switch for static_branch_unlikely() sites
+ */
+struct static_key {
+    bool enabled;
+};
+
+/*
+ * struct jump_entry - One static_branch_unlikely() site
+ */
+struct jump_entry {
+    uintptr_t code;                     /* The 5-byte NOP */
+    uintptr_t target;                   /* Where the JMP goes */
+    uintptr_t key;                      /* struct static_key * */
+};
+
+#ifdef __x86_64__
+#define __JUMP_ENTRY    ".balign 8\n\t.quad 1b, %l[l_yes_], %c0\n\t"
+#else
+#define __JUMP_ENTRY    ".balign 4\n\t.long 1b, %l[l_yes_], %c0\n\t"
+#endif
+
+#ifdef HOST_TEST
+/* Host tests cannot patch their own text: read the key instead */
+#define static_branch_unlikely(key) __builtin_expect((key)->enabled, 0)
+#else
+/*
+ * static_branch_unlikely - True when @key is enabled
+ *
+ * A macro rather than an inline function: the "i" constraint needs the
+ * key's address as a link-time constant, which -O0 does not propagate
+ * through a function argument.
+ */
+#define static_branch_unlikely(key) ({                                      \
+    __label__ l_yes_, l_out_;                                               \
+    bool branch_;                                                           \
+    __asm__ goto ("1: .byte 0x0f, 0x1f, 0x44, 0x00, 0x00\n\t"               \
+                  ".pushsection __jump_table, \"aw\"\n\t"                   \
+                  __JUMP_ENTRY                                              \
+                  ".popsection"                                             \
+                  : : "i"(key) : : l_yes_);                                 \
+    branch_ = false;                                                        \
+    goto l_out_;                                                            \
+l_yes_:                                                                     \
+    branch_ = true;                                                         \
+l_out_:                                                                     \
+    branch_;                                                                \
+})
+#endif
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * jump_label_apply - Patch a key's sites to match its state
+ *
+ * Writes a JMP to each site's target if @key is enabled and the NOP
+ * otherwise; sites of other keys are left alone.
+ *
+ * @start: First entry of the table
+ * @end: One past the last entry
+ * @key: Key whose sites to patch
+ *
+ * Returns: Number of sites patched
+ */
+uint32_t jump_label_apply(const struct jump_entry *start,
+                          const struct jump_entry *end,
+                          const struct static_key *key);
+
+/*
+ * static_key_enable - Turn a key on, patching its sites into jumps
+ */
+void static_key_enable(struct static_key *key);
+
+/*
+ * static_key_disable - Turn a key off, patching its sites back to NOPs
+ */
+void static_key_disable(struct static_key *key);
+
+/*
+ * static_key_enabled - Current state of a key
+ */
+static inline bool static_key_enabled(const struct static_key *key)
+{
+    return key->enabled;
+}
+
+#endif /* KERNEL_INCLUDE_JUMP_LABEL_H */
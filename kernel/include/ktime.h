@@ -0,0 +1,95 @@
+/*
+ * kernel/include/ktime.h - Clocksources and kernel time
+ *
+ * ktime_get_ns() returns nanoseconds since ktime_init() from the best
+ * available clocksource:
+ *
+ *   - TSC, when CPUID reports it invariant (constant rate in all
+ *     P-/C-states). Its frequency is calibrated at boot against PIT
+ *     channel 2. A read is one RDTSC plus a multiply and shift.
+ *   - PIT channel 0 otherwise: exact, but each read is port I/O.
+ *
+ * Conversion never divides: a clocksource stores mult and shift with
+ * ns = (cycles * mult) >> shift, chosen by clocks_calc_mult_shift().
+ */
+
+#ifndef KERNEL_INCLUDE_KTIME_H
+#define KERNEL_INCLUDE_KTIME_H
+
+#include <types.h>
+#include <math64.h>
+
+#define NSEC_PER_USEC   1000U
+#define NSEC_PER_MSEC   1000000U
+#define NSEC_PER_SEC    1000000000U
+
+#define KTIME_MAX       ((uint64_t)-1)
+
+/*
+ * struct clocksource - A free-running counter usable for time
+ */
+struct clocksource {
+    const char *name;
+    uint64_t (*read)(void);     /* Current counter value */
+    uint32_t mult;              /* ns = (cycles * mult) >> shift */
+    uint32_t shift;
+    uint64_t base;              /* Counter value at ktime 0 */
+    uint64_t max_idle_ns;       /* Longest gap between reads it tolerates */
+};
+
+/* TSC frequency from boot calibration (0 if calibration failed) */
+extern uint32_t tsc_khz;
+
+/* CPUID says the TSC rate is constant (CPUID 0x80000007 EDX[8]) */
+extern bool tsc_invariant;
+
+/*
+ * clocksource_cyc2ns - Convert a counter delta to nanoseconds
+ */
+static inline uint64_t clocksource_cyc2ns(uint64_t cycles, uint32_t mult,
+                                          uint32_t shift)
+{
+    return mul_u64_u32_shr(cycles, mult, shift);
+}
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * clocks_calc_mult_shift - Pick mult/shift for a from -> to rate ratio
+ *
+ * Chooses the largest shift (<= 32, for precision) whose mult still
+ * fits in 32 bits, so that (x * mult) >> shift ~= x * to / from.
+ * Exposed for host-side testing.
+ *
+ * @mult: Output multiplier
+ * @shift: Output shift
+ * @from: Source rate, e.g. counter kHz (non-zero)
+ * @to: Target rate in the same unit, e.g. NSEC_PER_MSEC for kHz
+ */
+void clocks_calc_mult_shift(uint32_t *mult, uint32_t *shift,
+                            uint32_t from, uint32_t to);
+
+/*
+ * ktime_init - Calibrate the TSC and select the clocksource
+ *
+ * Takes about 50 ms (five PIT calibration windows).
+ */
+void ktime_init(void);
+
+/*
+ * ktime_get_ns - Nanoseconds since ktime_init()
+ *
+ * Returns 0 before ktime_init().
+ */
+uint64_t ktime_get_ns(void);
+
+/*
+ * ktime_get_clocksource - The clocksource ktime_get_ns() reads
+ */
+const struct clocksource *ktime_get_clocksource(void);
+
+#endif /* KERNEL_INCLUDE_KTIME_H */
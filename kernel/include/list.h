@@ -0,0 +1,113 @@
+/*
+ * kernel/include/list.h - Intrusive doubly linked list
+ *
+ * A struct list_head is embedded in each object on the list; the list
+ * head itself is a struct list_head whose next/prev point back at
+ * itself when empty. Insertion and removal are O(1) and never
+ * allocate.
+ *
+ * A removed entry has its links cleared to NULL, so "next == NULL"
+ * reliably means "not on any list".
+ *
+ * Usage:
+ *   struct list_head *pos = head.next;
+ *   while (pos != &head) {
+ *       struct foo *f = list_entry(pos, struct foo, link);
+ *       pos = pos->next;
+ *       ...
+ *   }
+ */
+
+#ifndef KERNEL_INCLUDE_LIST_H
+#define KERNEL_INCLUDE_LIST_H
+
+#include <types.h>
+
+struct list_head {
+    struct list_head *next;
+    struct list_head *prev;
+};
+
+#define LIST_HEAD_INIT(name)    { &(name), &(name) }
+
+/* Get the struct containing an embedded list_head */
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+
+/*
+ * INIT_LIST_HEAD - Make @head an empty list
+ */
+static inline void INIT_LIST_HEAD(struct list_head *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+/*
+ * list_empty - Check whether a list has no entries
+ */
+static inline bool list_empty(const struct list_head *head)
+{
+    return head->next == head;
+}
+
+static inline void __list_add(struct list_head *entry, struct list_head *prev,
+                              struct list_head *next)
+{
+    next->prev = entry;
+    entry->next = next;
+    entry->prev = prev;
+    prev->next = entry;
+}
+
+/*
+ * list_add - Insert @entry at the front of @head
+ */
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+    __list_add(entry, head, head->next);
+}
+
+/*
+ * list_add_tail - Insert @entry at the back of @head
+ */
+static inline void list_add_tail(struct list_head *entry,
+                                 struct list_head *head)
+{
+    __list_add(entry, head->prev, head);
+}
+
+/*
+ * list_del - Unlink @entry and clear its links
+ */
+static inline void list_del(struct list_head *entry)
+{
+    entry->next->prev = entry->prev;
+    entry->prev->next = entry->next;
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+/*
+ * list_splice_init - Move all entries of @list to the front of @head
+ *
+ * @list is left empty.
+ */
+static inline void list_splice_init(struct list_head *list,
+                                    struct list_head *head)
+{
+    struct list_head *first = list->next;
+    struct list_head *last = list->prev;
+
+    if (first == list) {
+        return;
+    }
+
+    first->prev = head;
+    last->next = head->next;
+    head->next->prev = last;
+    head->next = first;
+
+    INIT_LIST_HEAD(list);
+}
+
+#endif /* KERNEL_INCLUDE_LIST_H */
@@ -0,0 +1,101 @@
+/*
+ * kernel/include/math64.h - 64-bit arithmetic helpers
+ *
+ * The i686 kernel is linked without libgcc, so a plain 64-bit '/' or
+ * '%' would fail to link (__udivdi3). These helpers use only 32-bit
+ * divides and 32x32->64 multiplies on i686 and plain C on x86_64.
+ *
+ * No kernel dependencies, so they are usable from host tests.
+ */
+
+#ifndef KERNEL_INCLUDE_MATH64_H
+#define KERNEL_INCLUDE_MATH64_H
+
+#include <types.h>
+
+/*
+ * div_u64_u32 - Divide a 64-bit value by a 32-bit one
+ *
+ * @dividend: Numerator
+ * @divisor: Denominator (non-zero)
+ * @remainder: Output remainder, or NULL
+ *
+ * Returns: Quotient
+ */
+static inline uint64_t div_u64_u32(uint64_t dividend, uint32_t divisor,
+                                   uint32_t *remainder)
+{
+#if defined(__i386__) && !defined(HOST_TEST)
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t q_high = high / divisor;
+    uint32_t q_low, rem;
+
+    /* Second step divides (high % divisor):low, which cannot overflow */
+    __asm__ ("divl %4"
+             : "=a"(q_low), "=d"(rem)
+             : "a"(low), "d"(high % divisor), "rm"(divisor));
+    if (remainder != NULL) {
+        *remainder = rem;
+    }
+    return ((uint64_t)q_high << 32) | q_low;
+#else
+    if (remainder != NULL) {
+        *remainder = (uint32_t)(dividend % divisor);
+    }
+    return dividend / divisor;
+#endif
+}
+
+/*
+ * mul_u64_u32_shr - (a * mul) >> shift without 64-bit overflow
+ *
+ * The full product is up to 96 bits; it is formed from two 32x32->64
+ * multiplies and shifted exactly, so the result only overflows if the
+ * shifted value itself exceeds 64 bits.
+ *
+ * @a: 64-bit multiplicand
+ * @mul: 32-bit multiplier
+ * @shift: Right shift, 0-32
+ *
+ * Returns: (a * mul) >> shift
+ */
+static inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul,
+                                       uint32_t shift)
+{
+    uint64_t low = (uint64_t)(uint32_t)a * mul;
+    uint64_t high = (uint64_t)(uint32_t)(a >> 32) * mul;
+
+    if (shift == 0) {
+        return low + (high << 32);
+    }
+    return (low >> shift) + (high << (32 - shift));
+}
+
+/*
+ * mul_u64_u64_hi - High 64 bits of the 128-bit product a * b
+ *
+ * Built from four 32x32->64 multiplies; with a precomputed reciprocal
+ * this divides a 64-bit value by a constant without __udivdi3.
+ *
+ * @a: Multiplicand
+ * @b: Multiplier
+ *
+ * Returns: (a * b) >> 64
+ */
+static inline uint64_t mul_u64_u64_hi(uint64_t a, uint64_t b)
+{
+    uint32_t a_lo = (uint32_t)a, a_hi = (uint32_t)(a >> 32);
+    uint32_t b_lo = (uint32_t)b, b_hi = (uint32_t)(b >> 32);
+    uint64_t lo_lo = (uint64_t)a_lo * b_lo;
+    uint64_t hi_lo = (uint64_t)a_hi * b_lo;
+    uint64_t lo_hi = (uint64_t)a_lo * b_hi;
+    uint64_t hi_hi = (uint64_t)a_hi * b_hi;
+
+    /* Cannot overflow: lo_hi <= (2^32 - 1)^2 and the rest < 2^33 */
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+
+    return hi_hi + (hi_lo >> 32) + (cross >> 32);
+}
+
+#endif /* KERNEL_INCLUDE_MATH64_H */
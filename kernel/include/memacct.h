@@ -0,0 +1,124 @@
+/*
+ * kernel/include/memacct.h - Per-Owner Memory Accounting and OOM
+ *
+ * Every frame allocated through memacct_alloc() is charged to an owner
+ * (process id, 0 = kernel) under one of three counters: resident user
+ * pages, page tables, and kernel objects. Counters are updated when a
+ * frame is allocated or freed, never by walking page tables.
+ *
+ * When the frame allocator runs dry, the OOM path picks the non-kernel
+ * owner with the largest total and hands it to the registered killer,
+ * then retries the allocation. Only if nothing can be killed does it
+ * fall back to panic().
+ *
+ * Usage:
+ *   struct page *pg = memacct_alloc(pid, MM_RSS, 0);
+ *   ...
+ *   memacct_free(pg);
+ */
+
+#ifndef KERNEL_INCLUDE_MEMACCT_H
+#define KERNEL_INCLUDE_MEMACCT_H
+
+#include <types.h>
+#include <page.h>
+
+/* Owner ids are 0 (kernel) .. MEMACCT_MAX_OWNERS - 1 */
+#define MEMACCT_MAX_OWNERS  64
+
+/* Owner id for kernel allocations; never chosen by the OOM path */
+#define MEMACCT_KERNEL      0
+
+/* Returned by memacct_oom_select() when there is no candidate */
+#define MEMACCT_NO_OWNER    0xFFFFFFFFU
+
+/*
+ * Counter types
+ */
+enum mm_counter {
+    MM_RSS = 0,         /* Resident user pages */
+    MM_PGTABLE,         /* Page directory / page table frames */
+    MM_KOBJ,            /* Kernel objects allocated on the owner's behalf */
+    MM_NR_COUNTERS
+};
+
+/*
+ * struct mem_usage - Frame counts for one owner
+ *
+ * Same layout as the record a userspace query gets back.
+ */
+struct mem_usage {
+    uint32_t pages[MM_NR_COUNTERS];     /* Frames per counter type */
+    uint32_t peak;                      /* Highest total ever charged */
+    uint32_t oom_kills;                 /* Times chosen by the OOM path */
+};
+
+/*
+ * Killer callback: release all memory held by @owner.
+ * Returns 0 if the owner was killed, negative errno otherwise.
+ */
+typedef int (*memacct_kill_fn)(uint32_t owner);
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * memacct_alloc - Allocate frames and charge them to an owner
+ *
+ * On allocator failure, runs the OOM path and retries until the
+ * allocation succeeds or no owner is left to kill.
+ *
+ * @owner: Owner id (< MEMACCT_MAX_OWNERS)
+ * @type: Counter to charge
+ * @order: log2 of the number of frames
+ *
+ * Returns: First frame of the block, or NULL for an invalid owner/type
+ *          (panics if memory is exhausted and nothing can be killed)
+ */
+struct page *memacct_alloc(uint32_t owner, enum mm_counter type,
+                           uint32_t order);
+
+/*
+ * memacct_free - Drop a reference and uncharge on the last one
+ *
+ * @pg: Block from memacct_alloc(), or one frame of a split block
+ */
+void memacct_free(struct page *pg);
+
+/*
+ * memacct_read - Copy out one owner's counters
+ *
+ * This is the record a memory-usage system call returns to userspace.
+ *
+ * @owner: Owner id
+ * @out: Destination
+ *
+ * Returns: 0 on success, -ESRCH for an owner id out of range
+ */
+int memacct_read(uint32_t owner, struct mem_usage *out);
+
+/*
+ * memacct_oom_select - Pick the owner charged with the most frames
+ *
+ * The kernel (owner 0) is never selected.
+ *
+ * Returns: Owner id, or MEMACCT_NO_OWNER if no owner holds memory
+ */
+uint32_t memacct_oom_select(void);
+
+/*
+ * memacct_set_killer - Register the OOM kill callback
+ *
+ * @kill: Callback, or NULL to make exhaustion fatal
+ */
+void memacct_set_killer(memacct_kill_fn kill);
+
+/*
+ * memacct_reset - Zero every owner's counters
+ */
+void memacct_reset(void);
+
+#endif /* KERNEL_INCLUDE_MEMACCT_H */
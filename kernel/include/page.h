@@ -0,0 +1,202 @@
+/*
+ * kernel/include/page.h - Page Frame Descriptors
+ *
+ * Every physical page frame has one struct page in a single array
+ * indexed by page frame number (pfn = physical address >> PAGE_SHIFT).
+ * The array is sized and populated from the E820 boot memory map.
+ *
+ * The descriptor is kept at exactly 32 bytes so two share a 64-byte
+ * cache line, and its hot fields (flags, refcount) share the first
+ * 32-bit word so fault and reclaim paths touch them with one load.
+ * LRU links are frame numbers, not pointers, so the layout is the
+ * same on i686 and x86_64 (and in host-side tests).
+ *
+ * Usage:
+ *   struct page *pg = pfn_to_page(addr >> PAGE_SHIFT);
+ *   if (!(pg->flags & PG_RESERVED)) { ... }
+ */
+
+#ifndef KERNEL_INCLUDE_PAGE_H
+#define KERNEL_INCLUDE_PAGE_H
+
+#include <types.h>
+#include <e820.h>
+
+/*
+ * =============================================================================
+ * Page Constants
+ * =============================================================================
+ */
+#define PAGE_SHIFT      12
+#define PAGE_SIZE       (1U << PAGE_SHIFT)
+#define PAGE_MASK       (~(PAGE_SIZE - 1))
+
+/* Highest frame count tracked: 4GB of physical memory */
+#define PAGE_MAX_FRAMES (1U << (32 - PAGE_SHIFT))
+
+/* Terminator for frame-number links (lru_next / lru_prev) */
+#define PAGE_NONE       0xFFFFFFFFU
+
+/*
+ * =============================================================================
+ * Page Flags (struct page.flags)
+ * =============================================================================
+ */
+#define PG_RESERVED     0x0001  /* Not allocatable: hole, BIOS, kernel image */
+#define PG_KERNEL       0x0002  /* Owned by the kernel (heap, page tables) */
+#define PG_LRU          0x0004  /* On an LRU list */
+#define PG_ACTIVE       0x0008  /* On the active (vs inactive) LRU list */
+#define PG_REFERENCED   0x0010  /* Accessed since the last reclaim scan */
+#define PG_DIRTY        0x0020  /* Modified, must be written back */
+#define PG_LOCKED       0x0040  /* Under I/O or otherwise pinned */
+#define PG_HEAD         0x0080  /* First frame of a multi-frame block */
+#define PG_TAIL         0x0100  /* Non-first frame of a multi-frame block */
+#define PG_PGTABLE      0x0200  /* Holds a page directory or page table */
+
+/*
+ * struct page - Physical page frame descriptor (32 bytes)
+ *
+ * Offset  Size  Field
+ *   0      2    flags      \  first word: hot fields
+ *   2      2    refcount   /
+ *   4      2    mapcount
+ *   6      1    order
+ *   7      1    (padding)
+ *   8      4    lru_next
+ *  12      4    lru_prev
+ *  16      4    owner
+ *  20      4    index
+ *  24      4    private
+ *  28      4    (reserved)
+ */
+struct page {
+    uint16_t flags;         /* PG_* bits */
+    uint16_t refcount;      /* References held; 0 = free */
+    uint16_t mapcount;      /* Page table entries mapping this frame */
+    uint8_t  order;         /* log2(frames) of the block when PG_HEAD */
+    uint8_t  pad;
+    uint32_t lru_next;      /* Next frame on LRU list, or PAGE_NONE */
+    uint32_t lru_prev;      /* Previous frame on LRU list, or PAGE_NONE */
+    uint32_t owner;         /* Owning process id, 0 = kernel */
+    uint32_t index;         /* Virtual page number in the owner's space */
+    uint32_t private;       /* Allocator-private data */
+    uint32_t reserved;
+};
+
+/*
+ * =============================================================================
+ * Page Array
+ * =============================================================================
+ */
+
+/* Descriptor array, indexed by page frame number */
+extern struct page *page_array;
+
+/* Number of descriptors in page_array (highest tracked pfn + 1) */
+extern uint32_t page_count;
+
+/*
+ * pfn_to_page - Get the descriptor for a frame number
+ */
+static inline struct page *pfn_to_page(uint32_t pfn)
+{
+    return &page_array[pfn];
+}
+
+/*
+ * page_to_pfn - Get the frame number of a descriptor
+ */
+static inline uint32_t page_to_pfn(const struct page *pg)
+{
+    return (uint32_t)(pg - page_array);
+}
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * page_array_frames - Compute the descriptor count for a memory map
+ *
+ * Returns one past the highest frame fully covered by a usable region,
+ * capped at PAGE_MAX_FRAMES.
+ *
+ * @map: E820 entries
+ * @count: Number of entries
+ *
+ * Returns: Number of struct page descriptors needed
+ */
+uint32_t page_array_frames(const struct e820_entry *map, uint32_t count);
+
+/*
+ * page_array_build - Populate a descriptor array from a memory map
+ *
+ * Marks every frame PG_RESERVED, then clears the flag for frames that
+ * lie entirely inside a usable region. Links are set to PAGE_NONE and
+ * all other fields to zero. Reserved regions take priority over usable
+ * ones where they overlap.
+ *
+ * @array: Descriptor storage, at least @nframes entries
+ * @nframes: Number of descriptors (from page_array_frames)
+ * @map: E820 entries
+ * @count: Number of entries
+ *
+ * Returns: Number of usable (non-reserved) frames
+ */
+uint32_t page_array_build(struct page *array, uint32_t nframes,
+                          const struct e820_entry *map, uint32_t count);
+
+/*
+ * page_reserve_range - Mark a physical range reserved
+ *
+ * Frames partially covered by [start, end) are reserved too.
+ *
+ * @start: Physical start address
+ * @end: Physical end address (exclusive)
+ */
+void page_reserve_range(uint32_t start, uint32_t end);
+
+/*
+ * page_alloc - Allocate 2^order physically contiguous frames
+ *
+ * Finds a run of free frames aligned to its own size (so an order-10
+ * block is a valid 4MB large page). The first descriptor is returned
+ * with refcount 1; multi-frame blocks are marked PG_HEAD / PG_TAIL.
+ *
+ * @order: log2 of the number of frames (0 = single 4KB frame)
+ *
+ * Returns: Descriptor of the first frame, or NULL if no run is free
+ */
+struct page *page_alloc(uint32_t order);
+
+/*
+ * page_free - Drop a reference to a block from page_alloc
+ *
+ * When the last reference goes, every frame of the block is freed.
+ *
+ * @pg: First frame of the block
+ */
+void page_free(struct page *pg);
+
+/*
+ * page_split_block - Turn a multi-frame block into independent frames
+ *
+ * Each frame becomes an order-0 allocation with refcount 1, so it can
+ * be freed on its own (used when a large page is split into 4KB pages).
+ *
+ * @pg: First frame (PG_HEAD) of the block
+ */
+void page_split_block(struct page *pg);
+
+/*
+ * page_init - Build page_array from the boot memory map
+ *
+ * Places the array right after the kernel image, then reserves the
+ * first 1MB (BIOS, boot data, VGA), the kernel image and the array
+ * itself. Panics if the boot memory map has no usable memory.
+ */
+void page_init(void);
+
+#endif /* KERNEL_INCLUDE_PAGE_H */
@@ -0,0 +1,72 @@
+/*
+ * kernel/include/pic.h - 8259A Programmable Interrupt Controller
+ *
+ * Two cascaded 8259As provide the 16 legacy ISA IRQs. The kernel only
+ * uses them when there is no local APIC; otherwise they are remapped
+ * out of the exception range and fully masked so they cannot raise
+ * spurious interrupts on vectors 8-15.
+ *
+ * Every operation is port I/O to an ISA-speed device, roughly a
+ * microsecond each, which is why EOI through the PIC is slow.
+ */
+
+#ifndef KERNEL_INCLUDE_PIC_H
+#define KERNEL_INCLUDE_PIC_H
+
+#include <types.h>
+
+/*
+ * =============================================================================
+ * I/O Ports
+ * =============================================================================
+ */
+#define PIC1_CMD        0x20    /* Master command / status */
+#define PIC1_DATA       0x21    /* Master interrupt mask */
+#define PIC2_CMD        0xA0    /* Slave command / status */
+#define PIC2_DATA       0xA1    /* Slave interrupt mask */
+
+/*
+ * =============================================================================
+ * Commands
+ * =============================================================================
+ */
+#define PIC_ICW1_INIT   0x11    /* ICW1: init, cascade, expect ICW4 */
+#define PIC_ICW4_8086   0x01    /* ICW4: 8086 mode */
+#define PIC_EOI         0x20    /* OCW2: non-specific end of interrupt */
+
+#define PIC_CASCADE_IRQ 2       /* Slave is wired to master IRQ 2 */
+#define PIC_IRQS        16
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * pic_init - Remap both PICs and mask every line
+ *
+ * @vector_base: Vector for IRQ 0; IRQ n is delivered on vector_base + n
+ */
+void pic_init(uint8_t vector_base);
+
+/*
+ * pic_mask / pic_unmask - Disable or enable one IRQ line
+ *
+ * Unmasking a slave line also unmasks the cascade on the master.
+ *
+ * @irq: ISA IRQ (0-15)
+ */
+void pic_mask(uint8_t irq);
+void pic_unmask(uint8_t irq);
+
+/*
+ * pic_eoi - Acknowledge an IRQ
+ *
+ * Slave IRQs need an EOI to both chips.
+ *
+ * @irq: ISA IRQ (0-15)
+ */
+void pic_eoi(uint8_t irq);
+
+#endif /* KERNEL_INCLUDE_PIC_H */
@@ -0,0 +1,76 @@
+/*
+ * kernel/include/pit.h - 8253/8254 Programmable Interval Timer
+ *
+ * The PIT counts a fixed 1.193182 MHz input clock, so it is the
+ * kernel's reference for calibrating faster clocks:
+ *
+ *   - Channel 2 (gated by port 0x61, normally the PC speaker) runs a
+ *     one-shot countdown whose end is visible by polling, with no IRQ.
+ *     That window is used to count TSC cycles.
+ *   - Channel 0 is set up as a free-running 16-bit counter and read
+ *     as a fallback clocksource when the TSC is not reliable.
+ */
+
+#ifndef KERNEL_INCLUDE_PIT_H
+#define KERNEL_INCLUDE_PIT_H
+
+#include <types.h>
+
+#define PIT_HZ          1193182     /* Input clock */
+
+/*
+ * =============================================================================
+ * I/O Ports
+ * =============================================================================
+ */
+#define PIT_CH0         0x40
+#define PIT_CH2         0x42
+#define PIT_CMD         0x43
+#define PIT_GATE        0x61        /* Keyboard controller port B */
+
+/* Command byte: channel[7:6], access[5:4], mode[3:1], BCD[0] */
+#define PIT_SEL_CH0     0x00
+#define PIT_SEL_CH2     0x80
+#define PIT_ACCESS_LOHI 0x30        /* Low byte then high byte */
+#define PIT_LATCH       0x00        /* Counter latch command */
+#define PIT_MODE0       0x00        /* Interrupt on terminal count */
+#define PIT_MODE2       0x04        /* Rate generator */
+
+/* Port 0x61 bits */
+#define PIT_GATE_CH2    0x01        /* Channel 2 gate input */
+#define PIT_SPEAKER     0x02        /* Speaker data enable */
+#define PIT_OUT_CH2     0x20        /* Channel 2 output (read-only) */
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * pit_measure_tsc - Count TSC cycles over a channel 2 countdown
+ *
+ * Leaves the speaker disabled and channel 2 gated off.
+ *
+ * @ticks: Countdown length in PIT ticks (1-65535)
+ *
+ * Returns: TSC cycles elapsed, or 0 if the countdown never ended
+ *          (no PIT)
+ */
+uint64_t pit_measure_tsc(uint16_t ticks);
+
+/*
+ * pit_clocksource_init - Start channel 0 as a free-running counter
+ */
+void pit_clocksource_init(void);
+
+/*
+ * pit_read_ticks - Ticks since pit_clocksource_init(), extended to 64 bits
+ *
+ * The hardware counter wraps every 65536 ticks (~55 ms). Wraps are
+ * detected on each read, so this must be called at least that often
+ * for the count to stay exact.
+ */
+uint64_t pit_read_ticks(void);
+
+#endif /* KERNEL_INCLUDE_PIT_H */
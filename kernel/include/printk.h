@@ -2,8 +2,15 @@
  * kernel/include/printk.h - Kernel Logging Interface
  *
  * Provides printf-like formatted output for kernel messages with
- * configurable log levels. Output goes to both serial (primary)
- * and VGA (secondary) for maximum visibility.
+ * configurable log levels. Output goes to every registered console
+ * (console.h) whose own level admits the message: COM1 and VGA by
+ * default.
+ *
+ * Messages are first recorded in the kernel log, a lock-free ring of
+ * timestamped records, and printed on the consoles from there: by a
+ * tasklet once printk_init_async() has run, synchronously before that
+ * and after panic(). The last PRB_RECORDS messages stay readable with
+ * dmesg_read().
  *
  * Log Levels:
  *   LOG_ERROR (0) - Failures requiring attention
@@ -24,12 +31,22 @@
  *   %c  - character (char)
  *   %p  - pointer (void *) - printed as 0xXXXXXXXX
  *   %%  - literal percent sign
+ *
+ * Between the '%' and the specifier, as in C:
+ *   -       left-align in the field
+ *   0       pad numbers with zeros instead of spaces
+ *   N or *  minimum field width
+ *   .N, .*  minimum digits for numbers, maximum characters for %s
+ *   l, ll   long / long long (e.g. %llu, %016llx for 64-bit values)
+ *   z       size_t
  */
 
 #ifndef KERNEL_INCLUDE_PRINTK_H
 #define KERNEL_INCLUDE_PRINTK_H
 
 #include <types.h>
+#include <jump_label.h>
+#include <ratelimit.h>
 
 /*
  * =============================================================================
@@ -37,7 +54,8 @@
  * =============================================================================
  *
  * Messages with level > LOG_LEVEL are filtered at compile time.
- * Set LOG_LEVEL in Makefile or here for default.
+ * Set LOG_LEVEL in Makefile or here for default. klog() messages are
+ * also filtered at run time, per subsystem (see below).
  */
 #define LOG_ERROR   0
 #define LOG_WARN    1
@@ -49,6 +67,101 @@
 #define LOG_LEVEL   LOG_DEBUG
 #endif
 
+/*
+ * =============================================================================
+ * Per-Subsystem Log Levels
+ * =============================================================================
+ *
+ * klog(subsys, level, fmt, ...) prints like printk() when @level is
+ * within the subsystem's runtime level, and otherwise evaluates none
+ * of its arguments. LOG_WARN..LOG_INFO sites test a cached level byte;
+ * LOG_DEBUG sites are a static_branch_unlikely() on the subsystem's
+ * debug key, so a disabled debug message costs one NOP.
+ *
+ * Levels start at LOG_DEFAULT_LEVEL and are set with log_set_level()
+ * or on the kernel command line (`make CMDLINE="log.mm=debug"`):
+ *   loglevel=<level>         every subsystem
+ *   log.<subsys>=<level>     one subsystem
+ *   console.<name>=<level>   one console sink, or "off" (console.h)
+ * where <level> is error, warn, info, debug or 0-3.
+ *
+ * Usage:
+ *   klog(LOG_SYS_MM, LOG_DEBUG, "mm: map %p -> %p\n", virt, phys);
+ */
+enum log_subsys {
+    LOG_SYS_CORE,               /* Boot, panic, everything else */
+    LOG_SYS_MM,                 /* Page frames, hugepages, accounting */
+    LOG_SYS_IRQ,                /* Interrupt controllers, softirqs */
+    LOG_SYS_TIME,               /* ktime, tick, timers, hrtimers */
+    LOG_SYS_SERIAL,             /* UART driver */
+    LOG_SYS_COUNT
+};
+
+/* Runtime level of every subsystem at boot; LOG_DEBUG keys start off */
+#define LOG_DEFAULT_LEVEL   LOG_INFO
+
+/* Cached levels and debug keys; change them with log_set_level() */
+extern uint8_t log_levels[LOG_SYS_COUNT];
+extern struct static_key log_debug_keys[LOG_SYS_COUNT];
+
+/*
+ * klog_enabled - Whether @subsys prints messages of @level
+ *
+ * @subsys and @level must be constants.
+ */
+#define klog_enabled(subsys, level)                                         \
+    ((level) == LOG_DEBUG ? static_branch_unlikely(&log_debug_keys[subsys]) \
+                          : (level) <= log_levels[subsys])
+
+/*
+ * klog - printk() filtered by the subsystem's runtime level
+ */
+#define klog(subsys, level, ...)                                            \
+    do {                                                                    \
+        if ((level) <= LOG_LEVEL && klog_enabled(subsys, level)) {          \
+            printk((level), __VA_ARGS__);                                   \
+        }                                                                   \
+    } while (0)
+
+/*
+ * =============================================================================
+ * Rate-Limited Messages
+ * =============================================================================
+ *
+ * printk_ratelimited(level, fmt, ...) is printk() for paths that can
+ * run thousands of times a second, like interrupt handlers for a
+ * misbehaving device. Each call site has its own bucket of
+ * RATELIMIT_BURST messages per RATELIMIT_INTERVAL_NS (ratelimit.h);
+ * past that, messages are dropped and counted, and the count is
+ * printed as "<function>: N messages suppressed" when the site next
+ * gets a token. Suppressed messages cost a clock read and a compare,
+ * and their arguments are not evaluated.
+ *
+ * Usage:
+ *   printk_ratelimited(LOG_WARN, "Stray interrupt on vector %u\n", v);
+ */
+#define printk_ratelimited(level, ...)                                      \
+    do {                                                                    \
+        static struct ratelimit_state _rs =                                 \
+            RATELIMIT_STATE_INIT(RATELIMIT_INTERVAL_NS, RATELIMIT_BURST);   \
+        if ((level) <= LOG_LEVEL && printk_ratelimit(&_rs, (level),        \
+                                                     __func__)) {           \
+            printk((level), __VA_ARGS__);                                   \
+        }                                                                   \
+    } while (0)
+
+/*
+ * struct printk_stats - Kernel log counters
+ */
+struct printk_stats {
+    uint32_t records;           /* Records written since boot */
+    uint32_t dropped;           /* Overwritten before reaching the consoles */
+    uint32_t truncated;         /* Messages cut to fit a record */
+    uint32_t direct;            /* Drains run by a printk() caller that was
+                                   half a ring ahead of the consoles */
+    uint32_t suppressed;        /* Dropped by printk_ratelimited() */
+};
+
 /*
  * =============================================================================
  * Public Functions
@@ -58,8 +171,9 @@
 /*
  * printk - Print formatted kernel message
  *
- * Outputs a formatted message to both serial and VGA console.
- * Messages are prefixed with the log level (e.g., "[INFO] ").
+ * Records a formatted message in the kernel log, for output on the
+ * registered consoles. Messages are prefixed with the log level
+ * (e.g., "[INFO] ") on output.
  *
  * If level > LOG_LEVEL, the message is silently discarded.
  *
@@ -69,4 +183,109 @@
  */
 void printk(int level, const char *fmt, ...);
 
+/*
+ * printk_ratelimit - Whether a rate-limited message may be printed
+ *
+ * Takes a token from @rs at the current ktime. When the bucket refills
+ * after dropping messages, first prints how many, at @level.
+ *
+ * @rs: The call site's bucket
+ * @level: Level of the message
+ * @site: Name for the suppressed report, normally __func__
+ *
+ * Returns: true if the caller should print its message
+ */
+bool printk_ratelimit(struct ratelimit_state *rs, int level,
+                      const char *site);
+
+/*
+ * printk_init_async - Print from a tasklet instead of in printk()
+ *
+ * Call once softirqs are set up.
+ */
+void printk_init_async(void);
+
+/*
+ * printk_flush - Print every record logged so far
+ *
+ * Returns at once if a drain is already running, e.g. in the context
+ * this call interrupted.
+ */
+void printk_flush(void);
+
+/*
+ * printk_set_sync - Select synchronous or deferred console output
+ *
+ * In sync mode printk() prints its message before returning. Entering
+ * it flushes the log first, taking over from any drain in progress:
+ * meant for panic(), where an interrupted drain never resumes.
+ *
+ * @sync: true for synchronous output
+ */
+void printk_set_sync(bool sync);
+
+/*
+ * printk_get_stats - Kernel log counters since boot
+ */
+const struct printk_stats *printk_get_stats(void);
+
+/*
+ * log_set_level - Set a subsystem's runtime log level
+ *
+ * Enables the subsystem's LOG_DEBUG sites when @level is LOG_DEBUG and
+ * patches them back to NOPs otherwise.
+ *
+ * @subsys: LOG_SYS_*
+ * @level: LOG_ERROR..LOG_DEBUG
+ *
+ * Returns: 0 on success, -EINVAL for an unknown subsystem or level
+ */
+int log_set_level(unsigned int subsys, int level);
+
+/*
+ * log_get_level - A subsystem's runtime log level, or -EINVAL
+ */
+int log_get_level(unsigned int subsys);
+
+/*
+ * log_subsys_name - Command-line name of a subsystem, or NULL
+ */
+const char *log_subsys_name(unsigned int subsys);
+
+/*
+ * log_parse_cmdline - Apply the log options of a kernel command line
+ *
+ * Options are separated by spaces; ones that are not log or console
+ * options are skipped, and a bad one does not stop the rest from
+ * applying. Console options only reach consoles already registered.
+ *
+ * @cmdline: Command line, NUL-terminated
+ *
+ * Returns: 0, or -EINVAL if a log or console option was not understood
+ */
+int log_parse_cmdline(const char *cmdline);
+
+/*
+ * dmesg_first_seq - Sequence number of the oldest record still in the log
+ */
+uint32_t dmesg_first_seq(void);
+
+/*
+ * dmesg_read - Read one log record as a line of text
+ *
+ * Formats the record at *@seq, or the oldest one after it if it has
+ * been overwritten, as "[seconds.micros] [LEVEL] message".
+ *
+ * Usage:
+ *   uint32_t seq = dmesg_first_seq();
+ *   while (dmesg_read(&seq, line, sizeof(line)) > 0) { ... }
+ *
+ * @seq: In: record to read; out: the record after the one read
+ * @buf: Destination, NUL-terminated (truncated to fit)
+ * @size: Size of @buf
+ *
+ * Returns: Length of the line, or 0 once there are no more records
+ */
+size_t dmesg_read(uint32_t *seq, char *buf, size_t size);
+
 #endif /* KERNEL_INCLUDE_PRINTK_H */
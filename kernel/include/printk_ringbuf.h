@@ -0,0 +1,106 @@
+/*
+ * kernel/include/printk_ringbuf.h - Lock-free printk record ring
+ *
+ * The kernel log is a ring of fixed-size records. Writers never take a
+ * lock: a record is reserved by atomically incrementing the head
+ * sequence number, filled in place, then committed. Any context may
+ * write, including one that interrupted another writer.
+ *
+ * Readers (the console drain, dmesg) never block writers either. Each
+ * slot carries the sequence number it holds and whether it has been
+ * committed; a reader copies a record out and re-checks that word, so
+ * a record overwritten mid-copy is detected and skipped.
+ *
+ * Once the ring is full the oldest records are overwritten. Readers
+ * that fall behind skip ahead to the oldest record still retained.
+ *
+ * Sequence numbers are 32-bit and compared modulo 2^31, so a reader
+ * must not fall more than 2^30 records behind.
+ */
+
+#ifndef KERNEL_INCLUDE_PRINTK_RINGBUF_H
+#define KERNEL_INCLUDE_PRINTK_RINGBUF_H
+
+#include <types.h>
+
+#define PRB_RECORDS         256         /* Must be a power of two */
+#define PRB_TEXT_MAX        240         /* Text bytes per record, with NUL */
+
+/*
+ * struct printk_record - One printk() call
+ */
+struct printk_record {
+    uint64_t ts_nsec;           /* ktime when the record was reserved */
+    uint32_t seq;               /* Sequence number */
+    uint16_t len;               /* Text length, excluding the NUL */
+    uint8_t level;              /* LOG_* level, or PRB_LEVEL_NONE */
+    uint8_t cpu;                /* CPU that wrote it */
+    char text[PRB_TEXT_MAX];
+};
+
+#define PRB_LEVEL_NONE      0xFF
+
+/*
+ * struct prb_slot - A record and its state
+ *
+ * @id is (seq << 1) | committed. Writers store it before touching the
+ * record and again after; readers check it on both sides of the copy.
+ */
+struct prb_slot {
+    volatile uint32_t id;
+    struct printk_record rec;
+};
+
+struct printk_ringbuf {
+    struct prb_slot slots[PRB_RECORDS];
+    volatile uint32_t head;     /* Next sequence number to reserve */
+};
+
+/*
+ * prb_init - Empty a ring
+ */
+void prb_init(struct printk_ringbuf *rb);
+
+/*
+ * prb_reserve - Claim the next record for writing
+ *
+ * Sets the record's sequence number; the caller fills in the rest and
+ * then calls prb_commit(). Readers stop at a reserved record until it
+ * is committed, so the window between the two should be short.
+ *
+ * Returns: The record, inside the ring
+ */
+struct printk_record *prb_reserve(struct printk_ringbuf *rb);
+
+/*
+ * prb_commit - Publish a record returned by prb_reserve()
+ */
+void prb_commit(struct printk_ringbuf *rb, struct printk_record *rec);
+
+/*
+ * prb_read - Copy out the record at *@seq, or the oldest one after it
+ *
+ * If *@seq has been overwritten, *@seq is moved forward to the oldest
+ * record still retained; the difference is the number of records lost.
+ *
+ * @rb: Ring to read
+ * @seq: In: sequence number wanted; out: the one actually read
+ * @out: Copy of the record, or NULL to only check that it is readable
+ *
+ * Returns: 0 on success, -EAGAIN if the record has not been committed
+ *          yet (*@seq == prb_head() when the reader has caught up)
+ */
+int prb_read(const struct printk_ringbuf *rb, uint32_t *seq,
+             struct printk_record *out);
+
+/*
+ * prb_head - Sequence number the next record will get
+ */
+uint32_t prb_head(const struct printk_ringbuf *rb);
+
+/*
+ * prb_first_seq - Sequence number of the oldest record retained
+ */
+uint32_t prb_first_seq(const struct printk_ringbuf *rb);
+
+#endif /* KERNEL_INCLUDE_PRINTK_RINGBUF_H */
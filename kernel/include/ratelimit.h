@@ -0,0 +1,58 @@
+/*
+ * kernel/include/ratelimit.h - Message rate limiting
+ *
+ * A ratelimit_state is a bucket of @burst tokens refilled every
+ * @interval nanoseconds of ktime. Each message takes a token; a message
+ * finding the bucket empty is suppressed and counted. The count is
+ * handed back when the bucket next refills, so the caller can report
+ * how many messages it dropped, at most once per interval.
+ *
+ * Within a window the check is one timestamp compare and a token
+ * decrement. State is updated without locks: an interrupt landing in
+ * the middle of a check can at worst let one extra message through.
+ *
+ * printk_ratelimited() (printk.h) gives each call site its own state.
+ * No kernel dependencies, so it is usable from host tests.
+ */
+
+#ifndef KERNEL_INCLUDE_RATELIMIT_H
+#define KERNEL_INCLUDE_RATELIMIT_H
+
+#include <types.h>
+
+/* Defaults: 10 messages per 5 seconds */
+#define RATELIMIT_INTERVAL_NS   5000000000ULL
+#define RATELIMIT_BURST         10
+
+/*
+ * struct ratelimit_state - A token bucket
+ */
+struct ratelimit_state {
+    uint64_t interval;          /* Refill period, ns; 0 = never limit */
+    uint64_t window_end;        /* Next refill; 0 until first used */
+    uint32_t burst;             /* Tokens per refill; 0 = always limit */
+    uint32_t tokens;            /* Left until window_end */
+    uint32_t missed;            /* Suppressed since the last refill */
+    uint32_t suppressed;        /* Suppressed since boot */
+};
+
+#define RATELIMIT_STATE_INIT(interval_ns, burst_)                           \
+    { .interval = (interval_ns), .burst = (burst_) }
+
+#define DEFINE_RATELIMIT_STATE(name, interval_ns, burst_)                   \
+    struct ratelimit_state name = RATELIMIT_STATE_INIT(interval_ns, burst_)
+
+/*
+ * ratelimit_check - Take a token for a message
+ *
+ * @rs: Bucket
+ * @now: Current ktime, ns
+ * @missed: Output: messages suppressed since the previous refill;
+ *          non-zero only on a call that refills the bucket
+ *
+ * Returns: true if the message may be printed
+ */
+bool ratelimit_check(struct ratelimit_state *rs, uint64_t now,
+                     uint32_t *missed);
+
+#endif /* KERNEL_INCLUDE_RATELIMIT_H */
@@ -0,0 +1,106 @@
+/*
+ * kernel/include/rbtree.h - Intrusive Red-Black Tree
+ *
+ * A struct rb_node is embedded in the object being stored; the tree
+ * never allocates. Callers do their own ordered descent to find the
+ * insertion point, link the node with rb_link_node(), then rebalance
+ * with rb_insert_color(). This keeps comparison logic (and its cost)
+ * in the caller, with no function pointer per comparison.
+ *
+ * Augmented trees: a root may carry an augment callback that recomputes
+ * one node's cached subtree value (e.g. a maximum) from the node and
+ * its children. The tree calls it on every node whose subtree changes
+ * during insert, erase and rotation, so cached values are always valid
+ * for O(log n) pruned searches. Plain trees pass NULL.
+ *
+ * Usage:
+ *   struct rb_node **link = &root->node, *parent = NULL;
+ *   while (*link) {
+ *       parent = *link;
+ *       link = key < rb_entry(parent, struct foo, rb)->key ?
+ *              &parent->left : &parent->right;
+ *   }
+ *   rb_link_node(&foo->rb, parent, link);
+ *   rb_insert_color(&foo->rb, root);
+ */
+
+#ifndef KERNEL_INCLUDE_RBTREE_H
+#define KERNEL_INCLUDE_RBTREE_H
+
+#include <types.h>
+
+#define RB_RED      0
+#define RB_BLACK    1
+
+struct rb_node {
+    struct rb_node *parent;
+    struct rb_node *left;
+    struct rb_node *right;
+    int color;                  /* RB_RED or RB_BLACK */
+};
+
+/* Recompute @node's augmented value from itself and its children */
+typedef void (*rb_augment_fn)(struct rb_node *node);
+
+struct rb_root {
+    struct rb_node *node;       /* Root node, NULL when empty */
+    rb_augment_fn augment;      /* NULL for a plain tree */
+};
+
+#define RB_ROOT_INIT(fn)    { NULL, (fn) }
+
+/* Get the struct containing an embedded rb_node */
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
+/*
+ * rb_link_node - Attach a new node at a leaf position
+ *
+ * @node: Node to insert
+ * @parent: Parent found by the caller's descent (NULL for empty tree)
+ * @link: &parent->left, &parent->right, or &root->node
+ */
+static inline void rb_link_node(struct rb_node *node, struct rb_node *parent,
+                                struct rb_node **link)
+{
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = RB_RED;
+    *link = node;
+}
+
+/*
+ * rb_insert_color - Rebalance after rb_link_node()
+ *
+ * @node: Newly linked node
+ * @root: Tree
+ */
+void rb_insert_color(struct rb_node *node, struct rb_root *root);
+
+/*
+ * rb_erase - Remove a node from the tree
+ *
+ * @node: Node to remove
+ * @root: Tree
+ */
+void rb_erase(struct rb_node *node, struct rb_root *root);
+
+/*
+ * rb_propagate - Recompute augmented values from a node to the root
+ *
+ * Call after changing a node's own augmented input (not its position).
+ *
+ * @node: Changed node
+ * @root: Tree
+ */
+void rb_propagate(struct rb_node *node, struct rb_root *root);
+
+/*
+ * In-order traversal. Each returns NULL at the end.
+ */
+struct rb_node *rb_first(const struct rb_root *root);
+struct rb_node *rb_last(const struct rb_root *root);
+struct rb_node *rb_next(const struct rb_node *node);
+struct rb_node *rb_prev(const struct rb_node *node);
+
+#endif /* KERNEL_INCLUDE_RBTREE_H */
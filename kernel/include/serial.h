@@ -2,7 +2,23 @@
  * kernel/include/serial.h - Serial Port (UART) Driver Interface
  *
  * Provides serial port communication for debug output. Uses COM1 (0x3F8)
- * as the primary debug serial port with polling-based I/O.
+ * as the primary debug serial port (the console); serial_putchar(),
+ * serial_puts() and serial_write() write to it.
+ *
+ * Each COM port is a struct serial_port with its own baud rate, FIFO
+ * depth, rings and counters. Any port can be (re)initialized at
+ * runtime with serial_port_init() and written with serial_port_write(),
+ * e.g. to keep a trace channel off the console.
+ *
+ * Output is polled until serial_irq_init(); after that it is queued on
+ * a per-port TX ring and drained by the transmitter-empty interrupt,
+ * one FIFO load per interrupt, so callers never wait on the line.
+ * panic() switches the console back to polling with serial_set_sync().
+ *
+ * Input is interrupt-driven on every port that is present (COM1-COM4):
+ * the received-data interrupt empties the UART FIFO into a per-port
+ * ring, which serial_read() and serial_read_line() consume. Input is
+ * cooked like a terminal's: CR and CR LF arrive as a single LF.
  *
  * The serial driver is essential for:
  *   - Debug output visible in QEMU's -serial stdio
@@ -11,7 +27,8 @@
  *   - GDB debugging coordination
  *
  * Hardware: 16550A UART compatible
- * Configuration: 38400 baud, 8 data bits, no parity, 1 stop bit (8N1)
+ * Configuration: 115200 baud by default, 8 data bits, no parity,
+ *                1 stop bit (8N1)
  */
 
 #ifndef KERNEL_INCLUDE_SERIAL_H
@@ -29,6 +46,13 @@
 #define COM3_PORT 0x3E8
 #define COM4_PORT 0x2E8
 
+/* Port indexes for the serial_read*() calls */
+#define SERIAL_COM1         0
+#define SERIAL_COM2         1
+#define SERIAL_COM3         2
+#define SERIAL_COM4         3
+#define SERIAL_PORTS        4
+
 /*
  * =============================================================================
  * UART Register Offsets (from base port)
@@ -58,6 +82,29 @@
 #define SERIAL_MODEM_STATUS 6   /* Modem status register */
 #define SERIAL_SCRATCH      7   /* Scratch register */
 
+/*
+ * =============================================================================
+ * Interrupt Enable Register (IER) Bits
+ * =============================================================================
+ */
+#define SERIAL_IER_RX           0x01    /* Received data available */
+#define SERIAL_IER_THRE         0x02    /* TX holding register empty */
+#define SERIAL_IER_LSR          0x04    /* Receiver line status */
+
+/*
+ * =============================================================================
+ * Interrupt Identification Register (IIR) Values
+ * =============================================================================
+ */
+#define SERIAL_IIR_NONE         0x01    /* No interrupt pending */
+#define SERIAL_IIR_ID_MASK      0x0E    /* Interrupt source */
+#define SERIAL_IIR_MSR          0x00    /* Modem status change */
+#define SERIAL_IIR_THRE         0x02    /* TX holding register empty */
+#define SERIAL_IIR_RX           0x04    /* Received data available */
+#define SERIAL_IIR_LSR          0x06    /* Receiver line status */
+#define SERIAL_IIR_RX_TIMEOUT   0x0C    /* Data below trigger, line idle */
+#define SERIAL_IIR_FIFO_MASK    0xC0    /* 11: FIFOs enabled and working */
+
 /*
  * =============================================================================
  * Line Control Register (LCR) Bits
@@ -72,7 +119,16 @@
  * =============================================================================
  */
 #define SERIAL_LSR_DATA_READY   0x01    /* Data available in RX buffer */
+#define SERIAL_LSR_OVERRUN      0x02    /* RX FIFO overrun, byte lost */
+#define SERIAL_LSR_PARITY       0x04    /* Parity error */
+#define SERIAL_LSR_FRAMING      0x08    /* Framing error (bad stop bit) */
+#define SERIAL_LSR_BREAK        0x10    /* Break condition */
 #define SERIAL_LSR_TX_EMPTY     0x20    /* TX holding register empty */
+#define SERIAL_LSR_TX_IDLE      0x40    /* TX FIFO and shift register empty */
+
+/* Error bits; reading LSR clears them */
+#define SERIAL_LSR_ERRORS       (SERIAL_LSR_OVERRUN | SERIAL_LSR_PARITY | \
+                                 SERIAL_LSR_FRAMING | SERIAL_LSR_BREAK)
 
 /*
  * =============================================================================
@@ -84,6 +140,9 @@
 #define SERIAL_FCR_CLEAR_TX     0x04    /* Clear transmit FIFO */
 #define SERIAL_FCR_TRIGGER_14   0xC0    /* 14-byte trigger level */
 
+/* Bytes the 16550A TX FIFO takes once it reports empty */
+#define SERIAL_FIFO_SIZE        16
+
 /*
  * =============================================================================
  * Modem Control Register (MCR) Bits
@@ -92,22 +151,138 @@
 #define SERIAL_MCR_DTR          0x01    /* Data Terminal Ready */
 #define SERIAL_MCR_RTS          0x02    /* Request To Send */
 #define SERIAL_MCR_OUT2         0x08    /* Auxiliary output 2 (IRQ enable) */
+#define SERIAL_MCR_LOOP         0x10    /* Loop TX back to RX internally */
 
 /*
  * =============================================================================
  * Baud Rate Divisors
  * =============================================================================
  *
- * Divisor = 115200 / baud_rate
+ * Divisor = 115200 / baud_rate (the 1.8432 MHz UART clock over 16)
  */
+#define SERIAL_BASE_BAUD        115200
 #define SERIAL_BAUD_115200      1
 #define SERIAL_BAUD_57600       2
 #define SERIAL_BAUD_38400       3
 #define SERIAL_BAUD_19200       6
 #define SERIAL_BAUD_9600        12
 
-/* Default baud rate for debug output */
-#define SERIAL_DEFAULT_BAUD     SERIAL_BAUD_38400
+/* Default baud rate (bits per second) for debug output */
+#define SERIAL_DEFAULT_BAUD     115200
+
+/* TX and RX ring sizes in bytes (powers of two) */
+#define SERIAL_TX_RING_SIZE     4096
+#define SERIAL_RX_RING_SIZE     1024
+
+/* TX FIFO depth without a working FIFO (8250/16450) */
+#define SERIAL_NO_FIFO_SIZE     1
+
+/* serial_read*() flag: return -EAGAIN instead of waiting */
+#define SERIAL_NONBLOCK         0x01
+
+/*
+ * struct serial_tx_stats - Interrupt-driven TX counters
+ */
+struct serial_tx_stats {
+    uint64_t queued;            /* Bytes put on the ring */
+    uint64_t irqs;              /* TX-empty interrupts handled */
+    uint64_t bursts;            /* FIFO loads written */
+    uint64_t full_waits;        /* Times a writer found the ring full */
+};
+
+/*
+ * struct serial_rx_stats - Receive counters for one port
+ */
+struct serial_rx_stats {
+    uint64_t bytes;             /* Bytes read from the UART */
+    uint64_t irqs;              /* Received-data interrupts handled */
+    uint64_t hw_overruns;       /* UART FIFO overruns (LSR OE) */
+    uint64_t sw_overruns;       /* Bytes dropped on a full ring */
+    uint64_t errors;            /* Parity, framing and break */
+};
+
+/*
+ * struct serial_rx_ring - Cooked input queue
+ *
+ * head and tail run freely and are masked on access. Filled from the
+ * interrupt handler, drained with interrupts disabled.
+ */
+struct serial_rx_ring {
+    uint8_t buf[SERIAL_RX_RING_SIZE];
+    uint32_t head;              /* Next free byte */
+    uint32_t tail;              /* Next byte to read */
+    uint32_t lines;             /* Queued '\n' bytes */
+    bool last_cr;               /* Last byte received was CR */
+};
+
+/*
+ * struct serial_port - One COM port
+ *
+ * The rings are only touched with interrupts disabled. The TX ring's
+ * head and tail run freely like the RX ring's.
+ */
+struct serial_port {
+    uint16_t base;              /* I/O port base */
+    uint8_t irq;                /* ISA IRQ, shared by COM1/3 and COM2/4 */
+    uint8_t ier;                /* Last value written to IER */
+    uint32_t baud;              /* Line rate, bits per second */
+    uint32_t fifo_size;         /* Bytes per TX burst */
+    bool present;               /* Found and configured */
+    bool irq_active;            /* TX ring and RX interrupts in use */
+    bool tx_armed;              /* IER THRE is enabled */
+    uint32_t tx_head;           /* Next byte to queue */
+    uint32_t tx_tail;           /* Next byte to send */
+    uint8_t tx_ring[SERIAL_TX_RING_SIZE];
+    struct serial_rx_ring rx;
+    struct serial_tx_stats tx_stats;
+    struct serial_rx_stats rx_stats;
+};
+
+/*
+ * =============================================================================
+ * RX Ring
+ * =============================================================================
+ */
+
+/*
+ * serial_rx_ring_init - Empty a ring
+ */
+void serial_rx_ring_init(struct serial_rx_ring *ring);
+
+/*
+ * serial_rx_ring_put - Queue one received byte
+ *
+ * CR is stored as LF, and an LF right after a CR is dropped.
+ *
+ * Returns: false if the ring was full and the byte was lost
+ */
+bool serial_rx_ring_put(struct serial_rx_ring *ring, uint8_t c);
+
+/*
+ * serial_rx_ring_count - Bytes queued
+ */
+uint32_t serial_rx_ring_count(const struct serial_rx_ring *ring);
+
+/*
+ * serial_rx_ring_read - Dequeue up to @len bytes
+ *
+ * Returns: Bytes copied to @buf
+ */
+size_t serial_rx_ring_read(struct serial_rx_ring *ring, void *buf,
+                           size_t len);
+
+/*
+ * serial_rx_ring_getline - Dequeue one line
+ *
+ * Copies the line without its LF and NUL-terminates it. A line longer
+ * than @size - 1 is returned in pieces. A full ring without an LF is
+ * returned as a line, so the writer can make progress.
+ *
+ * Returns: Length of the string in @buf, or -EAGAIN if no complete
+ *          line is queued
+ */
+int serial_rx_ring_getline(struct serial_rx_ring *ring, char *buf,
+                           size_t size);
 
 /*
  * =============================================================================
@@ -120,20 +295,155 @@
  *
  * Configures COM1 for serial communication:
  *   - Disables interrupts
- *   - Sets baud rate to 38400
+ *   - Sets baud rate to SERIAL_DEFAULT_BAUD
  *   - Configures 8N1 (8 data bits, no parity, 1 stop bit)
- *   - Enables and clears FIFOs
+ *   - Enables and clears FIFOs, and sizes the TX FIFO
  *   - Sets DTR, RTS, and OUT2
  *
- * Must be called before any other serial functions.
+ * Must be called before any other serial functions. Console output
+ * before it is dropped. Registers COM1 as the "com1" console, which
+ * prints every log level.
  */
 void serial_init(void);
 
+/*
+ * serial_irq_init - Switch output to the TX ring and enable input
+ *
+ * Probes COM2-COM4 and sets up those present like COM1, then moves
+ * every present port to interrupts, taking IRQ 4 (COM1/COM3) and
+ * IRQ 3 (COM2/COM4). Needs irq_init(). Until interrupts are enabled,
+ * queued bytes go out one FIFO load at a time as writers find the ring
+ * full.
+ *
+ * Returns: 0 on success, or the irq_request() error for IRQ 4 (console
+ *          output stays polled)
+ */
+int serial_irq_init(void);
+
+/*
+ * serial_port_init - Configure a COM port at runtime
+ *
+ * Probes the port if it was not found before. Output already queued
+ * on the port is sent at the old rate first. After serial_irq_init(),
+ * the port also moves to interrupts.
+ *
+ * @port: SERIAL_COM1 to SERIAL_COM4
+ * @baud: Bits per second; must divide SERIAL_BASE_BAUD
+ *
+ * Returns: 0 on success, -EINVAL for a bad index or baud rate,
+ *          -ENODEV if there is no UART, or the irq_request() error
+ */
+int serial_port_init(unsigned int port, uint32_t baud);
+
+/*
+ * serial_set_baud - Change a configured port's baud rate
+ *
+ * Queued output is sent at the old rate first.
+ *
+ * Returns: 0 on success, -EINVAL for a bad baud rate, -ENODEV for a
+ *          port that is not configured
+ */
+int serial_set_baud(unsigned int port, uint32_t baud);
+
+/*
+ * serial_console_register - Print kernel messages on a port
+ *
+ * Registers the port's console ("com1".."com4", see console.h), or
+ * re-enables it with a new level if it is already registered.
+ *
+ * @port: SERIAL_COM1 to SERIAL_COM4
+ * @level: Highest log level to print there
+ *
+ * Returns: 0 on success, -EINVAL for a bad index or level, -ENODEV if
+ *          the port is not configured
+ */
+int serial_console_register(unsigned int port, int level);
+
+/*
+ * serial_port_get - A port's state and counters
+ *
+ * Returns: The port, or NULL for a bad index
+ */
+const struct serial_port *serial_port_get(unsigned int port);
+
+/*
+ * serial_port_write - Write raw bytes to a port
+ *
+ * Queued on the port's TX ring like serial_write(), or polled out if
+ * the port is not on interrupts.
+ *
+ * Returns: 0 on success, -ENODEV for a port that is not configured
+ */
+int serial_port_write(unsigned int port, const void *buf, size_t len);
+
+/*
+ * serial_set_sync - Select polled or interrupt-driven console output
+ *
+ * Switching to polled output first drains the ring, so nothing queued
+ * is lost or reordered. panic() calls this before printing.
+ *
+ * @sync: true to poll every byte out, false to use the TX ring again
+ *        (if serial_irq_init() succeeded)
+ */
+void serial_set_sync(bool sync);
+
+/*
+ * serial_flush - Wait until everything queued on the console is in the UART
+ *
+ * Polls the ring out with the TX interrupt masked. Safe with interrupts
+ * disabled.
+ */
+void serial_flush(void);
+
+/*
+ * serial_get_tx_stats - Console TX ring counters
+ */
+const struct serial_tx_stats *serial_get_tx_stats(void);
+
+/*
+ * serial_port_present - Check whether a port was found
+ */
+bool serial_port_present(unsigned int port);
+
+/*
+ * serial_read - Read received bytes
+ *
+ * Waits for at least one byte unless @flags has SERIAL_NONBLOCK. The
+ * wait halts in cpu_idle(), with interrupts enabled, and is ended by
+ * the RX interrupt.
+ *
+ * @port: SERIAL_COM1 to SERIAL_COM4
+ * @buf: Destination
+ * @len: Maximum bytes to read
+ * @flags: 0 or SERIAL_NONBLOCK
+ *
+ * Returns: Bytes read, -EAGAIN if none are queued and SERIAL_NONBLOCK
+ *          is set, -ENODEV for a missing port
+ */
+int serial_read(unsigned int port, void *buf, size_t len, int flags);
+
+/*
+ * serial_read_line - Read one line of input
+ *
+ * Like serial_read(), but waits for a whole line; see
+ * serial_rx_ring_getline() for how it is returned.
+ *
+ * Returns: Line length, -EAGAIN, -ENODEV or -EINVAL for a zero @size
+ */
+int serial_read_line(unsigned int port, char *buf, size_t size, int flags);
+
+/*
+ * serial_get_rx_stats - Receive counters for a port
+ *
+ * Returns: Counters, or NULL for a bad port index
+ */
+const struct serial_rx_stats *serial_get_rx_stats(unsigned int port);
+
 /*
  * serial_putchar - Write a single character to serial port
  *
- * Waits for the transmit buffer to be empty (polling), then sends
- * the character. This is a blocking call.
+ * Queues the character on the TX ring, or sends it by polling in sync
+ * mode. Only waits when the ring is full.
  *
  * @c: Character to transmit
  */
@@ -142,7 +452,7 @@ void serial_putchar(char c);
 /*
  * serial_puts - Write a null-terminated string to serial port
  *
- * Sends each character of the string using serial_putchar().
+ * Queues the string like serial_putchar().
  * Automatically converts '\n' to '\r\n' for proper terminal display.
  *
  * @str: Null-terminated string to transmit
@@ -152,7 +462,7 @@ void serial_puts(const char *str);
 /*
  * serial_write - Write a buffer of bytes to serial port
  *
- * Sends exactly 'len' bytes from the buffer. Does not interpret
+ * Queues exactly 'len' bytes from the buffer. Does not interpret
  * the data (no newline conversion). Useful for binary data.
  *
  * @buf: Pointer to data buffer
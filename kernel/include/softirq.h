@@ -0,0 +1,166 @@
+/*
+ * kernel/include/softirq.h - Softirqs and tasklets (bottom halves)
+ *
+ * Interrupt handlers should only acknowledge the device and grab what
+ * cannot wait; the rest of the work is deferred to a softirq, which
+ * runs with interrupts enabled:
+ *
+ *   - on the way out of the outermost interrupt (irq_exit()), or
+ *   - in the per-CPU softirq thread (ksoftirqd_run()), when irq_exit()
+ *     has used up its budget or the softirq was raised from process
+ *     context.
+ *
+ * There is a fixed set of softirq vectors, run in priority order.
+ * Tasklets are one-shot work items queued on the HI or TASKLET vector;
+ * scheduling an already-queued tasklet is a no-op.
+ *
+ * Each vector's run count and execution time are accounted.
+ */
+
+#ifndef KERNEL_INCLUDE_SOFTIRQ_H
+#define KERNEL_INCLUDE_SOFTIRQ_H
+
+#include <types.h>
+#include <list.h>
+#include <ktime.h>
+
+enum {
+    HI_SOFTIRQ,                 /* High-priority tasklets */
+    TIMER_SOFTIRQ,              /* Timer wheel expiry */
+    TASKLET_SOFTIRQ,            /* Tasklets */
+    NR_SOFTIRQS
+};
+
+/*
+ * irq_exit() budget: rounds of re-raised softirqs, and wall time,
+ * before the rest is left to the softirq thread
+ */
+#define SOFTIRQ_MAX_RESTART     10
+#define SOFTIRQ_MAX_NS          (2ULL * NSEC_PER_MSEC)
+
+typedef void (*softirq_action_fn)(void);
+
+/*
+ * struct softirq_stat - Accounting for one vector
+ */
+struct softirq_stat {
+    uint64_t raised;            /* raise_softirq() calls */
+    uint64_t runs;              /* Handler invocations */
+    uint64_t time_ns;           /* Total handler time */
+    uint64_t max_ns;            /* Longest single invocation */
+};
+
+/*
+ * struct softirq_stats - Softirq accounting for this CPU
+ */
+struct softirq_stats {
+    struct softirq_stat vec[NR_SOFTIRQS];
+    uint64_t irq_exit_runs;     /* Processing passes from irq_exit() */
+    uint64_t thread_runs;       /* Processing passes from ksoftirqd_run() */
+    uint64_t deferred;          /* irq_exit() budget overruns */
+};
+
+/*
+ * struct tasklet - One-shot deferred work
+ */
+struct tasklet {
+    struct list_head entry;     /* Queue link; next == NULL when idle */
+    void (*func)(unsigned long data);
+    unsigned long data;
+};
+
+/*
+ * tasklet_init - Prepare a tasklet for first use
+ */
+static inline void tasklet_init(struct tasklet *t,
+                                void (*func)(unsigned long data),
+                                unsigned long data)
+{
+    t->entry.next = NULL;
+    t->entry.prev = NULL;
+    t->func = func;
+    t->data = data;
+}
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * softirq_init - Install the tasklet vectors
+ */
+void softirq_init(void);
+
+/*
+ * open_softirq - Set the handler for a vector
+ */
+void open_softirq(unsigned int nr, softirq_action_fn action);
+
+/*
+ * raise_softirq - Mark a vector pending
+ *
+ * Safe from any context. From an interrupt handler the vector runs at
+ * irq_exit(); from process context, in the softirq thread.
+ */
+void raise_softirq(unsigned int nr);
+
+/*
+ * raise_softirq_irqoff - raise_softirq() with interrupts already off
+ */
+void raise_softirq_irqoff(unsigned int nr);
+
+/*
+ * softirq_pending - Check for pending vectors
+ */
+bool softirq_pending(void);
+
+/*
+ * irq_enter - Mark entry to a hardware interrupt handler
+ */
+void irq_enter(void);
+
+/*
+ * irq_exit - Mark exit from a hardware interrupt handler
+ *
+ * Leaving the outermost interrupt runs pending softirqs, with
+ * interrupts enabled, unless the softirq thread has taken over.
+ * Call with interrupts disabled, after the EOI.
+ */
+void irq_exit(void);
+
+/*
+ * in_interrupt - Check for hardirq or softirq context
+ */
+bool in_interrupt(void);
+
+/*
+ * ksoftirqd_run - Body of this CPU's softirq thread
+ *
+ * Runs pending softirqs from process context. Until there is a
+ * scheduler, cpu_idle() calls it instead of halting.
+ */
+void ksoftirqd_run(void);
+
+/*
+ * tasklet_schedule - Queue a tasklet on TASKLET_SOFTIRQ
+ */
+void tasklet_schedule(struct tasklet *t);
+
+/*
+ * tasklet_hi_schedule - Queue a tasklet on HI_SOFTIRQ
+ */
+void tasklet_hi_schedule(struct tasklet *t);
+
+/*
+ * softirq_name - Short name of a vector, for stats output
+ */
+const char *softirq_name(unsigned int nr);
+
+/*
+ * softirq_get_stats - Accounting since boot
+ */
+const struct softirq_stats *softirq_get_stats(void);
+
+#endif /* KERNEL_INCLUDE_SOFTIRQ_H */
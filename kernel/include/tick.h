@@ -0,0 +1,119 @@
+/*
+ * kernel/include/tick.h - Tick, timer interrupt programming and tickless idle
+ *
+ * The LAPIC timer runs in one-shot mode and is always programmed for
+ * the nearest of two deadlines: the next jiffy boundary (the tick) and
+ * the earliest high-resolution event reported by the event handler
+ * (hrtimers). The tick therefore lands on exact multiples of TICK_NSEC
+ * of ktime, and jiffies == ktime / TICK_NSEC after every tick.
+ *
+ * When the CPU goes idle, cpu_idle() asks each registered next-event
+ * source (timer subsystems) for its earliest expiry. If that is at
+ * least two ticks away, the tick is stopped and the timer is armed for
+ * that expiry alone, so an idle CPU wakes only when there is work.
+ * jiffies is resynchronized from ktime on wakeup and the tick restarts.
+ *
+ * Without a local APIC there is no tick; cpu_idle() just halts.
+ */
+
+#ifndef KERNEL_INCLUDE_TICK_H
+#define KERNEL_INCLUDE_TICK_H
+
+#include <types.h>
+#include <ktime.h>
+
+#define HZ              100
+#define TICK_NSEC       (NSEC_PER_SEC / HZ)
+
+/* Number of next-event sources that can be registered */
+#define TICK_MAX_SOURCES    4
+
+/* Ticks since ktime 0 */
+extern volatile uint64_t jiffies;
+
+/*
+ * tick_next_event_fn - Earliest pending expiry of a timer subsystem
+ *
+ * Called with interrupts disabled.
+ *
+ * Returns: Absolute ktime in ns, or KTIME_MAX if nothing is pending
+ */
+typedef uint64_t (*tick_next_event_fn)(void);
+
+/*
+ * tick_event_handler_fn - High-resolution event handler
+ *
+ * Called from the timer interrupt with interrupts disabled.
+ *
+ * @now: ktime at interrupt entry
+ *
+ * Returns: Absolute ktime of the handler's next event, or KTIME_MAX
+ */
+typedef uint64_t (*tick_event_handler_fn)(uint64_t now);
+
+/*
+ * struct tick_idle_stats - Idle residency and wakeup counts
+ */
+struct tick_idle_stats {
+    uint64_t idle_ns;           /* Total time halted in cpu_idle() */
+    uint64_t entries;           /* Halts */
+    uint64_t tickless;          /* Halts with the tick stopped */
+    uint64_t timer_wakeups;     /* Woken by the tickless expiry */
+    uint64_t tick_wakeups;      /* Woken by the tick or an hrtimer */
+    uint64_t other_wakeups;     /* Woken by any other interrupt */
+};
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * tick_init - Calibrate the LAPIC timer and start the tick
+ *
+ * Needs ktime_init() and an enabled local APIC (irq_init()). The tick
+ * interrupt is pending until interrupts are enabled.
+ *
+ * Returns: 0 on success, -ENODEV without a usable LAPIC timer
+ */
+int tick_init(void);
+
+/*
+ * tick_register_next_event - Add a next-event source for idle
+ *
+ * Returns: 0 on success, -ENOSPC if TICK_MAX_SOURCES are registered
+ */
+int tick_register_next_event(tick_next_event_fn fn);
+
+/*
+ * tick_set_event_handler - Install the high-resolution event handler
+ *
+ * Returns: 0 on success, -ENODEV without a running tick
+ */
+int tick_set_event_handler(tick_event_handler_fn fn);
+
+/*
+ * tick_program_event - Make the timer interrupt fire by @expires
+ *
+ * Called by the event handler's owner when a new earliest event is
+ * queued. Call with interrupts disabled.
+ *
+ * @expires: Absolute ktime in ns
+ */
+void tick_program_event(uint64_t expires);
+
+/*
+ * cpu_idle - Halt until the next interrupt, stopping the tick if possible
+ *
+ * Runs pending softirqs instead of halting if there are any. Call with
+ * interrupts in any state; returns with them enabled.
+ */
+void cpu_idle(void);
+
+/*
+ * tick_get_idle_stats - Idle counters since boot
+ */
+const struct tick_idle_stats *tick_get_idle_stats(void);
+
+#endif /* KERNEL_INCLUDE_TICK_H */
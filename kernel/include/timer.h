@@ -0,0 +1,197 @@
+/*
+ * kernel/include/timer.h - Hierarchical timer wheel
+ *
+ * Jiffy-resolution timeouts (sleeps, I/O timeouts, retries) with O(1)
+ * add and cancel. Timers hang off one of five wheels of list slots:
+ *
+ *   level 0: 256 slots, 1 jiffy each        (expiry < 256 jiffies)
+ *   level 1:  64 slots, 256 jiffies each    (< 2^14)
+ *   level 2:  64 slots, 2^14 jiffies each   (< 2^20)
+ *   level 3:  64 slots, 2^20 jiffies each   (< 2^26)
+ *   level 4:  64 slots, 2^26 jiffies each   (< 2^32)
+ *
+ * Each jiffy the level-0 slot for that jiffy expires as a batch. When
+ * level 0 wraps, the due slot of level 1 is cascaded: its timers are
+ * re-hashed into finer levels by their remaining time, and so on up.
+ * A timer is touched at most once per level over its lifetime.
+ *
+ * Expiry never runs in hardirq context: the tick only advances jiffies
+ * and raises TIMER_SOFTIRQ when a timer is due, and the softirq moves
+ * due timers to a local list and calls them with interrupts enabled.
+ * Timers may be added and cancelled from interrupt handlers.
+ *
+ * The wheel itself (struct timer_base and the timer_base_*() calls)
+ * has no hardware dependencies and is unit-tested on the host.
+ */
+
+#ifndef KERNEL_INCLUDE_TIMER_H
+#define KERNEL_INCLUDE_TIMER_H
+
+#include <types.h>
+#include <list.h>
+
+#define TIMER_LVL0_BITS     8
+#define TIMER_LVL_BITS      6
+#define TIMER_LEVELS        5
+#define TIMER_LVL0_SIZE     (1U << TIMER_LVL0_BITS)
+#define TIMER_LVL_SIZE      (1U << TIMER_LVL_BITS)
+#define TIMER_SLOTS         (TIMER_LVL0_SIZE + \
+                             (TIMER_LEVELS - 1) * TIMER_LVL_SIZE)
+
+/* Longer timeouts are held on the last level until they come in range */
+#define TIMER_MAX_TIMEOUT   0xFFFFFFFFULL
+
+/* timer_base_next() with nothing pending */
+#define TIMER_IDLE          ((uint64_t)-1)
+
+/* Slot of a timer that has been collected for expiry */
+#define TIMER_SLOT_EXPIRED  0xFFFF
+
+struct timer_list;
+
+typedef void (*timer_fn)(struct timer_list *timer);
+
+/*
+ * struct timer_list - A one-shot timeout
+ *
+ * Embed in the owning object and recover it with container_of() in
+ * the callback. A callback may re-arm its own timer.
+ */
+struct timer_list {
+    struct list_head entry;     /* Slot link; next == NULL when idle */
+    uint64_t expires;           /* Absolute jiffies */
+    timer_fn function;
+    uint16_t slot;              /* Index into vectors[] while queued */
+};
+
+/*
+ * struct timer_base - One timer wheel
+ */
+struct timer_base {
+    uint64_t clk;               /* Next jiffy to expire */
+    uint32_t count;             /* Timers queued in vectors[] */
+    uint64_t expired;           /* Timers collected for expiry */
+    uint64_t cascaded;          /* Timers moved down a level */
+    uint32_t pending[TIMER_SLOTS / 32];  /* Non-empty slot bitmap */
+    struct list_head vectors[TIMER_SLOTS];
+};
+
+/*
+ * timer_setup - Prepare a timer for first use
+ */
+static inline void timer_setup(struct timer_list *timer, timer_fn fn)
+{
+    timer->entry.next = NULL;
+    timer->entry.prev = NULL;
+    timer->expires = 0;
+    timer->function = fn;
+    timer->slot = 0;
+}
+
+/*
+ * timer_pending - Check whether a timer is queued and has not yet run
+ */
+static inline bool timer_pending(const struct timer_list *timer)
+{
+    return timer->entry.next != NULL;
+}
+
+/*
+ * =============================================================================
+ * Timer Wheel
+ * =============================================================================
+ */
+
+/*
+ * timer_base_init - Empty a wheel
+ *
+ * @base: Wheel
+ * @clk: First jiffy it will expire
+ */
+void timer_base_init(struct timer_base *base, uint64_t clk);
+
+/*
+ * timer_base_add - Queue a timer at timer->expires
+ *
+ * An expiry in the past fires on the next jiffy collected.
+ *
+ * @base: Wheel
+ * @timer: Timer that is not pending
+ */
+void timer_base_add(struct timer_base *base, struct timer_list *timer);
+
+/*
+ * timer_base_del - Dequeue a timer
+ *
+ * Also removes a timer that was collected but not yet run.
+ *
+ * Returns: true if the timer was pending
+ */
+bool timer_base_del(struct timer_base *base, struct timer_list *timer);
+
+/*
+ * timer_base_collect - Move every timer due by @now onto @expired
+ *
+ * Advances base->clk to @now + 1, cascading as it goes. Collected
+ * timers stay pending (on @expired) until the caller unlinks them.
+ *
+ * @base: Wheel
+ * @now: Current jiffies
+ * @expired: List to append due timers to
+ *
+ * Returns: Number of timers collected
+ */
+uint32_t timer_base_collect(struct timer_base *base, uint64_t now,
+                            struct list_head *expired);
+
+/*
+ * timer_base_next - Earliest expiry on the wheel
+ *
+ * Looks at the first non-empty slot of each level, so the cost does
+ * not depend on how many timers are queued elsewhere.
+ *
+ * Returns: Expiry in jiffies, or TIMER_IDLE if the wheel is empty
+ */
+uint64_t timer_base_next(const struct timer_base *base);
+
+/*
+ * =============================================================================
+ * Kernel Timers
+ * =============================================================================
+ */
+
+/*
+ * timer_init - Set up the kernel wheel and report it to tickless idle
+ *
+ * Needs tick_init() and softirq_init(); without a tick, jiffies do not
+ * advance and timers never expire.
+ */
+void timer_init(void);
+
+/*
+ * add_timer - Queue a timer at timer->expires (jiffies)
+ */
+void add_timer(struct timer_list *timer);
+
+/*
+ * mod_timer - (Re)queue a timer at @expires
+ *
+ * Returns: true if the timer was already pending
+ */
+bool mod_timer(struct timer_list *timer, uint64_t expires);
+
+/*
+ * del_timer - Cancel a timer
+ *
+ * Returns: true if the timer was pending (and will now not run)
+ */
+bool del_timer(struct timer_list *timer);
+
+/*
+ * timer_tick - Raise TIMER_SOFTIRQ if a timer is due
+ *
+ * Called by the tick after jiffies advance, with interrupts off.
+ */
+void timer_tick(void);
+
+#endif /* KERNEL_INCLUDE_TIMER_H */
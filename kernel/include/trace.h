@@ -0,0 +1,220 @@
+/*
+ * kernel/include/trace.h - Binary deferred-format tracing
+ *
+ * TRACE() is for hot paths where printk() is too slow. Nothing is
+ * formatted in the kernel: an event is a fixed-size record holding the
+ * TSC, the address of its format string and up to four raw 32-bit
+ * arguments, written to this CPU's trace buffer (a ring that keeps the
+ * latest TRACE_EVENTS events).
+ *
+ * Format strings are placed in their own linker section, .trace_fmt.
+ * trace_dump() writes the buffer to a serial port, and
+ * scripts/trace_decode.py formats the dump on the host, looking the
+ * strings up in build/kernel.elf.
+ *
+ * Usage:
+ *   TRACE("irq %u took %u cycles", vector, cycles);
+ *
+ * Arguments are cast to uint32_t: %u, %d, %x, %X, %c and %p are
+ * decoded; %s is looked up in kernel.elf, so it only works for strings
+ * built into the kernel. Tracing is off until trace_set_enabled(true);
+ * while off, a trace point costs one load and branch.
+ */
+
+#ifndef KERNEL_INCLUDE_TRACE_H
+#define KERNEL_INCLUDE_TRACE_H
+
+#include <types.h>
+#include <asm.h>
+
+#define TRACE_EVENTS        1024        /* Per CPU, power of two */
+#define TRACE_MAX_ARGS      4
+
+/* Dump header magic: "TRC1" */
+#define TRACE_DUMP_MAGIC    0x31435254U
+#define TRACE_DUMP_VERSION  1
+
+/*
+ * struct trace_event - One trace point hit (32 bytes)
+ */
+struct trace_event {
+    uint64_t tsc;               /* rdtsc() when recorded */
+    uint32_t fmt;               /* Address of the format in .trace_fmt */
+    uint8_t nargs;
+    uint8_t cpu;
+    uint16_t reserved;
+    uint32_t args[TRACE_MAX_ARGS];
+};
+
+/*
+ * struct trace_buffer - One CPU's events
+ *
+ * @head counts every event ever written; the newest is at
+ * (head - 1) % TRACE_EVENTS.
+ */
+struct trace_buffer {
+    volatile uint32_t head;
+    struct trace_event events[TRACE_EVENTS];
+};
+
+/*
+ * struct trace_dump_header - Start of a trace_dump() stream
+ *
+ * Followed by @count events, oldest first. All fields little-endian.
+ */
+struct trace_dump_header {
+    uint32_t magic;             /* TRACE_DUMP_MAGIC */
+    uint16_t version;           /* TRACE_DUMP_VERSION */
+    uint16_t event_size;        /* sizeof(struct trace_event) */
+    uint32_t count;             /* Events that follow */
+    uint32_t lost;              /* Overwritten before the dump */
+    uint32_t tsc_khz;           /* TSC rate, 0 if unknown */
+    uint32_t fmt_start;         /* Address of .trace_fmt, to match the ELF */
+};
+
+/* The boot CPU's buffer; only the boot CPU runs for now */
+extern struct trace_buffer trace_cpu_buf;
+extern volatile bool trace_enabled;
+
+/*
+ * trace_buffer_claim - Take the next slot of a CPU's own buffer
+ *
+ * XADD without LOCK: only this CPU writes the buffer, and an interrupt
+ * cannot split one instruction, so a nested trace point gets the next
+ * slot rather than the same one.
+ */
+static inline uint32_t trace_buffer_claim(struct trace_buffer *buf)
+{
+    uint32_t idx = 1;
+
+    __asm__ volatile ("xaddl %0, %1"
+                      : "+r"(idx), "+m"(buf->head) : : "memory");
+    return idx;
+}
+
+/*
+ * trace_buffer_write - Record one event
+ *
+ * @buf: This CPU's buffer
+ * @tsc: Timestamp
+ * @fmt: Format string, in .trace_fmt
+ * @nargs: Arguments used, at most TRACE_MAX_ARGS
+ * @a0..@a3: Arguments
+ */
+static inline void trace_buffer_write(struct trace_buffer *buf, uint64_t tsc,
+                                      const char *fmt, uint32_t nargs,
+                                      uint32_t a0, uint32_t a1,
+                                      uint32_t a2, uint32_t a3)
+{
+    struct trace_event *ev =
+        &buf->events[trace_buffer_claim(buf) & (TRACE_EVENTS - 1)];
+
+    ev->tsc = tsc;
+    ev->fmt = (uint32_t)(uintptr_t)fmt;
+    ev->nargs = (uint8_t)nargs;
+    ev->cpu = 0;
+    ev->args[0] = a0;
+    ev->args[1] = a1;
+    ev->args[2] = a2;
+    ev->args[3] = a3;
+}
+
+#define TRACE_ARG(x)        ((uint32_t)(uintptr_t)(x))
+
+/*
+ * __TRACE - Emit an event with @n arguments
+ *
+ * The format lives in a function-local array so that it, and only it,
+ * is placed in .trace_fmt.
+ */
+#define __TRACE(n, fmt, a0, a1, a2, a3)                                    \
+    do {                                                                    \
+        static const char trace_fmt_[]                                      \
+            __attribute__((section(".trace_fmt"), aligned(1))) = fmt;       \
+        if (trace_enabled) {                                                \
+            trace_buffer_write(&trace_cpu_buf, rdtsc(), trace_fmt_, (n),    \
+                               (a0), (a1), (a2), (a3));                     \
+        }                                                                   \
+    } while (0)
+
+#define __TRACE0(fmt) \
+    __TRACE(0, fmt, 0, 0, 0, 0)
+#define __TRACE1(fmt, a) \
+    __TRACE(1, fmt, TRACE_ARG(a), 0, 0, 0)
+#define __TRACE2(fmt, a, b) \
+    __TRACE(2, fmt, TRACE_ARG(a), TRACE_ARG(b), 0, 0)
+#define __TRACE3(fmt, a, b, c) \
+    __TRACE(3, fmt, TRACE_ARG(a), TRACE_ARG(b), TRACE_ARG(c), 0)
+#define __TRACE4(fmt, a, b, c, d) \
+    __TRACE(4, fmt, TRACE_ARG(a), TRACE_ARG(b), TRACE_ARG(c), TRACE_ARG(d))
+
+/* Number of arguments after the format, 0-4 */
+#define __TRACE_NARGS(...)  __TRACE_PICK(__VA_ARGS__, 4, 3, 2, 1, 0, ~)
+#define __TRACE_PICK(fmt, _1, _2, _3, _4, n, ...) n
+#define __TRACE_CAT(a, b)   __TRACE_CAT2(a, b)
+#define __TRACE_CAT2(a, b)  a##b
+
+/*
+ * TRACE - Record a trace event: TRACE(fmt, up to four arguments)
+ */
+#define TRACE(...) __TRACE_CAT(__TRACE, __TRACE_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * trace_buffer_reset - Empty a buffer
+ */
+void trace_buffer_reset(struct trace_buffer *buf);
+
+/*
+ * trace_buffer_count - Events a buffer still holds
+ */
+uint32_t trace_buffer_count(const struct trace_buffer *buf);
+
+/*
+ * trace_buffer_get - The @i-th oldest event still held
+ *
+ * Returns: The event, or NULL if @i >= trace_buffer_count()
+ */
+const struct trace_event *trace_buffer_get(const struct trace_buffer *buf,
+                                           uint32_t i);
+
+/*
+ * trace_dump_header_init - Describe a buffer's contents for a dump
+ *
+ * @hdr: Header to fill in
+ * @buf: Buffer to be dumped
+ * @tsc_khz: TSC rate, or 0
+ * @fmt_start: Address of the .trace_fmt section
+ */
+void trace_dump_header_init(struct trace_dump_header *hdr,
+                            const struct trace_buffer *buf,
+                            uint32_t tsc_khz, uint32_t fmt_start);
+
+/*
+ * trace_set_enabled - Start or stop recording events
+ */
+void trace_set_enabled(bool enabled);
+
+/*
+ * trace_reset - Discard this CPU's events
+ */
+void trace_reset(void);
+
+/*
+ * trace_dump - Write this CPU's events to a serial port
+ *
+ * Writes a struct trace_dump_header followed by the events, oldest
+ * first, for scripts/trace_decode.py. Tracing is paused meanwhile.
+ *
+ * @port: Serial port index (SERIAL_COM1..SERIAL_COM4)
+ *
+ * Returns: Number of events written, or -ENODEV if the port is absent
+ */
+int trace_dump(unsigned int port);
+
+#endif /* KERNEL_INCLUDE_TRACE_H */
@@ -23,14 +23,17 @@ typedef unsigned int       uint32_t;
 typedef signed long long   int64_t;
 typedef unsigned long long uint64_t;
 
-/* Size types */
-typedef uint32_t size_t;
-typedef int32_t  ssize_t;
-typedef int32_t  ptrdiff_t;
-
-/* Pointer-sized integer types */
-typedef uint32_t uintptr_t;
-typedef int32_t  intptr_t;
+/*
+ * Size and pointer-sized types
+ *
+ * Taken from the compiler's predefined types so they are 32 bits on
+ * i686 and 64 bits on x86_64 without per-architecture typedefs.
+ */
+typedef __SIZE_TYPE__      size_t;
+typedef __PTRDIFF_TYPE__   ssize_t;
+typedef __PTRDIFF_TYPE__   ptrdiff_t;
+typedef __UINTPTR_TYPE__   uintptr_t;
+typedef __INTPTR_TYPE__    intptr_t;
 
 /* Boolean type */
 typedef _Bool bool;
@@ -40,6 +43,18 @@ typedef _Bool bool;
 /* NULL pointer */
 #define NULL ((void *)0)
 
+/* Byte offset of a struct member */
+#define offsetof(type, member) __builtin_offsetof(type, member)
+
 #endif /* HOST_TEST */
 
+/*
+ * container_of - Get the enclosing struct from a pointer to a member
+ *
+ * Used by intrusive data structures (tree nodes, list links) embedded
+ * in the objects they organize.
+ */
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
 #endif /* KERNEL_INCLUDE_TYPES_H */
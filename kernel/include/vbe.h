@@ -0,0 +1,72 @@
+/*
+ * kernel/include/vbe.h - VESA BIOS Extensions boot video info
+ *
+ * With make VBE=1, stage 2 looks for a VBE_WIDTH x VBE_HEIGHT x 32
+ * linear-framebuffer mode (INT 0x10 AX=0x4F00/0x4F01), sets it
+ * (AX=0x4F02) and leaves its mode info block at 0x1200. It also copies
+ * the BIOS 8x16 font to 0x1300, since the kernel has none of its own.
+ * entry.S passes the mode info address to C as boot_vbe_ptr, which is
+ * 0 when the display stayed in text mode.
+ *
+ * References:
+ *   - VESA BIOS Extension (VBE) Core Functions Standard 3.0
+ */
+
+#ifndef KERNEL_INCLUDE_VBE_H
+#define KERNEL_INCLUDE_VBE_H
+
+#include <types.h>
+
+#define VBE_MODE_INFO_ADDR  0x1200
+#define VBE_FONT_ADDR       0x1300
+#define VBE_FONT_WIDTH      8
+#define VBE_FONT_HEIGHT     16          /* Bytes per glyph */
+
+/* Mode attributes */
+#define VBE_ATTR_SUPPORTED  0x0001
+#define VBE_ATTR_GRAPHICS   0x0010
+#define VBE_ATTR_LFB        0x0080
+
+/*
+ * struct vbe_mode_info - Mode info block (AX=0x4F01), 256 bytes
+ */
+struct vbe_mode_info {
+    uint16_t attributes;                /* VBE_ATTR_* */
+    uint8_t window_a;
+    uint8_t window_b;
+    uint16_t granularity;
+    uint16_t window_size;
+    uint16_t segment_a;
+    uint16_t segment_b;
+    uint32_t win_func_ptr;
+    uint16_t pitch;                     /* Bytes per scan line */
+    uint16_t width;                     /* Pixels */
+    uint16_t height;
+    uint8_t char_width;
+    uint8_t char_height;
+    uint8_t planes;
+    uint8_t bpp;                        /* Bits per pixel */
+    uint8_t banks;
+    uint8_t memory_model;
+    uint8_t bank_size;
+    uint8_t image_pages;
+    uint8_t reserved0;
+
+    /* Direct color field sizes and bit positions */
+    uint8_t red_size;
+    uint8_t red_pos;
+    uint8_t green_size;
+    uint8_t green_pos;
+    uint8_t blue_size;
+    uint8_t blue_pos;
+    uint8_t rsvd_size;
+    uint8_t rsvd_pos;
+    uint8_t direct_color_attributes;
+
+    uint32_t framebuffer;               /* Physical address of the LFB */
+    uint32_t off_screen_mem_off;
+    uint16_t off_screen_mem_size;
+    uint8_t reserved1[206];
+} __attribute__((packed));
+
+#endif /* KERNEL_INCLUDE_VBE_H */
@@ -6,8 +6,9 @@
  *
  * Features:
  *   - Character and string output with automatic cursor advance
+ *   - Rendering into a RAM shadow, copied to the screen in dirty spans
  *   - Line wrapping at column 80
- *   - Screen scrolling when reaching bottom
+ *   - Hardware scrolling (CRTC start address) with scrollback
  *   - Hardware cursor synchronization
  *   - Configurable text colors
  *
@@ -15,7 +16,9 @@
  *   Byte 0: ASCII character code (0x00-0xFF)
  *   Byte 1: Attribute byte (foreground | background << 4)
  *
- * Screen: 80 columns x 25 rows = 2000 cells = 4000 bytes
+ * Screen: 80 columns x 25 rows = 2000 cells = 4000 bytes, a window
+ * onto the 32KB of text memory (204 rows) that moves down as the
+ * screen scrolls. Rows above it are scrollback.
  */
 
 #ifndef KERNEL_INCLUDE_VGA_H
@@ -36,6 +39,13 @@
 #define VGA_WIDTH  80
 #define VGA_HEIGHT 25
 
+/* Text memory: 32KB at 0xB8000, in whole rows */
+#define VGA_VRAM_SIZE   0x8000
+#define VGA_VRAM_ROWS   (VGA_VRAM_SIZE / 2 / VGA_WIDTH)
+
+/* Scrollback rows kept when the screen wraps to the start of text memory */
+#define VGA_SCROLLBACK_KEEP ((VGA_VRAM_ROWS - VGA_HEIGHT) / 2)
+
 /*
  * =============================================================================
  * VGA Color Constants
@@ -66,11 +76,13 @@
 
 /*
  * =============================================================================
- * VGA CRT Controller Ports (for hardware cursor)
+ * VGA CRT Controller Ports (for hardware cursor and scrolling)
  * =============================================================================
  */
 #define VGA_CRTC_INDEX  0x3D4
 #define VGA_CRTC_DATA   0x3D5
+#define VGA_START_HIGH  0x0C
+#define VGA_START_LOW   0x0D
 #define VGA_CURSOR_HIGH 0x0E
 #define VGA_CURSOR_LOW  0x0F
 
@@ -84,7 +96,9 @@
  * vga_init - Initialize VGA driver and clear screen
  *
  * Resets cursor to (0,0), sets default color (light grey on black),
- * clears entire screen, and updates hardware cursor.
+ * clears entire screen, and updates hardware cursor. Registers the
+ * "vga" console, which prints every log level. In a framebuffer mode
+ * (see fbcon.h) the "fb" console replaces it, and "vga" is disabled.
  *
  * Must be called before any other VGA functions.
  */
@@ -104,6 +118,9 @@ void vga_init(void);
  *   - Scroll if at row 25
  *   - Update hardware cursor
  *
+ * Shown at once: each call flushes. Use vga_write() for more than
+ * a character.
+ *
  * @c: ASCII character to print
  */
 void vga_putchar(char c);
@@ -111,13 +128,58 @@ void vga_putchar(char c);
 /*
  * vga_puts - Print a null-terminated string
  *
- * Prints each character using vga_putchar(), handling newlines
- * and wrapping automatically.
+ * Handles newlines and wrapping like vga_putchar(), but flushes
+ * once at the end.
  *
  * @str: Null-terminated string to print
  */
 void vga_puts(const char *str);
 
+/*
+ * vga_write - Print a buffer of characters
+ *
+ * Renders all @len characters into the shadow, then flushes once,
+ * so scrolling several lines redraws the screen a single time.
+ *
+ * @buf: Characters to print, need not be NUL-terminated
+ * @len: Number of characters
+ */
+void vga_write(const char *buf, size_t len);
+
+/*
+ * vga_flush - Show everything printed so far
+ *
+ * Copies each row's dirty span from the shadow to the VGA buffer a
+ * machine word at a time, then moves the start address and hardware
+ * cursor if they changed. Cheap when nothing is dirty. New output
+ * ends a vga_scrollback() view.
+ */
+void vga_flush(void);
+
+/*
+ * vga_scrollback - Scroll the view back (or forward) through history
+ *
+ * Only moves the CRTC start address; nothing is copied. The view
+ * returns to the live screen at the next output.
+ *
+ * Usage:
+ *   vga_scrollback(VGA_HEIGHT);      page up
+ *   vga_scrollback(-VGA_HEIGHT);     page down
+ *
+ * @rows: Rows to go back; negative goes forward
+ *
+ * Returns: Rows the view is now behind the live screen
+ */
+int vga_scrollback(int rows);
+
+/*
+ * vga_screen_offset - Cell of text memory shown at the top-left
+ *
+ * The screen is VGA_BUFFER_ADDR + 2 * vga_screen_offset(). Changes
+ * with every scroll.
+ */
+uint16_t vga_screen_offset(void);
+
 /*
  * vga_clear - Clear the entire screen
  *
@@ -129,8 +191,9 @@ void vga_clear(void);
 /*
  * vga_set_color - Set text foreground and background colors
  *
- * Changes the color attribute used for subsequent character output.
- * Does not affect characters already on screen.
+ * Changes the color attribute used for subsequent character output,
+ * on the framebuffer console too. Does not affect characters already
+ * on screen.
  *
  * @fg: Foreground color (0-15, use VGA_COLOR_* constants)
  * @bg: Background color (0-7, use VGA_COLOR_* constants)
@@ -0,0 +1,92 @@
+/*
+ * kernel/include/vma.h - Virtual Memory Area Tree
+ *
+ * An address space is a set of non-overlapping [start, end) regions
+ * kept in a red-black tree ordered by address. Each node also caches
+ * the largest free gap anywhere in its subtree, where a VMA's gap is
+ * the free space between the previous VMA's end (or 0) and its start.
+ *
+ * That gives O(log n) for both hot paths:
+ *   - page fault:  vma_find(tree, fault_addr)
+ *   - mmap:        vma_find_gap(tree, len, low, high, &addr)
+ * instead of the O(n) walk a linked list of regions would need.
+ *
+ * The tree is intrusive: callers own struct vma storage.
+ */
+
+#ifndef KERNEL_INCLUDE_VMA_H
+#define KERNEL_INCLUDE_VMA_H
+
+#include <types.h>
+#include <rbtree.h>
+
+/*
+ * struct vma - One mapped region
+ */
+struct vma {
+    uint32_t start;         /* First address (inclusive) */
+    uint32_t end;           /* Last address (exclusive) */
+    uint32_t flags;         /* Protection / mapping flags, opaque here */
+    uint32_t gap;           /* Free bytes before start (tree-maintained) */
+    uint32_t max_gap;       /* Largest gap in this subtree (tree-maintained) */
+    struct rb_node rb;
+};
+
+/*
+ * struct vma_tree - An address space's regions
+ */
+struct vma_tree {
+    struct rb_root root;
+    uint32_t count;         /* Number of VMAs */
+};
+
+/*
+ * =============================================================================
+ * Public Functions
+ * =============================================================================
+ */
+
+/*
+ * vma_tree_init - Initialize an empty tree
+ */
+void vma_tree_init(struct vma_tree *tree);
+
+/*
+ * vma_insert - Add a region
+ *
+ * @tree: Address space
+ * @vma: Region with start and end set; other fields are overwritten
+ *       except flags
+ *
+ * Returns: 0 on success, -EINVAL if start >= end, -EEXIST if the
+ *          region overlaps one already in the tree
+ */
+int vma_insert(struct vma_tree *tree, struct vma *vma);
+
+/*
+ * vma_remove - Remove a region previously inserted
+ */
+void vma_remove(struct vma_tree *tree, struct vma *vma);
+
+/*
+ * vma_find - Find the region containing an address
+ *
+ * Returns: The VMA with start <= addr < end, or NULL
+ */
+struct vma *vma_find(const struct vma_tree *tree, uint32_t addr);
+
+/*
+ * vma_find_gap - Find the lowest free range of a given size
+ *
+ * @tree: Address space
+ * @size: Bytes needed (> 0)
+ * @low: Lowest acceptable start address
+ * @high: Highest acceptable end address (exclusive)
+ * @addr: Output, start of the free range
+ *
+ * Returns: 0 on success, -ENOMEM if no free range fits
+ */
+int vma_find_gap(const struct vma_tree *tree, uint32_t size,
+                 uint32_t low, uint32_t high, uint32_t *addr);
+
+#endif /* KERNEL_INCLUDE_VMA_H */
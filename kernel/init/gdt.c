@@ -17,10 +17,11 @@
 #include <gdt.h>
 
 /*
- * The following are only needed for the kernel build (gdt_init).
- * Host-side tests only need gdt_set_gate.
+ * The following are only needed for the i686 kernel build (gdt_init).
+ * Host-side tests only need gdt_set_gate, and the x86_64 build has its
+ * own gdt_init in kernel/arch/x86_64/gdt.c that reuses gdt_set_gate.
  */
-#ifndef HOST_TEST
+#if !defined(HOST_TEST) && !defined(__x86_64__)
 
 /*
  * GDT_ENTRIES - Number of GDT entries
@@ -54,7 +55,7 @@ static struct gdt_ptr gdt_pointer;
  */
 extern void gdt_flush(uint32_t gdt_ptr);
 
-#endif /* !HOST_TEST */
+#endif /* !HOST_TEST && !__x86_64__ */
 
 /*
  * gdt_set_gate - Set a GDT descriptor entry
@@ -97,10 +98,10 @@ void gdt_set_gate(struct gdt_entry *entry, uint32_t base, uint32_t limit,
 }
 
 /*
- * gdt_init is only compiled for the kernel, not for host-side tests.
+ * gdt_init is only compiled for the i686 kernel, not for host-side tests.
  * Host tests only need gdt_set_gate for testing the encoding logic.
  */
-#ifndef HOST_TEST
+#if !defined(HOST_TEST) && !defined(__x86_64__)
 
 /*
  * gdt_init - Initialize the Global Descriptor Table
@@ -201,4 +202,4 @@ void gdt_init(void)
     gdt_flush((uint32_t)&gdt_pointer);
 }
 
-#endif /* !HOST_TEST */
+#endif /* !HOST_TEST && !__x86_64__ */
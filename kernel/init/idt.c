@@ -0,0 +1,265 @@
+/*
+ * kernel/init/idt.c - Interrupt Descriptor Table and ISR dispatch
+ *
+ * Builds the IDT (8-byte gates on i686, 16-byte gates on x86_64) with
+ * every vector pointing at its entry stub in isr_stubs.S, and owns the
+ * handler tables the stubs dispatch through.
+ *
+ * Handler table entries are never NULL: unclaimed exceptions point at
+ * a handler that reports and panics, other vectors at one that just
+ * returns (the counters still record the hit). That keeps dispatch a
+ * single indirect call.
+ *
+ * References:
+ *   - Intel SDM Vol 3, Section 6.10: Interrupt Descriptor Table
+ *   - Intel SDM Vol 3, Section 6.12: Exception and Interrupt Handling
+ */
+
+#include <idt.h>
+
+/*
+ * idt_set_gate - Fill a 32-bit gate
+ */
+void idt_set_gate(struct idt_entry *entry, uint32_t handler,
+                  uint16_t selector, uint8_t type_attr)
+{
+    entry->offset_low = handler & 0xFFFF;
+    entry->selector = selector;
+    entry->zero = 0;
+    entry->type_attr = type_attr;
+    entry->offset_high = (handler >> 16) & 0xFFFF;
+}
+
+/*
+ * idt_set_gate64 - Fill a 64-bit gate (IST 0)
+ */
+void idt_set_gate64(struct idt_entry64 *entry, uint64_t handler,
+                    uint16_t selector, uint8_t type_attr)
+{
+    entry->offset_low = handler & 0xFFFF;
+    entry->selector = selector;
+    entry->ist = 0;
+    entry->type_attr = type_attr;
+    entry->offset_mid = (handler >> 16) & 0xFFFF;
+    entry->offset_high = (uint32_t)(handler >> 32);
+    entry->reserved = 0;
+}
+
+/*
+ * Everything below needs the entry stubs and is kernel-only. Host
+ * tests only need the gate encoders.
+ */
+#ifndef HOST_TEST
+
+#include <gdt.h>
+#include <asm.h>
+#include <errno.h>
+#include <printk.h>
+#include <panic.h>
+#include <softirq.h>
+#include <trace.h>
+
+/* Stub arrays from isr_stubs.S, ISR_STUB_SIZE bytes per vector */
+extern char isr_stubs[];
+extern char isr_fast_stubs[];
+
+#ifdef __x86_64__
+static struct idt_entry64 idt[IDT_ENTRIES];
+static struct idt_ptr64 idt_pointer;
+#else
+static struct idt_entry idt[IDT_ENTRIES];
+static struct idt_ptr idt_pointer;
+#endif
+
+static isr_handler_t isr_table[IDT_ENTRIES];
+static isr_fast_handler_t isr_fast_table[IDT_ENTRIES];
+static struct isr_stats isr_stats[IDT_ENTRIES];
+
+static const char *const exception_names[ISR_EXCEPTIONS] = {
+    "Divide error", "Debug", "NMI", "Breakpoint",
+    "Overflow", "BOUND range exceeded", "Invalid opcode",
+    "Device not available", "Double fault", "Coprocessor segment overrun",
+    "Invalid TSS", "Segment not present", "Stack-segment fault",
+    "General protection fault", "Page fault", "Reserved",
+    "x87 floating-point", "Alignment check", "Machine check",
+    "SIMD floating-point", "Virtualization", "Control protection",
+    "Reserved", "Reserved", "Reserved", "Reserved", "Reserved",
+    "Reserved", "Hypervisor injection", "VMM communication",
+    "Security", "Reserved",
+};
+
+/*
+ * unhandled_exception - Default handler for vectors 0-31
+ */
+static void unhandled_exception(struct interrupt_frame *frame)
+{
+    printk(LOG_ERROR, "Exception %u (%s), error code 0x%x\n",
+           (uint32_t)frame->vector, exception_names[frame->vector],
+           (uint32_t)frame->error_code);
+    printk(LOG_ERROR, "  at %p, CS=0x%x, FLAGS=0x%x\n",
+           (void *)frame->ip, (uint32_t)frame->cs, (uint32_t)frame->flags);
+    panic("Unhandled exception");
+}
+
+/*
+ * unhandled_interrupt - Default handler for vectors 32-255
+ *
+ * Stray interrupts are counted (isr_stats) and reported, rate-limited
+ * since a device stuck asserting one would otherwise flood the log.
+ */
+static void unhandled_interrupt(struct interrupt_frame *frame)
+{
+    printk_ratelimited(LOG_WARN, "Stray interrupt on vector %u\n",
+                       (uint32_t)frame->vector);
+}
+
+static isr_handler_t default_handler(uint8_t vector)
+{
+    return vector < ISR_EXCEPTIONS ? unhandled_exception : unhandled_interrupt;
+}
+
+/*
+ * set_stub - Point a vector's gate at an entry stub
+ */
+static void set_stub(uint8_t vector, char *stubs)
+{
+    uintptr_t addr = (uintptr_t)(stubs + vector * ISR_STUB_SIZE);
+
+#ifdef __x86_64__
+    idt_set_gate64(&idt[vector], addr, KERNEL_CS, IDT_GATE_INTERRUPT);
+#else
+    idt_set_gate(&idt[vector], addr, KERNEL_CS, IDT_GATE_INTERRUPT);
+#endif
+}
+
+/*
+ * idt_init - Build the IDT and load it
+ */
+void idt_init(void)
+{
+    int i;
+
+    for (i = 0; i < IDT_ENTRIES; i++) {
+        isr_table[i] = default_handler(i);
+        isr_fast_table[i] = NULL;
+        set_stub(i, isr_stubs);
+    }
+    isr_reset_stats();
+
+    idt_pointer.limit = sizeof(idt) - 1;
+    idt_pointer.base = (uintptr_t)idt;
+    __asm__ volatile ("lidt %0" : : "m"(idt_pointer));
+}
+
+/*
+ * isr_register - Install a full-path handler
+ *
+ * The gate is switched back to the full stub before the table entry
+ * matters, with interrupts off so the vector never sees a half state.
+ */
+void isr_register(uint8_t vector, isr_handler_t handler)
+{
+    unsigned long flags = irq_save();
+
+    isr_table[vector] = handler ? handler : default_handler(vector);
+    set_stub(vector, isr_stubs);
+    isr_fast_table[vector] = NULL;
+
+    irq_restore(flags);
+}
+
+/*
+ * isr_register_fast - Install a fast-path handler
+ */
+int isr_register_fast(uint8_t vector, isr_fast_handler_t handler)
+{
+    unsigned long flags;
+
+    if (vector < ISR_EXCEPTIONS) {
+        return -EINVAL;
+    }
+
+    flags = irq_save();
+    if (handler != NULL) {
+        isr_fast_table[vector] = handler;
+        set_stub(vector, isr_fast_stubs);
+    } else {
+        set_stub(vector, isr_stubs);
+        isr_fast_table[vector] = NULL;
+    }
+    irq_restore(flags);
+
+    return 0;
+}
+
+/*
+ * isr_get_stats - Read a vector's counters
+ */
+const struct isr_stats *isr_get_stats(uint8_t vector)
+{
+    return &isr_stats[vector];
+}
+
+/*
+ * isr_reset_stats - Zero all counters
+ */
+void isr_reset_stats(void)
+{
+    int i;
+
+    for (i = 0; i < IDT_ENTRIES; i++) {
+        isr_stats[i].count = 0;
+        isr_stats[i].cycles = 0;
+    }
+}
+
+/*
+ * isr_dispatch - Full-path C entry, called from isr_common
+ *
+ * Hardware interrupts only arrive with IF set. A software INT issued
+ * with interrupts off is not treated as one, so irq_exit() never turns
+ * interrupts on behind its back to run softirqs.
+ */
+void isr_dispatch(struct interrupt_frame *frame)
+{
+    uint8_t vector = frame->vector;
+    bool hardirq = vector >= ISR_EXCEPTIONS && (frame->flags & EFLAGS_IF);
+    uint64_t start = rdtsc();
+    uint64_t cycles;
+
+    if (hardirq) {
+        irq_enter();
+    }
+
+    isr_table[vector](frame);
+
+    cycles = rdtsc() - start;
+    isr_stats[vector].count++;
+    isr_stats[vector].cycles += cycles;
+    TRACE("isr %u: %u cycles", vector, (uint32_t)cycles);
+
+    if (hardirq) {
+        irq_exit();
+    }
+}
+
+/*
+ * isr_fast_dispatch - Fast-path C entry, called from isr_fast_common
+ */
+void isr_fast_dispatch(uint32_t vector)
+{
+    uint64_t start = rdtsc();
+    uint64_t cycles;
+
+    vector &= 0xFF;
+    irq_enter();
+    isr_fast_table[vector](vector);
+
+    cycles = rdtsc() - start;
+    isr_stats[vector].count++;
+    isr_stats[vector].cycles += cycles;
+    TRACE("isr %u (fast): %u cycles", vector, (uint32_t)cycles);
+    irq_exit();
+}
+
+#endif /* !HOST_TEST */
@@ -0,0 +1,213 @@
+/*
+ * kernel/init/irq.c - Hardware IRQ routing
+ *
+ * Sits between the IDT (idt.c) and the interrupt controller drivers
+ * (drivers/apic.c, drivers/pic.c). Each requested IRQ's vector points
+ * at irq_entry(), which calls the driver's handler and then EOIs
+ * through whichever struct irq_chip is active.
+ */
+
+#include <irq.h>
+#include <apic.h>
+#include <pic.h>
+#include <asm.h>
+#include <errno.h>
+#include <printk.h>
+
+/*
+ * ISA IRQ -> IOAPIC pin table
+ *
+ * On virtually every PC chipset the PIT (IRQ 0) is wired to pin 2,
+ * where the PIC cascade would be; all other ISA lines are identity
+ * mapped, edge triggered, active high.
+ */
+static struct irq_route irq_routes[IRQ_LINES] = {
+    [0] = { 2, 0 },   [1] = { 1, 0 },   [2] = { 0, 0 },   [3] = { 3, 0 },
+    [4] = { 4, 0 },   [5] = { 5, 0 },   [6] = { 6, 0 },   [7] = { 7, 0 },
+    [8] = { 8, 0 },   [9] = { 9, 0 },   [10] = { 10, 0 }, [11] = { 11, 0 },
+    [12] = { 12, 0 }, [13] = { 13, 0 }, [14] = { 14, 0 }, [15] = { 15, 0 },
+};
+
+static isr_handler_t irq_handlers[IRQ_LINES];
+static const struct irq_chip *irq_chip;
+static struct irq_eoi_stats eoi_stats;
+
+/*
+ * =============================================================================
+ * Controller Backends
+ * =============================================================================
+ */
+
+static void apic_chip_mask(uint8_t irq)
+{
+    ioapic_mask(irq_routes[irq].gsi);
+}
+
+static void apic_chip_unmask(uint8_t irq)
+{
+    ioapic_unmask(irq_routes[irq].gsi);
+}
+
+static void apic_chip_eoi(uint8_t irq)
+{
+    (void)irq;
+    lapic_eoi();
+}
+
+static const struct irq_chip apic_chip = {
+    .name = "IOAPIC",
+    .mask = apic_chip_mask,
+    .unmask = apic_chip_unmask,
+    .eoi = apic_chip_eoi,
+};
+
+static const struct irq_chip pic_chip = {
+    .name = "8259A",
+    .mask = pic_mask,
+    .unmask = pic_unmask,
+    .eoi = pic_eoi,
+};
+
+/*
+ * =============================================================================
+ * IRQ Core
+ * =============================================================================
+ */
+
+/*
+ * irq_entry - ISR for every requested IRQ vector
+ */
+static void irq_entry(struct interrupt_frame *frame)
+{
+    uint8_t irq = frame->vector - IRQ_VECTOR_BASE;
+
+    irq_handlers[irq](frame);
+    irq_eoi(irq);
+}
+
+/*
+ * apic_setup - Bring up the IOAPIC and local APIC
+ *
+ * The IOAPIC is probed first: if it is missing, the local APIC is left
+ * in the firmware's virtual-wire mode so PIC interrupts still arrive.
+ *
+ * Returns: 0 on success, -ENODEV if either is missing
+ */
+static int apic_setup(void)
+{
+    uint8_t irq;
+    uint8_t dest;
+
+    if (!lapic_present() || ioapic_init(IOAPIC_DEFAULT_BASE) != 0) {
+        return -ENODEV;
+    }
+    lapic_init();
+
+    dest = lapic_id();
+    for (irq = 0; irq < IRQ_LINES; irq++) {
+        ioapic_route(irq_routes[irq].gsi,
+                     ioapic_redir_entry(IRQ_VECTOR_BASE + irq, dest,
+                                        irq_routes[irq].flags |
+                                        IOAPIC_MASKED));
+    }
+    return 0;
+}
+
+/*
+ * irq_init - Select and initialize the interrupt controller
+ */
+void irq_init(void)
+{
+    pic_init(IRQ_VECTOR_BASE);
+
+    if (apic_setup() == 0) {
+        irq_chip = &apic_chip;
+        klog(LOG_SYS_IRQ, LOG_INFO, "IRQ: IOAPIC (%u pins), LAPIC id %u\n",
+               ioapic_pins(), lapic_id());
+    } else {
+        irq_chip = &pic_chip;
+        klog(LOG_SYS_IRQ, LOG_INFO, "IRQ: no APIC, using 8259A PIC\n");
+    }
+
+    eoi_stats.count = 0;
+    eoi_stats.cycles = 0;
+}
+
+/*
+ * irq_get_chip - The controller irq_init() selected
+ */
+const struct irq_chip *irq_get_chip(void)
+{
+    return irq_chip;
+}
+
+/*
+ * irq_request - Install a handler and unmask the line
+ */
+int irq_request(uint8_t irq, isr_handler_t handler)
+{
+    if (irq >= IRQ_LINES || handler == NULL) {
+        return -EINVAL;
+    }
+    if (irq_handlers[irq] != NULL) {
+        return -EBUSY;
+    }
+
+    irq_handlers[irq] = handler;
+    isr_register(IRQ_VECTOR_BASE + irq, irq_entry);
+    irq_chip->unmask(irq);
+    klog(LOG_SYS_IRQ, LOG_DEBUG, "IRQ: line %u -> vector %u (%s)\n", irq,
+         IRQ_VECTOR_BASE + irq, irq_chip->name);
+    return 0;
+}
+
+/*
+ * irq_free - Mask the line and remove its handler
+ */
+void irq_free(uint8_t irq)
+{
+    if (irq >= IRQ_LINES) {
+        return;
+    }
+
+    irq_chip->mask(irq);
+    isr_register(IRQ_VECTOR_BASE + irq, NULL);
+    irq_handlers[irq] = NULL;
+}
+
+/*
+ * irq_mask - Disable a line at the controller
+ */
+void irq_mask(uint8_t irq)
+{
+    irq_chip->mask(irq);
+}
+
+/*
+ * irq_unmask - Enable a line at the controller
+ */
+void irq_unmask(uint8_t irq)
+{
+    irq_chip->unmask(irq);
+}
+
+/*
+ * irq_eoi - Acknowledge an IRQ (timed)
+ */
+void irq_eoi(uint8_t irq)
+{
+    uint64_t start = rdtsc();
+
+    irq_chip->eoi(irq);
+
+    eoi_stats.count++;
+    eoi_stats.cycles += rdtsc() - start;
+}
+
+/*
+ * irq_get_eoi_stats - EOI count and cycles since boot
+ */
+const struct irq_eoi_stats *irq_get_eoi_stats(void)
+{
+    return &eoi_stats;
+}
@@ -12,16 +12,17 @@
  *   - Set up the stack
  *
  * At this point:
- *   - 32-bit protected mode
+ *   - 32-bit protected mode (i686) or 64-bit long mode (x86_64)
  *   - Interrupts disabled
- *   - Paging disabled (physical == virtual)
+ *   - Paging disabled on i686; identity-mapped 2MB pages on x86_64
+ *     (physical == virtual either way)
  *   - Running at physical 0x100000
  *
  * Initialization order:
- *   1. GDT setup (Story 1.4)
+ *   1. GDT and IDT setup (Story 1.4, 2.1)
  *   2. VGA driver (Story 1.5)
  *   3. Serial debug, printk, panic (Story 1.6)
- *   4. IDT, interrupts (Story 2.x)
+ *   4. Interrupt controller, clocksource, tick (Story 2.2-2.4)
  *   5. Memory management (Story 3.x)
  *
  * =============================================================================
@@ -29,11 +30,22 @@
 
 #include <types.h>
 #include <gdt.h>
+#include <idt.h>
+#include <irq.h>
+#include <softirq.h>
+#include <ktime.h>
+#include <tick.h>
+#include <timer.h>
+#include <hrtimer.h>
 #include <vga.h>
 #include <asm.h>
 #include <serial.h>
+#include <debugcon.h>
+#include <fbcon.h>
 #include <printk.h>
 #include <panic.h>
+#include <page.h>
+#include <hugepage.h>
 
 #ifdef TEST_MODE
 #include <test.h>
@@ -48,6 +60,12 @@
 extern uint32_t boot_mmap_ptr;
 extern uint32_t boot_mmap_count;
 
+/* Built in with `make CMDLINE=...`; stage 2 does not pass one */
+#ifndef KERNEL_CMDLINE
+#define KERNEL_CMDLINE ""
+#endif
+
+static const char kernel_cmdline[] = KERNEL_CMDLINE;
 
 /*
  * kmain - Kernel main entry point
@@ -56,12 +74,16 @@ extern uint32_t boot_mmap_count;
  * kernel initialization and then halts.
  *
  * Initialization sequence:
- *   1. Initialize GDT (segment descriptors)
+ *   1. Initialize GDT (segment descriptors) and IDT (exception vectors)
  *   2. Initialize VGA driver (text output)
  *   3. Initialize serial driver (debug output)
- *   4. Display boot messages via printk
- *   5. Run tests if TEST_MODE enabled
- *   6. Halt
+ *   4. Display boot messages via printk, apply command-line log levels
+ *   5. Select IOAPIC/LAPIC or PIC for IRQ delivery, set up softirqs,
+ *      switch serial to interrupt-driven TX, calibrate the TSC, start
+ *      the tick, hrtimers and the timer wheel
+ *   6. Build page frame descriptors, enable 4MB pages
+ *   7. Run tests if TEST_MODE enabled
+ *   8. Idle (tickless)
  */
 void kmain(void)
 {
@@ -73,6 +95,14 @@ void kmain(void)
      */
     gdt_init();
 
+    /*
+     * Install exception and interrupt entry points
+     *
+     * Interrupts stay disabled; this makes faults report and panic
+     * instead of triple-faulting.
+     */
+    idt_init();
+
     /*
      * Initialize VGA driver
      *
@@ -84,11 +114,18 @@ void kmain(void)
     /*
      * Initialize serial driver
      *
-     * Configures COM1 for 38400 baud 8N1 output. This enables
+     * Configures COM1 for 115200 baud 8N1 output. This enables
      * printk output to both serial and VGA from this point on.
      */
     serial_init();
 
+    /*
+     * QEMU debug console on port 0xE9, when run with -debugcon
+     *
+     * Registered next to COM1 so it gets the whole boot log.
+     */
+    debugcon_init();
+
     /*
      * Display boot progress via printk
      *
@@ -97,10 +134,84 @@ void kmain(void)
      */
     printk(LOG_INFO, "os-dev kernel starting\n");
     printk(LOG_INFO, "GDT initialized\n");
+    printk(LOG_INFO, "IDT initialized\n");
     printk(LOG_INFO, "VGA initialized\n");
+    if (fbcon_active()) {
+        printk(LOG_INFO, "Framebuffer console: %ux%u characters\n",
+               fbcon_cols(), fbcon_rows());
+    }
     printk(LOG_INFO, "Serial initialized\n");
+    if (debugcon_present()) {
+        printk(LOG_INFO, "Debug console on port 0x%x\n", DEBUGCON_PORT);
+    }
     printk(LOG_INFO, "Memory map entries: %d\n", boot_mmap_count);
 
+    /*
+     * Per-subsystem log levels from the command line
+     *
+     * Before the other subsystems start, so their klog() messages
+     * are filtered from the first one.
+     */
+    printk(LOG_INFO, "Command line: %s\n", kernel_cmdline);
+    if (log_parse_cmdline(kernel_cmdline) < 0) {
+        printk(LOG_WARN, "Bad log option on the command line\n");
+    }
+
+    /*
+     * Set up IRQ routing (IOAPIC + LAPIC, or the 8259A PIC)
+     *
+     * All lines stay masked until a driver requests them.
+     */
+    irq_init();
+
+    /*
+     * Bottom halves: softirqs run on the way out of interrupts
+     */
+    softirq_init();
+
+    /*
+     * Serial output from here on is queued and sent by the UART's
+     * TX-empty interrupt
+     */
+    serial_irq_init();
+
+    /*
+     * printk() only logs from here on; a tasklet prints the log
+     */
+    printk_init_async();
+
+    /*
+     * Calibrate the TSC against the PIT and start kernel time
+     */
+    ktime_init();
+
+    /*
+     * Start the tick (LAPIC timer, one-shot); idle stops it when it can
+     */
+    tick_init();
+
+    /*
+     * High-resolution timers share the LAPIC one-shot with the tick
+     */
+    hrtimers_init();
+
+    /*
+     * Timer wheel; expired timers run in TIMER_SOFTIRQ
+     */
+    timer_init();
+
+    /*
+     * Build the page frame descriptor array from the E820 map
+     *
+     * Every later memory subsystem indexes struct page by frame number.
+     */
+    page_init();
+
+    /*
+     * Turn on PSE so large mappings can use 4MB pages
+     */
+    hugepage_init();
+
     /*
      * Run tests if TEST_MODE is enabled
      *
@@ -114,15 +225,14 @@ void kmain(void)
     printk(LOG_INFO, "Boot complete\n");
 
     /*
-     * Halt
+     * Idle
      *
-     * We're done for this story. The HLT instruction stops the CPU
-     * until an interrupt occurs. Since interrupts are disabled,
-     * this effectively stops execution.
+     * cpu_idle() runs softirqs left to the softirq thread, or halts
+     * and stops the tick while nothing is due.
      *
      * In later stories, we'll have a proper scheduler loop here.
      */
     for (;;) {
-        hlt();
+        cpu_idle();
     }
 }
@@ -0,0 +1,289 @@
+/*
+ * kernel/init/softirq.c - Softirqs and tasklets (bottom halves)
+ *
+ * Pending vectors are a bitmask, touched only with interrupts off. A
+ * processing pass snapshots and clears the mask, runs the snapshot
+ * with interrupts on, and repeats while handlers (or interrupts that
+ * arrived meanwhile) raise more, up to the budget.
+ *
+ * Softirqs never nest: an interrupt arriving during a pass only sets
+ * bits, which the running pass picks up on its next round.
+ */
+
+#include <softirq.h>
+#include <trace.h>
+#include <asm.h>
+
+static softirq_action_fn softirq_vec[NR_SOFTIRQS];
+static volatile uint32_t softirq_mask;
+
+static uint32_t hardirq_count;
+static bool softirq_running;
+static bool ksoftirqd_woken;            /* irq_exit() left work to the thread */
+
+static struct softirq_stats stats;
+
+static const char *const softirq_names[NR_SOFTIRQS] = {
+    [HI_SOFTIRQ] = "HI",
+    [TIMER_SOFTIRQ] = "TIMER",
+    [TASKLET_SOFTIRQ] = "TASKLET",
+};
+
+static struct list_head tasklet_vec = LIST_HEAD_INIT(tasklet_vec);
+static struct list_head tasklet_hi_vec = LIST_HEAD_INIT(tasklet_hi_vec);
+
+/*
+ * =============================================================================
+ * Softirq Core
+ * =============================================================================
+ */
+
+/*
+ * open_softirq - Set the handler for a vector
+ */
+void open_softirq(unsigned int nr, softirq_action_fn action)
+{
+    if (nr < NR_SOFTIRQS) {
+        softirq_vec[nr] = action;
+    }
+}
+
+/*
+ * raise_softirq_irqoff - raise_softirq() with interrupts already off
+ */
+void raise_softirq_irqoff(unsigned int nr)
+{
+    softirq_mask |= 1U << nr;
+    stats.vec[nr].raised++;
+}
+
+/*
+ * raise_softirq - Mark a vector pending
+ */
+void raise_softirq(unsigned int nr)
+{
+    unsigned long flags = irq_save();
+
+    raise_softirq_irqoff(nr);
+    irq_restore(flags);
+}
+
+/*
+ * softirq_pending - Check for pending vectors
+ */
+bool softirq_pending(void)
+{
+    return softirq_mask != 0;
+}
+
+/*
+ * run_vector - Call one vector's handler and account its time
+ */
+static void run_vector(unsigned int nr)
+{
+    struct softirq_stat *st = &stats.vec[nr];
+    uint64_t start, delta;
+
+    if (softirq_vec[nr] == NULL) {
+        return;
+    }
+
+    start = ktime_get_ns();
+    softirq_vec[nr]();
+    delta = ktime_get_ns() - start;
+    TRACE("softirq %s: %u ns", softirq_names[nr], (uint32_t)delta);
+
+    st->runs++;
+    st->time_ns += delta;
+    if (delta > st->max_ns) {
+        st->max_ns = delta;
+    }
+}
+
+/*
+ * do_softirq_pass - Run pending vectors until none are left or the
+ * budget runs out
+ *
+ * Called and returns with interrupts disabled. Whatever is still
+ * pending afterwards is left to the softirq thread.
+ */
+static void do_softirq_pass(void)
+{
+    uint64_t start = ktime_get_ns();
+    int restart = SOFTIRQ_MAX_RESTART;
+    uint32_t pending;
+    unsigned int nr;
+
+    softirq_running = true;
+
+    for (;;) {
+        pending = softirq_mask;
+        softirq_mask = 0;
+
+        sti();
+        while (pending != 0) {
+            nr = (unsigned int)__builtin_ctz(pending);
+            pending &= pending - 1;
+            run_vector(nr);
+        }
+        cli();
+
+        if (softirq_mask == 0) {
+            break;
+        }
+        if (--restart == 0 || ktime_get_ns() - start >= SOFTIRQ_MAX_NS) {
+            ksoftirqd_woken = true;
+            stats.deferred++;
+            break;
+        }
+    }
+
+    softirq_running = false;
+}
+
+/*
+ * irq_enter - Mark entry to a hardware interrupt handler
+ */
+void irq_enter(void)
+{
+    hardirq_count++;
+}
+
+/*
+ * irq_exit - Mark exit from a hardware interrupt handler
+ *
+ * While the thread owns the backlog, interrupts stop processing it, so
+ * a softirq storm cannot keep the interrupted code from running.
+ */
+void irq_exit(void)
+{
+    hardirq_count--;
+
+    if (hardirq_count == 0 && !softirq_running && !ksoftirqd_woken &&
+        softirq_mask != 0) {
+        stats.irq_exit_runs++;
+        do_softirq_pass();
+    }
+}
+
+/*
+ * in_interrupt - Check for hardirq or softirq context
+ */
+bool in_interrupt(void)
+{
+    return hardirq_count != 0 || softirq_running;
+}
+
+/*
+ * ksoftirqd_run - Body of this CPU's softirq thread
+ */
+void ksoftirqd_run(void)
+{
+    unsigned long flags = irq_save();
+
+    if (softirq_mask != 0 && !softirq_running) {
+        ksoftirqd_woken = false;
+        stats.thread_runs++;
+        do_softirq_pass();
+    }
+    irq_restore(flags);
+}
+
+/*
+ * =============================================================================
+ * Tasklets
+ * =============================================================================
+ */
+
+static void tasklet_queue(struct tasklet *t, struct list_head *list,
+                          unsigned int nr)
+{
+    unsigned long flags = irq_save();
+
+    if (t->entry.next == NULL) {
+        list_add_tail(&t->entry, list);
+        raise_softirq_irqoff(nr);
+    }
+    irq_restore(flags);
+}
+
+/*
+ * tasklet_schedule - Queue a tasklet on TASKLET_SOFTIRQ
+ */
+void tasklet_schedule(struct tasklet *t)
+{
+    tasklet_queue(t, &tasklet_vec, TASKLET_SOFTIRQ);
+}
+
+/*
+ * tasklet_hi_schedule - Queue a tasklet on HI_SOFTIRQ
+ */
+void tasklet_hi_schedule(struct tasklet *t)
+{
+    tasklet_queue(t, &tasklet_hi_vec, HI_SOFTIRQ);
+}
+
+/*
+ * tasklet_run_list - Run every tasklet queued on @list
+ *
+ * The queue is taken whole, so a tasklet that reschedules itself runs
+ * again on the next round rather than looping here. Each one is
+ * unlinked before it runs, which lets it be scheduled again from then
+ * on.
+ */
+static void tasklet_run_list(struct list_head *list)
+{
+    struct list_head work;
+    struct tasklet *t;
+    unsigned long flags;
+
+    INIT_LIST_HEAD(&work);
+    flags = irq_save();
+    list_splice_init(list, &work);
+
+    while (!list_empty(&work)) {
+        t = list_entry(work.next, struct tasklet, entry);
+        list_del(&t->entry);
+        irq_restore(flags);
+
+        t->func(t->data);
+
+        flags = irq_save();
+    }
+    irq_restore(flags);
+}
+
+static void tasklet_action(void)
+{
+    tasklet_run_list(&tasklet_vec);
+}
+
+static void tasklet_hi_action(void)
+{
+    tasklet_run_list(&tasklet_hi_vec);
+}
+
+/*
+ * softirq_init - Install the tasklet vectors
+ */
+void softirq_init(void)
+{
+    open_softirq(HI_SOFTIRQ, tasklet_hi_action);
+    open_softirq(TASKLET_SOFTIRQ, tasklet_action);
+}
+
+/*
+ * softirq_name - Short name of a vector, for stats output
+ */
+const char *softirq_name(unsigned int nr)
+{
+    return nr < NR_SOFTIRQS ? softirq_names[nr] : "?";
+}
+
+/*
+ * softirq_get_stats - Accounting since boot
+ */
+const struct softirq_stats *softirq_get_stats(void)
+{
+    return &stats;
+}
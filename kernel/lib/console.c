@@ -0,0 +1,141 @@
+/*
+ * kernel/lib/console.c - Console sink registry
+ *
+ * A singly linked list of consoles, walked by console_write() for each
+ * record the printk drain prints. Only the drain writes, one record at
+ * a time, so a console's write() never runs concurrently with itself.
+ *
+ * Links are only ever published by a single store, and an unregistered
+ * console keeps its next pointer, so a drain that interrupted a change
+ * still walks a well-formed list. No kernel dependencies: unit-tested
+ * on the host with stub consoles.
+ */
+
+#include <console.h>
+#include <printk.h>
+#include <errno.h>
+
+static struct console *consoles;
+
+/*
+ * name_equal - Compare two NUL-terminated names
+ */
+static bool name_equal(const char *a, const char *b)
+{
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/*
+ * console_register - Add a console to the registry
+ *
+ * Appends, so consoles print in registration order.
+ */
+int console_register(struct console *con)
+{
+    struct console **link;
+
+    if (con == NULL || con->name == NULL || con->write == NULL) {
+        return -EINVAL;
+    }
+
+    for (link = &consoles; *link != NULL; link = &(*link)->next) {
+        if (*link == con || name_equal((*link)->name, con->name)) {
+            return -EEXIST;
+        }
+    }
+
+    con->next = NULL;
+    __atomic_store_n(link, con, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * console_unregister - Remove a console from the registry
+ */
+void console_unregister(struct console *con)
+{
+    struct console **link;
+
+    for (link = &consoles; *link != NULL; link = &(*link)->next) {
+        if (*link == con) {
+            __atomic_store_n(link, con->next, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+}
+
+/*
+ * console_find - Registered console named @name, or NULL
+ */
+struct console *console_find(const char *name)
+{
+    struct console *con;
+
+    for (con = consoles; con != NULL; con = con->next) {
+        if (name_equal(con->name, name)) {
+            return con;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * console_set_level - Set the highest level a console prints
+ */
+int console_set_level(struct console *con, int level)
+{
+    if (con == NULL || level < LOG_ERROR || level > LOG_DEBUG) {
+        return -EINVAL;
+    }
+    con->level = level;
+    return 0;
+}
+
+/*
+ * console_set_enabled - Turn a console on or off
+ */
+void console_set_enabled(struct console *con, bool enabled)
+{
+    if (con != NULL) {
+        con->enabled = enabled;
+    }
+}
+
+/*
+ * console_write - Print a record on every console that takes @level
+ */
+uint32_t console_write(int level, const char *prefix, const char *text,
+                       size_t len)
+{
+    struct console *con;
+    uint32_t written = 0;
+    size_t prefix_len = 0;
+
+    if (prefix != NULL) {
+        while (prefix[prefix_len] != '\0') {
+            prefix_len++;
+        }
+    }
+
+    for (con = __atomic_load_n(&consoles, __ATOMIC_ACQUIRE); con != NULL;
+         con = __atomic_load_n(&con->next, __ATOMIC_ACQUIRE)) {
+        if (!con->enabled ||
+            (level >= LOG_ERROR && level <= LOG_DEBUG && level > con->level)) {
+            continue;
+        }
+        if (prefix_len > 0) {
+            con->write(con, prefix, prefix_len);
+        }
+        con->write(con, text, len);
+        if (con->flush != NULL) {
+            con->flush(con);
+        }
+        con->records++;
+        written++;
+    }
+    return written;
+}
@@ -8,84 +8,222 @@
  *   - Unit tested on the host with standard tools
  *   - Used by printk for kernel output
  *   - Reused anywhere string formatting is needed
+ *
+ * Conversion never divides. Decimal digits come two at a time from a
+ * lookup table, with n / 100 done as a multiply by a reciprocal; a
+ * 64-bit value is first split into 8-digit chunks the same way, using
+ * mul_u64_u64_hi(). Power-of-two bases use shifts and masks. The i686
+ * kernel therefore needs neither a divide instruction per digit nor
+ * libgcc's __udivdi3.
  */
 
 #include <format.h>
+#include <math64.h>
 
 /*
- * format_unsigned - Format unsigned integer to buffer
+ * Reciprocals, exact for every input they are used on:
+ *   n / 100 = (n * 0x51EB851F) >> 37          for all 32-bit n
+ *   n / 10^8 = mulhi(n, 0xABCC77118461CEFD) >> 26   for all 64-bit n
  */
-int format_unsigned(char *buf, size_t size, uint32_t num, int base, int uppercase)
+#define DIV100_MUL      0x51EB851FU
+#define DIV100_SHIFT    37
+#define DIV1E8_MUL      0xABCC77118461CEFDULL
+#define DIV1E8_SHIFT    26
+
+/* Longest conversion: 64-bit octal is 22 digits */
+#define FORMAT_DIGITS_MAX   24
+
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char digits_lower[] = "0123456789abcdef";
+static const char digits_upper[] = "0123456789ABCDEF";
+
+static inline uint32_t div100(uint32_t n)
 {
-    char tmp[12];  /* Enough for 32-bit decimal (10 digits) or hex (8 digits) */
-    char *p = tmp + sizeof(tmp) - 1;
-    const char *digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
-    int len = 0;
+    return (uint32_t)(((uint64_t)n * DIV100_MUL) >> DIV100_SHIFT);
+}
 
-    if (size == 0) {
-        return 0;
+/*
+ * put_pair - Store the two digits of @n (0-99) just before @end
+ */
+static inline char *put_pair(char *end, uint32_t n)
+{
+    end -= 2;
+    end[0] = digit_pairs[n * 2];
+    end[1] = digit_pairs[n * 2 + 1];
+    return end;
+}
+
+/*
+ * put_dec32 - Store @num's decimal digits just before @end
+ *
+ * Returns: Start of the digits
+ */
+static char *put_dec32(char *end, uint32_t num)
+{
+    uint32_t q;
+
+    while (num >= 100) {
+        q = div100(num);
+        end = put_pair(end, num - q * 100);
+        num = q;
+    }
+    if (num >= 10) {
+        return put_pair(end, num);
     }
+    *--end = (char)('0' + num);
+    return end;
+}
 
-    *p = '\0';
+/*
+ * put_dec8 - Store exactly eight digits of @num (< 10^8) before @end
+ */
+static char *put_dec8(char *end, uint32_t num)
+{
+    uint32_t q;
+    int i;
 
-    /* Special case: zero */
-    if (num == 0) {
-        if (size > 1) {
-            buf[0] = '0';
-            buf[1] = '\0';
-            return 1;
-        }
-        buf[0] = '\0';
-        return 0;
+    for (i = 0; i < 4; i++) {
+        q = div100(num);
+        end = put_pair(end, num - q * 100);
+        num = q;
     }
+    return end;
+}
+
+/*
+ * put_dec64 - Store @num's decimal digits just before @end
+ *
+ * Peels off 8-digit chunks until the rest fits in 32 bits; that takes
+ * at most two rounds.
+ */
+static char *put_dec64(char *end, uint64_t num)
+{
+    uint64_t q;
 
-    /* Build string in reverse */
-    while (num > 0) {
-        *--p = digits[num % base];
-        num /= base;
+    while (num >> 32) {
+        q = mul_u64_u64_hi(num, DIV1E8_MUL) >> DIV1E8_SHIFT;
+        end = put_dec8(end, (uint32_t)num - (uint32_t)q * 100000000U);
+        num = q;
     }
+    return put_dec32(end, (uint32_t)num);
+}
+
+/*
+ * put_pow2 - Store @num's digits in base 2^@bits just before @end
+ */
+static char *put_pow2(char *end, uint64_t num, int bits, const char *digits)
+{
+    uint32_t mask = (1U << bits) - 1;
+
+    do {
+        *--end = digits[(uint32_t)num & mask];
+        num >>= bits;
+    } while (num != 0);
+    return end;
+}
+
+/*
+ * copy_out - Copy @len characters to @buf, truncating to fit
+ */
+static int copy_out(char *buf, size_t size, const char *s, int len)
+{
+    int i;
 
-    /* Copy to output buffer */
-    while (*p && (size_t)(len + 1) < size) {
-        buf[len++] = *p++;
+    if (size == 0) {
+        return 0;
+    }
+    if ((size_t)len >= size) {
+        len = (int)size - 1;
+    }
+    for (i = 0; i < len; i++) {
+        buf[i] = s[i];
     }
     buf[len] = '\0';
-
     return len;
 }
 
 /*
- * format_signed - Format signed integer to buffer
+ * format_u64 - Format 64-bit unsigned integer to buffer
  */
-int format_signed(char *buf, size_t size, int32_t num)
+int format_u64(char *buf, size_t size, uint64_t num, int base, int uppercase)
 {
+    char tmp[FORMAT_DIGITS_MAX];
+    char *end = tmp + sizeof(tmp);
+    char *p;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    switch (base) {
+    case 16:
+        p = put_pow2(end, num, 4, uppercase ? digits_upper : digits_lower);
+        break;
+    case 8:
+        p = put_pow2(end, num, 3, digits_lower);
+        break;
+    default:
+        p = put_dec64(end, num);
+        break;
+    }
+
+    return copy_out(buf, size, p, (int)(end - p));
+}
+
+/*
+ * format_s64 - Format 64-bit signed integer to buffer
+ */
+int format_s64(char *buf, size_t size, int64_t num)
+{
+    /* Negating in unsigned arithmetic is exact even for INT64_MIN */
+    uint64_t mag = num < 0 ? 0 - (uint64_t)num : (uint64_t)num;
     int len = 0;
 
     if (size == 0) {
         return 0;
     }
 
-    if (num < 0) {
-        if (size > 1) {
-            buf[len++] = '-';
-        }
+    if (num < 0 && size > 1) {
+        buf[len++] = '-';
+    }
+    return len + format_u64(buf + len, size - len, mag, 10, 0);
+}
+
+/*
+ * format_unsigned - Format unsigned integer to buffer
+ */
+int format_unsigned(char *buf, size_t size, uint32_t num, int base, int uppercase)
+{
+    char tmp[12];  /* Enough for 32-bit decimal (10 digits) or hex (8 digits) */
+    char *end = tmp + sizeof(tmp);
+    char *p;
 
-        /* Handle INT32_MIN specially to avoid overflow on negation */
-        if (num == (int32_t)0x80000000) {
-            const char *int32_min = "2147483648";
-            const char *p = int32_min;
-            while (*p && (size_t)(len + 1) < size) {
-                buf[len++] = *p++;
-            }
-            buf[len] = '\0';
-            return len;
-        }
-        num = -num;
+    if (base != 10) {
+        return format_u64(buf, size, num, base, uppercase);
     }
 
-    /* Format the absolute value */
-    int ulen = format_unsigned(buf + len, size - len, (uint32_t)num, 10, 0);
-    return len + ulen;
+    /* 32-bit decimal skips the 64-bit chunking */
+    p = put_dec32(end, num);
+    return copy_out(buf, size, p, (int)(end - p));
+}
+
+/*
+ * format_signed - Format signed integer to buffer
+ */
+int format_signed(char *buf, size_t size, int32_t num)
+{
+    return format_s64(buf, size, num);
 }
 
 /*
@@ -0,0 +1,398 @@
+/*
+ * kernel/lib/hrtimer.c - High-resolution timers
+ *
+ * The tree is a plain (unaugmented) rbtree keyed by expiry. Caching the
+ * leftmost node makes "what is next" O(1), which matters because it is
+ * asked on every timer interrupt and every idle entry; insert and
+ * cancel stay O(log n).
+ *
+ * The base and histogram code has no kernel dependencies and is
+ * unit-tested on the host.
+ */
+
+#include <hrtimer.h>
+#include <math64.h>
+
+/*
+ * hrtimer_base_init - Empty a base
+ */
+void hrtimer_base_init(struct hrtimer_cpu_base *base)
+{
+    uint32_t i;
+
+    base->active.node = NULL;
+    base->active.augment = NULL;
+    base->leftmost = NULL;
+    base->count = 0;
+
+    for (i = 0; i < HRTIMER_HIST_BUCKETS; i++) {
+        base->expiry.buckets[i] = 0;
+    }
+    base->expiry.count = 0;
+    base->expiry.total_ns = 0;
+    base->expiry.max_ns = 0;
+}
+
+/*
+ * hrtimer_base_enqueue - Queue a timer at timer->expires
+ *
+ * Equal keys descend right, which keeps FIFO order among them. The new
+ * node is leftmost exactly when the descent never turned right.
+ */
+bool hrtimer_base_enqueue(struct hrtimer_cpu_base *base,
+                          struct hrtimer *timer)
+{
+    struct rb_node **link = &base->active.node;
+    struct rb_node *parent = NULL;
+    bool leftmost = true;
+
+    while (*link) {
+        parent = *link;
+        if (timer->expires < rb_entry(parent, struct hrtimer, node)->expires) {
+            link = &parent->left;
+        } else {
+            link = &parent->right;
+            leftmost = false;
+        }
+    }
+
+    rb_link_node(&timer->node, parent, link);
+    rb_insert_color(&timer->node, &base->active);
+    if (leftmost) {
+        base->leftmost = &timer->node;
+    }
+    timer->queued = true;
+    base->count++;
+
+    return leftmost;
+}
+
+/*
+ * hrtimer_base_remove - Dequeue a timer
+ */
+bool hrtimer_base_remove(struct hrtimer_cpu_base *base,
+                         struct hrtimer *timer)
+{
+    if (!timer->queued) {
+        return false;
+    }
+
+    if (base->leftmost == &timer->node) {
+        base->leftmost = rb_next(&timer->node);
+    }
+    rb_erase(&timer->node, &base->active);
+    timer->queued = false;
+    base->count--;
+
+    return true;
+}
+
+/*
+ * hrtimer_base_next - Earliest expiry in the base
+ */
+uint64_t hrtimer_base_next(const struct hrtimer_cpu_base *base)
+{
+    if (base->leftmost == NULL) {
+        return KTIME_MAX;
+    }
+    return rb_entry(base->leftmost, struct hrtimer, node)->expires;
+}
+
+/*
+ * hrtimer_base_run - Run every timer due by @now, in expiry order
+ *
+ * The leftmost node is re-read after every callback, since a callback
+ * may start or cancel other timers. A restarted timer must have been
+ * moved past @now (see hrtimer_forward()), or it would run again here.
+ */
+uint64_t hrtimer_base_run(struct hrtimer_cpu_base *base, uint64_t now)
+{
+    struct hrtimer *timer;
+
+    while (base->leftmost != NULL) {
+        timer = rb_entry(base->leftmost, struct hrtimer, node);
+        if (timer->expires > now) {
+            break;
+        }
+
+        hrtimer_base_remove(base, timer);
+        hrtimer_hist_add(&base->expiry, now - timer->expires);
+
+        if (timer->function(timer) == HRTIMER_RESTART && !timer->queued) {
+            hrtimer_base_enqueue(base, timer);
+        }
+    }
+
+    return hrtimer_base_next(base);
+}
+
+/*
+ * hrtimer_forward - Push a periodic timer's expiry past @now
+ *
+ * The period count is one division when the interval fits 32 bits,
+ * which covers any period up to about four seconds.
+ */
+uint64_t hrtimer_forward(struct hrtimer *timer, uint64_t now,
+                         uint64_t interval)
+{
+    uint64_t n;
+
+    if (interval == 0 || now < timer->expires) {
+        return 0;
+    }
+
+    if (interval <= 0xFFFFFFFFULL) {
+        n = div_u64_u32(now - timer->expires, (uint32_t)interval, NULL) + 1;
+    } else {
+        for (n = 1; timer->expires + n * interval <= now; n++) {
+        }
+    }
+    timer->expires += n * interval;
+
+    return n;
+}
+
+/*
+ * hrtimer_latency_bucket - Histogram bucket for a lateness in ns
+ *
+ * Bucket n >= 1 holds [2^(n+9), 2^(n+10)) ns, i.e. the position of the
+ * most significant bit, found without 64-bit helpers.
+ */
+uint32_t hrtimer_latency_bucket(uint64_t ns)
+{
+    uint32_t hi = (uint32_t)(ns >> 32);
+    uint32_t msb;
+
+    if (ns < (1ULL << HRTIMER_HIST_MIN_SHIFT)) {
+        return 0;
+    }
+
+    if (hi != 0) {
+        msb = 63 - (uint32_t)__builtin_clz(hi);
+    } else {
+        msb = 31 - (uint32_t)__builtin_clz((uint32_t)ns);
+    }
+    msb -= HRTIMER_HIST_MIN_SHIFT - 1;
+
+    return msb < HRTIMER_HIST_BUCKETS ? msb : HRTIMER_HIST_BUCKETS - 1;
+}
+
+/*
+ * hrtimer_hist_add - Record one lateness sample
+ */
+void hrtimer_hist_add(struct hrtimer_latency_hist *hist, uint64_t ns)
+{
+    hist->buckets[hrtimer_latency_bucket(ns)]++;
+    hist->count++;
+    hist->total_ns += ns;
+    if (ns > hist->max_ns) {
+        hist->max_ns = ns;
+    }
+}
+
+/*
+ * Everything below runs the boot CPU's base off the LAPIC timer. Host
+ * tests drive a struct hrtimer_cpu_base directly.
+ */
+#ifndef HOST_TEST
+
+#include <tick.h>
+#include <asm.h>
+#include <errno.h>
+#include <printk.h>
+
+/* One base per CPU; only the boot CPU runs for now */
+static struct hrtimer_cpu_base cpu_base;
+static bool hres_active;
+
+static struct hrtimer_latency_hist wakeup_hist;
+
+/*
+ * hrtimer_interrupt - Tick event handler: run expired timers
+ */
+static uint64_t hrtimer_interrupt(uint64_t now)
+{
+    return hrtimer_base_run(&cpu_base, now);
+}
+
+/*
+ * hrtimers_init - Set up this CPU's base and take over timer events
+ */
+void hrtimers_init(void)
+{
+    hrtimer_base_init(&cpu_base);
+    hres_active = tick_set_event_handler(hrtimer_interrupt) == 0;
+}
+
+/*
+ * hrtimer_start - (Re)queue a timer
+ *
+ * Only a new earliest timer needs the one-shot reprogrammed.
+ */
+void hrtimer_start(struct hrtimer *timer, uint64_t expires,
+                   enum hrtimer_mode mode)
+{
+    unsigned long flags = irq_save();
+
+    hrtimer_base_remove(&cpu_base, timer);
+    if (mode == HRTIMER_MODE_REL) {
+        expires += ktime_get_ns();
+    }
+    timer->expires = expires;
+
+    if (hrtimer_base_enqueue(&cpu_base, timer)) {
+        tick_program_event(expires);
+    }
+    irq_restore(flags);
+}
+
+/*
+ * hrtimer_cancel - Dequeue a timer
+ *
+ * Callbacks run with interrupts off on this CPU, so one cannot be
+ * running concurrently.
+ */
+bool hrtimer_cancel(struct hrtimer *timer)
+{
+    unsigned long flags = irq_save();
+    bool queued = hrtimer_base_remove(&cpu_base, timer);
+
+    irq_restore(flags);
+    return queued;
+}
+
+struct sleeper {
+    struct hrtimer timer;
+    volatile bool done;
+};
+
+static enum hrtimer_restart sleeper_wake(struct hrtimer *timer)
+{
+    container_of(timer, struct sleeper, timer)->done = true;
+    return HRTIMER_NORESTART;
+}
+
+/*
+ * nanosleep - Sleep for @ns nanoseconds
+ *
+ * Returns with interrupts enabled.
+ */
+uint64_t nanosleep(uint64_t ns)
+{
+    struct sleeper s;
+    uint64_t now = ktime_get_ns();
+    uint64_t deadline = ns < KTIME_MAX - now ? now + ns : KTIME_MAX;
+    uint64_t late;
+    unsigned long flags;
+
+    if (hres_active) {
+        hrtimer_setup(&s.timer, sleeper_wake);
+        s.done = false;
+        hrtimer_start(&s.timer, deadline, HRTIMER_MODE_ABS);
+        while (!s.done) {
+            cpu_idle();
+        }
+    } else {
+        sti();
+        while (ktime_get_ns() < deadline) {
+            /* spin */
+        }
+    }
+
+    late = ktime_get_ns() - deadline;
+    flags = irq_save();
+    hrtimer_hist_add(&wakeup_hist, late);
+    irq_restore(flags);
+
+    return late;
+}
+
+/*
+ * sys_nanosleep - nanosleep(2)
+ */
+int sys_nanosleep(const struct kernel_timespec *req,
+                  struct kernel_timespec *rem)
+{
+    uint64_t ns;
+
+    if (req == NULL) {
+        return -EFAULT;
+    }
+    if (req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= NSEC_PER_SEC) {
+        return -EINVAL;
+    }
+
+    if ((uint64_t)req->tv_sec >= KTIME_MAX / NSEC_PER_SEC) {
+        ns = KTIME_MAX;
+    } else {
+        ns = (uint64_t)req->tv_sec * NSEC_PER_SEC + (uint64_t)req->tv_nsec;
+    }
+    nanosleep(ns);
+
+    if (rem != NULL) {
+        rem->tv_sec = 0;
+        rem->tv_nsec = 0;
+    }
+    return 0;
+}
+
+/*
+ * hrtimer_get_expiry_hist - Expiry lateness histogram of this CPU
+ */
+const struct hrtimer_latency_hist *hrtimer_get_expiry_hist(void)
+{
+    return &cpu_base.expiry;
+}
+
+/*
+ * hrtimer_get_wakeup_hist - nanosleep() wakeup lateness histogram
+ */
+const struct hrtimer_latency_hist *hrtimer_get_wakeup_hist(void)
+{
+    return &wakeup_hist;
+}
+
+/*
+ * dump_hist - Print one histogram's non-empty buckets
+ *
+ * Bucket bounds are printed in microseconds, rounded down.
+ */
+static void dump_hist(const char *name, const struct hrtimer_latency_hist *h)
+{
+    uint32_t avg = 0;
+    uint32_t lo, hi, i;
+
+    if (h->count != 0 && h->count <= 0xFFFFFFFFULL) {
+        avg = (uint32_t)div_u64_u32(h->total_ns, (uint32_t)h->count, NULL);
+    }
+    printk(LOG_INFO, "hrtimer: %s lateness, %u samples, avg %u ns, max %u ns\n",
+           name, (uint32_t)h->count, avg,
+           h->max_ns > 0xFFFFFFFFULL ? 0xFFFFFFFF : (uint32_t)h->max_ns);
+
+    for (i = 0; i < HRTIMER_HIST_BUCKETS; i++) {
+        if (h->buckets[i] == 0) {
+            continue;
+        }
+        lo = i == 0 ? 0 : (uint32_t)div_u64_u32(
+                 1ULL << (i + HRTIMER_HIST_MIN_SHIFT - 1), 1000, NULL);
+        hi = (uint32_t)div_u64_u32(1ULL << (i + HRTIMER_HIST_MIN_SHIFT),
+                                   1000, NULL);
+        if (i == HRTIMER_HIST_BUCKETS - 1) {
+            printk(LOG_INFO, "  >= %u us: %u\n", lo, (uint32_t)h->buckets[i]);
+        } else {
+            printk(LOG_INFO, "  %u-%u us: %u\n", lo, hi,
+                   (uint32_t)h->buckets[i]);
+        }
+    }
+}
+
+/*
+ * hrtimer_dump_latency - Print both histograms via printk
+ */
+void hrtimer_dump_latency(void)
+{
+    dump_hist("expiry", &cpu_base.expiry);
+    dump_hist("nanosleep wakeup", &wakeup_hist);
+}
+
+#endif /* !HOST_TEST */
@@ -0,0 +1,109 @@
+/*
+ * kernel/lib/jump_label.c - Patchable branches
+ *
+ * jump_label_apply() only writes bytes where the table says, so it is
+ * unit-tested on the host against a buffer standing in for code. The
+ * kernel applies it to the real __jump_table.
+ */
+
+#include <jump_label.h>
+
+static const uint8_t jump_label_nop[JUMP_LABEL_SIZE] = JUMP_LABEL_NOP;
+
+/*
+ * jump_label_patch - Write a JMP to @entry's target, or the NOP
+ *
+ * rel32 is relative to the end of the 5-byte instruction.
+ */
+static void jump_label_patch(const struct jump_entry *entry, bool enable)
+{
+    uint8_t *code = (uint8_t *)entry->code;
+    uint32_t rel;
+    int i;
+
+    if (!enable) {
+        for (i = 0; i < JUMP_LABEL_SIZE; i++) {
+            code[i] = jump_label_nop[i];
+        }
+        return;
+    }
+
+    rel = (uint32_t)(entry->target - (entry->code + JUMP_LABEL_SIZE));
+    code[0] = JUMP_LABEL_JMP;
+    for (i = 1; i < JUMP_LABEL_SIZE; i++) {
+        code[i] = (uint8_t)(rel >> ((i - 1) * 8));
+    }
+}
+
+/*
+ * jump_label_apply - Patch a key's sites to match its state
+ */
+uint32_t jump_label_apply(const struct jump_entry *start,
+                          const struct jump_entry *end,
+                          const struct static_key *key)
+{
+    const struct jump_entry *entry;
+    uint32_t patched = 0;
+
+    for (entry = start; entry < end; entry++) {
+        if (entry->key == (uintptr_t)key) {
+            jump_label_patch(entry, key->enabled);
+            patched++;
+        }
+    }
+    return patched;
+}
+
+#ifdef HOST_TEST
+
+/* Host code has no patched sites; static_branch_unlikely() reads the key */
+static void static_key_set(struct static_key *key, bool enabled)
+{
+    key->enabled = enabled;
+}
+
+#else
+
+#include <asm.h>
+
+/* The table, from the linker script */
+extern const struct jump_entry __jump_table_start[];
+extern const struct jump_entry __jump_table_end[];
+
+/*
+ * static_key_set - Change a key and patch its sites
+ *
+ * With interrupts off no site can run half-patched. The CPU sees its
+ * own stores to code once it has taken a branch, and returning from
+ * here is one.
+ */
+static void static_key_set(struct static_key *key, bool enabled)
+{
+    unsigned long flags = irq_save();
+
+    key->enabled = enabled;
+    jump_label_apply(__jump_table_start, __jump_table_end, key);
+    irq_restore(flags);
+}
+
+#endif /* HOST_TEST */
+
+/*
+ * static_key_enable - Turn a key on, patching its sites into jumps
+ */
+void static_key_enable(struct static_key *key)
+{
+    if (!key->enabled) {
+        static_key_set(key, true);
+    }
+}
+
+/*
+ * static_key_disable - Turn a key off, patching its sites back to NOPs
+ */
+void static_key_disable(struct static_key *key)
+{
+    if (key->enabled) {
+        static_key_set(key, false);
+    }
+}
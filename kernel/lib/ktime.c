@@ -0,0 +1,173 @@
+/*
+ * kernel/lib/ktime.c - Clocksources and kernel time
+ *
+ * TSC calibration: PIT channel 2 counts down a 10 ms window while the
+ * TSC is sampled at both ends. The shortest of several runs is kept,
+ * since an SMI or emulator hiccup can only make a run longer.
+ *
+ * The mult/shift math has no kernel dependencies and is unit-tested
+ * on the host.
+ */
+
+#include <ktime.h>
+
+/*
+ * clocks_calc_mult_shift - Pick mult/shift for a from -> to rate ratio
+ */
+void clocks_calc_mult_shift(uint32_t *mult, uint32_t *shift,
+                            uint32_t from, uint32_t to)
+{
+    uint32_t sft;
+    uint64_t m = 0;
+
+    for (sft = 32; sft > 0; sft--) {
+        m = div_u64_u32(((uint64_t)to << sft) + from / 2, from, NULL);
+        if (m <= 0xFFFFFFFFULL) {
+            break;
+        }
+    }
+    if (sft == 0) {
+        m = div_u64_u32((uint64_t)to + from / 2, from, NULL);
+    }
+
+    *mult = (uint32_t)m;
+    *shift = sft;
+}
+
+/*
+ * Everything below needs the hardware. Host tests only need the math.
+ */
+#ifndef HOST_TEST
+
+#include <asm.h>
+#include <pit.h>
+#include <printk.h>
+
+#define CALIBRATE_TICKS     11932   /* 10 ms of PIT input clock */
+#define CALIBRATE_RUNS      5
+
+/* CPUID 0x80000007 EDX: advanced power management */
+#define CPUID_APM_INVARIANT_TSC (1U << 8)
+
+uint32_t tsc_khz;
+bool tsc_invariant;
+
+static uint64_t read_none(void)
+{
+    return 0;
+}
+
+static uint64_t read_tsc(void)
+{
+    return rdtsc();
+}
+
+static struct clocksource clock_none = {
+    .name = "none",
+    .read = read_none,
+    .mult = 0,
+    .shift = 0,
+};
+
+static struct clocksource clock_tsc = {
+    .name = "tsc",
+    .read = read_tsc,
+    .max_idle_ns = ~0ULL,
+};
+
+/* Must be read before the 16-bit counter wraps (~55 ms) */
+static struct clocksource clock_pit = {
+    .name = "pit",
+    .read = pit_read_ticks,
+    .max_idle_ns = 50ULL * NSEC_PER_MSEC,
+};
+
+static struct clocksource *ktime_clock = &clock_none;
+
+/*
+ * detect_invariant_tsc - Check CPUID for a constant-rate TSC
+ */
+static bool detect_invariant_tsc(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax < 0x80000007) {
+        return false;
+    }
+    cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & CPUID_APM_INVARIANT_TSC) != 0;
+}
+
+/*
+ * calibrate_tsc - Measure the TSC rate against PIT channel 2
+ *
+ * kHz = cycles * PIT_HZ / (ticks * 1000)
+ *
+ * Returns: TSC frequency in kHz, or 0 if the PIT did not respond
+ */
+static uint32_t calibrate_tsc(void)
+{
+    uint64_t best = 0;
+    uint64_t cycles;
+    int i;
+
+    for (i = 0; i < CALIBRATE_RUNS; i++) {
+        cycles = pit_measure_tsc(CALIBRATE_TICKS);
+        if (cycles != 0 && (best == 0 || cycles < best)) {
+            best = cycles;
+        }
+    }
+    if (best == 0) {
+        return 0;
+    }
+
+    return (uint32_t)div_u64_u32(best * PIT_HZ, CALIBRATE_TICKS * 1000U,
+                                 NULL);
+}
+
+/*
+ * ktime_init - Calibrate the TSC and select the clocksource
+ */
+void ktime_init(void)
+{
+    struct clocksource *cs;
+
+    tsc_khz = calibrate_tsc();
+    tsc_invariant = detect_invariant_tsc();
+
+    if (tsc_khz != 0 && tsc_invariant) {
+        cs = &clock_tsc;
+        clocks_calc_mult_shift(&cs->mult, &cs->shift, tsc_khz, NSEC_PER_MSEC);
+    } else {
+        pit_clocksource_init();
+        cs = &clock_pit;
+        clocks_calc_mult_shift(&cs->mult, &cs->shift, PIT_HZ, NSEC_PER_SEC);
+    }
+    cs->base = cs->read();
+    ktime_clock = cs;
+
+    klog(LOG_SYS_TIME, LOG_INFO, "ktime: TSC %u kHz (%s), clocksource %s\n",
+           tsc_khz, tsc_invariant ? "invariant" : "not invariant",
+           cs->name);
+}
+
+/*
+ * ktime_get_ns - Nanoseconds since ktime_init()
+ */
+uint64_t ktime_get_ns(void)
+{
+    const struct clocksource *cs = ktime_clock;
+
+    return clocksource_cyc2ns(cs->read() - cs->base, cs->mult, cs->shift);
+}
+
+/*
+ * ktime_get_clocksource - The clocksource ktime_get_ns() reads
+ */
+const struct clocksource *ktime_get_clocksource(void)
+{
+    return ktime_clock;
+}
+
+#endif /* !HOST_TEST */
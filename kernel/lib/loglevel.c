@@ -0,0 +1,219 @@
+/*
+ * kernel/lib/loglevel.c - Per-subsystem runtime log levels
+ *
+ * Holds the level byte and LOG_DEBUG key klog() tests for each
+ * subsystem, and parses the log and console options of the kernel
+ * command line. No kernel dependencies beyond jump_label.c and
+ * console.c, so it is unit-tested on the host.
+ */
+
+#include <printk.h>
+#include <console.h>
+#include <errno.h>
+
+/* Longest console name on the command line, with its NUL */
+#define CONSOLE_NAME_MAX    16
+
+static const char *const subsys_names[LOG_SYS_COUNT] = {
+    [LOG_SYS_CORE]   = "core",
+    [LOG_SYS_MM]     = "mm",
+    [LOG_SYS_IRQ]    = "irq",
+    [LOG_SYS_TIME]   = "time",
+    [LOG_SYS_SERIAL] = "serial",
+};
+
+static const char *const level_names[] = {
+    [LOG_ERROR] = "error",
+    [LOG_WARN]  = "warn",
+    [LOG_INFO]  = "info",
+    [LOG_DEBUG] = "debug",
+};
+
+uint8_t log_levels[LOG_SYS_COUNT] = {
+    [LOG_SYS_CORE]   = LOG_DEFAULT_LEVEL,
+    [LOG_SYS_MM]     = LOG_DEFAULT_LEVEL,
+    [LOG_SYS_IRQ]    = LOG_DEFAULT_LEVEL,
+    [LOG_SYS_TIME]   = LOG_DEFAULT_LEVEL,
+    [LOG_SYS_SERIAL] = LOG_DEFAULT_LEVEL,
+};
+
+struct static_key log_debug_keys[LOG_SYS_COUNT];
+
+/*
+ * log_set_level - Set a subsystem's runtime log level
+ */
+int log_set_level(unsigned int subsys, int level)
+{
+    if (subsys >= LOG_SYS_COUNT || level < LOG_ERROR || level > LOG_DEBUG) {
+        return -EINVAL;
+    }
+
+    log_levels[subsys] = (uint8_t)level;
+    if (level == LOG_DEBUG) {
+        static_key_enable(&log_debug_keys[subsys]);
+    } else {
+        static_key_disable(&log_debug_keys[subsys]);
+    }
+    return 0;
+}
+
+/*
+ * log_get_level - A subsystem's runtime log level, or -EINVAL
+ */
+int log_get_level(unsigned int subsys)
+{
+    if (subsys >= LOG_SYS_COUNT) {
+        return -EINVAL;
+    }
+    return log_levels[subsys];
+}
+
+/*
+ * log_subsys_name - Command-line name of a subsystem, or NULL
+ */
+const char *log_subsys_name(unsigned int subsys)
+{
+    return subsys < LOG_SYS_COUNT ? subsys_names[subsys] : NULL;
+}
+
+/*
+ * match - Check that s[0..len) is exactly @word
+ */
+static bool match(const char *s, size_t len, const char *word)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (word[i] != s[i]) {
+            return false;
+        }
+    }
+    return word[len] == '\0';
+}
+
+/*
+ * parse_level - Level named by s[0..len), or -EINVAL
+ */
+static int parse_level(const char *s, size_t len)
+{
+    int level;
+
+    if (len == 1 && s[0] >= '0' && s[0] <= '0' + LOG_DEBUG) {
+        return s[0] - '0';
+    }
+    for (level = LOG_ERROR; level <= LOG_DEBUG; level++) {
+        if (match(s, len, level_names[level])) {
+            return level;
+        }
+    }
+    return -EINVAL;
+}
+
+/*
+ * parse_console - Apply "console.<name>=<value>"
+ *
+ * @name: Console name, @name_len characters
+ * @value: Level or "off", @value_len characters
+ */
+static int parse_console(const char *name, size_t name_len,
+                         const char *value, size_t value_len)
+{
+    char buf[CONSOLE_NAME_MAX];
+    struct console *con;
+    size_t i;
+    int level;
+
+    if (name_len >= sizeof(buf)) {
+        return -EINVAL;
+    }
+    for (i = 0; i < name_len; i++) {
+        buf[i] = name[i];
+    }
+    buf[name_len] = '\0';
+
+    con = console_find(buf);
+    if (con == NULL) {
+        return -EINVAL;
+    }
+    if (match(value, value_len, "off")) {
+        console_set_enabled(con, false);
+        return 0;
+    }
+
+    level = parse_level(value, value_len);
+    if (level < 0) {
+        return -EINVAL;
+    }
+    console_set_enabled(con, true);
+    return console_set_level(con, level);
+}
+
+/*
+ * parse_option - Apply one command-line option, s[0..len)
+ *
+ * Returns: 0 if applied or not a log option, -EINVAL if malformed
+ */
+static int parse_option(const char *s, size_t len)
+{
+    size_t name_len = 0;
+    unsigned int subsys;
+    int level;
+
+    while (name_len < len && s[name_len] != '=') {
+        name_len++;
+    }
+    if (name_len == len) {
+        return 0;
+    }
+
+    if (name_len > 8 && match(s, 8, "console.")) {
+        return parse_console(s + 8, name_len - 8, s + name_len + 1,
+                             len - name_len - 1);
+    }
+
+    level = parse_level(s + name_len + 1, len - name_len - 1);
+
+    if (match(s, name_len, "loglevel")) {
+        if (level < 0) {
+            return -EINVAL;
+        }
+        for (subsys = 0; subsys < LOG_SYS_COUNT; subsys++) {
+            log_set_level(subsys, level);
+        }
+        return 0;
+    }
+
+    if (name_len < 4 || !match(s, 4, "log.")) {
+        return 0;
+    }
+    for (subsys = 0; subsys < LOG_SYS_COUNT; subsys++) {
+        if (match(s + 4, name_len - 4, subsys_names[subsys])) {
+            return log_set_level(subsys, level);
+        }
+    }
+    return -EINVAL;
+}
+
+/*
+ * log_parse_cmdline - Apply the log options of a kernel command line
+ */
+int log_parse_cmdline(const char *cmdline)
+{
+    size_t len;
+    int ret = 0;
+
+    while (*cmdline != '\0') {
+        while (*cmdline == ' ') {
+            cmdline++;
+        }
+        len = 0;
+        while (cmdline[len] != '\0' && cmdline[len] != ' ') {
+            len++;
+        }
+        if (len > 0 && parse_option(cmdline, len) < 0) {
+            ret = -EINVAL;
+        }
+        cmdline += len;
+    }
+    return ret;
+}
@@ -11,10 +11,24 @@
 
 #include <panic.h>
 #include <printk.h>
+#include <serial.h>
 #include <vga.h>
 #include <asm.h>
 #include <types.h>
 
+#ifdef __x86_64__
+/*
+ * print_reg64 - Print a 64-bit register as 16 zero-padded hex digits
+ *
+ * @name: Register name
+ * @value: Register value
+ */
+static void print_reg64(const char *name, uint64_t value)
+{
+    printk(LOG_ERROR, "  %s=0x%016llx\n", name, (unsigned long long)value);
+}
+#endif
+
 /*
  * panic - Halt the kernel with error message and register dump
  *
@@ -26,6 +40,40 @@
  */
 void panic(const char *msg)
 {
+#ifdef __x86_64__
+    /*
+     * Register storage - must be first to ensure capture happens
+     * before any stack frame manipulation
+     */
+    uint64_t rax, rbx, rcx, rdx, rsi, rdi, rbp, rsp, rip, rflags;
+
+    /*
+     * CRITICAL: Capture registers IMMEDIATELY
+     *
+     * Same caveats as the i686 path below. In the SysV x86_64 ABI,
+     * RBX/RBP are callee-saved; RDI holds @msg on entry.
+     */
+    __asm__ volatile (
+        "movq %%rax, %0\n"
+        "movq %%rbx, %1\n"
+        "movq %%rcx, %2\n"
+        "movq %%rdx, %3\n"
+        "movq %%rsi, %4\n"
+        "movq %%rdi, %5\n"
+        "movq %%rbp, %6\n"
+        "movq %%rsp, %7\n"
+        "pushfq\n"
+        "popq %8\n"
+        : "=m"(rax), "=m"(rbx), "=m"(rcx), "=m"(rdx),
+          "=m"(rsi), "=m"(rdi), "=m"(rbp), "=m"(rsp), "=m"(rflags)
+    );
+
+    /* Caller's RIP is the return address at [rbp + 8] */
+    __asm__ volatile (
+        "movq 8(%%rbp), %0"
+        : "=r"(rip)
+    );
+#else
     /*
      * Register storage - must be first to ensure capture happens
      * before any stack frame manipulation
@@ -69,9 +117,17 @@ void panic(const char *msg)
         : "=r"(eip)
     );
 
+#endif
+
     /* Disable interrupts - we're not coming back */
     cli();
 
+    /* Flush queued serial output and poll from here on */
+    serial_set_sync(true);
+
+    /* Print the log backlog, then every message as it is logged */
+    printk_set_sync(true);
+
     /*
      * Display KERNEL PANIC header (red on VGA)
      */
@@ -83,11 +139,25 @@ void panic(const char *msg)
      */
     vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
     printk(LOG_ERROR, "Register dump:\n");
+#ifdef __x86_64__
+    print_reg64("RAX", rax);
+    print_reg64("RBX", rbx);
+    print_reg64("RCX", rcx);
+    print_reg64("RDX", rdx);
+    print_reg64("RSI", rsi);
+    print_reg64("RDI", rdi);
+    print_reg64("RBP", rbp);
+    print_reg64("RSP", rsp);
+    print_reg64("RIP", rip);
+    print_reg64("RFLAGS", rflags);
+    printk(LOG_ERROR, "\n");
+#else
     printk(LOG_ERROR, "  EAX=0x%X  EBX=0x%X\n", eax, ebx);
     printk(LOG_ERROR, "  ECX=0x%X  EDX=0x%X\n", ecx, edx);
     printk(LOG_ERROR, "  ESI=0x%X  EDI=0x%X\n", esi, edi);
     printk(LOG_ERROR, "  EBP=0x%X  ESP=0x%X\n", ebp, esp);
     printk(LOG_ERROR, "  EIP=0x%X  EFLAGS=0x%X\n\n", eip, eflags);
+#endif
 
     /* Final message */
     vga_set_color(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK);
@@ -1,20 +1,36 @@
 /*
  * kernel/lib/printk.c - Kernel Logging Implementation
  *
- * Implements printk() with format string parsing. Output goes to
- * both serial (primary) and VGA (secondary) for maximum visibility.
+ * Implements printk() with format string parsing. Each call is
+ * formatted once, straight into a record of the lock-free log ring
+ * (see printk_ringbuf.h); the consoles are fed from the ring
+ * afterwards, so the caller does not wait on the slowest one. Each
+ * record goes to every registered console (console.h) whose level
+ * admits it.
+ *
+ * Consoles are drained:
+ *   - by printk() itself until printk_init_async(), and in sync mode
+ *     (panic()),
+ *   - by a tasklet otherwise, and
+ *   - by printk() again when it gets half a ring ahead of the consoles,
+ *     so a burst cannot overwrite records before they are printed.
+ *
+ * One drain runs at a time; a printk() that finds one running (e.g.
+ * from an interrupt) leaves its record for that drain to pick up.
  *
  * This is a minimal implementation suitable for kernel debugging:
  *   - No dynamic memory allocation
  *   - No floating point support
- *   - No width/precision modifiers (MVP)
- *   - Fixed internal buffer for number conversion
+ *   - Records are cut at PRB_TEXT_MAX - 1 characters
  */
 
 #include <printk.h>
-#include <serial.h>
-#include <vga.h>
+#include <printk_ringbuf.h>
+#include <console.h>
 #include <format.h>
+#include <ktime.h>
+#include <math64.h>
+#include <softirq.h>
 
 /*
  * GCC built-in variadic argument support
@@ -25,6 +41,9 @@ typedef __builtin_va_list va_list;
 #define va_end(ap)          __builtin_va_end(ap)
 #define va_arg(ap, type)    __builtin_va_arg(ap, type)
 
+/* A printk() this many records ahead of the consoles drains them itself */
+#define PRINTK_BACKLOG_MAX  (PRB_RECORDS / 2)
+
 /*
  * Log level prefixes - indexed by level value
  */
@@ -35,166 +54,394 @@ static const char *level_prefixes[] = {
     "[DEBUG] "
 };
 
+static struct printk_ringbuf log_buf;
+
+static uint32_t console_seq;            /* Next record for the consoles */
+static bool console_busy;               /* A drain is running */
+static bool printk_async;               /* Leave draining to the tasklet */
+static bool printk_sync;                /* panic(): drain in printk() */
+static struct tasklet console_tasklet;
+
+static struct printk_stats stats;
+
 /*
- * output_char - Send character to both serial and VGA
- *
- * Converts '\n' to '\r\n' on serial for proper terminal display,
- * matching the behavior of serial_puts().
+ * struct printk_buf - Text being formatted into a record
+ */
+struct printk_buf {
+    char *buf;
+    size_t len;
+    size_t size;                        /* Including the NUL */
+    bool truncated;
+};
+
+/*
+ * output_char - Append a character to the record
  */
-static void output_char(char c)
+static void output_char(struct printk_buf *out, char c)
 {
-    if (c == '\n') {
-        serial_putchar('\r');
+    if (out->len + 1 < out->size) {
+        out->buf[out->len++] = c;
+    } else {
+        out->truncated = true;
     }
-    serial_putchar(c);
-    vga_putchar(c);
 }
 
 /*
- * output_string - Send string to both serial and VGA
+ * output_string - Append a string to the record
  */
-static void output_string(const char *s)
+static void output_string(struct printk_buf *out, const char *s)
 {
-    serial_puts(s);
-    vga_puts(s);
+    while (*s) {
+        output_char(out, *s++);
+    }
 }
 
 /*
- * print_unsigned - Print unsigned integer in specified base
- *
- * Uses format_unsigned() for the actual conversion, then outputs the result.
- *
- * @num: Number to print
- * @base: Number base (10 or 16)
- * @uppercase: Use uppercase hex digits if true
+ * struct printk_spec - One conversion's flags, width and precision
  */
-static void print_unsigned(uint32_t num, int base, int uppercase)
+struct printk_spec {
+    bool left;                          /* '-': pad on the right */
+    bool zero;                          /* '0': pad numbers with zeros */
+    int width;                          /* Minimum field width */
+    int precision;                      /* '.N', or -1 if none */
+    int length;                         /* 'l' count; 'z' counts as 'l' */
+};
+
+/*
+ * output_pad - Append @n copies of @c
+ */
+static void output_pad(struct printk_buf *out, char c, int n)
 {
-    char buf[12];
-    format_unsigned(buf, sizeof(buf), num, base, uppercase);
-    output_string(buf);
+    while (n-- > 0) {
+        output_char(out, c);
+    }
 }
 
 /*
- * print_signed - Print signed integer
+ * print_field - Append @len characters of @s padded to the field width
  *
- * Uses format_signed() for the actual conversion, then outputs the result.
- *
- * @num: Number to print
+ * @out: Record text
+ * @spec: Conversion spec
+ * @prefix: Sign or "0x", placed before any zero padding
+ * @s: Digits or text
+ * @len: Characters of @s to print
+ * @min_digits: Zeros to lead @s with, for a number's precision
  */
-static void print_signed(int32_t num)
+static void print_field(struct printk_buf *out, const struct printk_spec *spec,
+                        const char *prefix, const char *s, int len,
+                        int min_digits)
 {
-    char buf[12];
-    format_signed(buf, sizeof(buf), num);
-    output_string(buf);
+    int prefix_len = 0;
+    int zeros = min_digits > len ? min_digits - len : 0;
+    int pad;
+
+    while (prefix[prefix_len] != '\0') {
+        prefix_len++;
+    }
+    pad = spec->width - prefix_len - zeros - len;
+
+    if (!spec->left && !spec->zero) {
+        output_pad(out, ' ', pad);
+    }
+    output_string(out, prefix);
+    if (!spec->left && spec->zero) {
+        output_pad(out, '0', pad);
+    }
+    output_pad(out, '0', zeros);
+    while (len-- > 0) {
+        output_char(out, *s++);
+    }
+    if (spec->left) {
+        output_pad(out, ' ', pad);
+    }
 }
 
 /*
- * print_pointer - Print 32-bit value as hex with 0x prefix
+ * print_number - Append an integer converted by format_u64()
  *
- * Uses format_pointer() for the actual conversion, then outputs the result.
+ * As in C, a precision is the minimum number of digits and turns off
+ * zero padding, and zero with precision 0 prints no digits.
  *
- * @num: Value to print
+ * @out: Record text
+ * @spec: Conversion spec
+ * @num: Magnitude
+ * @negative: Print a minus sign
+ * @base: 10 or 16
+ * @uppercase: Use uppercase hex digits if true
  */
-static void print_pointer(uint32_t num)
+static void print_number(struct printk_buf *out, struct printk_spec *spec,
+                         uint64_t num, bool negative, int base, int uppercase)
 {
-    char buf[12];
-    format_pointer(buf, sizeof(buf), num);
-    output_string(buf);
+    char buf[24];
+    int len = 0;
+
+    if (num != 0 || spec->precision != 0) {
+        len = format_u64(buf, sizeof(buf), num, base, uppercase);
+    }
+    if (spec->precision >= 0) {
+        spec->zero = false;
+    }
+    print_field(out, spec, negative ? "-" : "", buf, len, spec->precision);
 }
 
 /*
- * vprintk - Print formatted string with va_list
+ * print_string - Append a string, at most @spec->precision characters
+ */
+static void print_string(struct printk_buf *out, struct printk_spec *spec,
+                         const char *s)
+{
+    int len = 0;
+
+    if (s == NULL) {
+        s = "(null)";
+    }
+    while (s[len] != '\0' && (spec->precision < 0 || len < spec->precision)) {
+        len++;
+    }
+    spec->zero = false;
+    print_field(out, spec, "", s, len, 0);
+}
+
+/*
+ * parse_int - Read a decimal field width or precision
+ */
+static int parse_int(const char **fmt)
+{
+    int n = 0;
+
+    while (**fmt >= '0' && **fmt <= '9') {
+        n = n * 10 + (*(*fmt)++ - '0');
+    }
+    return n;
+}
+
+/*
+ * vprintk - Format a string with va_list into a record
  *
+ * Conversions are %[flags][width][.precision][length]specifier, with
+ * flags '-' and '0', '*' for a width or precision taken from the
+ * arguments, and lengths l, ll and z.
+ *
+ * @out: Record text
  * @fmt: Format string
  * @args: Argument list
  */
-static void vprintk(const char *fmt, va_list args)
+static void vprintk(struct printk_buf *out, const char *fmt, va_list args)
 {
+    struct printk_spec spec;
+    const char *start;
+    uint64_t num;
+    int64_t snum;
     char c;
 
     while ((c = *fmt++) != '\0') {
         if (c != '%') {
-            output_char(c);
+            output_char(out, c);
             continue;
         }
+        start = fmt - 1;
 
-        /* Handle format specifier */
-        c = *fmt++;
-        if (c == '\0') {
-            break;
+        spec.left = false;
+        spec.zero = false;
+        spec.width = 0;
+        spec.precision = -1;
+        spec.length = 0;
+
+        for (;; fmt++) {
+            if (*fmt == '-') {
+                spec.left = true;
+            } else if (*fmt == '0') {
+                spec.zero = true;
+            } else {
+                break;
+            }
         }
 
-        switch (c) {
-        case 's': {
-            const char *s = va_arg(args, const char *);
-            if (s == NULL) {
-                s = "(null)";
+        if (*fmt == '*') {
+            fmt++;
+            spec.width = va_arg(args, int);
+            if (spec.width < 0) {
+                spec.left = true;
+                spec.width = -spec.width;
             }
-            while (*s) {
-                output_char(*s++);
+        } else {
+            spec.width = parse_int(&fmt);
+        }
+
+        if (*fmt == '.') {
+            fmt++;
+            if (*fmt == '*') {
+                fmt++;
+                spec.precision = va_arg(args, int);
+            } else {
+                spec.precision = parse_int(&fmt);
             }
-            break;
         }
 
-        case 'd': {
-            int32_t n = va_arg(args, int32_t);
-            print_signed(n);
-            break;
+        /* size_t is long-sized on both i686 and x86_64 */
+        while (*fmt == 'l' || *fmt == 'z') {
+            fmt++;
+            spec.length++;
         }
 
-        case 'u': {
-            uint32_t n = va_arg(args, uint32_t);
-            print_unsigned(n, 10, 0);
+        /* Handle format specifier */
+        c = *fmt++;
+        if (c == '\0') {
             break;
         }
 
-        case 'x': {
-            uint32_t n = va_arg(args, uint32_t);
-            print_unsigned(n, 16, 0);
+        switch (c) {
+        case 's':
+            print_string(out, &spec, va_arg(args, const char *));
             break;
-        }
 
-        case 'X': {
-            uint32_t n = va_arg(args, uint32_t);
-            print_unsigned(n, 16, 1);
+        case 'd':
+            if (spec.length >= 2) {
+                snum = va_arg(args, long long);
+            } else if (spec.length == 1) {
+                snum = va_arg(args, long);
+            } else {
+                snum = va_arg(args, int32_t);
+            }
+            print_number(out, &spec, snum < 0 ? 0 - (uint64_t)snum
+                                              : (uint64_t)snum,
+                         snum < 0, 10, 0);
+            break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+            if (spec.length >= 2) {
+                num = va_arg(args, unsigned long long);
+            } else if (spec.length == 1) {
+                num = va_arg(args, unsigned long);
+            } else {
+                num = va_arg(args, uint32_t);
+            }
+            print_number(out, &spec, num, false, c == 'u' ? 10 : 16,
+                         c == 'X');
             break;
-        }
 
         case 'c': {
             /* char is promoted to int in variadic functions */
             char ch = (char)va_arg(args, int);
-            output_char(ch);
+            spec.zero = false;
+            print_field(out, &spec, "", &ch, 1, 0);
             break;
         }
 
         case 'p': {
+            /*
+             * Kernel addresses fit in 32 bits on both i686 and x86_64
+             * (the 64-bit kernel runs identity-mapped below 4GB).
+             */
+            char buf[12];
             void *ptr = va_arg(args, void *);
-            print_pointer((uint32_t)ptr);
+            int len = format_pointer(buf, sizeof(buf),
+                                     (uint32_t)(uintptr_t)ptr);
+            spec.zero = false;
+            print_field(out, &spec, "", buf, len, 0);
             break;
         }
 
         case '%':
-            output_char('%');
+            output_char(out, '%');
             break;
 
         default:
             /* Unknown specifier - print literally */
-            output_char('%');
-            output_char(c);
+            while (start < fmt) {
+                output_char(out, *start++);
+            }
             break;
         }
     }
 }
 
+/*
+ * format_record - Append formatted text to a record or line
+ */
+static void format_record(struct printk_buf *out, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vprintk(out, fmt, args);
+    va_end(args);
+}
+
+/*
+ * console_emit - Print one record on the consoles that take its level
+ */
+static void console_emit(const struct printk_record *rec)
+{
+    if (rec->level <= LOG_DEBUG) {
+        console_write(rec->level, level_prefixes[rec->level], rec->text,
+                      rec->len);
+    } else {
+        console_write(-1, NULL, rec->text, rec->len);
+    }
+}
+
+/*
+ * console_drain - Print every committed record the consoles have not seen
+ *
+ * Stops at a record that is reserved but not yet committed: its writer
+ * may be the context this drain interrupted, and it drains (or
+ * schedules a drain) itself after committing. In sync mode there is
+ * no such writer left to wait for, so the record is skipped.
+ *
+ * The recheck after dropping ownership catches a record committed by
+ * an interrupt that found the drain busy just before it ended.
+ */
+static void console_drain(void)
+{
+    struct printk_record rec;
+    uint32_t seq;
+
+    do {
+        if (__atomic_exchange_n(&console_busy, true, __ATOMIC_ACQUIRE)) {
+            return;
+        }
+
+        for (;;) {
+            seq = console_seq;
+            if (prb_read(&log_buf, &seq, &rec) == 0) {
+                console_emit(&rec);
+            } else if (printk_sync && seq != prb_head(&log_buf)) {
+                stats.dropped++;
+            } else {
+                stats.dropped += seq - console_seq;
+                console_seq = seq;
+                break;
+            }
+            /* Records overwritten before we got to them */
+            stats.dropped += seq - console_seq;
+            console_seq = seq + 1;
+        }
+
+        __atomic_store_n(&console_busy, false, __ATOMIC_RELEASE);
+        seq = console_seq;
+    } while (prb_read(&log_buf, &seq, NULL) == 0);
+}
+
+static void console_tasklet_fn(unsigned long data)
+{
+    (void)data;
+    console_drain();
+}
+
 /*
  * printk - Print formatted kernel message
  *
- * Entry point for all kernel logging. Prefixes message with log level
- * and outputs to both serial and VGA.
+ * Entry point for all kernel logging. Formats the message into the next
+ * log record, then drains it to the consoles or leaves that to the
+ * tasklet.
  */
 void printk(int level, const char *fmt, ...)
 {
+    struct printk_record *rec;
+    struct printk_buf out;
     va_list args;
 
     /* Filter by compile-time log level */
@@ -202,12 +449,134 @@ void printk(int level, const char *fmt, ...)
         return;
     }
 
-    /* Validate level for prefix lookup */
-    if (level >= 0 && level <= LOG_DEBUG) {
-        output_string(level_prefixes[level]);
-    }
+    rec = prb_reserve(&log_buf);
+    rec->ts_nsec = ktime_get_ns();
+    rec->level = (level >= 0 && level <= LOG_DEBUG) ? (uint8_t)level
+                                                    : PRB_LEVEL_NONE;
+    rec->cpu = 0;                       /* Only the boot CPU runs for now */
+
+    out.buf = rec->text;
+    out.len = 0;
+    out.size = PRB_TEXT_MAX;
+    out.truncated = false;
 
     va_start(args, fmt);
-    vprintk(fmt, args);
+    vprintk(&out, fmt, args);
     va_end(args);
+
+    rec->text[out.len] = '\0';
+    rec->len = (uint16_t)out.len;
+    prb_commit(&log_buf, rec);
+
+    if (out.truncated) {
+        __atomic_fetch_add(&stats.truncated, 1, __ATOMIC_RELAXED);
+    }
+
+    if (printk_sync || !printk_async) {
+        console_drain();
+    } else if (prb_head(&log_buf) - console_seq >= PRINTK_BACKLOG_MAX) {
+        __atomic_fetch_add(&stats.direct, 1, __ATOMIC_RELAXED);
+        console_drain();
+    } else {
+        tasklet_schedule(&console_tasklet);
+    }
+}
+
+/*
+ * printk_ratelimit - Take a token for a rate-limited message
+ */
+bool printk_ratelimit(struct ratelimit_state *rs, int level,
+                      const char *site)
+{
+    uint32_t missed;
+    bool ok = ratelimit_check(rs, ktime_get_ns(), &missed);
+
+    if (!ok) {
+        __atomic_fetch_add(&stats.suppressed, 1, __ATOMIC_RELAXED);
+    }
+    if (missed > 0) {
+        printk(level, "%s: %u messages suppressed\n", site, missed);
+    }
+    return ok;
+}
+
+/*
+ * printk_init_async - Hand console draining over to a tasklet
+ */
+void printk_init_async(void)
+{
+    tasklet_init(&console_tasklet, console_tasklet_fn, 0);
+    printk_async = true;
+}
+
+/*
+ * printk_flush - Print everything logged so far
+ */
+void printk_flush(void)
+{
+    console_drain();
+}
+
+/*
+ * printk_set_sync - Drain the consoles in printk() itself
+ *
+ * Entering sync mode takes the consoles over even from a drain that
+ * was interrupted and will never resume, as after a panic.
+ */
+void printk_set_sync(bool sync)
+{
+    printk_sync = sync;
+    if (sync) {
+        __atomic_store_n(&console_busy, false, __ATOMIC_RELEASE);
+        console_drain();
+    }
+}
+
+/*
+ * printk_get_stats - Log ring counters
+ */
+const struct printk_stats *printk_get_stats(void)
+{
+    stats.records = prb_head(&log_buf);
+    return &stats;
+}
+
+/*
+ * dmesg_first_seq - Sequence number of the oldest retained record
+ */
+uint32_t dmesg_first_seq(void)
+{
+    return prb_first_seq(&log_buf);
+}
+
+/*
+ * dmesg_read - Format the next retained record as a log line
+ *
+ * Lines look like "[    1.234567] [INFO]  text": seconds and
+ * microseconds of ktime when the record was written.
+ */
+size_t dmesg_read(uint32_t *seq, char *buf, size_t size)
+{
+    struct printk_record rec;
+    struct printk_buf out;
+    uint32_t rem;
+    uint32_t secs;
+
+    if (size == 0 || prb_read(&log_buf, seq, &rec) != 0) {
+        return 0;
+    }
+    (*seq)++;
+
+    out.buf = buf;
+    out.len = 0;
+    out.size = size;
+    out.truncated = false;
+
+    secs = (uint32_t)div_u64_u32(rec.ts_nsec, NSEC_PER_SEC, &rem);
+    format_record(&out, "[%5u.%06u] %s%s", secs, rem / NSEC_PER_USEC,
+                  rec.level <= LOG_DEBUG ? level_prefixes[rec.level] : "",
+                  rec.text);
+
+    buf[out.len] = '\0';
+    return out.len;
 }
@@ -0,0 +1,161 @@
+/*
+ * kernel/lib/printk_ringbuf.c - Lock-free printk record ring
+ *
+ * Writers serialize only on the atomic increment of the head; each then
+ * owns its slot until it commits. Readers are seqlock-style: check the
+ * slot's id, copy, check again.
+ *
+ * No kernel dependencies; unit-tested on the host.
+ */
+
+#include <printk_ringbuf.h>
+#include <errno.h>
+
+#define PRB_MASK            (PRB_RECORDS - 1)
+#define PRB_COMMITTED       1U
+
+static inline uint32_t slot_id(uint32_t seq)
+{
+    return seq << 1;
+}
+
+/*
+ * copy_record - Copy a record's header and text
+ *
+ * Only the text in use is copied. The length may be torn if a writer
+ * reuses the slot meanwhile; it is clamped here and the copy discarded
+ * by the caller's id re-check.
+ */
+static void copy_record(struct printk_record *dst,
+                        const struct printk_record *src)
+{
+    uint32_t len = src->len;
+    uint32_t i;
+
+    if (len > PRB_TEXT_MAX - 1) {
+        len = PRB_TEXT_MAX - 1;
+    }
+    dst->ts_nsec = src->ts_nsec;
+    dst->seq = src->seq;
+    dst->len = (uint16_t)len;
+    dst->level = src->level;
+    dst->cpu = src->cpu;
+    for (i = 0; i < len; i++) {
+        dst->text[i] = src->text[i];
+    }
+    dst->text[len] = '\0';
+}
+
+static inline struct prb_slot *seq_to_slot(struct printk_ringbuf *rb,
+                                           uint32_t seq)
+{
+    return &rb->slots[seq & PRB_MASK];
+}
+
+/*
+ * prb_init - Empty a ring
+ *
+ * Every slot starts out as an uncommitted record 0, which readers treat
+ * as "not written yet" for any sequence number of the first lap.
+ */
+void prb_init(struct printk_ringbuf *rb)
+{
+    uint32_t i;
+
+    for (i = 0; i < PRB_RECORDS; i++) {
+        rb->slots[i].id = 0;
+    }
+    rb->head = 0;
+}
+
+/*
+ * prb_reserve - Claim the next record for writing
+ *
+ * The uncommitted id goes out before any of the record's bytes change,
+ * so a reader copying the previous lap's record sees it move.
+ */
+struct printk_record *prb_reserve(struct printk_ringbuf *rb)
+{
+    uint32_t seq = __atomic_fetch_add(&rb->head, 1, __ATOMIC_RELAXED);
+    struct prb_slot *slot = seq_to_slot(rb, seq);
+
+    __atomic_store_n(&slot->id, slot_id(seq), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->rec.seq = seq;
+    return &slot->rec;
+}
+
+/*
+ * prb_commit - Publish a record returned by prb_reserve()
+ */
+void prb_commit(struct printk_ringbuf *rb, struct printk_record *rec)
+{
+    struct prb_slot *slot = seq_to_slot(rb, rec->seq);
+
+    __atomic_store_n(&slot->id, slot_id(rec->seq) | PRB_COMMITTED,
+                     __ATOMIC_RELEASE);
+}
+
+/*
+ * prb_head - Sequence number the next record will get
+ */
+uint32_t prb_head(const struct printk_ringbuf *rb)
+{
+    return __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * prb_first_seq - Sequence number of the oldest record retained
+ *
+ * Before the first wrap this is 0; after it, the slot at head is the
+ * next to be reused and so is already as good as gone.
+ */
+uint32_t prb_first_seq(const struct printk_ringbuf *rb)
+{
+    uint32_t head = prb_head(rb);
+
+    return head > PRB_RECORDS ? head - PRB_RECORDS : 0;
+}
+
+/*
+ * prb_read - Copy out the record at *@seq, or the oldest one after it
+ *
+ * The id check distinguishes three cases: the slot still holds an
+ * older lap (not written yet), exactly the wanted record, or a newer
+ * lap (overwritten: restart from the new oldest record).
+ */
+int prb_read(const struct printk_ringbuf *rb, uint32_t *seq,
+             struct printk_record *out)
+{
+    const struct prb_slot *slot;
+    uint32_t id, first;
+    int32_t delta;
+
+    for (;;) {
+        first = prb_first_seq(rb);
+        if ((int32_t)((*seq - first) << 1) < 0) {
+            *seq = first;
+        }
+
+        slot = &rb->slots[*seq & PRB_MASK];
+        id = __atomic_load_n(&slot->id, __ATOMIC_ACQUIRE);
+        delta = (int32_t)((id & ~PRB_COMMITTED) - slot_id(*seq));
+
+        if (delta < 0 || (delta == 0 && !(id & PRB_COMMITTED))) {
+            return -EAGAIN;
+        }
+        if (delta > 0) {
+            continue;
+        }
+        if (out == NULL) {
+            return 0;
+        }
+
+        copy_record(out, &slot->rec);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->id, __ATOMIC_RELAXED) == id) {
+            return 0;
+        }
+    }
+}
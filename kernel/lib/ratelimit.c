@@ -0,0 +1,41 @@
+/*
+ * kernel/lib/ratelimit.c - Message rate limiting
+ *
+ * See ratelimit.h. The bucket refills all at once at the end of each
+ * window rather than a token at a time, so the common case needs no
+ * arithmetic on the timestamp beyond the compare with window_end.
+ */
+
+#include <ratelimit.h>
+
+/*
+ * ratelimit_check - Take a token for a message
+ */
+bool ratelimit_check(struct ratelimit_state *rs, uint64_t now,
+                     uint32_t *missed)
+{
+    *missed = 0;
+
+    if (now < rs->window_end) {
+        if (rs->tokens > 0) {
+            rs->tokens--;
+            return true;
+        }
+        rs->missed++;
+        rs->suppressed++;
+        return false;
+    }
+
+    /* Window over: refill, and report what the last ones dropped */
+    *missed = rs->missed;
+    rs->missed = 0;
+    rs->window_end = now + rs->interval;
+    if (rs->burst == 0) {
+        rs->tokens = 0;
+        rs->missed++;
+        rs->suppressed++;
+        return false;
+    }
+    rs->tokens = rs->burst - 1;
+    return true;
+}
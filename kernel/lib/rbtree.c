@@ -0,0 +1,359 @@
+/*
+ * kernel/lib/rbtree.c - Intrusive Red-Black Tree
+ *
+ * Classic red-black tree with parent pointers (CLRS), using NULL
+ * leaves. Augmented values are kept valid by three rules:
+ *   - after linking or unlinking, recompute from the lowest changed
+ *     node up to the root (rb_propagate)
+ *   - a rotation recomputes the two rotated nodes, lower one first
+ *   - recoloring never changes a subtree's contents, so needs nothing
+ * A rotation keeps the set of nodes below its top position unchanged,
+ * so ancestors of a rotation never need recomputing.
+ *
+ * No kernel dependencies, so the same code is unit-tested on the host.
+ */
+
+#include <rbtree.h>
+
+/*
+ * augment - Recompute one node's augmented value, if the tree has one
+ */
+static inline void augment(struct rb_root *root, struct rb_node *node)
+{
+    if (root->augment != NULL) {
+        root->augment(node);
+    }
+}
+
+/*
+ * is_black - NULL leaves count as black
+ */
+static inline bool is_black(const struct rb_node *node)
+{
+    return node == NULL || node->color == RB_BLACK;
+}
+
+/*
+ * change_child - Point @parent's link (or the root) from @old to @new
+ */
+static inline void change_child(struct rb_root *root, struct rb_node *parent,
+                                struct rb_node *old, struct rb_node *new)
+{
+    if (parent == NULL) {
+        root->node = new;
+    } else if (parent->left == old) {
+        parent->left = new;
+    } else {
+        parent->right = new;
+    }
+}
+
+/*
+ * rotate_left - Rotate @x down to the left; its right child takes its place
+ */
+static void rotate_left(struct rb_root *root, struct rb_node *x)
+{
+    struct rb_node *y = x->right;
+
+    x->right = y->left;
+    if (y->left != NULL) {
+        y->left->parent = x;
+    }
+    y->parent = x->parent;
+    change_child(root, x->parent, x, y);
+    y->left = x;
+    x->parent = y;
+
+    augment(root, x);
+    augment(root, y);
+}
+
+/*
+ * rotate_right - Rotate @x down to the right; its left child takes its place
+ */
+static void rotate_right(struct rb_root *root, struct rb_node *x)
+{
+    struct rb_node *y = x->left;
+
+    x->left = y->right;
+    if (y->right != NULL) {
+        y->right->parent = x;
+    }
+    y->parent = x->parent;
+    change_child(root, x->parent, x, y);
+    y->right = x;
+    x->parent = y;
+
+    augment(root, x);
+    augment(root, y);
+}
+
+/*
+ * rb_propagate - Recompute augmented values from a node to the root
+ */
+void rb_propagate(struct rb_node *node, struct rb_root *root)
+{
+    if (root->augment == NULL) {
+        return;
+    }
+    for (; node != NULL; node = node->parent) {
+        root->augment(node);
+    }
+}
+
+/*
+ * rb_insert_color - Rebalance after rb_link_node()
+ */
+void rb_insert_color(struct rb_node *node, struct rb_root *root)
+{
+    struct rb_node *parent;
+
+    rb_propagate(node, root);
+
+    while ((parent = node->parent) != NULL && parent->color == RB_RED) {
+        /* A red parent is never the root, so the grandparent exists */
+        struct rb_node *gparent = parent->parent;
+        struct rb_node *uncle;
+
+        if (parent == gparent->left) {
+            uncle = gparent->right;
+            if (!is_black(uncle)) {
+                uncle->color = RB_BLACK;
+                parent->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->right) {
+                rotate_left(root, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rotate_right(root, gparent);
+        } else {
+            uncle = gparent->left;
+            if (!is_black(uncle)) {
+                uncle->color = RB_BLACK;
+                parent->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->left) {
+                rotate_right(root, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rotate_left(root, gparent);
+        }
+    }
+
+    root->node->color = RB_BLACK;
+}
+
+/*
+ * erase_fixup - Restore black height after removing a black node
+ *
+ * @child: Node that took the removed node's place (may be NULL)
+ * @parent: Parent of @child
+ */
+static void erase_fixup(struct rb_root *root, struct rb_node *child,
+                        struct rb_node *parent)
+{
+    struct rb_node *sibling;
+
+    while (child != root->node && is_black(child)) {
+        if (child == parent->left) {
+            sibling = parent->right;
+            if (!is_black(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_left(root, parent);
+                sibling = parent->right;
+            }
+            if (is_black(sibling->left) && is_black(sibling->right)) {
+                sibling->color = RB_RED;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (is_black(sibling->right)) {
+                sibling->left->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rotate_right(root, sibling);
+                sibling = parent->right;
+            }
+            sibling->color = parent->color;
+            parent->color = RB_BLACK;
+            sibling->right->color = RB_BLACK;
+            rotate_left(root, parent);
+        } else {
+            sibling = parent->left;
+            if (!is_black(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_right(root, parent);
+                sibling = parent->left;
+            }
+            if (is_black(sibling->left) && is_black(sibling->right)) {
+                sibling->color = RB_RED;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (is_black(sibling->left)) {
+                sibling->right->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rotate_left(root, sibling);
+                sibling = parent->left;
+            }
+            sibling->color = parent->color;
+            parent->color = RB_BLACK;
+            sibling->left->color = RB_BLACK;
+            rotate_right(root, parent);
+        }
+        child = root->node;
+        break;
+    }
+
+    if (child != NULL) {
+        child->color = RB_BLACK;
+    }
+}
+
+/*
+ * rb_erase - Remove a node from the tree
+ *
+ * A node with two children is replaced by its in-order successor,
+ * which takes over its position and color; the successor's old spot is
+ * the one physically removed from the tree.
+ */
+void rb_erase(struct rb_node *node, struct rb_root *root)
+{
+    struct rb_node *child;
+    struct rb_node *parent;
+    int color;
+
+    if (node->left == NULL || node->right == NULL) {
+        child = node->left != NULL ? node->left : node->right;
+        parent = node->parent;
+        color = node->color;
+
+        if (child != NULL) {
+            child->parent = parent;
+        }
+        change_child(root, parent, node, child);
+    } else {
+        struct rb_node *succ = node->right;
+
+        while (succ->left != NULL) {
+            succ = succ->left;
+        }
+
+        color = succ->color;
+        child = succ->right;
+
+        if (succ->parent == node) {
+            parent = succ;
+        } else {
+            parent = succ->parent;
+            parent->left = child;
+            if (child != NULL) {
+                child->parent = parent;
+            }
+            succ->right = node->right;
+            node->right->parent = succ;
+        }
+
+        succ->left = node->left;
+        node->left->parent = succ;
+        succ->parent = node->parent;
+        succ->color = node->color;
+        change_child(root, node->parent, node, succ);
+    }
+
+    /* parent is the lowest node whose subtree lost a member */
+    rb_propagate(parent, root);
+
+    if (color == RB_BLACK) {
+        erase_fixup(root, child, parent);
+    }
+}
+
+/*
+ * rb_first - Leftmost (smallest) node
+ */
+struct rb_node *rb_first(const struct rb_root *root)
+{
+    struct rb_node *node = root->node;
+
+    if (node == NULL) {
+        return NULL;
+    }
+    while (node->left != NULL) {
+        node = node->left;
+    }
+    return node;
+}
+
+/*
+ * rb_last - Rightmost (largest) node
+ */
+struct rb_node *rb_last(const struct rb_root *root)
+{
+    struct rb_node *node = root->node;
+
+    if (node == NULL) {
+        return NULL;
+    }
+    while (node->right != NULL) {
+        node = node->right;
+    }
+    return node;
+}
+
+/*
+ * rb_next - In-order successor
+ */
+struct rb_node *rb_next(const struct rb_node *node)
+{
+    struct rb_node *parent;
+
+    if (node->right != NULL) {
+        node = node->right;
+        while (node->left != NULL) {
+            node = node->left;
+        }
+        return (struct rb_node *)node;
+    }
+
+    while ((parent = node->parent) != NULL && node == parent->right) {
+        node = parent;
+    }
+    return parent;
+}
+
+/*
+ * rb_prev - In-order predecessor
+ */
+struct rb_node *rb_prev(const struct rb_node *node)
+{
+    struct rb_node *parent;
+
+    if (node->left != NULL) {
+        node = node->left;
+        while (node->right != NULL) {
+            node = node->right;
+        }
+        return (struct rb_node *)node;
+    }
+
+    while ((parent = node->parent) != NULL && node == parent->left) {
+        node = parent;
+    }
+    return parent;
+}
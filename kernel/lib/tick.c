@@ -0,0 +1,270 @@
+/*
+ * kernel/lib/tick.c - Tick, timer interrupt programming and tickless idle
+ *
+ * The timer interrupt takes the fast ISR path: it updates jiffies on a
+ * tick boundary (raising TIMER_SOFTIRQ if a wheel timer is due), runs
+ * the high-resolution event handler, reprograms the one-shot for the
+ * nearer of the two, and EOIs.
+ *
+ * Nanoseconds are converted to LAPIC timer ticks with a mult/shift
+ * pair, the same way clocksources convert cycles to nanoseconds.
+ */
+
+#include <tick.h>
+#include <apic.h>
+#include <idt.h>
+#include <asm.h>
+#include <errno.h>
+#include <printk.h>
+#include <softirq.h>
+#include <timer.h>
+
+/* Longest one-shot sleep; the 32-bit initial count bounds it anyway */
+#define TICK_MAX_SLEEP_NS   (10ULL * NSEC_PER_SEC)
+
+volatile uint64_t jiffies;
+
+static bool tick_running;
+static uint32_t ns2tick_mult;
+static uint32_t ns2tick_shift;
+
+static tick_next_event_fn next_event_sources[TICK_MAX_SOURCES];
+static int next_event_count;
+
+static tick_event_handler_fn event_handler;
+
+static uint64_t next_tick;              /* ktime of the next jiffy */
+static uint64_t next_hres = KTIME_MAX;  /* Event handler's next event */
+
+/* Set by the interrupt, read by cpu_idle() after waking */
+static volatile bool tick_stopped;
+static volatile bool tick_fired;
+
+static struct tick_idle_stats idle_stats;
+
+/*
+ * ns_to_timer_ticks - LAPIC timer count for a delay, clamped to 32 bits
+ *
+ * Sleeps are also capped to what the clocksource can span unread, or
+ * ktime would lose time across the idle period. An event past the cap
+ * just takes an extra, early interrupt.
+ */
+static uint32_t ns_to_timer_ticks(uint64_t ns)
+{
+    uint64_t max = ktime_get_clocksource()->max_idle_ns;
+    uint64_t ticks;
+
+    if (max > TICK_MAX_SLEEP_NS) {
+        max = TICK_MAX_SLEEP_NS;
+    }
+    if (ns > max) {
+        ns = max;
+    }
+    ticks = mul_u64_u32_shr(ns, ns2tick_mult, ns2tick_shift);
+    return ticks > 0xFFFFFFFFULL ? 0xFFFFFFFF : (uint32_t)ticks;
+}
+
+/*
+ * program_event - Arm the one-shot for the next tick or hrtimer event
+ */
+static void program_event(uint64_t now)
+{
+    uint64_t expires = next_hres < next_tick ? next_hres : next_tick;
+
+    lapic_timer_oneshot(APIC_TIMER_VECTOR,
+                        expires > now ? ns_to_timer_ticks(expires - now) : 0);
+}
+
+/*
+ * update_jiffies - Catch jiffies up to ktime
+ */
+static void update_jiffies(uint64_t now)
+{
+    jiffies = div_u64_u32(now, TICK_NSEC, NULL);
+    next_tick = (jiffies + 1) * TICK_NSEC;
+}
+
+/*
+ * tick_interrupt - LAPIC timer handler (fast path)
+ *
+ * While the tick is stopped, cpu_idle() restarts it right after the
+ * halt returns, so only the event handler runs here.
+ */
+static void tick_interrupt(uint32_t vector)
+{
+    uint64_t now = ktime_get_ns();
+
+    (void)vector;
+
+    if (!tick_stopped && now >= next_tick) {
+        update_jiffies(now);
+        timer_tick();
+    }
+    if (event_handler != NULL) {
+        next_hres = event_handler(now);
+    }
+    if (!tick_stopped) {
+        program_event(now);
+    }
+    tick_fired = true;
+    lapic_eoi();
+}
+
+/*
+ * tick_init - Calibrate the LAPIC timer and start the tick
+ */
+int tick_init(void)
+{
+    uint32_t per_ms = lapic_timer_calibrate();
+    uint64_t now;
+
+    if (per_ms == 0) {
+        klog(LOG_SYS_TIME, LOG_WARN, "tick: no LAPIC timer, idle without tick\n");
+        return -ENODEV;
+    }
+
+    clocks_calc_mult_shift(&ns2tick_mult, &ns2tick_shift,
+                           NSEC_PER_MSEC, per_ms);
+
+    isr_register_fast(APIC_TIMER_VECTOR, tick_interrupt);
+    now = ktime_get_ns();
+    update_jiffies(now);
+    program_event(now);
+    tick_running = true;
+
+    klog(LOG_SYS_TIME, LOG_INFO, "tick: %u Hz, LAPIC timer %u kHz (/16), one-shot\n",
+           HZ, per_ms);
+    return 0;
+}
+
+/*
+ * tick_register_next_event - Add a next-event source for idle
+ */
+int tick_register_next_event(tick_next_event_fn fn)
+{
+    if (next_event_count == TICK_MAX_SOURCES) {
+        return -ENOSPC;
+    }
+    next_event_sources[next_event_count++] = fn;
+    return 0;
+}
+
+/*
+ * tick_set_event_handler - Install the high-resolution event handler
+ */
+int tick_set_event_handler(tick_event_handler_fn fn)
+{
+    if (!tick_running) {
+        return -ENODEV;
+    }
+    event_handler = fn;
+    return 0;
+}
+
+/*
+ * tick_program_event - Make the timer interrupt fire by @expires
+ *
+ * Only ever pulls the interrupt earlier; a later one is reprogrammed
+ * by the interrupt itself. While the tick is stopped the halt is
+ * already armed for the nearest event, and a new earlier one takes
+ * effect when cpu_idle() restarts the tick.
+ */
+void tick_program_event(uint64_t expires)
+{
+    if (!tick_running || expires >= next_hres) {
+        return;
+    }
+    next_hres = expires;
+    if (!tick_stopped) {
+        program_event(ktime_get_ns());
+    }
+}
+
+/*
+ * next_event - Earliest expiry over all sources
+ */
+static uint64_t next_event(void)
+{
+    uint64_t next = next_hres;
+    uint64_t t;
+    int i;
+
+    for (i = 0; i < next_event_count; i++) {
+        t = next_event_sources[i]();
+        if (t < next) {
+            next = t;
+        }
+    }
+    return next;
+}
+
+/*
+ * cpu_idle - Halt until the next interrupt, stopping the tick if possible
+ *
+ * Pending softirqs are run instead of halting, standing in for the
+ * softirq thread until there is a scheduler.
+ *
+ * Decided with interrupts off, so an expiry cannot slip in between the
+ * check and the halt; STI's one-instruction shadow makes "sti; hlt"
+ * atomic.
+ */
+void cpu_idle(void)
+{
+    uint64_t now, next, start, end;
+    bool stop = false;
+
+    cli();
+    if (softirq_pending()) {
+        ksoftirqd_run();
+        sti();
+        return;
+    }
+
+    now = ktime_get_ns();
+    next = next_event();
+    if (next <= now) {
+        sti();
+        return;
+    }
+
+    if (tick_running && next - now >= 2 * TICK_NSEC) {
+        stop = true;
+        tick_stopped = true;
+        lapic_timer_oneshot(APIC_TIMER_VECTOR, ns_to_timer_ticks(next - now));
+        idle_stats.tickless++;
+    }
+    tick_fired = false;
+
+    start = ktime_get_ns();
+    __asm__ volatile ("sti; hlt; cli" : : : "memory");
+    end = ktime_get_ns();
+
+    idle_stats.idle_ns += end - start;
+    idle_stats.entries++;
+    if (tick_fired) {
+        if (stop) {
+            idle_stats.timer_wakeups++;
+        } else {
+            idle_stats.tick_wakeups++;
+        }
+    } else {
+        idle_stats.other_wakeups++;
+    }
+
+    if (stop) {
+        update_jiffies(end);
+        timer_tick();
+        tick_stopped = false;
+        program_event(end);
+    }
+
+    sti();
+}
+
+/*
+ * tick_get_idle_stats - Idle counters since boot
+ */
+const struct tick_idle_stats *tick_get_idle_stats(void)
+{
+    return &idle_stats;
+}
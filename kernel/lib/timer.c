@@ -0,0 +1,397 @@
+/*
+ * kernel/lib/timer.c - Hierarchical timer wheel
+ *
+ * The slots of all levels live in one flat array: level 0 at
+ * [0, 256), level n at 256 + (n - 1) * 64. A bitmap of non-empty slots
+ * lets timer_base_next() skip empty slots a word at a time.
+ *
+ * Within a level, slots are ordered by expiry starting from the one
+ * that cascades (or expires) next, so the earliest timer of a level is
+ * always in its first non-empty slot.
+ */
+
+#include <timer.h>
+
+/* Index shift of level @lvl: 0, 8, 14, 20, 26 */
+#define LVL_SHIFT(lvl)  ((lvl) == 0 ? 0 : \
+                         TIMER_LVL0_BITS + ((lvl) - 1) * TIMER_LVL_BITS)
+
+/* First slot of level @lvl */
+#define LVL_OFFS(lvl)   ((lvl) == 0 ? 0 : \
+                         TIMER_LVL0_SIZE + ((lvl) - 1) * TIMER_LVL_SIZE)
+
+#define LVL_SIZE(lvl)   ((lvl) == 0 ? TIMER_LVL0_SIZE : TIMER_LVL_SIZE)
+
+static inline void slot_set(struct timer_base *base, uint32_t slot)
+{
+    base->pending[slot / 32] |= 1U << (slot % 32);
+}
+
+static inline void slot_clear(struct timer_base *base, uint32_t slot)
+{
+    base->pending[slot / 32] &= ~(1U << (slot % 32));
+}
+
+/*
+ * calc_slot - Slot for a timer expiring at @expires
+ *
+ * The level is picked by the distance from base->clk; within a level
+ * the slot comes from the expiry's own bits, so it stays correct as
+ * the clock advances.
+ */
+static uint32_t calc_slot(const struct timer_base *base, uint64_t expires)
+{
+    uint64_t delta;
+    uint32_t lvl;
+
+    if (expires < base->clk) {
+        expires = base->clk;
+    }
+    delta = expires - base->clk;
+    if (delta > TIMER_MAX_TIMEOUT) {
+        delta = TIMER_MAX_TIMEOUT;
+        expires = base->clk + TIMER_MAX_TIMEOUT;
+    }
+
+    if (delta < TIMER_LVL0_SIZE) {
+        return (uint32_t)(expires & (TIMER_LVL0_SIZE - 1));
+    }
+    for (lvl = 1; lvl < TIMER_LEVELS - 1; lvl++) {
+        if (delta < (1ULL << (LVL_SHIFT(lvl) + TIMER_LVL_BITS))) {
+            break;
+        }
+    }
+    return LVL_OFFS(lvl) +
+           (uint32_t)((expires >> LVL_SHIFT(lvl)) & (TIMER_LVL_SIZE - 1));
+}
+
+static void enqueue(struct timer_base *base, struct timer_list *timer)
+{
+    uint32_t slot = calc_slot(base, timer->expires);
+
+    list_add_tail(&timer->entry, &base->vectors[slot]);
+    slot_set(base, slot);
+    timer->slot = (uint16_t)slot;
+}
+
+/*
+ * timer_base_init - Empty a wheel
+ */
+void timer_base_init(struct timer_base *base, uint64_t clk)
+{
+    uint32_t i;
+
+    base->clk = clk;
+    base->count = 0;
+    base->expired = 0;
+    base->cascaded = 0;
+    for (i = 0; i < TIMER_SLOTS / 32; i++) {
+        base->pending[i] = 0;
+    }
+    for (i = 0; i < TIMER_SLOTS; i++) {
+        INIT_LIST_HEAD(&base->vectors[i]);
+    }
+}
+
+/*
+ * timer_base_add - Queue a timer at timer->expires
+ */
+void timer_base_add(struct timer_base *base, struct timer_list *timer)
+{
+    enqueue(base, timer);
+    base->count++;
+}
+
+/*
+ * timer_base_del - Dequeue a timer
+ */
+bool timer_base_del(struct timer_base *base, struct timer_list *timer)
+{
+    if (!timer_pending(timer)) {
+        return false;
+    }
+
+    list_del(&timer->entry);
+    if (timer->slot != TIMER_SLOT_EXPIRED) {
+        if (list_empty(&base->vectors[timer->slot])) {
+            slot_clear(base, timer->slot);
+        }
+        base->count--;
+    }
+    return true;
+}
+
+/*
+ * cascade - Re-hash the due slot of level @lvl into lower levels
+ *
+ * Returns: The slot's index within its level; the next level up is
+ *          due only when this is 0.
+ */
+static uint32_t cascade(struct timer_base *base, uint32_t lvl)
+{
+    uint32_t idx = (uint32_t)(base->clk >> LVL_SHIFT(lvl)) &
+                   (TIMER_LVL_SIZE - 1);
+    uint32_t slot = LVL_OFFS(lvl) + idx;
+    struct list_head work;
+    struct list_head *pos;
+
+    INIT_LIST_HEAD(&work);
+    list_splice_init(&base->vectors[slot], &work);
+    slot_clear(base, slot);
+
+    while (!list_empty(&work)) {
+        pos = work.next;
+        list_del(pos);
+        enqueue(base, list_entry(pos, struct timer_list, entry));
+        base->cascaded++;
+    }
+    return idx;
+}
+
+/*
+ * timer_base_collect - Move every timer due by @now onto @expired
+ */
+uint32_t timer_base_collect(struct timer_base *base, uint64_t now,
+                            struct list_head *expired)
+{
+    uint32_t collected = 0;
+    uint32_t slot, lvl;
+    struct list_head *pos;
+
+    while (base->clk <= now) {
+        if (base->count == 0) {
+            base->clk = now + 1;
+            break;
+        }
+
+        slot = (uint32_t)(base->clk & (TIMER_LVL0_SIZE - 1));
+        if (slot == 0) {
+            for (lvl = 1; lvl < TIMER_LEVELS; lvl++) {
+                if (cascade(base, lvl) != 0) {
+                    break;
+                }
+            }
+        }
+
+        if (!list_empty(&base->vectors[slot])) {
+            for (pos = base->vectors[slot].next; pos != &base->vectors[slot];
+                 pos = pos->next) {
+                list_entry(pos, struct timer_list, entry)->slot =
+                    TIMER_SLOT_EXPIRED;
+                collected++;
+                base->count--;
+            }
+            list_splice_init(&base->vectors[slot], expired->prev);
+            slot_clear(base, slot);
+        }
+
+        base->clk++;
+    }
+
+    base->expired += collected;
+    return collected;
+}
+
+/*
+ * next_pending - Offset of the first non-empty slot at or after @start
+ *
+ * Searches one level circularly. Levels start on a 32-slot boundary,
+ * so bitmap words never straddle two levels.
+ *
+ * Returns: Offset from @start, or @size if the level is empty
+ */
+static uint32_t next_pending(const struct timer_base *base, uint32_t offs,
+                             uint32_t size, uint32_t start)
+{
+    uint32_t k = 0;
+    uint32_t bit, word;
+
+    while (k < size) {
+        bit = offs + ((start + k) & (size - 1));
+        word = base->pending[bit / 32] >> (bit % 32);
+        if (word != 0) {
+            k += (uint32_t)__builtin_ctz(word);
+            return k < size ? k : size;
+        }
+        k += 32 - bit % 32;
+    }
+    return size;
+}
+
+/*
+ * timer_base_next - Earliest expiry on the wheel
+ */
+uint64_t timer_base_next(const struct timer_base *base)
+{
+    uint64_t next = TIMER_IDLE;
+    uint64_t mask;
+    uint32_t lvl, start, k, slot;
+    const struct list_head *head, *pos;
+    const struct timer_list *timer;
+
+    if (base->count == 0) {
+        return TIMER_IDLE;
+    }
+
+    for (lvl = 0; lvl < TIMER_LEVELS; lvl++) {
+        start = (uint32_t)(base->clk >> LVL_SHIFT(lvl)) & (LVL_SIZE(lvl) - 1);
+
+        /*
+         * Off a boundary, the current slot of an upper level was already
+         * cascaded and only holds timers a full turn away: search it last.
+         */
+        mask = (1ULL << LVL_SHIFT(lvl)) - 1;
+        if (lvl > 0 && (base->clk & mask) != 0) {
+            start = (start + 1) & (LVL_SIZE(lvl) - 1);
+        }
+
+        k = next_pending(base, LVL_OFFS(lvl), LVL_SIZE(lvl), start);
+        if (k == LVL_SIZE(lvl)) {
+            continue;
+        }
+
+        slot = LVL_OFFS(lvl) + ((start + k) & (LVL_SIZE(lvl) - 1));
+        head = &base->vectors[slot];
+        for (pos = head->next; pos != head; pos = pos->next) {
+            timer = list_entry(pos, struct timer_list, entry);
+            if (timer->expires < next) {
+                next = timer->expires;
+            }
+        }
+    }
+    return next;
+}
+
+/*
+ * Everything below runs the kernel's wheel off jiffies. Host tests
+ * drive a struct timer_base directly.
+ */
+#ifndef HOST_TEST
+
+#include <tick.h>
+#include <softirq.h>
+#include <trace.h>
+#include <asm.h>
+
+static struct timer_base timer_base;
+static struct list_head timer_expired = LIST_HEAD_INIT(timer_expired);
+
+/*
+ * timer_next_event - Tickless idle hook: earliest timer in ktime ns
+ *
+ * Measured from the current jiffy rather than ktime 0, so the result
+ * agrees with whatever phase the tick has against ktime.
+ */
+static uint64_t timer_next_event(void)
+{
+    uint64_t next = timer_base_next(&timer_base);
+    uint64_t now = ktime_get_ns();
+    uint64_t cur = jiffies;
+
+    if (next == TIMER_IDLE) {
+        return KTIME_MAX;
+    }
+    if (next <= cur) {
+        return now;
+    }
+    return now + (next - cur) * TICK_NSEC;
+}
+
+/*
+ * run_timer_softirq - TIMER_SOFTIRQ: call every timer due by now
+ *
+ * Due timers are collected in one pass with interrupts off; each is
+ * then unlinked and called with interrupts restored, so a handler can
+ * still cancel one that has not run yet.
+ */
+static void run_timer_softirq(void)
+{
+    unsigned long flags = irq_save();
+    struct timer_list *timer;
+
+    timer_base_collect(&timer_base, jiffies, &timer_expired);
+    while (!list_empty(&timer_expired)) {
+        timer = list_entry(timer_expired.next, struct timer_list, entry);
+        list_del(&timer->entry);
+        irq_restore(flags);
+
+        TRACE("timer %p expired at jiffy %u", timer->function,
+              (uint32_t)jiffies);
+        timer->function(timer);
+
+        flags = irq_save();
+    }
+    irq_restore(flags);
+}
+
+/*
+ * timer_init - Set up the kernel wheel and report it to tickless idle
+ */
+void timer_init(void)
+{
+    timer_base_init(&timer_base, jiffies);
+    open_softirq(TIMER_SOFTIRQ, run_timer_softirq);
+    tick_register_next_event(timer_next_event);
+}
+
+/*
+ * timer_tick - Raise TIMER_SOFTIRQ if a timer is due
+ */
+void timer_tick(void)
+{
+    if (timer_base_next(&timer_base) <= jiffies) {
+        raise_softirq_irqoff(TIMER_SOFTIRQ);
+    }
+}
+
+/*
+ * queue_timer - Add to the wheel, raising the softirq if already due
+ *
+ * Interrupts must be off.
+ */
+static void queue_timer(struct timer_list *timer)
+{
+    timer_base_add(&timer_base, timer);
+    if (timer->expires <= jiffies) {
+        raise_softirq_irqoff(TIMER_SOFTIRQ);
+    }
+}
+
+/*
+ * add_timer - Queue a timer at timer->expires (jiffies)
+ */
+void add_timer(struct timer_list *timer)
+{
+    unsigned long flags = irq_save();
+
+    queue_timer(timer);
+    irq_restore(flags);
+}
+
+/*
+ * mod_timer - (Re)queue a timer at @expires
+ */
+bool mod_timer(struct timer_list *timer, uint64_t expires)
+{
+    unsigned long flags = irq_save();
+    bool pending = timer_base_del(&timer_base, timer);
+
+    timer->expires = expires;
+    queue_timer(timer);
+    irq_restore(flags);
+    return pending;
+}
+
+/*
+ * del_timer - Cancel a timer
+ */
+bool del_timer(struct timer_list *timer)
+{
+    unsigned long flags = irq_save();
+    bool pending = timer_base_del(&timer_base, timer);
+
+    irq_restore(flags);
+    return pending;
+}
+
+#endif /* !HOST_TEST */
@@ -0,0 +1,127 @@
+/*
+ * kernel/lib/trace.c - Binary deferred-format tracing
+ *
+ * Writing events is all inline in trace.h. This file reads buffers
+ * back: the buffer code has no kernel dependencies and is unit-tested
+ * on the host; the dump to a serial port is below.
+ */
+
+#include <trace.h>
+
+struct trace_buffer trace_cpu_buf;
+volatile bool trace_enabled;
+
+/*
+ * trace_buffer_reset - Empty a buffer
+ */
+void trace_buffer_reset(struct trace_buffer *buf)
+{
+    buf->head = 0;
+}
+
+/*
+ * trace_buffer_count - Events a buffer still holds
+ */
+uint32_t trace_buffer_count(const struct trace_buffer *buf)
+{
+    uint32_t head = buf->head;
+
+    return head < TRACE_EVENTS ? head : TRACE_EVENTS;
+}
+
+/*
+ * trace_buffer_get - The @i-th oldest event still held
+ */
+const struct trace_event *trace_buffer_get(const struct trace_buffer *buf,
+                                           uint32_t i)
+{
+    uint32_t count = trace_buffer_count(buf);
+
+    if (i >= count) {
+        return NULL;
+    }
+    return &buf->events[(buf->head - count + i) & (TRACE_EVENTS - 1)];
+}
+
+/*
+ * trace_dump_header_init - Describe a buffer's contents for a dump
+ */
+void trace_dump_header_init(struct trace_dump_header *hdr,
+                            const struct trace_buffer *buf,
+                            uint32_t tsc_khz, uint32_t fmt_start)
+{
+    hdr->magic = TRACE_DUMP_MAGIC;
+    hdr->version = TRACE_DUMP_VERSION;
+    hdr->event_size = (uint16_t)sizeof(struct trace_event);
+    hdr->count = trace_buffer_count(buf);
+    hdr->lost = buf->head - hdr->count;
+    hdr->tsc_khz = tsc_khz;
+    hdr->fmt_start = fmt_start;
+}
+
+/*
+ * Everything below dumps the kernel's buffer. Host tests drive a
+ * struct trace_buffer directly.
+ */
+#ifndef HOST_TEST
+
+#include <serial.h>
+#include <ktime.h>
+#include <errno.h>
+
+/* Start of .trace_fmt, from the linker script */
+extern const char __trace_fmt_start[];
+
+/*
+ * trace_set_enabled - Start or stop recording events
+ */
+void trace_set_enabled(bool enabled)
+{
+    trace_enabled = enabled;
+}
+
+/*
+ * trace_reset - Discard this CPU's events
+ */
+void trace_reset(void)
+{
+    unsigned long flags = irq_save();
+
+    trace_buffer_reset(&trace_cpu_buf);
+    irq_restore(flags);
+}
+
+/*
+ * trace_dump - Write this CPU's events to a serial port
+ *
+ * Events are written as they are; one whose format pointer is outside
+ * .trace_fmt (written by a trace point that was interrupted by the
+ * pause) is left for the decoder to report.
+ */
+int trace_dump(unsigned int port)
+{
+    struct trace_dump_header hdr;
+    const struct trace_event *ev;
+    bool was_enabled = trace_enabled;
+    uint32_t i;
+    int ret;
+
+    if (!serial_port_present(port)) {
+        return -ENODEV;
+    }
+
+    trace_enabled = false;
+    trace_dump_header_init(&hdr, &trace_cpu_buf, tsc_khz,
+                           (uint32_t)(uintptr_t)__trace_fmt_start);
+
+    ret = serial_port_write(port, &hdr, sizeof(hdr));
+    for (i = 0; ret == 0 && i < hdr.count; i++) {
+        ev = trace_buffer_get(&trace_cpu_buf, i);
+        ret = serial_port_write(port, ev, sizeof(*ev));
+    }
+
+    trace_enabled = was_enabled;
+    return ret < 0 ? ret : (int)hdr.count;
+}
+
+#endif /* !HOST_TEST */
@@ -0,0 +1,219 @@
+/*
+ * kernel/lib/vma.c - Virtual Memory Area Tree
+ *
+ * Regions are ordered by start address in an augmented red-black tree
+ * (see rbtree.h). Each VMA stores the gap before it, so inserting or
+ * removing a region changes exactly one other gap: its successor's.
+ * That successor is updated and its max_gap change propagated to the
+ * root, O(log n).
+ *
+ * No kernel dependencies, so the same code is unit-tested and
+ * benchmarked on the host.
+ */
+
+#include <vma.h>
+#include <errno.h>
+
+/*
+ * vma_augment - Recompute max_gap from a node's gap and its children
+ */
+static void vma_augment(struct rb_node *node)
+{
+    struct vma *vma = rb_entry(node, struct vma, rb);
+    uint32_t max = vma->gap;
+
+    if (node->left != NULL) {
+        uint32_t left = rb_entry(node->left, struct vma, rb)->max_gap;
+        if (left > max) {
+            max = left;
+        }
+    }
+    if (node->right != NULL) {
+        uint32_t right = rb_entry(node->right, struct vma, rb)->max_gap;
+        if (right > max) {
+            max = right;
+        }
+    }
+    vma->max_gap = max;
+}
+
+/*
+ * set_gap - Recompute a VMA's gap from its in-order predecessor
+ */
+static void set_gap(struct vma *vma)
+{
+    struct rb_node *prev = rb_prev(&vma->rb);
+    uint32_t prev_end = prev ? rb_entry(prev, struct vma, rb)->end : 0;
+
+    vma->gap = vma->start - prev_end;
+}
+
+/*
+ * update_next_gap - Refresh a successor's gap after its predecessor changed
+ *
+ * Also carries the new max_gap up to the root.
+ */
+static void update_next_gap(struct vma_tree *tree, struct rb_node *next)
+{
+    if (next != NULL) {
+        set_gap(rb_entry(next, struct vma, rb));
+        rb_propagate(next, &tree->root);
+    }
+}
+
+/*
+ * vma_tree_init - Initialize an empty tree
+ */
+void vma_tree_init(struct vma_tree *tree)
+{
+    tree->root.node = NULL;
+    tree->root.augment = vma_augment;
+    tree->count = 0;
+}
+
+/*
+ * vma_insert - Add a region
+ */
+int vma_insert(struct vma_tree *tree, struct vma *vma)
+{
+    struct rb_node **link = &tree->root.node;
+    struct rb_node *parent = NULL;
+
+    if (vma->start >= vma->end) {
+        return -EINVAL;
+    }
+
+    while (*link != NULL) {
+        struct vma *cur = rb_entry(*link, struct vma, rb);
+
+        parent = *link;
+        if (vma->end <= cur->start) {
+            link = &parent->left;
+        } else if (vma->start >= cur->end) {
+            link = &parent->right;
+        } else {
+            return -EEXIST;
+        }
+    }
+
+    rb_link_node(&vma->rb, parent, link);
+    set_gap(vma);
+    vma->max_gap = vma->gap;
+    rb_insert_color(&vma->rb, &tree->root);
+    update_next_gap(tree, rb_next(&vma->rb));
+
+    tree->count++;
+    return 0;
+}
+
+/*
+ * vma_remove - Remove a region previously inserted
+ */
+void vma_remove(struct vma_tree *tree, struct vma *vma)
+{
+    struct rb_node *next = rb_next(&vma->rb);
+
+    rb_erase(&vma->rb, &tree->root);
+    update_next_gap(tree, next);
+    tree->count--;
+}
+
+/*
+ * vma_find - Find the region containing an address
+ */
+struct vma *vma_find(const struct vma_tree *tree, uint32_t addr)
+{
+    struct rb_node *node = tree->root.node;
+
+    while (node != NULL) {
+        struct vma *vma = rb_entry(node, struct vma, rb);
+
+        if (addr < vma->start) {
+            node = node->left;
+        } else if (addr >= vma->end) {
+            node = node->right;
+        } else {
+            return vma;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * gap_search - Lowest fitting gap in a subtree
+ *
+ * In-order search pruned by max_gap: a subtree whose largest gap is
+ * too small is skipped whole. Left subtree gaps all end before this
+ * VMA's start, right subtree gaps all begin at or after its end, which
+ * prunes subtrees wholly outside [low, high).
+ */
+static bool gap_search(const struct rb_node *node, uint32_t size,
+                       uint32_t low, uint32_t high, uint32_t *addr)
+{
+    const struct vma *vma;
+    uint32_t gap_start, gap_end;
+
+    if (node == NULL) {
+        return false;
+    }
+
+    vma = rb_entry(node, struct vma, rb);
+    if (vma->max_gap < size) {
+        return false;
+    }
+
+    if (vma->start > low && gap_search(node->left, size, low, high, addr)) {
+        return true;
+    }
+
+    gap_start = vma->start - vma->gap;
+    gap_end = vma->start;
+    if (gap_start < low) {
+        gap_start = low;
+    }
+    if (gap_end > high) {
+        gap_end = high;
+    }
+    if (gap_end > gap_start && gap_end - gap_start >= size) {
+        *addr = gap_start;
+        return true;
+    }
+
+    if (vma->end >= high || high - vma->end < size) {
+        return false;
+    }
+    return gap_search(node->right, size, low, high, addr);
+}
+
+/*
+ * vma_find_gap - Find the lowest free range of a given size
+ *
+ * Gaps tracked in the tree all lie below the last VMA; the free space
+ * after it is checked separately.
+ */
+int vma_find_gap(const struct vma_tree *tree, uint32_t size,
+                 uint32_t low, uint32_t high, uint32_t *addr)
+{
+    struct rb_node *last;
+    uint32_t tail;
+
+    if (size == 0 || low >= high) {
+        return -ENOMEM;
+    }
+
+    if (gap_search(tree->root.node, size, low, high, addr)) {
+        return 0;
+    }
+
+    last = rb_last(&tree->root);
+    tail = last ? rb_entry(last, struct vma, rb)->end : 0;
+    if (tail < low) {
+        tail = low;
+    }
+    if (tail < high && high - tail >= size) {
+        *addr = tail;
+        return 0;
+    }
+
+    return -ENOMEM;
+}
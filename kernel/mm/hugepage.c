@@ -0,0 +1,418 @@
+/*
+ * kernel/mm/hugepage.c - Transparent 4MB Large Pages
+ *
+ * Page directory walkers that prefer PSE 4MB entries and fall back to
+ * 4KB page tables. See hugepage.h for the policy.
+ *
+ * A 4MB entry is used only when the whole slot is inside the range
+ * being mapped and the slot is currently empty, so a large page never
+ * has to be merged from existing small pages. The reverse direction,
+ * splitting, keeps the same physical frames: the block is handed to
+ * ops->split_frames() so each 4KB frame can later be freed on its own.
+ *
+ * The walkers only touch memory through @pd and ops->table_virt(), so
+ * they are tested on the host with a simulated physical allocator.
+ */
+
+#include <hugepage.h>
+#include <page.h>
+#include <errno.h>
+
+#ifndef HOST_TEST
+#include <asm.h>
+#include <printk.h>
+#endif
+
+bool hugepage_enabled = false;
+
+/*
+ * range_valid - Check a [start, end) range for the walkers
+ */
+static inline bool range_valid(uint32_t start, uint32_t end)
+{
+    return start < end && (start & ~PAGE_MASK) == 0 &&
+           (end & ~PAGE_MASK) == 0;
+}
+
+/*
+ * slot_end - End of the 4MB slot containing @addr, clipped to @end
+ */
+static inline uint32_t slot_end(uint32_t addr, uint32_t end)
+{
+    uint32_t next = (addr | (LARGE_PAGE_SIZE - 1)) + 1;
+
+    /* next wraps to 0 in the last slot of the address space */
+    if (next == 0 || next > end) {
+        next = end;
+    }
+    return next;
+}
+
+/*
+ * pte_index - Index of @addr within its page table
+ */
+static inline uint32_t pte_index(uint32_t addr)
+{
+    return (addr >> PAGE_SHIFT) & (PT_ENTRIES - 1);
+}
+
+/*
+ * flush_range - Invalidate TLB entries if the backend asks for it
+ */
+static inline void flush_range(const struct hugepage_ops *ops,
+                               uint32_t start, uint32_t end)
+{
+    if (ops->flush != NULL) {
+        ops->flush(start, end);
+    }
+}
+
+/*
+ * get_table - Get the page table behind a PDE, allocating it if needed
+ *
+ * Table PDEs are fully permissive; the PTEs carry the real permissions.
+ *
+ * Returns: Page table, or NULL if no frame is available
+ */
+static uint32_t *get_table(uint32_t *pde, const struct hugepage_ops *ops)
+{
+    uint32_t phys;
+    uint32_t *pt;
+
+    if (*pde & PTE_PRESENT) {
+        return ops->table_virt(*pde & PTE_ADDR_MASK);
+    }
+
+    phys = ops->alloc_frames(0);
+    if (phys == 0) {
+        return NULL;
+    }
+
+    pt = ops->table_virt(phys);
+    for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+        pt[i] = 0;
+    }
+    *pde = phys | PTE_PRESENT | PTE_WRITE | PTE_USER;
+    return pt;
+}
+
+/*
+ * put_table - Free the page table behind a PDE if it maps nothing
+ */
+static void put_table(uint32_t *pde, const struct hugepage_ops *ops)
+{
+    uint32_t *pt;
+
+    if ((*pde & (PTE_PRESENT | PDE_LARGE)) != PTE_PRESENT) {
+        return;
+    }
+
+    pt = ops->table_virt(*pde & PTE_ADDR_MASK);
+    for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+        if (pt[i] & PTE_PRESENT) {
+            return;
+        }
+    }
+
+    ops->free_frames(*pde & PTE_ADDR_MASK, 0);
+    *pde = 0;
+}
+
+/*
+ * hugepage_map - Map a virtual range with fresh frames
+ */
+int hugepage_map(uint32_t *pd, uint32_t start, uint32_t end, uint32_t prot,
+                 struct hugepage_stats *stats, const struct hugepage_ops *ops)
+{
+    uint32_t addr = start;
+    int ret;
+
+    if (!range_valid(start, end)) {
+        return -EINVAL;
+    }
+    prot &= PTE_PROT_MASK;
+
+    while (addr < end) {
+        uint32_t *pde = &pd[addr >> LARGE_PAGE_SHIFT];
+        uint32_t *pt;
+        uint32_t *pte;
+        uint32_t phys;
+
+        if (hugepage_enabled && !(*pde & PTE_PRESENT) &&
+            (addr & ~PDE_LARGE_MASK) == 0 &&
+            end - addr >= LARGE_PAGE_SIZE) {
+            phys = ops->alloc_frames(LARGE_PAGE_ORDER);
+            if (phys != 0) {
+                *pde = phys | prot | PTE_PRESENT | PDE_LARGE;
+                stats->huge++;
+                addr += LARGE_PAGE_SIZE;
+                continue;
+            }
+            /* No free 4MB block: fall back to 4KB pages */
+        }
+
+        if (*pde & PDE_LARGE) {
+            ret = -EEXIST;
+            goto fail;
+        }
+
+        pt = get_table(pde, ops);
+        if (pt == NULL) {
+            ret = -ENOMEM;
+            goto fail;
+        }
+
+        pte = &pt[pte_index(addr)];
+        if (*pte & PTE_PRESENT) {
+            ret = -EEXIST;
+            goto fail;
+        }
+
+        phys = ops->alloc_frames(0);
+        if (phys == 0) {
+            ret = -ENOMEM;
+            goto fail;
+        }
+
+        *pte = phys | prot | PTE_PRESENT;
+        stats->small++;
+        addr += PAGE_SIZE;
+    }
+
+    return 0;
+
+fail:
+    if (addr > start) {
+        hugepage_unmap(pd, start, addr, stats, ops);
+    }
+    /* A table allocated for the failing slot may still be empty */
+    put_table(&pd[addr >> LARGE_PAGE_SHIFT], ops);
+    return ret;
+}
+
+/*
+ * hugepage_split - Split the 4MB page covering an address into 4KB pages
+ */
+int hugepage_split(uint32_t *pd, uint32_t addr,
+                   struct hugepage_stats *stats,
+                   const struct hugepage_ops *ops)
+{
+    uint32_t *pde = &pd[addr >> LARGE_PAGE_SHIFT];
+    uint32_t base, flags, phys;
+    uint32_t *pt;
+
+    if ((*pde & (PTE_PRESENT | PDE_LARGE)) != (PTE_PRESENT | PDE_LARGE)) {
+        return 0;
+    }
+
+    phys = ops->alloc_frames(0);
+    if (phys == 0) {
+        return -ENOMEM;
+    }
+
+    base = *pde & PDE_LARGE_MASK;
+    flags = *pde & (PTE_PROT_MASK | PTE_PRESENT);
+
+    pt = ops->table_virt(phys);
+    for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+        pt[i] = (base + (i << PAGE_SHIFT)) | flags;
+    }
+
+    ops->split_frames(base, LARGE_PAGE_ORDER);
+    *pde = phys | PTE_PRESENT | PTE_WRITE | PTE_USER;
+
+    stats->huge--;
+    stats->small += PT_ENTRIES;
+    stats->splits++;
+
+    /* One byte short of the slot end, which wraps to 0 in the last slot */
+    addr &= PDE_LARGE_MASK;
+    flush_range(ops, addr, addr + (LARGE_PAGE_SIZE - 1));
+    return 0;
+}
+
+/*
+ * hugepage_unmap - Unmap a virtual range and free its frames
+ */
+int hugepage_unmap(uint32_t *pd, uint32_t start, uint32_t end,
+                   struct hugepage_stats *stats,
+                   const struct hugepage_ops *ops)
+{
+    uint32_t addr = start;
+    int ret = 0;
+
+    if (!range_valid(start, end)) {
+        return -EINVAL;
+    }
+
+    while (addr < end) {
+        uint32_t *pde = &pd[addr >> LARGE_PAGE_SHIFT];
+        uint32_t next = slot_end(addr, end);
+        uint32_t *pt;
+
+        if (!(*pde & PTE_PRESENT)) {
+            addr = next;
+            continue;
+        }
+
+        if (*pde & PDE_LARGE) {
+            if ((addr & ~PDE_LARGE_MASK) == 0 &&
+                next - addr == LARGE_PAGE_SIZE) {
+                ops->free_frames(*pde & PDE_LARGE_MASK, LARGE_PAGE_ORDER);
+                *pde = 0;
+                stats->huge--;
+                addr = next;
+                continue;
+            }
+            ret = hugepage_split(pd, addr, stats, ops);
+            if (ret < 0) {
+                break;
+            }
+        }
+
+        pt = ops->table_virt(*pde & PTE_ADDR_MASK);
+        for (; addr < next; addr += PAGE_SIZE) {
+            uint32_t *pte = &pt[pte_index(addr)];
+
+            if (*pte & PTE_PRESENT) {
+                ops->free_frames(*pte & PTE_ADDR_MASK, 0);
+                *pte = 0;
+                stats->small--;
+            }
+        }
+        put_table(pde, ops);
+    }
+
+    flush_range(ops, start, end);
+    return ret;
+}
+
+/*
+ * hugepage_protect - Change permissions on a virtual range
+ */
+int hugepage_protect(uint32_t *pd, uint32_t start, uint32_t end,
+                     uint32_t prot, struct hugepage_stats *stats,
+                     const struct hugepage_ops *ops)
+{
+    uint32_t addr = start;
+    int ret = 0;
+
+    if (!range_valid(start, end)) {
+        return -EINVAL;
+    }
+    prot &= PTE_PROT_MASK;
+
+    while (addr < end) {
+        uint32_t *pde = &pd[addr >> LARGE_PAGE_SHIFT];
+        uint32_t next = slot_end(addr, end);
+        uint32_t *pt;
+
+        if (!(*pde & PTE_PRESENT)) {
+            addr = next;
+            continue;
+        }
+
+        if (*pde & PDE_LARGE) {
+            if ((addr & ~PDE_LARGE_MASK) == 0 &&
+                next - addr == LARGE_PAGE_SIZE) {
+                *pde = (*pde & ~PTE_PROT_MASK) | prot;
+                addr = next;
+                continue;
+            }
+            ret = hugepage_split(pd, addr, stats, ops);
+            if (ret < 0) {
+                break;
+            }
+        }
+
+        pt = ops->table_virt(*pde & PTE_ADDR_MASK);
+        for (; addr < next; addr += PAGE_SIZE) {
+            uint32_t *pte = &pt[pte_index(addr)];
+
+            if (*pte & PTE_PRESENT) {
+                *pte = (*pte & ~PTE_PROT_MASK) | prot;
+            }
+        }
+    }
+
+    flush_range(ops, start, end);
+    return ret;
+}
+
+#ifndef HOST_TEST
+
+/*
+ * =============================================================================
+ * Kernel Backend
+ * =============================================================================
+ */
+
+static uint32_t kernel_alloc_frames(uint32_t order)
+{
+    struct page *pg = page_alloc(order);
+
+    return pg ? page_to_pfn(pg) << PAGE_SHIFT : 0;
+}
+
+static void kernel_free_frames(uint32_t phys, uint32_t order)
+{
+    (void)order;
+    page_free(pfn_to_page(phys >> PAGE_SHIFT));
+}
+
+static void kernel_split_frames(uint32_t phys, uint32_t order)
+{
+    (void)order;
+    page_split_block(pfn_to_page(phys >> PAGE_SHIFT));
+}
+
+static uint32_t *kernel_table_virt(uint32_t phys)
+{
+    /* Physical memory is identity mapped */
+    return (uint32_t *)(uintptr_t)phys;
+}
+
+static void kernel_flush(uint32_t start, uint32_t end)
+{
+    uint32_t addr = start & PAGE_MASK;
+    uint32_t pages = (uint32_t)(((uint64_t)end - addr + PAGE_SIZE - 1) >>
+                                PAGE_SHIFT);
+
+    /* One invlpg per 4KB page is wasteful for big ranges; fine for now */
+    while (pages-- > 0) {
+        invlpg(addr);
+        addr += PAGE_SIZE;
+    }
+}
+
+const struct hugepage_ops hugepage_kernel_ops = {
+    .alloc_frames = kernel_alloc_frames,
+    .free_frames = kernel_free_frames,
+    .split_frames = kernel_split_frames,
+    .table_virt = kernel_table_virt,
+    .flush = kernel_flush,
+};
+
+/*
+ * hugepage_init - Enable 4MB pages if the CPU supports PSE
+ */
+void hugepage_init(void)
+{
+#ifdef __x86_64__
+    klog(LOG_SYS_MM, LOG_INFO, "hugepage: 32-bit PSE tables unused in long mode\n");
+#else
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_PSE)) {
+        klog(LOG_SYS_MM, LOG_INFO, "hugepage: no PSE, using 4KB pages only\n");
+        return;
+    }
+
+    write_cr4(read_cr4() | CR4_PSE);
+    hugepage_enabled = true;
+    klog(LOG_SYS_MM, LOG_INFO, "hugepage: 4MB pages enabled\n");
+#endif
+}
+
+#endif /* !HOST_TEST */
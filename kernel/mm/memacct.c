@@ -0,0 +1,219 @@
+/*
+ * kernel/mm/memacct.c - Per-Owner Memory Accounting and OOM
+ *
+ * Counters live in a fixed table indexed by owner id. The owner and
+ * counter type of every accounted frame are recorded in its struct page
+ * (owner field, PG_PGTABLE / PG_KERNEL flags), so memacct_free() can
+ * uncharge without being told who paid for the frame. Every frame of a
+ * block is tagged, so a block split into 4KB frames uncharges frame by
+ * frame.
+ */
+
+#include <memacct.h>
+#include <errno.h>
+
+#ifndef HOST_TEST
+#include <printk.h>
+#include <panic.h>
+#endif
+
+static struct mem_usage usage[MEMACCT_MAX_OWNERS];
+static memacct_kill_fn oom_killer = NULL;
+
+/* struct page flag recording each counter type (RSS has none) */
+static const uint16_t counter_flag[MM_NR_COUNTERS] = {
+    [MM_RSS] = 0,
+    [MM_PGTABLE] = PG_PGTABLE,
+    [MM_KOBJ] = PG_KERNEL,
+};
+
+/*
+ * usage_total - Frames charged to an owner across all counters
+ */
+static uint32_t usage_total(const struct mem_usage *u)
+{
+    uint32_t total = 0;
+
+    for (int i = 0; i < MM_NR_COUNTERS; i++) {
+        total += u->pages[i];
+    }
+    return total;
+}
+
+/*
+ * page_counter - Counter type recorded in a frame's flags
+ */
+static enum mm_counter page_counter(const struct page *pg)
+{
+    if (pg->flags & PG_PGTABLE) {
+        return MM_PGTABLE;
+    }
+    if (pg->flags & PG_KERNEL) {
+        return MM_KOBJ;
+    }
+    return MM_RSS;
+}
+
+/*
+ * oom_fatal - Out of memory with nothing left to kill
+ */
+static struct page *oom_fatal(void)
+{
+#ifndef HOST_TEST
+    panic("Out of memory: no process to kill");
+#else
+    return NULL;
+#endif
+}
+
+/*
+ * oom_kill - Kill the largest consumer to free memory
+ *
+ * Returns: true if the victim's usage went down
+ */
+static bool oom_kill(void)
+{
+    uint32_t victim = memacct_oom_select();
+    uint32_t before;
+
+    if (victim == MEMACCT_NO_OWNER || oom_killer == NULL) {
+        return false;
+    }
+
+    before = usage_total(&usage[victim]);
+    usage[victim].oom_kills++;
+
+#ifndef HOST_TEST
+    klog(LOG_SYS_MM, LOG_WARN, "oom: killing owner %u (%u pages)\n", victim, before);
+#endif
+
+    if (oom_killer(victim) < 0) {
+        return false;
+    }
+
+    /* A killer that frees nothing would make us loop forever */
+    return usage_total(&usage[victim]) < before;
+}
+
+/*
+ * memacct_alloc - Allocate frames and charge them to an owner
+ */
+struct page *memacct_alloc(uint32_t owner, enum mm_counter type,
+                           uint32_t order)
+{
+    struct mem_usage *u;
+    struct page *pg;
+    uint32_t nr = 1U << order;
+    uint32_t total;
+
+    if (owner >= MEMACCT_MAX_OWNERS || (uint32_t)type >= MM_NR_COUNTERS) {
+        return NULL;
+    }
+
+    while ((pg = page_alloc(order)) == NULL) {
+        if (!oom_kill()) {
+            return oom_fatal();
+        }
+    }
+
+    for (uint32_t i = 0; i < nr; i++) {
+        pg[i].owner = owner;
+        pg[i].flags |= counter_flag[type];
+    }
+
+    u = &usage[owner];
+    u->pages[type] += nr;
+    total = usage_total(u);
+    if (total > u->peak) {
+        u->peak = total;
+    }
+
+    return pg;
+}
+
+/*
+ * memacct_free - Drop a reference and uncharge on the last one
+ */
+void memacct_free(struct page *pg)
+{
+    enum mm_counter type;
+    uint32_t owner = pg->owner;
+    uint32_t nr;
+
+    if (pg->refcount != 1) {
+        page_free(pg);
+        return;
+    }
+
+    type = page_counter(pg);
+    nr = (pg->flags & PG_HEAD) ? (1U << pg->order) : 1;
+
+    for (uint32_t i = 0; i < nr; i++) {
+        pg[i].owner = 0;
+        pg[i].flags &= (uint16_t)~(PG_PGTABLE | PG_KERNEL);
+    }
+
+    if (owner < MEMACCT_MAX_OWNERS) {
+        usage[owner].pages[type] -= nr;
+    }
+
+    page_free(pg);
+}
+
+/*
+ * memacct_read - Copy out one owner's counters
+ */
+int memacct_read(uint32_t owner, struct mem_usage *out)
+{
+    if (owner >= MEMACCT_MAX_OWNERS) {
+        return -ESRCH;
+    }
+
+    *out = usage[owner];
+    return 0;
+}
+
+/*
+ * memacct_oom_select - Pick the owner charged with the most frames
+ *
+ * Ties go to the lowest owner id.
+ */
+uint32_t memacct_oom_select(void)
+{
+    uint32_t victim = MEMACCT_NO_OWNER;
+    uint32_t largest = 0;
+
+    for (uint32_t owner = MEMACCT_KERNEL + 1; owner < MEMACCT_MAX_OWNERS;
+         owner++) {
+        uint32_t total = usage_total(&usage[owner]);
+
+        if (total > largest) {
+            largest = total;
+            victim = owner;
+        }
+    }
+
+    return victim;
+}
+
+/*
+ * memacct_set_killer - Register the OOM kill callback
+ */
+void memacct_set_killer(memacct_kill_fn kill)
+{
+    oom_killer = kill;
+}
+
+/*
+ * memacct_reset - Zero every owner's counters
+ */
+void memacct_reset(void)
+{
+    for (uint32_t owner = 0; owner < MEMACCT_MAX_OWNERS; owner++) {
+        for (int i = 0; i < MM_NR_COUNTERS; i++) {
+            usage[owner].pages[i] = 0;
+        }
+        usage[owner].peak = 0;
+        usage[owner].oom_kills = 0;
+    }
+}
@@ -0,0 +1,314 @@
+/*
+ * kernel/mm/page.c - Page Frame Descriptor Array
+ *
+ * Builds the struct page array from the E820 memory map. The array is
+ * placed directly after the kernel image at boot, carved out of the
+ * first usable memory the kernel does not already occupy.
+ *
+ * page_alloc() hands out naturally aligned blocks of 2^order frames by
+ * scanning the descriptors; it is simple rather than fast, and exists
+ * so large-page mappings can get 4MB-aligned physical memory.
+ *
+ * page_array_frames() and page_array_build() are pure functions over a
+ * caller-supplied map and storage so they can be tested on the host.
+ */
+
+#include <page.h>
+
+#ifndef HOST_TEST
+#include <printk.h>
+#include <panic.h>
+
+/* Boot parameters from entry.S */
+extern uint32_t boot_mmap_ptr;
+extern uint32_t boot_mmap_count;
+
+/* Linker script symbols */
+extern char _kernel_start;
+extern char _kernel_end;
+#endif /* !HOST_TEST */
+
+struct page *page_array = NULL;
+uint32_t page_count = 0;
+
+/* Next-fit hint for page_alloc: pfn just after the last allocation */
+static uint32_t alloc_hint = 0;
+
+/*
+ * region_frames - Clip an E820 region to whole frames below 4GB
+ *
+ * @entry: Region to clip
+ * @first: Output, first frame fully inside the region
+ * @last: Output, one past the last frame fully inside the region
+ *
+ * Returns: true if at least one whole frame remains
+ */
+static bool region_frames(const struct e820_entry *entry,
+                          uint32_t *first, uint32_t *last)
+{
+    uint64_t start = entry->base;
+    uint64_t end = entry->base + entry->length;
+    uint64_t limit = (uint64_t)PAGE_MAX_FRAMES << PAGE_SHIFT;
+
+    if (end > limit) {
+        end = limit;
+    }
+
+    /* Round start up and end down to frame boundaries */
+    start = (start + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    end >>= PAGE_SHIFT;
+
+    if (start >= end) {
+        return false;
+    }
+
+    *first = (uint32_t)start;
+    *last = (uint32_t)end;
+    return true;
+}
+
+/*
+ * page_array_frames - Compute the descriptor count for a memory map
+ */
+uint32_t page_array_frames(const struct e820_entry *map, uint32_t count)
+{
+    uint32_t nframes = 0;
+    uint32_t first, last;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (map[i].type != E820_USABLE) {
+            continue;
+        }
+        if (region_frames(&map[i], &first, &last) && last > nframes) {
+            nframes = last;
+        }
+    }
+
+    return nframes;
+}
+
+/*
+ * page_array_build - Populate a descriptor array from a memory map
+ *
+ * Two passes over the map: usable regions first, then any other type
+ * re-reserves the frames it overlaps, so a BIOS that reports overlapping
+ * entries never hands out reserved memory.
+ */
+uint32_t page_array_build(struct page *array, uint32_t nframes,
+                          const struct e820_entry *map, uint32_t count)
+{
+    uint32_t usable = 0;
+    uint32_t first, last;
+
+    for (uint32_t pfn = 0; pfn < nframes; pfn++) {
+        struct page *pg = &array[pfn];
+
+        pg->flags = PG_RESERVED;
+        pg->refcount = 0;
+        pg->mapcount = 0;
+        pg->order = 0;
+        pg->pad = 0;
+        pg->lru_next = PAGE_NONE;
+        pg->lru_prev = PAGE_NONE;
+        pg->owner = 0;
+        pg->index = 0;
+        pg->private = 0;
+        pg->reserved = 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (map[i].type != E820_USABLE ||
+            !region_frames(&map[i], &first, &last)) {
+            continue;
+        }
+        for (uint32_t pfn = first; pfn < last && pfn < nframes; pfn++) {
+            array[pfn].flags &= (uint16_t)~PG_RESERVED;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t start, end;
+
+        if (map[i].type == E820_USABLE || map[i].length == 0) {
+            continue;
+        }
+
+        /* Round outward: any partially reserved frame is reserved */
+        start = map[i].base >> PAGE_SHIFT;
+        end = (map[i].base + map[i].length + PAGE_SIZE - 1) >> PAGE_SHIFT;
+        for (uint64_t pfn = start; pfn < end && pfn < nframes; pfn++) {
+            array[pfn].flags |= PG_RESERVED;
+        }
+    }
+
+    for (uint32_t pfn = 0; pfn < nframes; pfn++) {
+        if (!(array[pfn].flags & PG_RESERVED)) {
+            usable++;
+        }
+    }
+
+    return usable;
+}
+
+/*
+ * page_reserve_range - Mark a physical range reserved
+ */
+void page_reserve_range(uint32_t start, uint32_t end)
+{
+    uint32_t pfn = start >> PAGE_SHIFT;
+    uint32_t last = (uint32_t)(((uint64_t)end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+
+    for (; pfn < last && pfn < page_count; pfn++) {
+        page_array[pfn].flags |= PG_RESERVED;
+    }
+}
+
+/*
+ * page_is_free - Check whether a frame can be handed out
+ */
+static inline bool page_is_free(const struct page *pg)
+{
+    return pg->refcount == 0 &&
+           !(pg->flags & (PG_RESERVED | PG_HEAD | PG_TAIL));
+}
+
+/*
+ * page_alloc - Allocate 2^order physically contiguous frames
+ *
+ * Next-fit scan over naturally aligned runs, wrapping once. A busy
+ * frame inside a candidate run skips the scan to the next aligned run
+ * after it, so each frame is examined at most once per call.
+ */
+struct page *page_alloc(uint32_t order)
+{
+    uint32_t nr = 1U << order;
+    uint32_t start = alloc_hint & ~(nr - 1);
+    uint32_t scanned = 0;
+    uint32_t pfn = start;
+
+    if (nr > page_count) {
+        return NULL;
+    }
+
+    while (scanned < page_count) {
+        uint32_t i;
+
+        if (pfn + nr > page_count) {
+            scanned += page_count - pfn;
+            pfn = 0;
+            continue;
+        }
+
+        for (i = 0; i < nr; i++) {
+            if (!page_is_free(&page_array[pfn + i])) {
+                break;
+            }
+        }
+
+        if (i == nr) {
+            struct page *head = &page_array[pfn];
+
+            head->refcount = 1;
+            head->order = (uint8_t)order;
+            if (nr > 1) {
+                head->flags |= PG_HEAD;
+                for (i = 1; i < nr; i++) {
+                    page_array[pfn + i].flags |= PG_TAIL;
+                }
+            }
+            alloc_hint = pfn + nr;
+            return head;
+        }
+
+        /* Skip past the busy frame to the next aligned run */
+        i = ((pfn + i) & ~(nr - 1)) + nr - pfn;
+        scanned += i;
+        pfn += i;
+    }
+
+    return NULL;
+}
+
+/*
+ * page_free - Drop a reference to a block from page_alloc
+ */
+void page_free(struct page *pg)
+{
+    uint32_t nr;
+
+    if (pg->refcount == 0 || --pg->refcount > 0) {
+        return;
+    }
+
+    nr = (pg->flags & PG_HEAD) ? (1U << pg->order) : 1;
+    for (uint32_t i = 0; i < nr; i++) {
+        pg[i].flags &= (uint16_t)~(PG_HEAD | PG_TAIL);
+        pg[i].order = 0;
+    }
+}
+
+/*
+ * page_split_block - Turn a multi-frame block into independent frames
+ */
+void page_split_block(struct page *pg)
+{
+    uint32_t nr;
+
+    if (!(pg->flags & PG_HEAD)) {
+        return;
+    }
+
+    nr = 1U << pg->order;
+    for (uint32_t i = 0; i < nr; i++) {
+        pg[i].flags &= (uint16_t)~(PG_HEAD | PG_TAIL);
+        pg[i].order = 0;
+        pg[i].refcount = 1;
+    }
+}
+
+#ifndef HOST_TEST
+
+/*
+ * page_init - Build page_array from the boot memory map
+ */
+void page_init(void)
+{
+    const struct e820_entry *map =
+        (const struct e820_entry *)(uintptr_t)boot_mmap_ptr;
+    uint32_t nframes = page_array_frames(map, boot_mmap_count);
+    uintptr_t array_start;
+    uintptr_t array_end;
+    uint32_t usable;
+
+    if (nframes == 0) {
+        panic("page_init: no usable memory in boot memory map");
+    }
+
+    /* Array starts on the first page boundary after the kernel image */
+    array_start = ((uintptr_t)&_kernel_end + PAGE_SIZE - 1) & PAGE_MASK;
+    array_end = array_start + (uintptr_t)nframes * sizeof(struct page);
+
+    page_array = (struct page *)array_start;
+    page_count = nframes;
+    page_array_build(page_array, nframes, map, boot_mmap_count);
+
+    /* Low 1MB (IVT, BIOS data, boot data, VGA, ROMs) */
+    page_reserve_range(0, 0x100000);
+
+    /* Kernel image and the descriptor array itself */
+    page_reserve_range((uint32_t)(uintptr_t)&_kernel_start,
+                       (uint32_t)array_end);
+
+    usable = 0;
+    for (uint32_t pfn = 0; pfn < page_count; pfn++) {
+        if (!(page_array[pfn].flags & PG_RESERVED)) {
+            usable++;
+        }
+    }
+
+    klog(LOG_SYS_MM, LOG_INFO, "page: %u frames tracked, %u usable, array at %p (%u KB)\n",
+           page_count, usable, page_array,
+           (uint32_t)((array_end - array_start) >> 10));
+}
+
+#endif /* !HOST_TEST */
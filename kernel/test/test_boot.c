@@ -26,9 +26,9 @@ extern uint32_t boot_mmap_count;
  *
  * CR0 bit 0 (PE) indicates protected mode is active.
  */
-static inline uint32_t get_cr0(void)
+static inline uintptr_t get_cr0(void)
 {
-    uint32_t cr0;
+    uintptr_t cr0;
     __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
     return cr0;
 }
@@ -36,13 +36,14 @@ static inline uint32_t get_cr0(void)
 /*
  * get_gdtr - Read GDTR (GDT Register)
  *
- * Returns the GDT limit and base address.
+ * Returns the GDT limit and base address. SGDT stores a pointer-sized
+ * base (4 bytes on i686, 8 bytes on x86_64).
  */
-static void get_gdtr(uint16_t *limit, uint32_t *base)
+static void get_gdtr(uint16_t *limit, uintptr_t *base)
 {
     struct {
         uint16_t limit;
-        uint32_t base;
+        uintptr_t base;
     } __attribute__((packed)) gdtr;
 
     __asm__ volatile ("sgdt %0" : "=m"(gdtr));
@@ -91,7 +92,7 @@ static void test_a20_enabled(void)
  */
 static void test_protected_mode(void)
 {
-    uint32_t cr0 = get_cr0();
+    uintptr_t cr0 = get_cr0();
 
     /* Bit 0 is PE (Protection Enable) */
     TEST_ASSERT_MSG((cr0 & 0x1) != 0, "CR0.PE bit not set - not in protected mode");
@@ -106,7 +107,7 @@ extern void _start(void);  /* From entry.S */
 
 static void test_kernel_address(void)
 {
-    uint32_t start_addr = (uint32_t)&_start;
+    uintptr_t start_addr = (uintptr_t)&_start;
 
     TEST_ASSERT_MSG(start_addr == 0x100000,
                     "Kernel _start not at 0x100000");
@@ -140,7 +141,7 @@ static void test_memory_map(void)
 static void test_gdt_loaded(void)
 {
     uint16_t limit;
-    uint32_t base;
+    uintptr_t base;
 
     get_gdtr(&limit, &base);
 
@@ -0,0 +1,78 @@
+/*
+ * kernel/test/test_debugcon.c - QEMU debug console tests
+ *
+ * Verifies:
+ *   - the port 0xE9 console is registered exactly when QEMU provides
+ *     one (make DEBUGCON=1), and takes every level
+ *   - printk() records reach it
+ *
+ * Prints the cost per byte of the debug console next to COM1.
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <debugcon.h>
+#include <console.h>
+#include <printk.h>
+#include <serial.h>
+#include <asm.h>
+
+#define BENCH_LINES     8
+
+static const char bench_line[] =
+    "debugcon: throughput line ...................................\n";
+
+/*
+ * test_debugcon - Debug console test suite
+ */
+void test_debugcon(void)
+{
+    struct console *con = console_find("debugcon");
+    uint32_t records, debugcon_cycles, com1_cycles, bytes, i;
+    uint64_t start;
+
+    TEST_BEGIN("debugcon");
+
+    if (!debugcon_present()) {
+        TEST_ASSERT_NULL(con);
+        TEST_SKIP("no debug console (run with make DEBUGCON=1)");
+        TEST_END();
+        return;
+    }
+
+    /* Test 1: Registered at LOG_DEBUG */
+    TEST_ASSERT_NOT_NULL(con);
+    TEST_ASSERT_EQ(LOG_DEBUG, con->level);
+    TEST_ASSERT(con->enabled);
+
+    /* Test 2: A debug record is printed on it */
+    printk_flush();
+    records = con->records;
+    printk(LOG_DEBUG, "debugcon: record\n");
+    printk_flush();
+    TEST_ASSERT_EQ(records + 1, con->records);
+
+    /* Test 3: Raw throughput against COM1 */
+    bytes = BENCH_LINES * (sizeof(bench_line) - 1);
+    start = rdtsc();
+    for (i = 0; i < BENCH_LINES; i++) {
+        debugcon_write(bench_line, sizeof(bench_line) - 1);
+    }
+    debugcon_cycles = (uint32_t)(rdtsc() - start) / bytes;
+
+    start = rdtsc();
+    for (i = 0; i < BENCH_LINES; i++) {
+        serial_write(bench_line, sizeof(bench_line) - 1);
+    }
+    serial_flush();
+    com1_cycles = (uint32_t)(rdtsc() - start) / bytes;
+
+    printk(LOG_INFO, "[debugcon] %u cycles/byte, COM1 %u cycles/byte\n",
+           debugcon_cycles, com1_cycles);
+    test_pass("debugcon throughput");
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
@@ -0,0 +1,88 @@
+/*
+ * kernel/test/test_fbcon.c - Framebuffer console tests
+ *
+ * Verifies:
+ *   - the "fb" console replaces "vga" exactly when the boot loader set
+ *     a framebuffer mode (make VBE=1), and takes every level
+ *   - printk() records reach it
+ *
+ * Prints the cost per character of fbcon_write() for log lines, which
+ * scroll the screen, and for text that does not.
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <fbcon.h>
+#include <vga.h>
+#include <console.h>
+#include <printk.h>
+#include <asm.h>
+
+#define BENCH_LINES     64
+
+static const char bench_line[] =
+    "fbcon: throughput line ......................................\n";
+
+/*
+ * test_fbcon - Framebuffer console test suite
+ */
+void test_fbcon(void)
+{
+    struct console *con = console_find("fb");
+    uint32_t records, scroll_cycles, text_cycles, bytes, i;
+    uint64_t start;
+
+    TEST_BEGIN("fbcon");
+
+    if (!fbcon_active()) {
+        TEST_ASSERT_NULL(con);
+        TEST_SKIP("text mode (run with make VBE=1)");
+        TEST_END();
+        return;
+    }
+
+    /* Test 1: Registered at LOG_DEBUG, in place of the VGA console */
+    TEST_ASSERT_NOT_NULL(con);
+    TEST_ASSERT_EQ(LOG_DEBUG, con->level);
+    TEST_ASSERT(con->enabled);
+    TEST_ASSERT(!console_find("vga")->enabled);
+
+    /* Test 2: A debug record is printed on it */
+    printk_flush();
+    records = con->records;
+    printk(LOG_DEBUG, "fbcon: record\n");
+    printk_flush();
+    TEST_ASSERT_EQ(records + 1, con->records);
+
+    /* Test 3: Throughput, with printk kept off the screen meanwhile */
+    console_set_enabled(con, false);
+    bytes = BENCH_LINES * (sizeof(bench_line) - 1);
+
+    start = rdtsc();
+    for (i = 0; i < BENCH_LINES; i++) {
+        fbcon_write(bench_line, sizeof(bench_line) - 1);
+    }
+    scroll_cycles = (uint32_t)(rdtsc() - start) / bytes;
+
+    /* Same text from the top of a clear screen: no scrolling */
+    fbcon_clear();
+    start = rdtsc();
+    for (i = 0; i < fbcon_rows() - 1; i++) {
+        fbcon_write(bench_line, sizeof(bench_line) - 1);
+    }
+    text_cycles = (uint32_t)(rdtsc() - start) /
+                  ((fbcon_rows() - 1) * (sizeof(bench_line) - 1));
+
+    fbcon_clear();
+    console_set_enabled(con, true);
+
+    printk(LOG_INFO, "[fbcon] %ux%u, %u cycles/char scrolling, "
+           "%u cycles/char without\n",
+           fbcon_cols(), fbcon_rows(), scroll_cycles, text_cycles);
+    test_pass("fbcon throughput");
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
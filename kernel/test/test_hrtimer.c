@@ -0,0 +1,141 @@
+/*
+ * kernel/test/test_hrtimer.c - High-resolution timer tests
+ *
+ * Verifies:
+ *   - hrtimers fire in expiry order and never early
+ *   - hrtimer_cancel() stops a queued timer
+ *   - a periodic hrtimer re-arms itself
+ *   - nanosleep() wakes well inside one tick (sub-jiffy precision)
+ *   - sys_nanosleep() rejects bad arguments
+ *
+ * Prints the expiry and wakeup latency histograms at the end.
+ * Skipped without a local APIC (no timer interrupt).
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <hrtimer.h>
+#include <tick.h>
+#include <irq.h>
+#include <pic.h>
+#include <asm.h>
+#include <errno.h>
+
+#define TEST_TIMERS     4
+#define PERIOD_NS       (250ULL * NSEC_PER_USEC)
+
+static struct hrtimer timers[TEST_TIMERS];
+static uint64_t fired_ns[TEST_TIMERS];
+static int fire_order[TEST_TIMERS];
+static volatile int fired;
+static volatile uint32_t periodic_runs;
+
+static enum hrtimer_restart test_hrtimer_fn(struct hrtimer *timer)
+{
+    int i = (int)(timer - timers);
+
+    fired_ns[i] = ktime_get_ns();
+    fire_order[fired++] = i;
+    return HRTIMER_NORESTART;
+}
+
+static enum hrtimer_restart test_periodic_fn(struct hrtimer *timer)
+{
+    if (++periodic_runs == 5) {
+        return HRTIMER_NORESTART;
+    }
+    hrtimer_forward(timer, ktime_get_ns(), PERIOD_NS);
+    return HRTIMER_RESTART;
+}
+
+/* Idle until @cond holds or 100 ms pass */
+#define IDLE_UNTIL(cond) do {                                           \
+        uint64_t _end = ktime_get_ns() + 100ULL * NSEC_PER_MSEC;        \
+        while (!(cond) && ktime_get_ns() < _end) {                      \
+            cpu_idle();                                                 \
+        }                                                               \
+        cli();                                                          \
+    } while (0)
+
+/*
+ * test_hrtimer - hrtimer test suite
+ */
+void test_hrtimer(void)
+{
+    struct kernel_timespec req, rem;
+    struct hrtimer periodic;
+    uint64_t base, late;
+    int i;
+
+    TEST_BEGIN("hrtimer");
+
+    if (irq_get_chip()->eoi == pic_eoi) {
+        TEST_SKIP("no local APIC timer");
+        TEST_END();
+        return;
+    }
+
+    /* Test 1: Expiry order, never early (300, 100, 200 us; 3 cancelled) */
+    fired = 0;
+    for (i = 0; i < TEST_TIMERS; i++) {
+        hrtimer_setup(&timers[i], test_hrtimer_fn);
+        fired_ns[i] = 0;
+    }
+    base = ktime_get_ns();
+    hrtimer_start(&timers[0], base + 300 * NSEC_PER_USEC, HRTIMER_MODE_ABS);
+    hrtimer_start(&timers[1], base + 100 * NSEC_PER_USEC, HRTIMER_MODE_ABS);
+    hrtimer_start(&timers[2], base + 200 * NSEC_PER_USEC, HRTIMER_MODE_ABS);
+    hrtimer_start(&timers[3], 150 * NSEC_PER_USEC, HRTIMER_MODE_REL);
+
+    /* Test 2: Cancel */
+    TEST_ASSERT(hrtimer_cancel(&timers[3]));
+    TEST_ASSERT(!hrtimer_cancel(&timers[3]));
+
+    IDLE_UNTIL(fired == 3);
+    TEST_ASSERT_EQ(3, fired);
+    TEST_ASSERT_EQ(1, fire_order[0]);
+    TEST_ASSERT_EQ(2, fire_order[1]);
+    TEST_ASSERT_EQ(0, fire_order[2]);
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT(fired_ns[i] >= timers[i].expires);
+    }
+    TEST_ASSERT_EQ(0, (uint32_t)fired_ns[3]);
+
+    /* Test 3: Periodic timer runs five times */
+    periodic_runs = 0;
+    hrtimer_setup(&periodic, test_periodic_fn);
+    hrtimer_start(&periodic, PERIOD_NS, HRTIMER_MODE_REL);
+    IDLE_UNTIL(periodic_runs == 5);
+    TEST_ASSERT_EQ(5, periodic_runs);
+    TEST_ASSERT(!hrtimer_active(&periodic));
+
+    /* Test 4: Sub-jiffy sleeps wake well before the next tick would */
+    for (i = 0; i < 10; i++) {
+        late = nanosleep(500 * NSEC_PER_USEC);
+        TEST_ASSERT_LT((uint32_t)late, TICK_NSEC / 4);
+    }
+    cli();
+
+    /* Test 5: sys_nanosleep argument checks */
+    req.tv_sec = 0;
+    req.tv_nsec = NSEC_PER_SEC;
+    TEST_ASSERT_EQ(-EINVAL, sys_nanosleep(&req, &rem));
+    req.tv_sec = -1;
+    req.tv_nsec = 0;
+    TEST_ASSERT_EQ(-EINVAL, sys_nanosleep(&req, &rem));
+    req.tv_sec = 0;
+    req.tv_nsec = 200 * NSEC_PER_USEC;
+    rem.tv_sec = rem.tv_nsec = 1;
+    TEST_ASSERT_EQ(0, sys_nanosleep(&req, &rem));
+    cli();
+    TEST_ASSERT_EQ(0, (uint32_t)rem.tv_nsec);
+    TEST_ASSERT_EQ(-EFAULT, sys_nanosleep(NULL, NULL));
+
+    TEST_ASSERT_GTE((uint32_t)hrtimer_get_wakeup_hist()->count, 11);
+    hrtimer_dump_latency();
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
@@ -0,0 +1,117 @@
+/*
+ * kernel/test/test_irq.c - IRQ routing and interrupt controller tests
+ *
+ * Verifies:
+ *   - irq_init() selected a controller
+ *   - irq_request() argument checks and ownership
+ *   - On the APIC path, an interrupt on an IRQ vector reaches the
+ *     handler and is acknowledged through the timed EOI path
+ *
+ * Also reports the cost of one EOI through each controller, measured
+ * with back-to-back EOIs (harmless with nothing in service).
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <irq.h>
+#include <apic.h>
+#include <pic.h>
+#include <asm.h>
+#include <errno.h>
+#include <printk.h>
+#include <serial.h>
+
+#define TEST_IRQ        5       /* Unused ISA line (LPT2/sound) */
+#define EOI_BENCH_ITERS 1000
+
+static volatile uint32_t irq_hits;
+
+static void test_irq_handler(struct interrupt_frame *frame)
+{
+    (void)frame;
+    irq_hits++;
+}
+
+/*
+ * bench_eoi - Average cycles for one EOI through a controller
+ */
+static uint32_t bench_eoi(void (*eoi)(uint8_t irq))
+{
+    uint64_t start;
+    int i;
+
+    start = rdtsc();
+    for (i = 0; i < EOI_BENCH_ITERS; i++) {
+        eoi(0);
+    }
+    return (uint32_t)(rdtsc() - start) / EOI_BENCH_ITERS;
+}
+
+static void lapic_eoi_irq(uint8_t irq)
+{
+    (void)irq;
+    lapic_eoi();
+}
+
+/*
+ * test_irq - IRQ test suite
+ */
+void test_irq(void)
+{
+    const struct irq_chip *chip = irq_get_chip();
+    const struct irq_eoi_stats *stats = irq_get_eoi_stats();
+    bool apic = false;
+    uint64_t eois;
+
+    TEST_BEGIN("irq");
+
+    /* Test 1: A controller was selected */
+    TEST_ASSERT_NOT_NULL(chip);
+    if (chip == NULL) {
+        TEST_END();
+        return;
+    }
+    apic = chip->eoi != pic_eoi;
+
+    /* Test 2: Bad requests are rejected */
+    TEST_ASSERT_EQ(-EINVAL, irq_request(IRQ_LINES, test_irq_handler));
+    TEST_ASSERT_EQ(-EINVAL, irq_request(TEST_IRQ, NULL));
+
+    /* Test 3: A line has one owner at a time */
+    TEST_ASSERT_EQ(0, irq_request(TEST_IRQ, test_irq_handler));
+    TEST_ASSERT_EQ(-EBUSY, irq_request(TEST_IRQ, test_irq_handler));
+
+    /* Test 4: Delivery on the IRQ vector runs the handler, then EOI */
+    if (apic) {
+        /* Take the serial TX interrupt out of the count */
+        printk_flush();
+        serial_flush();
+        __asm__ volatile ("sti; nop; cli");
+        eois = stats->count;
+        lapic_send_self_ipi(IRQ_VECTOR_BASE + TEST_IRQ);
+        __asm__ volatile ("sti; nop; cli");
+        TEST_ASSERT_EQ(1, irq_hits);
+        TEST_ASSERT_EQ(1, (uint32_t)(stats->count - eois));
+    } else {
+        TEST_SKIP("no local APIC for self-IPI delivery");
+    }
+
+    /* Test 5: Freed line can be requested again */
+    irq_free(TEST_IRQ);
+    TEST_ASSERT_EQ(0, irq_request(TEST_IRQ, test_irq_handler));
+    irq_free(TEST_IRQ);
+
+    /* Benchmark: cost of one EOI per controller */
+    if (apic) {
+        printk(LOG_INFO, "[irq] EOI cost: LAPIC %u cycles, PIC %u cycles\n",
+               bench_eoi(lapic_eoi_irq), bench_eoi(pic_eoi));
+    } else {
+        printk(LOG_INFO, "[irq] EOI cost: PIC %u cycles\n",
+               bench_eoi(pic_eoi));
+    }
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
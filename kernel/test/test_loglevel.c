@@ -0,0 +1,125 @@
+/*
+ * kernel/test/test_loglevel.c - Runtime log level and jump label tests
+ *
+ * Verifies:
+ *   - a static_branch_unlikely() site is a NOP until its key is
+ *     enabled, a JMP while it is, and a NOP again after
+ *   - klog() below a subsystem's level logs nothing and evaluates
+ *     none of its arguments
+ *   - raising the level to LOG_DEBUG turns the subsystem's debug
+ *     sites on, and only that subsystem's
+ *
+ * Prints the cost of a disabled debug site next to an enabled one.
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <printk.h>
+#include <jump_label.h>
+#include <asm.h>
+
+#define BENCH_CALLS     1024
+
+extern const struct jump_entry __jump_table_start[];
+extern const struct jump_entry __jump_table_end[];
+
+static struct static_key test_key;
+static uint32_t evaluated;
+
+/* An argument with a side effect, to see whether klog() evaluated it */
+static uint32_t count_eval(void)
+{
+    return ++evaluated;
+}
+
+/* One site of test_key; true when the branch was taken */
+static bool test_site(void)
+{
+    if (static_branch_unlikely(&test_key)) {
+        return true;
+    }
+    return false;
+}
+
+/* The code bytes of test_key's site, or NULL */
+static const uint8_t *test_site_code(void)
+{
+    const struct jump_entry *entry;
+
+    for (entry = __jump_table_start; entry < __jump_table_end; entry++) {
+        if (entry->key == (uintptr_t)&test_key) {
+            return (const uint8_t *)entry->code;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * test_loglevel - Runtime log level test suite
+ */
+void test_loglevel(void)
+{
+    static const uint8_t nop[JUMP_LABEL_SIZE] = JUMP_LABEL_NOP;
+    const uint8_t *code;
+    uint32_t records, off_cycles, i;
+    uint64_t start;
+    int core_level = log_get_level(LOG_SYS_CORE);
+    int mm_level = log_get_level(LOG_SYS_MM);
+
+    TEST_BEGIN("loglevel");
+
+    /* Test 1: The site is recorded and starts as a NOP */
+    code = test_site_code();
+    TEST_ASSERT(code != NULL);
+    for (i = 0; i < JUMP_LABEL_SIZE; i++) {
+        TEST_ASSERT_EQ(nop[i], code[i]);
+    }
+    TEST_ASSERT(!test_site());
+
+    /* Test 2: Enabling patches in a JMP; disabling restores the NOP */
+    static_key_enable(&test_key);
+    TEST_ASSERT_EQ(JUMP_LABEL_JMP, code[0]);
+    TEST_ASSERT(test_site());
+    static_key_disable(&test_key);
+    TEST_ASSERT_EQ(nop[0], code[0]);
+    TEST_ASSERT(!test_site());
+
+    /* Test 3: Filtered messages log nothing and skip their arguments */
+    log_set_level(LOG_SYS_CORE, LOG_WARN);
+    evaluated = 0;
+    records = printk_get_stats()->records;
+    klog(LOG_SYS_CORE, LOG_INFO, "loglevel: filtered %u\n", count_eval());
+    klog(LOG_SYS_CORE, LOG_DEBUG, "loglevel: filtered %u\n", count_eval());
+    TEST_ASSERT_EQ(records, printk_get_stats()->records);
+    TEST_ASSERT_EQ(0, evaluated);
+
+    /* Test 4: LOG_DEBUG enables this subsystem's debug sites only */
+    log_set_level(LOG_SYS_CORE, LOG_DEBUG);
+    log_set_level(LOG_SYS_MM, LOG_INFO);
+    records = printk_get_stats()->records;
+    klog(LOG_SYS_CORE, LOG_DEBUG, "loglevel: core debug %u\n", count_eval());
+    klog(LOG_SYS_MM, LOG_DEBUG, "loglevel: mm debug %u\n", count_eval());
+    TEST_ASSERT_EQ(records + 1, printk_get_stats()->records);
+    TEST_ASSERT_EQ(1, evaluated);
+
+    /* Test 5: A disabled debug site costs next to nothing */
+    log_set_level(LOG_SYS_CORE, LOG_INFO);
+    cli();
+    start = rdtsc();
+    for (i = 0; i < BENCH_CALLS; i++) {
+        klog(LOG_SYS_CORE, LOG_DEBUG, "loglevel: bench %u\n", count_eval());
+    }
+    off_cycles = (uint32_t)(rdtsc() - start) / BENCH_CALLS;
+    sti();
+    TEST_ASSERT_EQ(1, evaluated);
+    printk(LOG_INFO, "[loglevel] disabled debug klog: %u cycles\n",
+           off_cycles);
+
+    log_set_level(LOG_SYS_CORE, core_level);
+    log_set_level(LOG_SYS_MM, mm_level);
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
@@ -2,16 +2,20 @@
  * kernel/test/test_printk.c - printk format string tests
  *
  * Tests for the printk logging infrastructure.
- * Verifies all supported format specifiers work correctly.
+ * Verifies all supported format specifiers, flags, widths and
+ * precisions work correctly.
  *
- * Output is sent to both serial and VGA, so verification
- * can be done by checking QEMU's serial console.
+ * Output is sent to the registered consoles (COM1 and VGA), so
+ * verification can be done by checking QEMU's serial console. The log itself is
+ * checked by reading records back with dmesg_read().
  */
 
 #ifdef TEST_MODE
 
 #include <test.h>
 #include <printk.h>
+#include <printk_ringbuf.h>
+#include <console.h>
 #include <types.h>
 
 /*
@@ -97,6 +101,205 @@ static void test_printk_levels(void)
     test_pass("printk log levels");
 }
 
+/*
+ * ends_with - Check that @s ends in @suffix
+ */
+static bool ends_with(const char *s, size_t len, const char *suffix)
+{
+    size_t n = 0;
+
+    while (suffix[n]) {
+        n++;
+    }
+    if (n > len) {
+        return false;
+    }
+    s += len - n;
+    while (*suffix) {
+        if (*s++ != *suffix++) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * test_printk_dmesg - Test reading the log back
+ *
+ * Reads everything retained and checks the last line is the message
+ * just logged. Nothing may print between the two, or it would be last.
+ */
+static void test_printk_dmesg(void)
+{
+    const struct printk_stats *stats = printk_get_stats();
+    static char line[PRB_TEXT_MAX + 32];
+    static char last[PRB_TEXT_MAX + 32];
+    uint32_t records = stats->records;
+    uint32_t seq, first, head, i;
+    size_t len, last_len = 0;
+
+    printk(LOG_DEBUG, "dmesg marker %u\n", 4242U);
+
+    first = dmesg_first_seq();
+    seq = first;
+    while ((len = dmesg_read(&seq, line, sizeof(line))) > 0) {
+        for (i = 0; i <= len; i++) {
+            last[i] = line[i];
+        }
+        last_len = len;
+    }
+    head = printk_get_stats()->records;
+
+    /* Read up to the end of the log, which has one more record */
+    TEST_ASSERT_EQ(records + 1, head);
+    TEST_ASSERT_EQ(head, seq);
+    TEST_ASSERT(seq - first <= PRB_RECORDS);
+    TEST_ASSERT(last[0] == '[');
+    TEST_ASSERT(ends_with(last, last_len, "[DEBUG] dmesg marker 4242\n"));
+
+    test_pass("printk dmesg");
+}
+
+/*
+ * test_printk_truncate - Test an over-long message is cut, not lost
+ */
+static void test_printk_truncate(void)
+{
+    static char longstr[PRB_TEXT_MAX + 16];
+    static char line[PRB_TEXT_MAX + 32];
+    uint32_t truncated = printk_get_stats()->truncated;
+    uint32_t seq, i;
+    size_t len;
+
+    for (i = 0; i < sizeof(longstr) - 1; i++) {
+        longstr[i] = (char)('a' + i % 26);
+    }
+    longstr[i] = '\0';
+
+    printk(LOG_DEBUG, "%s", longstr);
+    seq = printk_get_stats()->records - 1;
+    len = dmesg_read(&seq, line, sizeof(line));
+
+    TEST_ASSERT_EQ(truncated + 1, printk_get_stats()->truncated);
+    TEST_ASSERT(ends_with(line, len, "zabcde"));
+    printk(LOG_DEBUG, "\n");
+
+    test_pass("printk truncation");
+}
+
+/*
+ * last_ends_with - Check the newest log record ends in @suffix
+ */
+static bool last_ends_with(const char *suffix)
+{
+    static char line[PRB_TEXT_MAX + 32];
+    uint32_t seq = printk_get_stats()->records - 1;
+    size_t len = dmesg_read(&seq, line, sizeof(line));
+
+    return len > 0 && ends_with(line, len, suffix);
+}
+
+/*
+ * test_printk_width - Test flags, width, precision and 64-bit lengths
+ *
+ * Each message is checked before the next, since a passing assertion
+ * logs a record of its own.
+ */
+static void test_printk_width(void)
+{
+    printk(LOG_DEBUG, "[%5u|%-5u|%05u]\n", 42U, 42U, 42U);
+    TEST_ASSERT(last_ends_with("[   42|42   |00042]\n"));
+
+    printk(LOG_DEBUG, "[%08x|%.3d|%05d]\n", 0xBEEFU, 7, -42);
+    TEST_ASSERT(last_ends_with("[0000beef|007|-0042]\n"));
+
+    printk(LOG_DEBUG, "[%*s|%.2s|%-3c]\n", 4, "ab", "xyz", 'q');
+    TEST_ASSERT(last_ends_with("[  ab|xy|q  ]\n"));
+
+    printk(LOG_DEBUG, "[%llu|%lld]\n", 18446744073709551615ULL,
+           (long long)(-9223372036854775807LL - 1));
+    TEST_ASSERT(last_ends_with(
+        "[18446744073709551615|-9223372036854775808]\n"));
+
+    printk(LOG_DEBUG, "[%016llx|%llX|%zu]\n", 0x12345678ABCULL,
+           0xFEDCBA9876543210ULL, (size_t)1234);
+    TEST_ASSERT(last_ends_with("[0000012345678abc|FEDCBA9876543210|1234]\n"));
+
+    test_pass("printk width/precision/%ll");
+}
+
+/*
+ * test_printk_flush - Test flushing leaves nothing behind
+ */
+static void test_printk_flush(void)
+{
+    printk(LOG_DEBUG, "Flushed line\n");
+    printk_flush();
+
+    TEST_ASSERT_EQ(0, printk_get_stats()->dropped);
+
+    test_pass("printk flush");
+}
+
+/*
+ * test_printk_console_level - Test a console's level filters records
+ *
+ * Lowers VGA to LOG_ERROR: a debug message still reaches COM1 but not
+ * VGA, and turning VGA off keeps even errors from it.
+ */
+static void test_printk_console_level(void)
+{
+    struct console *vga = console_find("vga");
+    struct console *com1 = console_find("com1");
+    uint32_t vga_records, com1_records;
+    bool vga_enabled;
+    int vga_level;
+
+    TEST_ASSERT(vga != NULL && com1 != NULL);
+    vga_level = vga->level;
+    vga_enabled = vga->enabled;
+
+    printk_flush();
+    console_set_level(vga, LOG_ERROR);
+    vga_records = vga->records;
+    com1_records = com1->records;
+    printk(LOG_DEBUG, "Console filter: COM1 only\n");
+    printk_flush();
+    console_set_enabled(vga, false);
+    printk(LOG_ERROR, "Console filter: VGA off\n");
+    printk_flush();
+    console_set_enabled(vga, vga_enabled);
+    console_set_level(vga, vga_level);
+
+    TEST_ASSERT_EQ(vga_records, vga->records);
+    TEST_ASSERT_EQ(com1_records + 2, com1->records);
+
+    test_pass("printk console level");
+}
+
+/*
+ * test_printk_ratelimited - Test a call site stops after its burst
+ *
+ * The loop is one call site: the first RATELIMIT_BURST messages are
+ * logged and the rest only counted (well within one interval).
+ */
+static void test_printk_ratelimited(void)
+{
+    uint32_t records = printk_get_stats()->records;
+    uint32_t suppressed = printk_get_stats()->suppressed;
+    uint32_t i;
+
+    for (i = 0; i < 3 * RATELIMIT_BURST; i++) {
+        printk_ratelimited(LOG_DEBUG, "Rate-limited %u\n", i);
+    }
+
+    TEST_ASSERT_EQ(records + RATELIMIT_BURST, printk_get_stats()->records);
+    TEST_ASSERT_EQ(suppressed + 2 * RATELIMIT_BURST,
+                   printk_get_stats()->suppressed);
+
+    test_pass("printk ratelimited");
+}
+
 /*
  * test_printk - printk test suite entry point
  *
@@ -113,6 +316,12 @@ void test_printk(void)
     test_printk_pointer();
     test_printk_percent();
     test_printk_levels();
+    test_printk_dmesg();
+    test_printk_truncate();
+    test_printk_width();
+    test_printk_console_level();
+    test_printk_ratelimited();
+    test_printk_flush();
 
     TEST_END();
 }
@@ -47,6 +47,39 @@ extern void test_vga(void);
 extern void test_serial(void);
 extern void test_printk(void);
 
+/* Story 2.1: IDT and ISR dispatch */
+extern void test_idt(void);
+
+/* Story 2.2: Interrupt controllers */
+extern void test_irq(void);
+
+/* Story 2.3: Clocksource and ktime */
+extern void test_ktime(void);
+
+/* Story 2.4: Tick and tickless idle */
+extern void test_tick(void);
+
+/* Story 2.5: Timer wheel */
+extern void test_timer(void);
+
+/* Story 2.6: High-resolution timers */
+extern void test_hrtimer(void);
+
+/* Story 2.7: Softirqs and tasklets */
+extern void test_softirq(void);
+
+/* Story 2.8: Binary tracing */
+extern void test_trace(void);
+
+/* Story 2.9: Runtime log levels */
+extern void test_loglevel(void);
+
+/* Story 2.10: QEMU debug console */
+extern void test_debugcon(void);
+
+/* Story 2.11: Framebuffer console */
+extern void test_fbcon(void);
+
 /* Milestone 3: Memory Management */
 /* extern void test_pmm(void); */
 /* extern void test_bitmap(void); */
@@ -140,6 +173,39 @@ void test_run_all(void)
     test_serial();
     test_printk();
 
+    /* Story 2.1: IDT and ISR dispatch */
+    test_idt();
+
+    /* Story 2.2: Interrupt controllers */
+    test_irq();
+
+    /* Story 2.3: Clocksource and ktime */
+    test_ktime();
+
+    /* Story 2.4: Tick and tickless idle */
+    test_tick();
+
+    /* Story 2.5: Timer wheel */
+    test_timer();
+
+    /* Story 2.6: High-resolution timers */
+    test_hrtimer();
+
+    /* Story 2.7: Softirqs and tasklets */
+    test_softirq();
+
+    /* Story 2.8: Binary tracing */
+    test_trace();
+
+    /* Story 2.9: Runtime log levels */
+    test_loglevel();
+
+    /* Story 2.10: QEMU debug console */
+    test_debugcon();
+
+    /* Story 2.11: Framebuffer console */
+    test_fbcon();
+
     /* Milestone 3: Memory */
     /* test_pmm(); */
     /* test_bitmap(); */
@@ -2,7 +2,11 @@
  * kernel/test/test_serial.c - Serial driver tests
  *
  * Tests for the serial port driver functionality.
- * Verifies character output, string output, and buffer writes.
+ * Verifies character output, string output, and buffer writes, and
+ * that interrupt-driven output is queued and drained in FIFO bursts.
+ * Input is checked with COM1 in loopback mode, so the port receives
+ * what it sends. Also checks runtime port setup and baud changes, and
+ * compares polled output cost at 38400 and 115200 baud.
  *
  * Note: These tests verify the driver functions execute without error.
  * Actual serial output verification requires checking QEMU's serial console.
@@ -12,8 +16,16 @@
 
 #include <test.h>
 #include <serial.h>
+#include <ktime.h>
+#include <printk.h>
+#include <tick.h>
+#include <errno.h>
+#include <asm.h>
 #include <types.h>
 
+#define TX_TEST_LINES   8
+#define RX_TEST_BYTES   256
+
 /*
  * test_serial_putchar - Test single character output
  *
@@ -56,6 +68,217 @@ static void test_serial_write(void)
     test_pass("serial_write");
 }
 
+/*
+ * test_serial_tx_ring - Test interrupt-driven output
+ *
+ * Queues a few lines with interrupts off, then lets the TX-empty
+ * interrupt drain them. Also compares the caller's cost of a line with
+ * polled output.
+ */
+static void test_serial_tx_ring(void)
+{
+    const struct serial_tx_stats *stats = serial_get_tx_stats();
+    const char line[] = "TX ring: 0123456789abcdefghijklmnopqrstuvwxyz\n";
+    uint64_t queued, irqs, bursts, start, deadline;
+    uint32_t ring_ns, sync_ns;
+    int i;
+
+    /* Warm up and start from an empty ring */
+    printk_flush();
+    serial_flush();
+
+    cli();
+    queued = stats->queued;
+    irqs = stats->irqs;
+    bursts = stats->bursts;
+
+    start = ktime_get_ns();
+    serial_puts(line);
+    ring_ns = (uint32_t)(ktime_get_ns() - start);
+
+    for (i = 1; i < TX_TEST_LINES; i++) {
+        serial_puts(line);
+    }
+
+    /* Every byte (plus a CR per line) was queued, not sent */
+    TEST_ASSERT_EQ(TX_TEST_LINES * sizeof(line),
+                   (uint32_t)(stats->queued - queued));
+
+    /* The interrupt moves the rest out, at most 16 bytes per burst */
+    deadline = ktime_get_ns() + 200ULL * NSEC_PER_MSEC;
+    while (stats->bursts - bursts < TX_TEST_LINES * sizeof(line) /
+                                    SERIAL_FIFO_SIZE &&
+           ktime_get_ns() < deadline) {
+        __asm__ volatile ("sti; hlt; cli");
+    }
+    TEST_ASSERT_GT((uint32_t)(stats->irqs - irqs), 0);
+    TEST_ASSERT_GTE((uint32_t)(stats->bursts - bursts),
+                    TX_TEST_LINES * sizeof(line) / SERIAL_FIFO_SIZE);
+    sti();
+
+    /* Polled output of the same line for comparison */
+    serial_set_sync(true);
+    start = ktime_get_ns();
+    serial_puts(line);
+    sync_ns = (uint32_t)(ktime_get_ns() - start);
+    serial_set_sync(false);
+
+    printk(LOG_INFO, "[serial] %u-byte line: queued %u ns, polled %u ns\n",
+           (uint32_t)sizeof(line), ring_ns, sync_ns);
+
+    test_pass("serial_tx_ring");
+}
+
+/*
+ * test_serial_rx_loopback - Test interrupt-driven input
+ *
+ * Nothing may print while loopback is on, or it would be received too,
+ * so results are checked once it is off again.
+ */
+static void test_serial_rx_loopback(void)
+{
+    const struct serial_rx_stats *stats = serial_get_rx_stats(SERIAL_COM1);
+    static uint8_t pattern[RX_TEST_BYTES];
+    static uint8_t got[RX_TEST_BYTES];
+    uint64_t hw_overruns, sw_overruns, irqs, deadline;
+    int empty_ret, line1, line2, n = 0, ret, i;
+    char line[16], line_2[16];
+    bool match;
+
+    if (!serial_port_present(SERIAL_COM1)) {
+        TEST_SKIP("no COM1");
+        return;
+    }
+    TEST_ASSERT_EQ(-ENODEV, serial_read(SERIAL_PORTS, got, 1, 0));
+
+    for (i = 0; i < RX_TEST_BYTES; i++) {
+        pattern[i] = (uint8_t)('a' + i % 26);
+    }
+
+    printk_flush();
+    serial_flush();
+    outb(COM1_PORT + SERIAL_MODEM_CTRL,
+         SERIAL_MCR_DTR | SERIAL_MCR_RTS | SERIAL_MCR_OUT2 | SERIAL_MCR_LOOP);
+    hw_overruns = stats->hw_overruns;
+    sw_overruns = stats->sw_overruns;
+    irqs = stats->irqs;
+
+    /* Nothing received yet */
+    empty_ret = serial_read(SERIAL_COM1, got, 1, SERIAL_NONBLOCK);
+
+    /* A burst well past the FIFO size arrives complete */
+    serial_write(pattern, RX_TEST_BYTES);
+    deadline = ktime_get_ns() + 500ULL * NSEC_PER_MSEC;
+    while (n < RX_TEST_BYTES && ktime_get_ns() < deadline) {
+        ret = serial_read(SERIAL_COM1, got + n, RX_TEST_BYTES - n,
+                          SERIAL_NONBLOCK);
+        if (ret > 0) {
+            n += ret;
+        } else {
+            cpu_idle();
+        }
+    }
+
+    /* Blocking line reads, woken by the RX interrupt */
+    serial_write("help\r\nls\r", 10);
+    line1 = serial_read_line(SERIAL_COM1, line, sizeof(line), 0);
+    line2 = serial_read_line(SERIAL_COM1, line_2, sizeof(line_2), 0);
+
+    serial_flush();
+    outb(COM1_PORT + SERIAL_MODEM_CTRL,
+         SERIAL_MCR_DTR | SERIAL_MCR_RTS | SERIAL_MCR_OUT2);
+
+    TEST_ASSERT_EQ(-EAGAIN, empty_ret);
+    TEST_ASSERT_EQ(RX_TEST_BYTES, n);
+    match = true;
+    for (i = 0; i < n; i++) {
+        if (got[i] != pattern[i]) {
+            match = false;
+        }
+    }
+    TEST_ASSERT(match);
+    TEST_ASSERT_EQ(0, (uint32_t)(stats->hw_overruns - hw_overruns));
+    TEST_ASSERT_EQ(0, (uint32_t)(stats->sw_overruns - sw_overruns));
+    TEST_ASSERT_GT((uint32_t)(stats->irqs - irqs), 0);
+
+    TEST_ASSERT_EQ(4, line1);
+    TEST_ASSERT_EQ(2, line2);
+    TEST_ASSERT(line[0] == 'h' && line[3] == 'p' && line[4] == '\0');
+    TEST_ASSERT(line_2[0] == 'l' && line_2[1] == 's' && line_2[2] == '\0');
+
+    printk(LOG_INFO, "[serial] RX %u bytes in %u interrupts\n",
+           (uint32_t)stats->bytes, (uint32_t)stats->irqs);
+
+    test_pass("serial_rx_loopback");
+}
+
+/*
+ * time_sync_line - Nanoseconds to poll one line out of the console
+ */
+static uint32_t time_sync_line(const char *line)
+{
+    uint64_t start;
+
+    serial_set_sync(true);
+    start = ktime_get_ns();
+    serial_puts(line);
+    printk_flush();
+    serial_flush();
+    while (!(inb(COM1_PORT + SERIAL_LINE_STATUS) & SERIAL_LSR_TX_IDLE)) {
+        /* spin */
+    }
+    serial_set_sync(false);
+    return (uint32_t)(ktime_get_ns() - start);
+}
+
+/*
+ * test_serial_ports - Test per-port setup and runtime baud changes
+ */
+static void test_serial_ports(void)
+{
+    const struct serial_port *com1 = serial_port_get(SERIAL_COM1);
+    const char line[] = "Baud test: 0123456789abcdefghijklmnopqrstuvwxyz\n";
+    uint32_t slow_ns, fast_ns;
+    uint32_t i;
+
+    /* Bad index and baud rates */
+    TEST_ASSERT_NULL(serial_port_get(SERIAL_PORTS));
+    TEST_ASSERT_EQ(-EINVAL, serial_port_init(SERIAL_PORTS, 115200));
+    TEST_ASSERT_EQ(-EINVAL, serial_port_init(SERIAL_COM1, 0));
+    TEST_ASSERT_EQ(-EINVAL, serial_port_init(SERIAL_COM1, 230400));
+    TEST_ASSERT_EQ(-EINVAL, serial_set_baud(SERIAL_COM1, 7));
+
+    /* The console runs at the default rate with a 16550A FIFO */
+    TEST_ASSERT_NOT_NULL(com1);
+    TEST_ASSERT_EQ(SERIAL_DEFAULT_BAUD, com1->baud);
+    TEST_ASSERT_EQ(SERIAL_FIFO_SIZE, com1->fifo_size);
+
+    /* Runtime baud change, and back */
+    TEST_ASSERT_EQ(0, serial_set_baud(SERIAL_COM1, 38400));
+    TEST_ASSERT_EQ(38400, com1->baud);
+    slow_ns = time_sync_line(line);
+    TEST_ASSERT_EQ(0, serial_set_baud(SERIAL_COM1, 115200));
+    TEST_ASSERT_EQ(115200, com1->baud);
+    fast_ns = time_sync_line(line);
+
+    /* Other ports are written independently of the console */
+    for (i = SERIAL_COM2; i < SERIAL_PORTS; i++) {
+        if (serial_port_present(i)) {
+            TEST_ASSERT_EQ(0, serial_port_write(i, "port\r\n", 6));
+            TEST_ASSERT_GTE((uint32_t)serial_port_get(i)->tx_stats.queued,
+                            6);
+        } else {
+            TEST_ASSERT_EQ(-ENODEV, serial_port_write(i, "x", 1));
+            TEST_ASSERT_EQ(-ENODEV, serial_set_baud(i, 115200));
+        }
+    }
+
+    printk(LOG_INFO, "[serial] polled %u-byte line: %u ns at 38400, "
+           "%u ns at 115200\n", (uint32_t)sizeof(line), slow_ns, fast_ns);
+
+    test_pass("serial_ports");
+}
+
 /*
  * test_serial - Serial driver test suite entry point
  *
@@ -68,6 +291,9 @@ void test_serial(void)
     test_serial_putchar();
     test_serial_puts();
     test_serial_write();
+    test_serial_tx_ring();
+    test_serial_rx_loopback();
+    test_serial_ports();
 
     TEST_END();
 }
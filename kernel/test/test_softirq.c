@@ -0,0 +1,157 @@
+/*
+ * kernel/test/test_softirq.c - Softirq and tasklet tests
+ *
+ * Verifies:
+ *   - a tasklet scheduled from process context runs in the softirq
+ *     thread (via cpu_idle()), once, however often it was scheduled
+ *   - a tasklet scheduled by an interrupt handler runs at irq_exit(),
+ *     before the interrupt returns
+ *   - a softirq that keeps re-raising itself is cut off at irq_exit()'s
+ *     budget and finished by the softirq thread
+ *   - per-vector run counts and time are accounted
+ *
+ * Prints the per-vector accounting at the end.
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <softirq.h>
+#include <tick.h>
+#include <irq.h>
+#include <apic.h>
+#include <pic.h>
+#include <asm.h>
+#include <printk.h>
+
+#define TEST_IRQ        5       /* Unused ISA line (LPT2/sound) */
+#define STORM_RUNS      50      /* Re-raises, well past SOFTIRQ_MAX_RESTART */
+
+static struct tasklet once_tasklet;
+static struct tasklet irq_tasklet;
+static struct tasklet storm_tasklet;
+
+static volatile uint32_t once_runs;
+static volatile uint32_t irq_runs;
+static volatile uint32_t storm_runs;
+static volatile bool irq_ran_in_handler;
+static volatile bool irq_returned;
+
+static void once_fn(unsigned long data)
+{
+    (void)data;
+    once_runs++;
+}
+
+static void irq_tasklet_fn(unsigned long data)
+{
+    (void)data;
+    irq_runs++;
+    irq_ran_in_handler = !irq_returned;
+}
+
+static void storm_fn(unsigned long data)
+{
+    (void)data;
+    if (++storm_runs < STORM_RUNS) {
+        tasklet_hi_schedule(&storm_tasklet);
+    }
+}
+
+static void test_irq_handler(struct interrupt_frame *frame)
+{
+    (void)frame;
+    tasklet_schedule(&irq_tasklet);
+}
+
+/*
+ * test_softirq - Softirq test suite
+ */
+void test_softirq(void)
+{
+    const struct softirq_stats *stats = softirq_get_stats();
+    uint64_t thread_runs, irq_exit_runs, deferred, runs;
+    uint32_t i;
+
+    TEST_BEGIN("softirq");
+
+    tasklet_init(&once_tasklet, once_fn, 0);
+    tasklet_init(&irq_tasklet, irq_tasklet_fn, 0);
+    tasklet_init(&storm_tasklet, storm_fn, 0);
+
+    /* Test 1: Process-context tasklet runs once, in the softirq thread */
+    cli();
+    thread_runs = stats->thread_runs;
+    runs = stats->vec[TASKLET_SOFTIRQ].runs;
+    tasklet_schedule(&once_tasklet);
+    tasklet_schedule(&once_tasklet);
+    TEST_ASSERT(softirq_pending());
+    TEST_ASSERT_EQ(0, once_runs);
+    cpu_idle();
+    cli();
+    TEST_ASSERT_EQ(1, once_runs);
+    TEST_ASSERT(!softirq_pending());
+    TEST_ASSERT_GTE((uint32_t)(stats->thread_runs - thread_runs), 1);
+    TEST_ASSERT_GTE((uint32_t)(stats->vec[TASKLET_SOFTIRQ].runs - runs), 1);
+
+    /* Test 2: Not in interrupt context here */
+    TEST_ASSERT(!in_interrupt());
+
+    /* Test 3: Tasklet from an interrupt handler runs at irq_exit() */
+    if (irq_get_chip()->eoi != pic_eoi &&
+        irq_request(TEST_IRQ, test_irq_handler) == 0) {
+        irq_exit_runs = stats->irq_exit_runs;
+        irq_returned = false;
+        lapic_send_self_ipi(IRQ_VECTOR_BASE + TEST_IRQ);
+        __asm__ volatile ("sti; nop; cli");
+        irq_returned = true;
+        TEST_ASSERT_EQ(1, irq_runs);
+        TEST_ASSERT(irq_ran_in_handler);
+        TEST_ASSERT_GTE((uint32_t)(stats->irq_exit_runs - irq_exit_runs), 1);
+        irq_free(TEST_IRQ);
+    } else {
+        TEST_SKIP("no local APIC for self-IPI delivery");
+    }
+
+    /*
+     * Test 4: A self-rescheduling tasklet exceeds the irq_exit() budget
+     * and is finished by the softirq thread
+     */
+    if (irq_get_chip()->eoi != pic_eoi &&
+        irq_request(TEST_IRQ, test_irq_handler) == 0) {
+        deferred = stats->deferred;
+        tasklet_hi_schedule(&storm_tasklet);
+        irq_returned = false;
+        lapic_send_self_ipi(IRQ_VECTOR_BASE + TEST_IRQ);
+        __asm__ volatile ("sti; nop; cli");
+        irq_returned = true;
+        TEST_ASSERT_EQ(1, (uint32_t)(stats->deferred - deferred));
+        TEST_ASSERT(storm_runs < STORM_RUNS);
+        for (i = 0; i < STORM_RUNS && storm_runs < STORM_RUNS; i++) {
+            cpu_idle();
+            cli();
+        }
+        TEST_ASSERT_EQ(STORM_RUNS, storm_runs);
+        irq_free(TEST_IRQ);
+    } else {
+        TEST_SKIP("no local APIC for self-IPI delivery");
+    }
+
+    /* Test 5: Handler time is accounted */
+    TEST_ASSERT_GTE((uint32_t)stats->vec[TASKLET_SOFTIRQ].runs, 1);
+    TEST_ASSERT(stats->vec[TASKLET_SOFTIRQ].time_ns > 0);
+
+    for (i = 0; i < NR_SOFTIRQS; i++) {
+        printk(LOG_INFO, "[softirq] %s: raised %u, runs %u, %u ns (max %u)\n",
+               softirq_name(i), (uint32_t)stats->vec[i].raised,
+               (uint32_t)stats->vec[i].runs, (uint32_t)stats->vec[i].time_ns,
+               (uint32_t)stats->vec[i].max_ns);
+    }
+    printk(LOG_INFO, "[softirq] passes: irq_exit %u, thread %u, deferred %u\n",
+           (uint32_t)stats->irq_exit_runs, (uint32_t)stats->thread_runs,
+           (uint32_t)stats->deferred);
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
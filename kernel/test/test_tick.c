@@ -0,0 +1,87 @@
+/*
+ * kernel/test/test_tick.c - Periodic tick and tickless idle tests
+ *
+ * Verifies:
+ *   - jiffies advance at HZ while interrupts are enabled
+ *   - cpu_idle() stops the tick for a far-off event, sleeps until it
+ *     on the one-shot timer, and accounts the idle time
+ *   - jiffies are caught up after a tickless sleep
+ *
+ * Skipped without a local APIC (no tick).
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <tick.h>
+#include <irq.h>
+#include <pic.h>
+#include <asm.h>
+#include <errno.h>
+
+#define SLEEP_NS    (50ULL * NSEC_PER_MSEC)
+
+static uint64_t test_deadline = KTIME_MAX;
+
+static uint64_t test_next_event(void)
+{
+    return test_deadline;
+}
+
+/*
+ * test_tick - Tick test suite
+ */
+void test_tick(void)
+{
+    const struct tick_idle_stats *stats = tick_get_idle_stats();
+    uint64_t start, j0, tickless, timer_wakeups, idle_ns;
+    uint32_t jdelta;
+
+    TEST_BEGIN("tick");
+
+    if (irq_get_chip()->eoi == pic_eoi) {
+        TEST_SKIP("no local APIC timer");
+        TEST_END();
+        return;
+    }
+
+    /* Test 1: jiffies advance at HZ (30 ms -> 3 ticks, +-1) */
+    j0 = jiffies;
+    start = ktime_get_ns();
+    sti();
+    while (ktime_get_ns() - start < 30ULL * NSEC_PER_MSEC) {
+        /* spin */
+    }
+    cli();
+    jdelta = (uint32_t)(jiffies - j0);
+    TEST_ASSERT_GTE(jdelta, 2);
+    TEST_ASSERT_LTE(jdelta, 4);
+
+    /* Test 2: Idle until a 50 ms deadline goes tickless and wakes on time */
+    TEST_ASSERT_EQ(0, tick_register_next_event(test_next_event));
+    tickless = stats->tickless;
+    timer_wakeups = stats->timer_wakeups;
+    idle_ns = stats->idle_ns;
+    j0 = jiffies;
+
+    test_deadline = ktime_get_ns() + SLEEP_NS;
+    while (ktime_get_ns() < test_deadline) {
+        cpu_idle();
+    }
+    cli();
+    test_deadline = KTIME_MAX;
+
+    TEST_ASSERT_GTE((uint32_t)(stats->tickless - tickless), 1);
+    TEST_ASSERT_GTE((uint32_t)(stats->timer_wakeups - timer_wakeups), 1);
+    TEST_ASSERT_GTE((uint32_t)(stats->idle_ns - idle_ns),
+                    (uint32_t)(SLEEP_NS * 8 / 10));
+
+    /* Test 3: jiffies caught up across the sleep (5 ticks, +-1) */
+    jdelta = (uint32_t)(jiffies - j0);
+    TEST_ASSERT_GTE(jdelta, 4);
+    TEST_ASSERT_LTE(jdelta, 6);
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
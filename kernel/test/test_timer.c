@@ -0,0 +1,103 @@
+/*
+ * kernel/test/test_timer.c - Timer wheel tests
+ *
+ * Verifies:
+ *   - timers fire in expiry order, no earlier than their jiffy
+ *   - del_timer() stops a pending timer from running
+ *   - mod_timer() moves a pending timer
+ *   - idle between expiries goes tickless via the wheel's next event
+ *
+ * Skipped without a local APIC (no tick, so jiffies do not advance).
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <timer.h>
+#include <tick.h>
+#include <irq.h>
+#include <pic.h>
+#include <asm.h>
+
+#define TEST_TIMERS     4
+
+static struct timer_list timers[TEST_TIMERS];
+static uint64_t fired_jiffies[TEST_TIMERS];
+static int fire_order[TEST_TIMERS];
+static int fired;
+
+static void test_timer_fn(struct timer_list *timer)
+{
+    int i = (int)(timer - timers);
+
+    fired_jiffies[i] = jiffies;
+    fire_order[fired++] = i;
+}
+
+/*
+ * test_timer - Timer wheel test suite
+ */
+void test_timer(void)
+{
+    const struct tick_idle_stats *stats = tick_get_idle_stats();
+    uint64_t j0, tickless, deadline;
+    int i;
+
+    TEST_BEGIN("timer");
+
+    if (irq_get_chip()->eoi == pic_eoi) {
+        TEST_SKIP("no local APIC timer");
+        TEST_END();
+        return;
+    }
+
+    for (i = 0; i < TEST_TIMERS; i++) {
+        timer_setup(&timers[i], test_timer_fn);
+        fired_jiffies[i] = 0;
+    }
+    fired = 0;
+    tickless = stats->tickless;
+
+    /* Armed out of order: expect 1 (+2), 0 (+10), 3 (moved to +12) */
+    j0 = jiffies;
+    timers[0].expires = j0 + 10;
+    timers[1].expires = j0 + 2;
+    timers[2].expires = j0 + 5;
+    timers[3].expires = j0 + 30;
+    for (i = 0; i < TEST_TIMERS; i++) {
+        add_timer(&timers[i]);
+    }
+
+    /* Test 1: Cancel and move while pending */
+    TEST_ASSERT(del_timer(&timers[2]));
+    TEST_ASSERT(!del_timer(&timers[2]));
+    TEST_ASSERT(mod_timer(&timers[3], j0 + 12));
+
+    /* Run the idle loop until all three fire (or 500 ms pass) */
+    deadline = ktime_get_ns() + 500ULL * NSEC_PER_MSEC;
+    while (fired < 3 && ktime_get_ns() < deadline) {
+        cpu_idle();
+    }
+    cli();
+
+    /* Test 2: Everything fired, in order, and not early */
+    TEST_ASSERT_EQ(3, fired);
+    TEST_ASSERT_EQ(1, fire_order[0]);
+    TEST_ASSERT_EQ(0, fire_order[1]);
+    TEST_ASSERT_EQ(3, fire_order[2]);
+    TEST_ASSERT_GTE((uint32_t)(fired_jiffies[1] - j0), 2);
+    TEST_ASSERT_GTE((uint32_t)(fired_jiffies[0] - j0), 10);
+    TEST_ASSERT_GTE((uint32_t)(fired_jiffies[3] - j0), 12);
+    TEST_ASSERT_LTE((uint32_t)(fired_jiffies[3] - j0), 14);
+
+    /* Test 3: The cancelled timer never ran */
+    TEST_ASSERT_EQ(0, (uint32_t)fired_jiffies[2]);
+    TEST_ASSERT(!timer_pending(&timers[2]));
+
+    /* Test 4: The 8-jiffy gap between +2 and +10 was slept tickless */
+    TEST_ASSERT_GTE((uint32_t)(stats->tickless - tickless), 1);
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
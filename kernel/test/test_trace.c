@@ -0,0 +1,119 @@
+/*
+ * kernel/test/test_trace.c - Binary tracing tests
+ *
+ * Verifies:
+ *   - nothing is recorded while tracing is off
+ *   - events hold their format's address in .trace_fmt, the argument
+ *     count and the raw arguments, in order
+ *   - the kernel's own trace points (softirq) record events
+ *   - a trace point is cheaper than a printk() to the log ring
+ *   - trace_dump() writes to COM2 when there is one
+ *
+ * Prints the cost of both per event. The dump on COM2 can be decoded
+ * with scripts/trace_decode.py.
+ */
+
+#ifdef TEST_MODE
+
+#include <test.h>
+#include <trace.h>
+#include <tick.h>
+#include <serial.h>
+#include <printk.h>
+#include <errno.h>
+#include <asm.h>
+
+#define BENCH_EVENTS    TRACE_EVENTS
+#define BENCH_PRINTKS   16
+
+extern const char __trace_fmt_start[];
+extern const char __trace_fmt_end[];
+
+static bool fmt_in_section(uint32_t fmt)
+{
+    return fmt >= (uint32_t)(uintptr_t)__trace_fmt_start &&
+           fmt < (uint32_t)(uintptr_t)__trace_fmt_end;
+}
+
+/*
+ * test_trace - Tracing test suite
+ */
+void test_trace(void)
+{
+    const struct trace_event *ev;
+    uint64_t start;
+    uint32_t trace_cycles, printk_cycles, count, i;
+    int ret;
+
+    TEST_BEGIN("trace");
+
+    /* Benchmark first, while nothing else is in the buffer */
+    trace_reset();
+    trace_set_enabled(true);
+    cli();
+    start = rdtsc();
+    for (i = 0; i < BENCH_EVENTS; i++) {
+        TRACE("bench %u %x", i, 0xC0FFEEU);
+    }
+    trace_cycles = (uint32_t)(rdtsc() - start) / BENCH_EVENTS;
+    sti();
+    trace_set_enabled(false);
+
+    printk_flush();
+    start = rdtsc();
+    for (i = 0; i < BENCH_PRINTKS; i++) {
+        printk(LOG_DEBUG, "bench %u %x\n", i, 0xC0FFEEU);
+    }
+    printk_cycles = (uint32_t)(rdtsc() - start) / BENCH_PRINTKS;
+
+    /* Test 1: Disabled trace points record nothing */
+    trace_reset();
+    TRACE("disabled");
+    TEST_ASSERT_EQ(0, trace_buffer_count(&trace_cpu_buf));
+
+    /* Test 2: Events carry format address, count and raw arguments */
+    trace_set_enabled(true);
+    cli();
+    TRACE("no args");
+    TRACE("four args %u %d %x %c", 1U, -2, 0xABCDU, 'z');
+    count = trace_buffer_count(&trace_cpu_buf);
+    sti();
+
+    TEST_ASSERT_EQ(2, count);
+    ev = trace_buffer_get(&trace_cpu_buf, 0);
+    TEST_ASSERT(fmt_in_section(ev->fmt));
+    TEST_ASSERT_EQ(0, ev->nargs);
+    ev = trace_buffer_get(&trace_cpu_buf, 1);
+    TEST_ASSERT(fmt_in_section(ev->fmt));
+    TEST_ASSERT_EQ(4, ev->nargs);
+    TEST_ASSERT_EQ(1, ev->args[0]);
+    TEST_ASSERT_EQ((uint32_t)-2, ev->args[1]);
+    TEST_ASSERT_EQ(0xABCD, ev->args[2]);
+    TEST_ASSERT_EQ('z', ev->args[3]);
+    TEST_ASSERT(ev->tsc >= trace_buffer_get(&trace_cpu_buf, 0)->tsc);
+
+    /* Test 3: Softirqs are traced (the printk tasklet runs in idle) */
+    count = trace_buffer_count(&trace_cpu_buf);
+    printk(LOG_DEBUG, "trace: idling once\n");
+    cpu_idle();
+    TEST_ASSERT_GT(trace_buffer_count(&trace_cpu_buf), count);
+    trace_set_enabled(false);
+
+    /* Test 4: A trace point is much cheaper than printk */
+    TEST_ASSERT_LT(trace_cycles, printk_cycles);
+    printk(LOG_INFO, "[trace] per event: TRACE %u cycles, printk %u cycles\n",
+           trace_cycles, printk_cycles);
+
+    /* Test 5: The buffer dumps to COM2 for scripts/trace_decode.py */
+    count = trace_buffer_count(&trace_cpu_buf);
+    ret = trace_dump(SERIAL_COM2);
+    if (serial_port_present(SERIAL_COM2)) {
+        TEST_ASSERT_EQ((int)count, ret);
+    } else {
+        TEST_ASSERT_EQ(-ENODEV, ret);
+    }
+
+    TEST_END();
+}
+
+#endif /* TEST_MODE */
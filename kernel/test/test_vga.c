@@ -8,17 +8,31 @@
  *   - Character output writes to correct buffer position
  *   - Screen clearing works
  *   - Line wrapping and scrolling work
+ *   - Batched output (vga_write) shows the same text as vga_putchar()
+ *   - Scrolling moves the CRTC start address, keeps scrollback, and
+ *     wraps at the end of text memory
+ *
+ * Prints the cost per character of vga_putchar() next to vga_write().
  */
 
 #ifdef TEST_MODE
 
 #include <test.h>
 #include <vga.h>
+#include <fbcon.h>
+#include <printk.h>
+#include <console.h>
+#include <asm.h>
 #include <types.h>
 
+#define BENCH_LINES     50
+
 /* Direct access to VGA buffer for verification */
 #define TEST_VGA_BUFFER ((volatile uint16_t *)0xB8000)
 
+/* The part of it on screen, which moves as the screen scrolls */
+#define TEST_VGA_SCREEN (TEST_VGA_BUFFER + vga_screen_offset())
+
 /*
  * Helper to extract character from VGA entry
  */
@@ -42,8 +56,23 @@ static inline uint8_t vga_get_attr(uint16_t entry)
  */
 void test_vga(void)
 {
+    struct console *con = console_find("vga");
+
     TEST_BEGIN("vga");
 
+    if (fbcon_active()) {
+        TEST_SKIP("text memory not displayed (framebuffer console)");
+        TEST_END();
+        return;
+    }
+
+    /*
+     * Keep printk (including the [PASS] lines) off the screen while
+     * it is being checked; the log drain may run between statements.
+     */
+    printk_flush();
+    console_set_enabled(con, false);
+
     /* Test 1: VGA constants are correct */
     TEST_ASSERT_EQ(80, VGA_WIDTH);
     TEST_ASSERT_EQ(25, VGA_HEIGHT);
@@ -59,8 +88,8 @@ void test_vga(void)
     vga_clear();
     /* Capture before assertions modify VGA */
     {
-        char ch = vga_get_char(TEST_VGA_BUFFER[0]);
-        uint8_t attr = vga_get_attr(TEST_VGA_BUFFER[0]);
+        char ch = vga_get_char(TEST_VGA_SCREEN[0]);
+        uint8_t attr = vga_get_attr(TEST_VGA_SCREEN[0]);
         TEST_ASSERT_EQ(' ', ch);
         TEST_ASSERT_EQ(VGA_COLOR_DEFAULT, attr);
     }
@@ -71,8 +100,8 @@ void test_vga(void)
     vga_putchar('B');
     /* Check both before any TEST_ASSERT (which writes to VGA) */
     {
-        char a = vga_get_char(TEST_VGA_BUFFER[0]);
-        char b = vga_get_char(TEST_VGA_BUFFER[1]);
+        char a = vga_get_char(TEST_VGA_SCREEN[0]);
+        char b = vga_get_char(TEST_VGA_SCREEN[1]);
         TEST_ASSERT_EQ('A', a);
         TEST_ASSERT_EQ('B', b);
     }
@@ -82,8 +111,8 @@ void test_vga(void)
     vga_puts("Hi");
     /* Capture both before assertions modify VGA */
     {
-        char h = vga_get_char(TEST_VGA_BUFFER[0]);
-        char i = vga_get_char(TEST_VGA_BUFFER[1]);
+        char h = vga_get_char(TEST_VGA_SCREEN[0]);
+        char i = vga_get_char(TEST_VGA_SCREEN[1]);
         TEST_ASSERT_EQ('H', h);
         TEST_ASSERT_EQ('i', i);
     }
@@ -94,14 +123,14 @@ void test_vga(void)
     vga_putchar('\n');
     vga_putchar('Y');
     /* 'Y' should be at start of row 1 (position 80) */
-    TEST_ASSERT_EQ('Y', vga_get_char(TEST_VGA_BUFFER[VGA_WIDTH]));
+    TEST_ASSERT_EQ('Y', vga_get_char(TEST_VGA_SCREEN[VGA_WIDTH]));
 
     /* Test 7: vga_set_color() changes output color */
     vga_clear();
     vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLUE);
     vga_putchar('C');
     /* Attribute should be white (15) on blue (1): 0x1F */
-    TEST_ASSERT_EQ(0x1F, vga_get_attr(TEST_VGA_BUFFER[0]));
+    TEST_ASSERT_EQ(0x1F, vga_get_attr(TEST_VGA_SCREEN[0]));
 
     /* Test 8: Line wrapping at column 80 */
     vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
@@ -112,7 +141,7 @@ void test_vga(void)
     }
     /* Next character should wrap to row 1 */
     vga_putchar('W');
-    TEST_ASSERT_EQ('W', vga_get_char(TEST_VGA_BUFFER[VGA_WIDTH]));
+    TEST_ASSERT_EQ('W', vga_get_char(TEST_VGA_SCREEN[VGA_WIDTH]));
 
     /* Test 9: Carriage return moves to start of current line */
     vga_clear();
@@ -121,8 +150,8 @@ void test_vga(void)
     vga_putchar('X');
     /* Capture both before assertions modify VGA */
     {
-        char x = vga_get_char(TEST_VGA_BUFFER[0]);
-        char b = vga_get_char(TEST_VGA_BUFFER[1]);
+        char x = vga_get_char(TEST_VGA_SCREEN[0]);
+        char b = vga_get_char(TEST_VGA_SCREEN[1]);
         /* 'X' should overwrite 'A' at position 0 */
         TEST_ASSERT_EQ('X', x);
         /* 'B' should still be at position 1 */
@@ -138,13 +167,89 @@ void test_vga(void)
     }
     /* Screen should have scrolled - row 0 now contains what was row 1 */
     /* Row 1 started with '1', so position 0 should now be '1' */
-    TEST_ASSERT_EQ('1', vga_get_char(TEST_VGA_BUFFER[0]));
+    TEST_ASSERT_EQ('1', vga_get_char(TEST_VGA_SCREEN[0]));
     /* Last row (24) should be empty (space) after scroll */
-    TEST_ASSERT_EQ(' ', vga_get_char(TEST_VGA_BUFFER[VGA_WIDTH * (VGA_HEIGHT - 1)]));
+    TEST_ASSERT_EQ(' ', vga_get_char(TEST_VGA_SCREEN[VGA_WIDTH * (VGA_HEIGHT - 1)]));
+
+    /* Test 11: A batch scrolling several lines matches per-char output */
+    vga_clear();
+    {
+        static const char lines[] = "a\nb\nc\n";
+
+        for (int row = 0; row < VGA_HEIGHT - 1; row++) {
+            vga_putchar('\n');
+        }
+        vga_write(lines, sizeof(lines) - 1);
+        TEST_ASSERT_EQ('a', vga_get_char(TEST_VGA_SCREEN[VGA_WIDTH * (VGA_HEIGHT - 4)]));
+        TEST_ASSERT_EQ('c', vga_get_char(TEST_VGA_SCREEN[VGA_WIDTH * (VGA_HEIGHT - 2)]));
+    }
+
+    /* Test 12: Batched output is cheaper than per-character output */
+    {
+        static const char line[] =
+            "vga: benchmark line ............................................\n";
+        uint32_t chars = BENCH_LINES * (sizeof(line) - 1);
+        uint32_t putchar_cycles, write_cycles;
+        uint64_t start;
+
+        start = rdtsc();
+        for (int i = 0; i < BENCH_LINES; i++) {
+            for (size_t j = 0; j < sizeof(line) - 1; j++) {
+                vga_putchar(line[j]);
+            }
+        }
+        putchar_cycles = (uint32_t)(rdtsc() - start) / chars;
+
+        start = rdtsc();
+        for (int i = 0; i < BENCH_LINES; i++) {
+            vga_write(line, sizeof(line) - 1);
+        }
+        write_cycles = (uint32_t)(rdtsc() - start) / chars;
+
+        TEST_ASSERT_LT(write_cycles, putchar_cycles);
+        printk(LOG_INFO, "[vga] vga_putchar %u cycles/char, vga_write %u cycles/char\n",
+               putchar_cycles, write_cycles);
+    }
+
+    /* Test 13: Scrolling moves the screen down text memory */
+    vga_clear();
+    for (int row = 0; row < VGA_HEIGHT + 5; row++) {
+        vga_putchar('A' + row);
+        vga_putchar('\n');
+    }
+    /* 24 newlines reach the bottom row; the other 6 scroll */
+    TEST_ASSERT_EQ(6 * VGA_WIDTH, vga_screen_offset());
+    TEST_ASSERT_EQ('G', vga_get_char(TEST_VGA_SCREEN[0]));
+
+    /* Test 14: Scrollback shows the rows that scrolled off */
+    TEST_ASSERT_EQ(6, vga_scrollback(VGA_HEIGHT));
+    TEST_ASSERT_EQ(0, vga_screen_offset());
+    TEST_ASSERT_EQ('A', vga_get_char(TEST_VGA_SCREEN[0]));
+    TEST_ASSERT_EQ(4, vga_scrollback(-2));
+    TEST_ASSERT_EQ('C', vga_get_char(TEST_VGA_SCREEN[0]));
+    vga_putchar('z');
+    TEST_ASSERT_EQ(6 * VGA_WIDTH, vga_screen_offset());
+
+    /* Test 15: Wrapping keeps the screen and recent scrollback */
+    vga_clear();
+    for (int row = 0; row < VGA_VRAM_ROWS + 10; row++) {
+        vga_putchar('0' + row % 10);
+        vga_putchar('\n');
+    }
+    /* The last row written is just above the cursor's blank row */
+    TEST_ASSERT_EQ('0' + (VGA_VRAM_ROWS + 9) % 10,
+                   vga_get_char(TEST_VGA_SCREEN[VGA_WIDTH * (VGA_HEIGHT - 2)]));
+    TEST_ASSERT_LTE(vga_screen_offset(), (VGA_VRAM_ROWS - VGA_HEIGHT) * VGA_WIDTH);
+    TEST_ASSERT_GTE(vga_scrollback(VGA_VRAM_ROWS), VGA_SCROLLBACK_KEEP);
+    /* Text above the screen continues the sequence */
+    TEST_ASSERT_EQ((vga_get_char(TEST_VGA_SCREEN[0]) - '0' + 1) % 10,
+                   vga_get_char(TEST_VGA_SCREEN[VGA_WIDTH]) - '0');
+    vga_scrollback(-VGA_VRAM_ROWS);
 
     /* Reset to default state for subsequent output */
     vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
     vga_clear();
+    console_set_enabled(con, true);
 
     TEST_END();
 }
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+#
+# scripts/trace_decode.py - Decode a binary trace dump against kernel.elf
+#
+# The kernel's TRACE() events (kernel/include/trace.h) hold only the
+# address of their format string, which lives in the .trace_fmt section
+# of kernel.elf, plus up to four raw 32-bit arguments. trace_dump()
+# writes them to a serial port as a struct trace_dump_header followed
+# by the events; `make qemu` captures COM2 in build/trace.bin.
+#
+# Usage:
+#   scripts/trace_decode.py build/kernel.elf build/trace.bin
+#
+# Output, one line per event, oldest first:
+#   [     12.345 us] cpu0 isr 32 (fast): 1843 cycles
+#
+# Timestamps are relative to the first event, in microseconds when the
+# dump carries the TSC rate and in cycles otherwise. %s arguments are
+# looked up in the kernel image, so they resolve for kernel strings.
+#
+# Needs only the Python 3 standard library.
+#
+
+import re
+import struct
+import sys
+
+TRACE_DUMP_MAGIC = 0x31435254           # "TRC1"
+TRACE_DUMP_VERSION = 1
+HEADER = struct.Struct("<IHHIIII")      # struct trace_dump_header
+EVENT = struct.Struct("<QIBBH4I")       # struct trace_event
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+CONVERSION = re.compile(r"%([-0 +#]*)(\d*)(?:\.(\d+))?(ll|l|h)?([duxXcps%])")
+
+
+class Elf:
+    """Allocated sections of an ELF32/ELF64 little-endian image."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[5] != 1:
+            raise ValueError(f"{path}: not a little-endian ELF file")
+
+        if self.data[4] == 2:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data,
+                                                            0x3A)
+            shdr = struct.Struct("<IIQQQQIIQQ")
+        else:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data,
+                                                            0x2E)
+            shdr = struct.Struct("<IIIIIIIIII")
+
+        headers = [shdr.unpack_from(self.data, shoff + i * shentsize)
+                   for i in range(shnum)]
+        strtab_off = headers[shstrndx][4]
+
+        # name -> (addr, offset, size); only sections loaded with data
+        self.sections = {}
+        for name_off, sh_type, flags, addr, offset, size, *_ in headers:
+            if not flags & SHF_ALLOC or sh_type == SHT_NOBITS:
+                continue
+            end = self.data.index(b"\0", strtab_off + name_off)
+            name = self.data[strtab_off + name_off:end].decode()
+            self.sections[name] = (addr, offset, size)
+
+    def section(self, name):
+        return self.sections.get(name)
+
+    def string_at(self, addr, within=None):
+        """NUL-terminated string at a kernel address, or None."""
+        for name, (start, offset, size) in self.sections.items():
+            if within is not None and name != within:
+                continue
+            if start <= addr < start + size:
+                pos = offset + addr - start
+                end = self.data.find(b"\0", pos, offset + size)
+                if end < 0:
+                    return None
+                return self.data[pos:end].decode("latin-1")
+        return None
+
+
+def format_event(elf, fmt, args):
+    """Apply a kernel format string to raw 32-bit arguments."""
+    out = []
+    pos = 0
+    argi = 0
+
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, _, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if argi >= len(args):
+            out.append(m.group(0))
+            continue
+
+        value = args[argi]
+        argi += 1
+        spec = "%" + flags + width + ("." + prec if prec else "")
+        if conv == "d":
+            out.append((spec + "d") % (value - (1 << 32)
+                                       if value & 0x80000000 else value))
+        elif conv == "u":
+            out.append((spec + "d") % value)
+        elif conv in "xX":
+            out.append((spec + conv) % value)
+        elif conv == "c":
+            out.append((spec + "c") % chr(value & 0xFF))
+        elif conv == "p":
+            out.append("0x%08x" % value)
+        else:
+            s = elf.string_at(value)
+            out.append((spec + "s") % (s if s is not None
+                                       else "(bad string 0x%08x)" % value))
+
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode(elf, dump, out):
+    """Decode every dump in @dump; returns the number of events."""
+    fmt_sec = elf.section(".trace_fmt")
+    if fmt_sec is None:
+        raise ValueError("kernel.elf has no .trace_fmt section")
+
+    total = 0
+    magic = struct.pack("<I", TRACE_DUMP_MAGIC)
+    pos = dump.find(magic)
+    while pos >= 0 and pos + HEADER.size <= len(dump):
+        (_, version, event_size, count, lost, tsc_khz,
+         fmt_start) = HEADER.unpack_from(dump, pos)
+        pos += HEADER.size
+
+        if version != TRACE_DUMP_VERSION or event_size != EVENT.size:
+            print(f"skipping dump: version {version}, "
+                  f"event size {event_size}", file=sys.stderr)
+            pos = dump.find(magic, pos)
+            continue
+        if fmt_start != fmt_sec[0]:
+            print("warning: dump is from a different kernel build "
+                  f"(.trace_fmt at 0x{fmt_start:x}, "
+                  f"ELF has 0x{fmt_sec[0]:x})", file=sys.stderr)
+
+        print(f"# {count} events, {lost} lost, TSC "
+              f"{tsc_khz} kHz" if tsc_khz else
+              f"# {count} events, {lost} lost, TSC rate unknown", file=out)
+
+        first_tsc = None
+        for _ in range(count):
+            if pos + EVENT.size > len(dump):
+                print("# dump truncated", file=out)
+                break
+            tsc, fmt, nargs, cpu, _, *args = EVENT.unpack_from(dump, pos)
+            pos += EVENT.size
+
+            if first_tsc is None:
+                first_tsc = tsc
+            delta = tsc - first_tsc
+            if tsc_khz:
+                stamp = "%14.3f us" % (delta * 1000.0 / tsc_khz)
+            else:
+                stamp = "%14d cyc" % delta
+
+            text = elf.string_at(fmt, within=".trace_fmt")
+            if text is None:
+                text = f"<bad format 0x{fmt:08x}>"
+            else:
+                text = format_event(elf, text, args[:min(nargs, 4)])
+            print(f"[{stamp}] cpu{cpu} {text}", file=out)
+            total += 1
+
+        pos = dump.find(magic, pos)
+    return total
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(f"usage: {argv[0]} kernel.elf trace.bin", file=sys.stderr)
+        return 2
+
+    try:
+        elf = Elf(argv[1])
+        with open(argv[2], "rb") as f:
+            dump = f.read()
+        if decode(elf, dump, sys.stdout) == 0:
+            print("no trace events found", file=sys.stderr)
+            return 1
+    except (OSError, ValueError) as e:
+        print(f"{argv[0]}: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,75 @@
+/*
+ * tests/host/test_apic.c - Host-side tests for IOAPIC redirection entries
+ *
+ * Tests the ACTUAL kernel ioapic_redir_entry implementation against the
+ * layout in the 82093AA I/O APIC datasheet, Section 3.2.4.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <apic.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * Test default ISA routing: fixed, physical, edge, active high
+ */
+void test_edge_high_entry(void)
+{
+    uint64_t entry = ioapic_redir_entry(0x21, 0, 0);
+
+    TEST_ASSERT_EQUAL_HEX32(0x00000021, (uint32_t)entry);
+    TEST_ASSERT_EQUAL_HEX32(0, (uint32_t)(entry >> 32));
+}
+
+/*
+ * Test destination APIC ID lands in bits 56-63
+ */
+void test_destination(void)
+{
+    uint64_t entry = ioapic_redir_entry(0x30, 0xA5, 0);
+
+    TEST_ASSERT_EQUAL_HEX32(0xA5000000, (uint32_t)(entry >> 32));
+}
+
+/*
+ * Test polarity, trigger and mask bits
+ */
+void test_flag_bits(void)
+{
+    uint64_t entry = ioapic_redir_entry(0x2B, 1,
+                                        IOAPIC_ACTIVE_LOW | IOAPIC_LEVEL |
+                                        IOAPIC_MASKED);
+
+    TEST_ASSERT_EQUAL_HEX32(0x0001A02B, (uint32_t)entry);
+    TEST_ASSERT_EQUAL_HEX32(0x01000000, (uint32_t)(entry >> 32));
+}
+
+/*
+ * Test unknown flag bits cannot change delivery or destination mode
+ */
+void test_ignores_other_flags(void)
+{
+    uint64_t entry = ioapic_redir_entry(0x40, 0, 0x00000F00);
+
+    TEST_ASSERT_EQUAL_HEX32(0x00000040, (uint32_t)entry);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_edge_high_entry);
+    RUN_TEST(test_destination);
+    RUN_TEST(test_flag_bits);
+    RUN_TEST(test_ignores_other_flags);
+
+    return UNITY_END();
+}
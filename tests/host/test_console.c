@@ -0,0 +1,254 @@
+/*
+ * tests/host/test_console.c - Host-side tests for the console registry
+ *
+ * Tests registration, per-console level filtering and enable/disable
+ * (kernel/lib/console.c) using the ACTUAL kernel code, with stub
+ * consoles that record what they were given.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <string.h>
+#include <errno.h>
+#include <console.h>
+#include <printk.h>
+
+#define STUB_BUF_SIZE   128
+
+struct stub {
+    struct console con;                 /* First, so a console is a stub */
+    char buf[STUB_BUF_SIZE];
+    size_t len;
+    unsigned int calls;
+    unsigned int flushes;
+    size_t flushed_len;                 /* len at the last flush */
+};
+
+/* Order in which stubs were written, by first letter of the name */
+static char order[16];
+static size_t order_len;
+
+static void stub_write(struct console *con, const char *text, size_t len)
+{
+    struct stub *s = (struct stub *)con;
+
+    if (s->len + len < STUB_BUF_SIZE) {
+        memcpy(&s->buf[s->len], text, len);
+        s->len += len;
+        s->buf[s->len] = '\0';
+    }
+    s->calls++;
+    if (order_len < sizeof(order) - 1) {
+        order[order_len++] = con->name[0];
+    }
+}
+
+static void stub_flush(struct console *con)
+{
+    struct stub *s = (struct stub *)con;
+
+    s->flushes++;
+    s->flushed_len = s->len;
+}
+
+static struct stub a, b, c;
+
+static void stub_init(struct stub *s, const char *name, int level)
+{
+    memset(s, 0, sizeof(*s));
+    s->con.name = name;
+    s->con.write = stub_write;
+    s->con.level = level;
+    s->con.enabled = true;
+}
+
+void setUp(void)
+{
+    stub_init(&a, "alpha", LOG_DEBUG);
+    stub_init(&b, "beta", LOG_WARN);
+    stub_init(&c, "gamma", LOG_INFO);
+    memset(order, 0, sizeof(order));
+    order_len = 0;
+}
+
+void tearDown(void)
+{
+    console_unregister(&a.con);
+    console_unregister(&b.con);
+    console_unregister(&c.con);
+}
+
+/*
+ * =============================================================================
+ * Registration
+ * =============================================================================
+ */
+
+void test_register_and_find(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, console_register(&a.con));
+    TEST_ASSERT_EQUAL_INT(0, console_register(&b.con));
+
+    TEST_ASSERT_EQUAL_PTR(&a.con, console_find("alpha"));
+    TEST_ASSERT_EQUAL_PTR(&b.con, console_find("beta"));
+    TEST_ASSERT_NULL(console_find("gamma"));
+    TEST_ASSERT_NULL(console_find("alph"));
+    TEST_ASSERT_NULL(console_find("alphabet"));
+}
+
+void test_register_rejects_duplicates_and_incomplete(void)
+{
+    struct stub dup;
+
+    stub_init(&dup, "alpha", LOG_DEBUG);
+    TEST_ASSERT_EQUAL_INT(0, console_register(&a.con));
+    TEST_ASSERT_EQUAL_INT(-EEXIST, console_register(&a.con));
+    TEST_ASSERT_EQUAL_INT(-EEXIST, console_register(&dup.con));
+
+    TEST_ASSERT_EQUAL_INT(-EINVAL, console_register(NULL));
+    c.con.write = NULL;
+    TEST_ASSERT_EQUAL_INT(-EINVAL, console_register(&c.con));
+    c.con.write = stub_write;
+    c.con.name = NULL;
+    TEST_ASSERT_EQUAL_INT(-EINVAL, console_register(&c.con));
+}
+
+void test_write_in_registration_order(void)
+{
+    console_register(&b.con);
+    console_register(&a.con);
+    console_register(&c.con);
+
+    TEST_ASSERT_EQUAL_UINT32(3, console_write(LOG_ERROR, NULL, "x", 1));
+    TEST_ASSERT_EQUAL_STRING("bag", order);
+}
+
+void test_unregister_middle_keeps_the_rest(void)
+{
+    console_register(&a.con);
+    console_register(&b.con);
+    console_register(&c.con);
+    console_unregister(&b.con);
+
+    TEST_ASSERT_NULL(console_find("beta"));
+    TEST_ASSERT_EQUAL_UINT32(2, console_write(LOG_ERROR, NULL, "x", 1));
+    TEST_ASSERT_EQUAL_STRING("ag", order);
+
+    /* Unregistering twice, or something never registered, is harmless */
+    console_unregister(&b.con);
+    TEST_ASSERT_EQUAL_INT(0, console_register(&b.con));
+}
+
+/*
+ * =============================================================================
+ * Filtering
+ * =============================================================================
+ */
+
+void test_level_filters_each_console(void)
+{
+    console_register(&a.con);
+    console_register(&b.con);
+    console_register(&c.con);
+
+    TEST_ASSERT_EQUAL_UINT32(1, console_write(LOG_DEBUG, NULL, "d", 1));
+    TEST_ASSERT_EQUAL_UINT32(2, console_write(LOG_INFO, NULL, "i", 1));
+    TEST_ASSERT_EQUAL_UINT32(3, console_write(LOG_WARN, NULL, "w", 1));
+
+    TEST_ASSERT_EQUAL_STRING("diw", a.buf);
+    TEST_ASSERT_EQUAL_STRING("w", b.buf);
+    TEST_ASSERT_EQUAL_STRING("iw", c.buf);
+    TEST_ASSERT_EQUAL_UINT32(3, a.con.records);
+    TEST_ASSERT_EQUAL_UINT32(1, b.con.records);
+}
+
+void test_unleveled_records_reach_every_console(void)
+{
+    console_register(&a.con);
+    console_register(&b.con);
+
+    TEST_ASSERT_EQUAL_UINT32(2, console_write(-1, NULL, "raw", 3));
+    TEST_ASSERT_EQUAL_STRING("raw", b.buf);
+}
+
+void test_disabled_console_is_skipped(void)
+{
+    console_register(&a.con);
+    console_register(&b.con);
+
+    console_set_enabled(&a.con, false);
+    TEST_ASSERT_EQUAL_UINT32(1, console_write(LOG_ERROR, NULL, "e", 1));
+    TEST_ASSERT_EQUAL_UINT(0, a.calls);
+    TEST_ASSERT_EQUAL_UINT32(0, a.con.records);
+
+    console_set_enabled(&a.con, true);
+    TEST_ASSERT_EQUAL_UINT32(2, console_write(LOG_ERROR, NULL, "e", 1));
+    console_set_enabled(NULL, false);
+}
+
+void test_set_level(void)
+{
+    console_register(&a.con);
+
+    TEST_ASSERT_EQUAL_INT(0, console_set_level(&a.con, LOG_ERROR));
+    TEST_ASSERT_EQUAL_UINT32(0, console_write(LOG_WARN, NULL, "w", 1));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, console_set_level(&a.con, LOG_DEBUG + 1));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, console_set_level(&a.con, -1));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, console_set_level(NULL, LOG_INFO));
+    TEST_ASSERT_EQUAL_INT(LOG_ERROR, a.con.level);
+}
+
+void test_prefix_written_before_text(void)
+{
+    console_register(&a.con);
+
+    console_write(LOG_INFO, "[INFO]  ", "hello\n", 6);
+    TEST_ASSERT_EQUAL_STRING("[INFO]  hello\n", a.buf);
+    TEST_ASSERT_EQUAL_UINT(2, a.calls);
+
+    /* An empty prefix costs no call */
+    console_write(LOG_INFO, "", "x", 1);
+    TEST_ASSERT_EQUAL_UINT(3, a.calls);
+}
+
+void test_flush_once_per_record(void)
+{
+    a.con.flush = stub_flush;
+    console_register(&a.con);
+    console_register(&b.con);
+
+    console_write(LOG_ERROR, "[ERROR] ", "one\n", 4);
+    TEST_ASSERT_EQUAL_UINT(1, a.flushes);
+    TEST_ASSERT_EQUAL_size_t(a.len, a.flushed_len);
+
+    /* Filtered records are not flushed; consoles without flush() work */
+    console_write(LOG_DEBUG, NULL, "two\n", 4);
+    TEST_ASSERT_EQUAL_UINT(2, a.flushes);
+    b.con.level = LOG_DEBUG;
+    a.con.level = LOG_ERROR;
+    console_write(LOG_DEBUG, NULL, "three\n", 6);
+    TEST_ASSERT_EQUAL_UINT(2, a.flushes);
+    TEST_ASSERT_EQUAL_STRING("three\n", b.buf + b.len - 6);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Registration */
+    RUN_TEST(test_register_and_find);
+    RUN_TEST(test_register_rejects_duplicates_and_incomplete);
+    RUN_TEST(test_write_in_registration_order);
+    RUN_TEST(test_unregister_middle_keeps_the_rest);
+
+    /* Filtering */
+    RUN_TEST(test_level_filters_each_console);
+    RUN_TEST(test_unleveled_records_reach_every_console);
+    RUN_TEST(test_disabled_console_is_skipped);
+    RUN_TEST(test_set_level);
+    RUN_TEST(test_prefix_written_before_text);
+    RUN_TEST(test_flush_once_per_record);
+
+    return UNITY_END();
+}
@@ -0,0 +1,452 @@
+/*
+ * tests/host/test_fbcon.c - Host-side tests for the framebuffer console
+ *
+ * Tests the text renderer (kernel/drivers/fbcon.c) using the ACTUAL
+ * kernel code, drawing into a framebuffer in RAM with a synthetic
+ * font: every pixel is checked against the font and the VGA palette,
+ * through wrapping, scrolling and more color pairs than the glyph
+ * cache holds. The pitch is padded, and the padding must stay as it
+ * was. The benchmark times fbcon_write() against drawing each pixel
+ * from the font bits.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fbcon.h>
+#include <vga.h>
+
+#define FB_WIDTH        640
+#define FB_HEIGHT       488             /* 30 rows and 8 spare lines */
+#define FB_PAD          64              /* Bytes past each scan line */
+#define FB_PITCH        (FB_WIDTH * 4 + FB_PAD)
+#define FB_COLS         (FB_WIDTH / 8)
+#define FB_ROWS         (FB_HEIGHT / 16)
+#define SENTINEL        0xDEADBEEFU
+
+#define BENCH_CHARS     200000
+
+static uint32_t fb_mem[FB_PITCH * FB_HEIGHT / 4];
+static uint8_t font[256 * 16];
+static struct fb_info info;
+
+/* Expected screen contents: character and attribute per cell */
+static uint16_t model[FB_ROWS][FB_COLS];
+
+static const uint32_t vga_rgb[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA,
+    0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF,
+    0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+void setUp(void)
+{
+    uint32_t i;
+
+    /* Every glyph different, except a blank space */
+    for (i = 0; i < 256 * 16; i++) {
+        font[i] = (uint8_t)((i / 16) ^ (i % 16) * 37);
+    }
+    memset(&font[' ' * 16], 0, 16);
+    for (i = 0; i < sizeof(fb_mem) / 4; i++) {
+        fb_mem[i] = SENTINEL;
+    }
+
+    /* XRGB8888, as QEMU's std VGA reports it */
+    info.base = (uint8_t *)fb_mem;
+    info.pitch = FB_PITCH;
+    info.width = FB_WIDTH;
+    info.height = FB_HEIGHT;
+    info.red_pos = 16;
+    info.red_size = 8;
+    info.green_pos = 8;
+    info.green_size = 8;
+    info.blue_pos = 0;
+    info.blue_size = 8;
+    info.font = font;
+
+    fbcon_set_attr(VGA_COLOR_DEFAULT);
+    TEST_ASSERT_EQUAL(0, fbcon_setup(&info));
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t pixel_at(uint32_t x, uint32_t y)
+{
+    return fb_mem[(y * FB_PITCH) / 4 + x];
+}
+
+/* Check one cell against the font, or return the first bad pixel */
+static int cell_matches(uint32_t row, uint32_t col, uint16_t cell)
+{
+    const uint8_t *bits = &font[(cell & 0xFF) * 16];
+    uint32_t fg = vga_rgb[(cell >> 8) & 0x0F];
+    uint32_t bg = vga_rgb[cell >> 12];
+    uint32_t x, y;
+
+    for (y = 0; y < 16; y++) {
+        for (x = 0; x < 8; x++) {
+            uint32_t want = (bits[y] & (0x80 >> x)) ? fg : bg;
+
+            if (pixel_at(col * 8 + x, row * 16 + y) != want) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Every cell matches the model, and the padding is untouched */
+static void assert_screen(void)
+{
+    uint32_t row, col, y, i;
+
+    for (row = 0; row < FB_ROWS; row++) {
+        for (col = 0; col < FB_COLS; col++) {
+            if (!cell_matches(row, col, model[row][col])) {
+                char msg[48];
+
+                snprintf(msg, sizeof(msg), "cell %u,%u", row, col);
+                TEST_FAIL_MESSAGE(msg);
+            }
+        }
+    }
+    for (y = 0; y < FB_HEIGHT; y++) {
+        for (i = 0; i < FB_PAD / 4; i++) {
+            TEST_ASSERT_EQUAL_HEX32(SENTINEL, pixel_at(FB_WIDTH + i, y));
+        }
+    }
+}
+
+static void model_clear(uint8_t attr)
+{
+    uint32_t row, col;
+
+    for (row = 0; row < FB_ROWS; row++) {
+        for (col = 0; col < FB_COLS; col++) {
+            model[row][col] = (uint16_t)(attr << 8) | ' ';
+        }
+    }
+}
+
+/* Apply text to the model the way fbcon_write() should */
+static uint32_t m_row, m_col;
+
+static void model_write(const char *s, uint8_t attr)
+{
+    for (; *s; s++) {
+        if (*s == '\n') {
+            m_col = 0;
+            m_row++;
+        } else if (*s == '\r') {
+            m_col = 0;
+        } else {
+            model[m_row][m_col] = (uint16_t)(attr << 8) | (uint8_t)*s;
+            if (++m_col == FB_COLS) {
+                m_col = 0;
+                m_row++;
+            }
+        }
+        if (m_row == FB_ROWS) {
+            memmove(model[0], model[1], sizeof(model) - sizeof(model[0]));
+            for (uint32_t col = 0; col < FB_COLS; col++) {
+                model[FB_ROWS - 1][col] = (uint16_t)(attr << 8) | ' ';
+            }
+            m_row = FB_ROWS - 1;
+        }
+    }
+}
+
+static void both_write(const char *s, uint8_t attr)
+{
+    fbcon_set_attr(attr);
+    fbcon_write(s, strlen(s));
+    model_write(s, attr);
+}
+
+static void model_reset(void)
+{
+    model_clear(VGA_COLOR_DEFAULT);
+    m_row = 0;
+    m_col = 0;
+}
+
+/*
+ * =============================================================================
+ * Tests
+ * =============================================================================
+ */
+
+void test_setup_rejects_bad_info(void)
+{
+    struct fb_info bad = info;
+
+    bad.font = NULL;
+    TEST_ASSERT_EQUAL(-EINVAL, fbcon_setup(&bad));
+    bad = info;
+    bad.width = 7;
+    TEST_ASSERT_EQUAL(-EINVAL, fbcon_setup(&bad));
+    bad = info;
+    bad.height = 15;
+    TEST_ASSERT_EQUAL(-EINVAL, fbcon_setup(&bad));
+}
+
+void test_geometry(void)
+{
+    TEST_ASSERT_TRUE(fbcon_active());
+    TEST_ASSERT_EQUAL_UINT32(FB_COLS, fbcon_cols());
+    TEST_ASSERT_EQUAL_UINT32(FB_ROWS, fbcon_rows());
+}
+
+void test_setup_clears_to_black(void)
+{
+    uint32_t y;
+
+    model_reset();
+    assert_screen();
+
+    /* Lines below the last row are black too */
+    for (y = FB_ROWS * 16; y < FB_HEIGHT; y++) {
+        TEST_ASSERT_EQUAL_HEX32(0, pixel_at(0, y));
+        TEST_ASSERT_EQUAL_HEX32(0, pixel_at(FB_WIDTH - 1, y));
+    }
+}
+
+void test_glyph_pixels(void)
+{
+    model_reset();
+    both_write("Hello", VGA_COLOR_DEFAULT);
+    both_write(" world\n", 0x1F);
+    both_write("\x01\x80\xFF", 0x4E);
+    assert_screen();
+}
+
+void test_palette_layout(void)
+{
+    /* Blue-first layout with 6-bit fields, e.g. a BGR mode */
+    info.red_pos = 0;
+    info.red_size = 6;
+    info.green_pos = 8;
+    info.green_size = 6;
+    info.blue_pos = 16;
+    info.blue_size = 6;
+    TEST_ASSERT_EQUAL(0, fbcon_setup(&info));
+
+    fbcon_set_attr(0x0C);
+    fbcon_write("\xFF", 1);
+
+    /* font[0xFF * 16] = 0xFF: the top row is all foreground */
+    TEST_ASSERT_EQUAL_HEX32((0xFF >> 2) | (0x55 >> 2) << 8 | (0x55 >> 2) << 16,
+                            pixel_at(0, 0));
+}
+
+void test_carriage_return_overwrites(void)
+{
+    model_reset();
+    both_write("abcdef\rXY", 0x02);
+    assert_screen();
+}
+
+void test_wrap_and_scroll(void)
+{
+    char line[FB_COLS + 8];
+    uint32_t i;
+
+    model_reset();
+    for (i = 0; i < FB_ROWS + 7; i++) {
+        snprintf(line, sizeof(line), "line %u\n", i);
+        both_write(line, (uint8_t)(i & 0x7F));
+    }
+
+    /* Wraps: exactly one line, and one over */
+    memset(line, 'w', FB_COLS);
+    line[FB_COLS] = '\0';
+    both_write(line, 0x07);
+    both_write(line, 0x70);
+    both_write("!", 0x07);
+    assert_screen();
+}
+
+void test_scroll_whole_screen_in_one_write(void)
+{
+    static char text[FB_ROWS * 3 * 8];
+    char *p = text;
+    uint32_t i;
+
+    model_reset();
+    both_write("before", 0x07);
+
+    /* More lines than the screen holds before a single flush */
+    for (i = 0; i < FB_ROWS * 2; i++) {
+        p += sprintf(p, "%u\n", i);
+    }
+    both_write(text, 0x03);
+    assert_screen();
+}
+
+void test_cache_many_attributes(void)
+{
+    uint32_t a;
+    char s[2] = { 0, 0 };
+
+    model_reset();
+
+    /* Far more color pairs than FBCON_CACHE_ATTRS, revisited */
+    for (a = 0; a < 3 * 256; a++) {
+        s[0] = (char)('A' + a % 26);
+        both_write(s, (uint8_t)(a * 7));
+    }
+    assert_screen();
+}
+
+void test_clear_uses_background(void)
+{
+    model_reset();
+    both_write("text", 0x07);
+    fbcon_set_attr(0x10);
+    fbcon_clear();
+    model_clear(0x10);
+    m_row = 0;
+    m_col = 0;
+    assert_screen();
+
+    both_write("after", 0x1E);
+    assert_screen();
+}
+
+/*
+ * =============================================================================
+ * Benchmark
+ * =============================================================================
+ */
+
+/*
+ * Reference renderer: test each font bit as the pixel is drawn, and
+ * scroll by moving the framebuffer up a row, a pixel at a time, for
+ * every line.
+ */
+static uint32_t ref_row, ref_col;
+
+static void ref_newline(uint32_t bg)
+{
+    uint32_t i;
+
+    ref_col = 0;
+    if (++ref_row < FB_ROWS) {
+        return;
+    }
+    ref_row = FB_ROWS - 1;
+    for (i = 0; i < (FB_ROWS - 1) * 16 * FB_PITCH / 4; i++) {
+        fb_mem[i] = fb_mem[i + 16 * FB_PITCH / 4];
+    }
+    for (i = 0; i < 16 * FB_PITCH / 4; i++) {
+        fb_mem[(ref_row * 16 * FB_PITCH) / 4 + i] = bg;
+    }
+}
+
+static void ref_write(const char *s, size_t len, uint32_t fg, uint32_t bg)
+{
+    while (len--) {
+        const uint8_t *bits = &font[(uint8_t)*s * 16];
+        uint32_t x, y;
+
+        if (*s++ == '\n') {
+            ref_newline(bg);
+            continue;
+        }
+        for (y = 0; y < 16; y++) {
+            for (x = 0; x < 8; x++) {
+                fb_mem[((ref_row * 16 + y) * FB_PITCH) / 4 + ref_col * 8 + x] =
+                    (bits[y] & (0x80 >> x)) ? fg : bg;
+            }
+        }
+        if (++ref_col == FB_COLS) {
+            ref_newline(bg);
+        }
+    }
+}
+
+static double elapsed_ns(clock_t start, uint32_t ops)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ops;
+}
+
+/*
+ * Time writing @text over and over, BENCH_CHARS characters in all,
+ * from a cleared screen each time if @clear
+ */
+static double bench(const char *text, int ref, int clear)
+{
+    uint32_t len = strlen(text);
+    uint32_t i, j, n = BENCH_CHARS / len;
+    clock_t t = clock();
+
+    for (i = 0; i < n; i++) {
+        if (clear && ref) {
+            for (j = 0; j < sizeof(fb_mem) / 4; j++) {
+                fb_mem[j] = 0;
+            }
+            ref_row = 0;
+            ref_col = 0;
+        } else if (clear) {
+            fbcon_clear();
+        }
+        if (ref) {
+            ref_write(text, len, 0xAAAAAA, 0);
+        } else {
+            fbcon_write(text, len);
+        }
+    }
+    return elapsed_ns(t, n * len);
+}
+
+void test_benchmark_fbcon(void)
+{
+    static const char line[] =
+        "[    1.234567] [INFO] PMM: 32512 pages free, 127 MB\n";
+    static const char word[] = "pages ";
+    static char screen[(FB_ROWS - 1) * FB_COLS + 1];
+
+    memset(screen, 'x', sizeof(screen) - 1);
+
+    printf("\n  ns/char, per-pixel font test vs fbcon_write:\n");
+    printf("    log lines (a scroll each): %.1f vs %.1f\n",
+           bench(line, 1, 0), bench(line, 0, 0));
+    printf("    wrapped text (a scroll per %u chars): %.1f vs %.1f\n",
+           FB_COLS, bench(word, 1, 0), bench(word, 0, 0));
+    printf("    cleared screens of text: %.1f vs %.1f\n",
+           bench(screen, 1, 1), bench(screen, 0, 1));
+
+    TEST_ASSERT_TRUE(fbcon_active());
+}
+
+/*
+ * Main test runner
+ */
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_setup_rejects_bad_info);
+    RUN_TEST(test_geometry);
+    RUN_TEST(test_setup_clears_to_black);
+    RUN_TEST(test_glyph_pixels);
+    RUN_TEST(test_palette_layout);
+    RUN_TEST(test_carriage_return_overwrites);
+    RUN_TEST(test_wrap_and_scroll);
+    RUN_TEST(test_scroll_whole_screen_in_one_write);
+    RUN_TEST(test_cache_many_attributes);
+    RUN_TEST(test_clear_uses_background);
+
+    /* Benchmark */
+    RUN_TEST(test_benchmark_fbcon);
+
+    return UNITY_END();
+}
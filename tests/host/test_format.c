@@ -4,13 +4,62 @@
  * Tests the pure string formatting functions used by printk.
  * These run on the development host using Unity framework.
  *
+ * The division-free conversions are checked against a plain
+ * divide-per-digit reference (the previous implementation), which the
+ * benchmark also times them against.
+ *
  * Build: make (in tests/ directory)
  * Run: ./test_format
  */
 
 #include "unity/unity.h"
 #include <format.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#define BENCH_NUMBERS   1000000
+
+/*
+ * ref_format - Divide-per-digit conversion, as format_unsigned() was
+ */
+static int ref_format(char *buf, uint64_t num, int base, int uppercase)
+{
+    const char *digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[24];
+    char *p = tmp + sizeof(tmp);
+    int len = 0;
+
+    do {
+        *--p = digits[num % base];
+        num /= base;
+    } while (num > 0);
+
+    while (p < tmp + sizeof(tmp)) {
+        buf[len++] = *p++;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+/* xorshift64: repeatable values spread over every magnitude */
+static uint64_t rng_state;
+
+static uint64_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* A random value of random bit length, so short numbers are covered */
+static uint64_t rng_value(void)
+{
+    uint64_t v = rng();
+
+    return v >> (rng() & 63);
+}
 
 void setUp(void)
 {
@@ -186,6 +235,159 @@ void test_format_pointer_small_buffer(void)
     TEST_ASSERT_EQUAL_STRING("0xdea", buf);
 }
 
+/*
+ * =============================================================================
+ * format_u64 / format_s64 tests
+ * =============================================================================
+ */
+
+void test_format_u64_max(void)
+{
+    char buf[24];
+    int len = format_u64(buf, sizeof(buf), 18446744073709551615ULL, 10, 0);
+    TEST_ASSERT_EQUAL_STRING("18446744073709551615", buf);
+    TEST_ASSERT_EQUAL_INT(20, len);
+}
+
+void test_format_u64_chunk_boundaries(void)
+{
+    char buf[24];
+
+    /* Just past 32 bits, and either side of each 8-digit chunk */
+    format_u64(buf, sizeof(buf), 4294967296ULL, 10, 0);
+    TEST_ASSERT_EQUAL_STRING("4294967296", buf);
+    format_u64(buf, sizeof(buf), 9999999999999999ULL, 10, 0);
+    TEST_ASSERT_EQUAL_STRING("9999999999999999", buf);
+    format_u64(buf, sizeof(buf), 10000000000000000ULL, 10, 0);
+    TEST_ASSERT_EQUAL_STRING("10000000000000000", buf);
+    format_u64(buf, sizeof(buf), 100000000000000001ULL, 10, 0);
+    TEST_ASSERT_EQUAL_STRING("100000000000000001", buf);
+}
+
+void test_format_u64_hex(void)
+{
+    char buf[24];
+
+    format_u64(buf, sizeof(buf), 0xFEDCBA9876543210ULL, 16, 0);
+    TEST_ASSERT_EQUAL_STRING("fedcba9876543210", buf);
+    format_u64(buf, sizeof(buf), 0x100000000ULL, 16, 1);
+    TEST_ASSERT_EQUAL_STRING("100000000", buf);
+}
+
+void test_format_u64_octal(void)
+{
+    char buf[24];
+    int len = format_u64(buf, sizeof(buf), 18446744073709551615ULL, 8, 0);
+    TEST_ASSERT_EQUAL_STRING("1777777777777777777777", buf);
+    TEST_ASSERT_EQUAL_INT(22, len);
+}
+
+void test_format_u64_small_buffer(void)
+{
+    char buf[6];
+    int len = format_u64(buf, sizeof(buf), 12345678901ULL, 10, 0);
+    TEST_ASSERT_EQUAL_INT(5, len);
+    TEST_ASSERT_EQUAL_STRING("12345", buf);
+}
+
+void test_format_s64_extremes(void)
+{
+    char buf[24];
+    int len;
+
+    len = format_s64(buf, sizeof(buf), (int64_t)0x8000000000000000ULL);
+    TEST_ASSERT_EQUAL_STRING("-9223372036854775808", buf);
+    TEST_ASSERT_EQUAL_INT(20, len);
+    format_s64(buf, sizeof(buf), 9223372036854775807LL);
+    TEST_ASSERT_EQUAL_STRING("9223372036854775807", buf);
+    format_s64(buf, sizeof(buf), -1);
+    TEST_ASSERT_EQUAL_STRING("-1", buf);
+}
+
+void test_format_u64_matches_reference(void)
+{
+    char buf[24], ref[24];
+    uint64_t v;
+    uint32_t i;
+
+    rng_state = 88172645463325252ULL;
+    for (i = 0; i < 200000; i++) {
+        v = rng_value();
+        ref_format(ref, v, 10, 0);
+        format_u64(buf, sizeof(buf), v, 10, 0);
+        TEST_ASSERT_EQUAL_STRING(ref, buf);
+
+        ref_format(ref, v, 16, 1);
+        format_u64(buf, sizeof(buf), v, 16, 1);
+        TEST_ASSERT_EQUAL_STRING(ref, buf);
+
+        ref_format(ref, (uint32_t)v, 10, 0);
+        format_unsigned(buf, sizeof(buf), (uint32_t)v, 10, 0);
+        TEST_ASSERT_EQUAL_STRING(ref, buf);
+    }
+}
+
+/*
+ * =============================================================================
+ * Benchmark
+ * =============================================================================
+ */
+
+static double elapsed_ns(clock_t start, uint32_t ops)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ops;
+}
+
+/* Time one conversion over BENCH_NUMBERS values from @values */
+static double bench(const uint64_t *values, int which, int base,
+                    unsigned long *sink)
+{
+    char buf[24];
+    clock_t t = clock();
+    uint32_t i;
+
+    for (i = 0; i < BENCH_NUMBERS; i++) {
+        switch (which) {
+        case 0:
+            *sink += ref_format(buf, values[i], base, 0);
+            break;
+        case 1:
+            *sink += format_u64(buf, sizeof(buf), values[i], base, 0);
+            break;
+        default:
+            *sink += format_unsigned(buf, sizeof(buf), (uint32_t)values[i],
+                                     base, 0);
+            break;
+        }
+        *sink += (unsigned char)buf[0];
+    }
+    return elapsed_ns(t, BENCH_NUMBERS);
+}
+
+void test_benchmark_format(void)
+{
+    static uint64_t wide[BENCH_NUMBERS], narrow[BENCH_NUMBERS];
+    unsigned long sink = 0;
+    uint32_t i;
+
+    rng_state = 2463534242ULL;
+    for (i = 0; i < BENCH_NUMBERS; i++) {
+        wide[i] = rng_value();
+        narrow[i] = (uint32_t)rng_value();
+    }
+
+    printf("\n  ns/number over %d values of random length:\n",
+           BENCH_NUMBERS);
+    printf("    32-bit decimal: divide %.1f, format_unsigned %.1f\n",
+           bench(narrow, 0, 10, &sink), bench(narrow, 2, 10, &sink));
+    printf("    64-bit decimal: divide %.1f, format_u64 %.1f\n",
+           bench(wide, 0, 10, &sink), bench(wide, 1, 10, &sink));
+    printf("    64-bit hex:     divide %.1f, format_u64 %.1f\n",
+           bench(wide, 0, 16, &sink), bench(wide, 1, 16, &sink));
+
+    TEST_ASSERT_TRUE(sink != 0);
+}
+
 /*
  * Main test runner
  */
@@ -217,5 +419,17 @@ int main(void)
     RUN_TEST(test_format_pointer_max);
     RUN_TEST(test_format_pointer_small_buffer);
 
+    /* 64-bit tests */
+    RUN_TEST(test_format_u64_max);
+    RUN_TEST(test_format_u64_chunk_boundaries);
+    RUN_TEST(test_format_u64_hex);
+    RUN_TEST(test_format_u64_octal);
+    RUN_TEST(test_format_u64_small_buffer);
+    RUN_TEST(test_format_s64_extremes);
+    RUN_TEST(test_format_u64_matches_reference);
+
+    /* Benchmark */
+    RUN_TEST(test_benchmark_format);
+
     return UNITY_END();
 }
@@ -0,0 +1,237 @@
+/*
+ * tests/host/test_hrtimer.c - Host-side tests for hrtimers
+ *
+ * Tests the per-CPU hrtimer base (kernel/lib/hrtimer.c) on top of the
+ * red-black tree (kernel/lib/rbtree.c) using the ACTUAL kernel code:
+ * expiry order, the cached leftmost node, periodic restart, and the
+ * latency histogram buckets.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <hrtimer.h>
+
+static struct hrtimer_cpu_base base;
+
+#define POOL    2048
+static struct hrtimer pool[POOL];
+static int order[POOL];
+static int nfired;
+
+static enum hrtimer_restart record(struct hrtimer *timer)
+{
+    order[nfired++] = (int)(timer - pool);
+    return HRTIMER_NORESTART;
+}
+
+static void arm(int i, uint64_t expires)
+{
+    hrtimer_setup(&pool[i], record);
+    pool[i].expires = expires;
+    hrtimer_base_enqueue(&base, &pool[i]);
+}
+
+void setUp(void)
+{
+    hrtimer_base_init(&base);
+    nfired = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/*
+ * =============================================================================
+ * Base
+ * =============================================================================
+ */
+
+void test_empty_base(void)
+{
+    TEST_ASSERT_EQUAL_UINT64(KTIME_MAX, hrtimer_base_next(&base));
+    TEST_ASSERT_EQUAL_UINT64(KTIME_MAX, hrtimer_base_run(&base, 1000));
+    TEST_ASSERT_EQUAL_INT(0, nfired);
+}
+
+void test_enqueue_reports_new_earliest(void)
+{
+    hrtimer_setup(&pool[0], record);
+    pool[0].expires = 500;
+    TEST_ASSERT_TRUE(hrtimer_base_enqueue(&base, &pool[0]));
+
+    hrtimer_setup(&pool[1], record);
+    pool[1].expires = 700;
+    TEST_ASSERT_FALSE(hrtimer_base_enqueue(&base, &pool[1]));
+
+    hrtimer_setup(&pool[2], record);
+    pool[2].expires = 100;
+    TEST_ASSERT_TRUE(hrtimer_base_enqueue(&base, &pool[2]));
+
+    TEST_ASSERT_EQUAL_UINT64(100, hrtimer_base_next(&base));
+    TEST_ASSERT_EQUAL_UINT32(3, base.count);
+}
+
+void test_run_in_expiry_order_fifo_on_ties(void)
+{
+    arm(0, 300);
+    arm(1, 100);
+    arm(2, 200);
+    arm(3, 100);
+
+    TEST_ASSERT_EQUAL_UINT64(300, hrtimer_base_run(&base, 250));
+    TEST_ASSERT_EQUAL_INT(3, nfired);
+    TEST_ASSERT_EQUAL_INT(1, order[0]);
+    TEST_ASSERT_EQUAL_INT(3, order[1]);
+    TEST_ASSERT_EQUAL_INT(2, order[2]);
+    TEST_ASSERT_FALSE(hrtimer_active(&pool[1]));
+    TEST_ASSERT_TRUE(hrtimer_active(&pool[0]));
+}
+
+void test_remove_leftmost_updates_next(void)
+{
+    arm(0, 100);
+    arm(1, 200);
+
+    TEST_ASSERT_TRUE(hrtimer_base_remove(&base, &pool[0]));
+    TEST_ASSERT_FALSE(hrtimer_base_remove(&base, &pool[0]));
+    TEST_ASSERT_EQUAL_UINT64(200, hrtimer_base_next(&base));
+    TEST_ASSERT_TRUE(hrtimer_base_remove(&base, &pool[1]));
+    TEST_ASSERT_EQUAL_UINT64(KTIME_MAX, hrtimer_base_next(&base));
+}
+
+static uint32_t periodic_runs;
+
+static enum hrtimer_restart periodic(struct hrtimer *timer)
+{
+    periodic_runs++;
+    hrtimer_forward(timer, timer->expires, 1000);
+    return HRTIMER_RESTART;
+}
+
+void test_periodic_restart(void)
+{
+    periodic_runs = 0;
+    hrtimer_setup(&pool[0], periodic);
+    pool[0].expires = 1000;
+    hrtimer_base_enqueue(&base, &pool[0]);
+
+    TEST_ASSERT_EQUAL_UINT64(2000, hrtimer_base_run(&base, 1500));
+    TEST_ASSERT_EQUAL_UINT64(5000, hrtimer_base_run(&base, 4000));
+    TEST_ASSERT_EQUAL_UINT32(4, periodic_runs);
+    TEST_ASSERT_TRUE(hrtimer_active(&pool[0]));
+}
+
+void test_forward_counts_overruns(void)
+{
+    struct hrtimer t;
+
+    hrtimer_setup(&t, record);
+    t.expires = 1000;
+    TEST_ASSERT_EQUAL_UINT64(0, hrtimer_forward(&t, 999, 100));
+    TEST_ASSERT_EQUAL_UINT64(1, hrtimer_forward(&t, 1000, 100));
+    TEST_ASSERT_EQUAL_UINT64(1100, t.expires);
+    TEST_ASSERT_EQUAL_UINT64(5, hrtimer_forward(&t, 1550, 100));
+    TEST_ASSERT_EQUAL_UINT64(1600, t.expires);
+
+    /* Interval too wide for the 32-bit divide */
+    t.expires = 0;
+    TEST_ASSERT_EQUAL_UINT64(3, hrtimer_forward(&t, 10000000000ULL,
+                                                5000000000ULL));
+    TEST_ASSERT_EQUAL_UINT64(15000000000ULL, t.expires);
+}
+
+void test_random_against_sorted_order(void)
+{
+    uint64_t last = 0;
+    uint64_t now = 0;
+    int i;
+
+    rng_state = 777;
+    for (i = 0; i < POOL; i++) {
+        arm(i, rng() % 1000000);
+    }
+    /* Cancel a quarter */
+    for (i = 0; i < POOL; i += 4) {
+        TEST_ASSERT_TRUE(hrtimer_base_remove(&base, &pool[i]));
+    }
+
+    while (base.count != 0) {
+        now += 1 + rng() % 5000;
+        hrtimer_base_run(&base, now);
+    }
+
+    TEST_ASSERT_EQUAL_INT(POOL - POOL / 4, nfired);
+    for (i = 0; i < nfired; i++) {
+        TEST_ASSERT_TRUE(order[i] % 4 != 0);
+        TEST_ASSERT_TRUE(pool[order[i]].expires >= last);
+        last = pool[order[i]].expires;
+    }
+}
+
+/*
+ * =============================================================================
+ * Latency histogram
+ * =============================================================================
+ */
+
+void test_latency_buckets(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0, hrtimer_latency_bucket(0));
+    TEST_ASSERT_EQUAL_UINT32(0, hrtimer_latency_bucket(1023));
+    TEST_ASSERT_EQUAL_UINT32(1, hrtimer_latency_bucket(1024));
+    TEST_ASSERT_EQUAL_UINT32(1, hrtimer_latency_bucket(2047));
+    TEST_ASSERT_EQUAL_UINT32(2, hrtimer_latency_bucket(2048));
+    TEST_ASSERT_EQUAL_UINT32(22, hrtimer_latency_bucket(1ULL << 31));
+    TEST_ASSERT_EQUAL_UINT32(HRTIMER_HIST_BUCKETS - 1,
+                             hrtimer_latency_bucket(1ULL << 32));
+    TEST_ASSERT_EQUAL_UINT32(HRTIMER_HIST_BUCKETS - 1,
+                             hrtimer_latency_bucket(KTIME_MAX));
+}
+
+void test_run_records_lateness(void)
+{
+    arm(0, 1000);
+    arm(1, 1000);
+    arm(2, 5000);
+
+    hrtimer_base_run(&base, 1500);      /* 500 ns late, twice */
+    hrtimer_base_run(&base, 9000);      /* 4000 ns late */
+
+    TEST_ASSERT_EQUAL_UINT64(3, base.expiry.count);
+    TEST_ASSERT_EQUAL_UINT64(5000, base.expiry.total_ns);
+    TEST_ASSERT_EQUAL_UINT64(4000, base.expiry.max_ns);
+    TEST_ASSERT_EQUAL_UINT64(2, base.expiry.buckets[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, base.expiry.buckets[2]);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Base */
+    RUN_TEST(test_empty_base);
+    RUN_TEST(test_enqueue_reports_new_earliest);
+    RUN_TEST(test_run_in_expiry_order_fifo_on_ties);
+    RUN_TEST(test_remove_leftmost_updates_next);
+    RUN_TEST(test_periodic_restart);
+    RUN_TEST(test_forward_counts_overruns);
+    RUN_TEST(test_random_against_sorted_order);
+
+    /* Latency histogram */
+    RUN_TEST(test_latency_buckets);
+    RUN_TEST(test_run_records_lateness);
+
+    return UNITY_END();
+}
@@ -0,0 +1,567 @@
+/*
+ * tests/host/test_hugepage.c - Host-side tests for 4MB large pages
+ *
+ * Tests the frame allocator in kernel/mm/page.c and the large-page
+ * mapping walkers in kernel/mm/hugepage.c using the ACTUAL kernel
+ * implementations. Physical memory is simulated: frames come from a
+ * host page_array, and page table frames are backed by a static pool.
+ *
+ * The benchmark maps the same range with 4KB and with 4MB pages and
+ * replays one random access stream through a TLB model to count misses.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <stdio.h>
+#include <page.h>
+#include <hugepage.h>
+#include <errno.h>
+
+/*
+ * =============================================================================
+ * Simulated physical memory
+ * =============================================================================
+ */
+
+/* 64MB machine: low 640KB, BIOS hole, RAM from 1MB */
+static const struct e820_entry mem_map[] = {
+    { 0x00000000, 0x0009FC00, E820_USABLE, 0 },
+    { 0x0009FC00, 0x00060400, E820_RESERVED, 0 },
+    { 0x00100000, 0x03F00000, E820_USABLE, 0 },
+};
+#define MEM_FRAMES  0x4000
+
+static struct page pages[MEM_FRAMES];
+
+/* Page table storage, bound to a physical frame on first use */
+#define TABLE_POOL  64
+static uint32_t table_pool[TABLE_POOL][PT_ENTRIES];
+static uint32_t table_phys[TABLE_POOL];
+static uint32_t tables_used;
+
+static uint32_t host_alloc_frames(uint32_t order)
+{
+    struct page *pg = page_alloc(order);
+
+    return pg ? page_to_pfn(pg) << PAGE_SHIFT : 0;
+}
+
+static void host_free_frames(uint32_t phys, uint32_t order)
+{
+    (void)order;
+    page_free(pfn_to_page(phys >> PAGE_SHIFT));
+}
+
+static void host_split_frames(uint32_t phys, uint32_t order)
+{
+    (void)order;
+    page_split_block(pfn_to_page(phys >> PAGE_SHIFT));
+}
+
+static uint32_t *host_table_virt(uint32_t phys)
+{
+    for (uint32_t i = 0; i < tables_used; i++) {
+        if (table_phys[i] == phys) {
+            return table_pool[i];
+        }
+    }
+    TEST_ASSERT_TRUE_MESSAGE(tables_used < TABLE_POOL, "table pool full");
+    table_phys[tables_used] = phys;
+    return table_pool[tables_used++];
+}
+
+static const struct hugepage_ops host_ops = {
+    .alloc_frames = host_alloc_frames,
+    .free_frames = host_free_frames,
+    .split_frames = host_split_frames,
+    .table_virt = host_table_virt,
+    .flush = NULL,
+};
+
+/* Alternate backend whose 4KB allocations can be made to fail */
+static uint32_t small_allocs_left;
+
+static uint32_t limited_alloc_frames(uint32_t order)
+{
+    if (order == 0) {
+        if (small_allocs_left == 0) {
+            return 0;
+        }
+        small_allocs_left--;
+    }
+    return host_alloc_frames(order);
+}
+
+static const struct hugepage_ops limited_ops = {
+    .alloc_frames = limited_alloc_frames,
+    .free_frames = host_free_frames,
+    .split_frames = host_split_frames,
+    .table_virt = host_table_virt,
+    .flush = NULL,
+};
+
+static uint32_t pd[PT_ENTRIES];
+static struct hugepage_stats st;
+
+static uint32_t free_frames(void)
+{
+    uint32_t n = 0;
+
+    for (uint32_t pfn = 0; pfn < page_count; pfn++) {
+        const struct page *pg = &page_array[pfn];
+
+        if (pg->refcount == 0 &&
+            !(pg->flags & (PG_RESERVED | PG_HEAD | PG_TAIL))) {
+            n++;
+        }
+    }
+    return n;
+}
+
+#define VBASE   0x40000000U
+#define MB      0x100000U
+
+void setUp(void)
+{
+    page_array_build(pages, MEM_FRAMES, mem_map, 3);
+    page_array = pages;
+    page_count = MEM_FRAMES;
+    page_reserve_range(0, 0x100000);
+
+    tables_used = 0;
+    for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+        pd[i] = 0;
+    }
+    st.huge = 0;
+    st.small = 0;
+    st.splits = 0;
+    hugepage_enabled = true;
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * =============================================================================
+ * Frame allocator tests
+ * =============================================================================
+ */
+
+void test_alloc_single_frame(void)
+{
+    struct page *pg = page_alloc(0);
+
+    TEST_ASSERT_NOT_NULL(pg);
+    TEST_ASSERT_FALSE(pg->flags & PG_RESERVED);
+    TEST_ASSERT_TRUE(page_to_pfn(pg) >= 0x100);
+    TEST_ASSERT_EQUAL_UINT16(1, pg->refcount);
+
+    page_free(pg);
+    TEST_ASSERT_EQUAL_UINT16(0, pg->refcount);
+}
+
+void test_alloc_large_block_is_aligned(void)
+{
+    uint32_t before = free_frames();
+    struct page *pg = page_alloc(LARGE_PAGE_ORDER);
+    uint32_t pfn;
+
+    TEST_ASSERT_NOT_NULL(pg);
+    pfn = page_to_pfn(pg);
+    TEST_ASSERT_EQUAL_UINT32(0, pfn & (PT_ENTRIES - 1));
+    /* Slot 0 holds the reserved low 1MB, so it cannot be used */
+    TEST_ASSERT_TRUE(pfn >= PT_ENTRIES);
+    TEST_ASSERT_TRUE(pg->flags & PG_HEAD);
+    TEST_ASSERT_TRUE(pg[1].flags & PG_TAIL);
+    TEST_ASSERT_TRUE(pg[PT_ENTRIES - 1].flags & PG_TAIL);
+    TEST_ASSERT_EQUAL_UINT32(before - PT_ENTRIES, free_frames());
+
+    page_free(pg);
+    TEST_ASSERT_EQUAL_UINT32(before, free_frames());
+}
+
+void test_alloc_exhausts_large_blocks(void)
+{
+    /* 64MB has 15 free 4MB slots (slot 0 is partly reserved) */
+    for (int i = 0; i < 15; i++) {
+        TEST_ASSERT_NOT_NULL(page_alloc(LARGE_PAGE_ORDER));
+    }
+    TEST_ASSERT_NULL(page_alloc(LARGE_PAGE_ORDER));
+    TEST_ASSERT_NOT_NULL(page_alloc(0));
+}
+
+void test_split_block_frees_frames_individually(void)
+{
+    uint32_t before = free_frames();
+    struct page *pg = page_alloc(LARGE_PAGE_ORDER);
+
+    page_split_block(pg);
+    TEST_ASSERT_FALSE(pg->flags & PG_HEAD);
+    TEST_ASSERT_FALSE(pg[5].flags & PG_TAIL);
+    TEST_ASSERT_EQUAL_UINT16(1, pg[5].refcount);
+
+    page_free(&pg[5]);
+    TEST_ASSERT_EQUAL_UINT32(before - PT_ENTRIES + 1, free_frames());
+
+    for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+        if (i != 5) {
+            page_free(&pg[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(before, free_frames());
+}
+
+/*
+ * =============================================================================
+ * Mapping tests
+ * =============================================================================
+ */
+
+void test_map_aligned_range_uses_large_pages(void)
+{
+    uint32_t pde;
+
+    TEST_ASSERT_EQUAL_INT(0, hugepage_map(pd, VBASE, VBASE + 8 * MB,
+                                          PTE_WRITE | PTE_USER, &st,
+                                          &host_ops));
+    TEST_ASSERT_EQUAL_UINT32(2, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(0, st.small);
+
+    pde = pd[VBASE >> LARGE_PAGE_SHIFT];
+    TEST_ASSERT_TRUE(pde & PDE_LARGE);
+    TEST_ASSERT_TRUE(pde & PTE_PRESENT);
+    TEST_ASSERT_TRUE(pde & PTE_USER);
+    TEST_ASSERT_EQUAL_UINT32(0, pde & ~PDE_LARGE_MASK & 0xFFFFF000U);
+}
+
+void test_map_unaligned_range_mixes_sizes(void)
+{
+    /* 0x40001000-0x40801000: only 0x40400000-0x40800000 is a full slot */
+    TEST_ASSERT_EQUAL_INT(0, hugepage_map(pd, VBASE + 0x1000,
+                                          VBASE + 8 * MB + 0x1000,
+                                          PTE_WRITE, &st, &host_ops));
+    TEST_ASSERT_EQUAL_UINT32(1, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(PT_ENTRIES - 1 + 1, st.small);
+    TEST_ASSERT_FALSE(pd[VBASE >> LARGE_PAGE_SHIFT] & PDE_LARGE);
+    TEST_ASSERT_TRUE(pd[(VBASE >> LARGE_PAGE_SHIFT) + 1] & PDE_LARGE);
+    TEST_ASSERT_FALSE(pd[(VBASE >> LARGE_PAGE_SHIFT) + 2] & PDE_LARGE);
+}
+
+void test_map_disabled_uses_small_pages(void)
+{
+    hugepage_enabled = false;
+
+    TEST_ASSERT_EQUAL_INT(0, hugepage_map(pd, VBASE, VBASE + 4 * MB,
+                                          PTE_WRITE, &st, &host_ops));
+    TEST_ASSERT_EQUAL_UINT32(0, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(PT_ENTRIES, st.small);
+}
+
+void test_map_without_free_block_falls_back(void)
+{
+    struct page *pg = NULL;
+    struct page *last;
+
+    /* Take every 4MB block, then give one back minus its first frame */
+    while ((last = page_alloc(LARGE_PAGE_ORDER)) != NULL) {
+        pg = last;
+    }
+    page_split_block(pg);
+    for (uint32_t i = 1; i < PT_ENTRIES; i++) {
+        page_free(&pg[i]);
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, hugepage_map(pd, VBASE, VBASE + 4 * MB,
+                                          PTE_WRITE, &st, &host_ops));
+    TEST_ASSERT_EQUAL_UINT32(0, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(PT_ENTRIES, st.small);
+}
+
+void test_map_rejects_bad_ranges(void)
+{
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hugepage_map(pd, VBASE + 1, VBASE + MB,
+                                                0, &st, &host_ops));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hugepage_map(pd, VBASE, VBASE,
+                                                0, &st, &host_ops));
+}
+
+void test_map_overlap_rolls_back(void)
+{
+    uint32_t before;
+
+    hugepage_map(pd, VBASE + 4 * MB, VBASE + 4 * MB + 0x1000, 0, &st,
+                 &host_ops);
+    before = free_frames();
+
+    /* Second slot already has a 4KB page, so the map must fail there */
+    TEST_ASSERT_EQUAL_INT(-EEXIST, hugepage_map(pd, VBASE, VBASE + 8 * MB,
+                                                0, &st, &host_ops));
+    TEST_ASSERT_EQUAL_UINT32(0, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(1, st.small);
+    TEST_ASSERT_EQUAL_UINT32(0, pd[VBASE >> LARGE_PAGE_SHIFT]);
+    TEST_ASSERT_EQUAL_UINT32(before, free_frames());
+}
+
+void test_map_out_of_memory_rolls_back(void)
+{
+    uint32_t before = free_frames();
+
+    hugepage_enabled = false;
+    small_allocs_left = 100;
+
+    TEST_ASSERT_EQUAL_INT(-ENOMEM, hugepage_map(pd, VBASE, VBASE + 4 * MB,
+                                                0, &st, &limited_ops));
+    TEST_ASSERT_EQUAL_UINT32(0, st.small);
+    TEST_ASSERT_EQUAL_UINT32(0, pd[VBASE >> LARGE_PAGE_SHIFT]);
+    TEST_ASSERT_EQUAL_UINT32(before, free_frames());
+}
+
+/*
+ * =============================================================================
+ * Split, unmap and protect tests
+ * =============================================================================
+ */
+
+void test_unmap_whole_range_frees_everything(void)
+{
+    uint32_t before = free_frames();
+
+    hugepage_map(pd, VBASE + 0x1000, VBASE + 12 * MB, PTE_WRITE, &st,
+                 &host_ops);
+    TEST_ASSERT_EQUAL_INT(0, hugepage_unmap(pd, VBASE, VBASE + 12 * MB,
+                                            &st, &host_ops));
+
+    TEST_ASSERT_EQUAL_UINT32(0, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(0, st.small);
+    TEST_ASSERT_EQUAL_UINT32(before, free_frames());
+    for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, pd[i]);
+    }
+}
+
+void test_partial_unmap_splits_large_page(void)
+{
+    uint32_t slot = VBASE >> LARGE_PAGE_SHIFT;
+    uint32_t base, *pt;
+
+    hugepage_map(pd, VBASE, VBASE + 8 * MB, PTE_WRITE, &st, &host_ops);
+    base = pd[slot] & PDE_LARGE_MASK;
+
+    TEST_ASSERT_EQUAL_INT(0, hugepage_unmap(pd, VBASE + 0x5000,
+                                            VBASE + 0x6000, &st,
+                                            &host_ops));
+
+    TEST_ASSERT_EQUAL_UINT32(1, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(PT_ENTRIES - 1, st.small);
+    TEST_ASSERT_EQUAL_UINT32(1, st.splits);
+    TEST_ASSERT_FALSE(pd[slot] & PDE_LARGE);
+    TEST_ASSERT_TRUE(pd[slot + 1] & PDE_LARGE);
+
+    /* Same frames, now mapped by 4KB entries with the same permissions */
+    pt = host_table_virt(pd[slot] & PTE_ADDR_MASK);
+    TEST_ASSERT_EQUAL_HEX32(base | PTE_PRESENT | PTE_WRITE, pt[0]);
+    TEST_ASSERT_EQUAL_HEX32((base + 0x4000) | PTE_PRESENT | PTE_WRITE, pt[4]);
+    TEST_ASSERT_EQUAL_HEX32(0, pt[5]);
+
+    /* The unmapped frame went back to the allocator on its own */
+    TEST_ASSERT_EQUAL_UINT16(0, pfn_to_page((base >> PAGE_SHIFT) + 5)->refcount);
+    TEST_ASSERT_EQUAL_UINT16(1, pfn_to_page((base >> PAGE_SHIFT) + 6)->refcount);
+}
+
+void test_protect_whole_slot_keeps_large_page(void)
+{
+    uint32_t slot = VBASE >> LARGE_PAGE_SHIFT;
+
+    hugepage_map(pd, VBASE, VBASE + 4 * MB, PTE_WRITE | PTE_USER, &st,
+                 &host_ops);
+    TEST_ASSERT_EQUAL_INT(0, hugepage_protect(pd, VBASE, VBASE + 4 * MB,
+                                              PTE_USER, &st, &host_ops));
+
+    TEST_ASSERT_TRUE(pd[slot] & PDE_LARGE);
+    TEST_ASSERT_FALSE(pd[slot] & PTE_WRITE);
+    TEST_ASSERT_TRUE(pd[slot] & PTE_USER);
+    TEST_ASSERT_EQUAL_UINT32(0, st.splits);
+}
+
+void test_partial_protect_splits_large_page(void)
+{
+    uint32_t slot = VBASE >> LARGE_PAGE_SHIFT;
+    uint32_t *pt;
+
+    hugepage_map(pd, VBASE, VBASE + 4 * MB, PTE_WRITE | PTE_USER, &st,
+                 &host_ops);
+    TEST_ASSERT_EQUAL_INT(0, hugepage_protect(pd, VBASE + MB, VBASE + 2 * MB,
+                                              PTE_USER, &st, &host_ops));
+
+    TEST_ASSERT_EQUAL_UINT32(0, st.huge);
+    TEST_ASSERT_EQUAL_UINT32(PT_ENTRIES, st.small);
+    TEST_ASSERT_EQUAL_UINT32(1, st.splits);
+
+    pt = host_table_virt(pd[slot] & PTE_ADDR_MASK);
+    TEST_ASSERT_TRUE(pt[255] & PTE_WRITE);
+    TEST_ASSERT_FALSE(pt[256] & PTE_WRITE);
+    TEST_ASSERT_FALSE(pt[511] & PTE_WRITE);
+    TEST_ASSERT_TRUE(pt[512] & PTE_WRITE);
+    TEST_ASSERT_TRUE(pt[256] & PTE_USER);
+}
+
+/*
+ * =============================================================================
+ * Benchmark: TLB misses with and without large pages
+ * =============================================================================
+ *
+ * TLB model sized like a typical P6-class core: 64-entry 4-way 4KB TLB
+ * and an 8-entry fully associative 4MB TLB, both LRU. A miss costs one
+ * page walk: two memory references for a 4KB page, one for a 4MB page.
+ */
+
+#define TLB4K_SETS  16
+#define TLB4K_WAYS  4
+#define TLB4M_WAYS  8
+
+struct tlb_model {
+    uint32_t tag4k[TLB4K_SETS][TLB4K_WAYS];
+    uint32_t age4k[TLB4K_SETS][TLB4K_WAYS];
+    uint32_t tag4m[TLB4M_WAYS];
+    uint32_t age4m[TLB4M_WAYS];
+    uint32_t clock;
+    uint32_t misses;
+    uint32_t walk_refs;
+};
+
+static bool tlb_lookup(uint32_t *tags, uint32_t *ages, uint32_t ways,
+                       uint32_t tag, uint32_t clock)
+{
+    uint32_t victim = 0;
+
+    for (uint32_t i = 0; i < ways; i++) {
+        if (tags[i] == tag) {
+            ages[i] = clock;
+            return true;
+        }
+        if (ages[i] < ages[victim]) {
+            victim = i;
+        }
+    }
+    tags[victim] = tag;
+    ages[victim] = clock;
+    return false;
+}
+
+static void tlb_access(struct tlb_model *tlb, const uint32_t *dir,
+                       uint32_t addr)
+{
+    uint32_t pde = dir[addr >> LARGE_PAGE_SHIFT];
+    uint32_t vpn = addr >> PAGE_SHIFT;
+
+    tlb->clock++;
+    if (pde & PDE_LARGE) {
+        if (!tlb_lookup(tlb->tag4m, tlb->age4m, TLB4M_WAYS,
+                        addr >> LARGE_PAGE_SHIFT, tlb->clock)) {
+            tlb->misses++;
+            tlb->walk_refs += 1;
+        }
+    } else {
+        uint32_t set = vpn % TLB4K_SETS;
+
+        if (!tlb_lookup(tlb->tag4k[set], tlb->age4k[set], TLB4K_WAYS,
+                        vpn, tlb->clock)) {
+            tlb->misses++;
+            tlb->walk_refs += 2;
+        }
+    }
+}
+
+static void tlb_run(struct tlb_model *tlb, const uint32_t *dir,
+                    uint32_t start, uint32_t size, uint32_t accesses)
+{
+    uint32_t x = 0x12345678;
+
+    for (uint32_t i = 0; i < TLB4K_SETS; i++) {
+        for (uint32_t w = 0; w < TLB4K_WAYS; w++) {
+            tlb->tag4k[i][w] = 0xFFFFFFFFU;
+            tlb->age4k[i][w] = 0;
+        }
+    }
+    for (uint32_t w = 0; w < TLB4M_WAYS; w++) {
+        tlb->tag4m[w] = 0xFFFFFFFFU;
+        tlb->age4m[w] = 0;
+    }
+    tlb->clock = 0;
+    tlb->misses = 0;
+    tlb->walk_refs = 0;
+
+    /* xorshift32 random access pattern, identical for every run */
+    for (uint32_t i = 0; i < accesses; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        tlb_access(tlb, dir, start + (x % size));
+    }
+}
+
+void test_benchmark_tlb_miss_reduction(void)
+{
+    static struct tlb_model tlb;
+    const uint32_t size = 32 * MB;
+    const uint32_t accesses = 200000;
+    uint32_t small_misses, small_refs;
+
+    hugepage_enabled = false;
+    TEST_ASSERT_EQUAL_INT(0, hugepage_map(pd, VBASE, VBASE + size,
+                                          PTE_WRITE, &st, &host_ops));
+    tlb_run(&tlb, pd, VBASE, size, accesses);
+    small_misses = tlb.misses;
+    small_refs = tlb.walk_refs;
+    hugepage_unmap(pd, VBASE, VBASE + size, &st, &host_ops);
+
+    hugepage_enabled = true;
+    TEST_ASSERT_EQUAL_INT(0, hugepage_map(pd, VBASE, VBASE + size,
+                                          PTE_WRITE, &st, &host_ops));
+    TEST_ASSERT_EQUAL_UINT32(size / LARGE_PAGE_SIZE, st.huge);
+    tlb_run(&tlb, pd, VBASE, size, accesses);
+
+    printf("\n  TLB model, %u random accesses over %u MB:\n",
+           accesses, size / MB);
+    printf("    4KB pages: %u misses, %u walk refs\n",
+           small_misses, small_refs);
+    printf("    4MB pages: %u misses, %u walk refs\n",
+           tlb.misses, tlb.walk_refs);
+
+    /* 32MB fits in the 4MB TLB, so only cold misses remain */
+    TEST_ASSERT_EQUAL_UINT32(size / LARGE_PAGE_SIZE, tlb.misses);
+    TEST_ASSERT_TRUE(small_misses > accesses * 9 / 10);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Frame allocator */
+    RUN_TEST(test_alloc_single_frame);
+    RUN_TEST(test_alloc_large_block_is_aligned);
+    RUN_TEST(test_alloc_exhausts_large_blocks);
+    RUN_TEST(test_split_block_frees_frames_individually);
+
+    /* Mapping */
+    RUN_TEST(test_map_aligned_range_uses_large_pages);
+    RUN_TEST(test_map_unaligned_range_mixes_sizes);
+    RUN_TEST(test_map_disabled_uses_small_pages);
+    RUN_TEST(test_map_without_free_block_falls_back);
+    RUN_TEST(test_map_rejects_bad_ranges);
+    RUN_TEST(test_map_overlap_rolls_back);
+    RUN_TEST(test_map_out_of_memory_rolls_back);
+
+    /* Split, unmap, protect */
+    RUN_TEST(test_unmap_whole_range_frees_everything);
+    RUN_TEST(test_partial_unmap_splits_large_page);
+    RUN_TEST(test_protect_whole_slot_keeps_large_page);
+    RUN_TEST(test_partial_protect_splits_large_page);
+
+    /* Benchmark */
+    RUN_TEST(test_benchmark_tlb_miss_reduction);
+
+    return UNITY_END();
+}
@@ -0,0 +1,102 @@
+/*
+ * tests/host/test_idt.c - Host-side tests for IDT gate encoding
+ *
+ * Tests the ACTUAL kernel idt_set_gate/idt_set_gate64 implementation
+ * against the gate layouts in Intel SDM Vol 3, Figures 6-2 and 6-8.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <string.h>
+#include <idt.h>
+#include <gdt.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * Test structure sizes match Intel spec
+ */
+void test_structure_sizes(void)
+{
+    TEST_ASSERT_EQUAL(8, sizeof(struct idt_entry));
+    TEST_ASSERT_EQUAL(16, sizeof(struct idt_entry64));
+    TEST_ASSERT_EQUAL(6, sizeof(struct idt_ptr));
+    TEST_ASSERT_EQUAL(10, sizeof(struct idt_ptr64));
+}
+
+/*
+ * Test 32-bit gate splits the handler address and clears reserved byte
+ */
+void test_gate32_encoding(void)
+{
+    struct idt_entry entry;
+    memset(&entry, 0xFF, sizeof(entry));
+
+    idt_set_gate(&entry, 0x00101234, KERNEL_CS, IDT_GATE_INTERRUPT);
+
+    TEST_ASSERT_EQUAL_HEX16(0x1234, entry.offset_low);
+    TEST_ASSERT_EQUAL_HEX16(0x0010, entry.offset_high);
+    TEST_ASSERT_EQUAL_HEX16(0x08, entry.selector);
+    TEST_ASSERT_EQUAL_HEX8(0, entry.zero);
+    TEST_ASSERT_EQUAL_HEX8(0x8E, entry.type_attr);
+}
+
+/*
+ * Test 32-bit gate raw bytes
+ */
+void test_gate32_bytes(void)
+{
+    struct idt_entry entry;
+    uint8_t *b = (uint8_t *)&entry;
+
+    idt_set_gate(&entry, 0xDEADBEEF, KERNEL_CS,
+                 IDT_GATE_TRAP | IDT_GATE_USER);
+
+    TEST_ASSERT_EQUAL_HEX8(0xEF, b[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xBE, b[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x08, b[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, b[3]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, b[4]);
+    TEST_ASSERT_EQUAL_HEX8(0xEF, b[5]);  /* P=1, DPL=3, trap gate */
+    TEST_ASSERT_EQUAL_HEX8(0xAD, b[6]);
+    TEST_ASSERT_EQUAL_HEX8(0xDE, b[7]);
+}
+
+/*
+ * Test 64-bit gate splits the address three ways and zeroes IST/reserved
+ */
+void test_gate64_encoding(void)
+{
+    struct idt_entry64 entry;
+    memset(&entry, 0xFF, sizeof(entry));
+
+    idt_set_gate64(&entry, 0xFFFF800012345678ULL, KERNEL_CS,
+                   IDT_GATE_INTERRUPT);
+
+    TEST_ASSERT_EQUAL_HEX16(0x5678, entry.offset_low);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, entry.offset_mid);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFF8000, entry.offset_high);
+    TEST_ASSERT_EQUAL_HEX16(0x08, entry.selector);
+    TEST_ASSERT_EQUAL_HEX8(0, entry.ist);
+    TEST_ASSERT_EQUAL_HEX8(0x8E, entry.type_attr);
+    TEST_ASSERT_EQUAL_HEX32(0, entry.reserved);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_structure_sizes);
+    RUN_TEST(test_gate32_encoding);
+    RUN_TEST(test_gate32_bytes);
+    RUN_TEST(test_gate64_encoding);
+
+    return UNITY_END();
+}
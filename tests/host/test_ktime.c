@@ -0,0 +1,142 @@
+/*
+ * tests/host/test_ktime.c - Host-side tests for clocksource math
+ *
+ * Tests the ACTUAL kernel clocks_calc_mult_shift implementation and the
+ * math64.h helpers it relies on:
+ *   - mult fits in 32 bits with the largest usable shift
+ *   - cycle -> ns conversion error stays within 1 ppm across rates
+ *   - mul_u64_u32_shr matches a 128-bit reference for large inputs
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <ktime.h>
+
+/* 128-bit reference arithmetic (GCC extension) */
+__extension__ typedef unsigned __int128 u128;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * ref_cyc2ns - Exact conversion for comparison
+ */
+static uint64_t ref_cyc2ns(uint64_t cycles, uint32_t khz)
+{
+    return (uint64_t)(((u128)cycles * NSEC_PER_MSEC) / khz);
+}
+
+/*
+ * Test a typical 3 GHz TSC uses the full 32-bit shift
+ */
+void test_mult_shift_3ghz(void)
+{
+    uint32_t mult, shift;
+
+    clocks_calc_mult_shift(&mult, &shift, 3000000, NSEC_PER_MSEC);
+
+    TEST_ASSERT_EQUAL_UINT32(32, shift);
+    TEST_ASSERT_EQUAL_UINT32(1431655765, mult);     /* 2^32 / 3 */
+}
+
+/*
+ * Test a slow counter (1 ns > 1 cycle) lowers the shift to keep mult in range
+ */
+void test_mult_shift_slow_counter(void)
+{
+    uint32_t mult, shift;
+
+    clocks_calc_mult_shift(&mult, &shift, 1193182, NSEC_PER_SEC);
+
+    TEST_ASSERT_LESS_THAN_UINT32(32, shift);
+    TEST_ASSERT_GREATER_THAN_UINT32(0x7FFFFFFF, mult);
+    /* 1 s of PIT ticks is 1e9 ns, to well under 1 ppm */
+    TEST_ASSERT_UINT64_WITHIN(1000,
+        NSEC_PER_SEC, clocksource_cyc2ns(1193182, mult, shift));
+}
+
+/*
+ * Test conversion accuracy over a range of TSC rates and a 1 hour span
+ */
+void test_cyc2ns_accuracy(void)
+{
+    static const uint32_t rates_khz[] = {
+        100000, 1193, 999999, 2400000, 3600000, 5200000,
+    };
+
+    for (size_t i = 0; i < sizeof(rates_khz) / sizeof(rates_khz[0]); i++) {
+        uint32_t mult, shift;
+        uint32_t khz = rates_khz[i];
+        uint64_t cycles = (uint64_t)khz * 1000 * 3600;
+        uint64_t ref = ref_cyc2ns(cycles, khz);
+        uint64_t got;
+
+        clocks_calc_mult_shift(&mult, &shift, khz, NSEC_PER_MSEC);
+        got = clocksource_cyc2ns(cycles, mult, shift);
+
+        /* 1 ppm of one hour is 3.6 ms */
+        TEST_ASSERT_UINT64_WITHIN(ref / 1000000 + 1, ref, got);
+    }
+}
+
+/*
+ * Test mul_u64_u32_shr against a 128-bit product where a 64-bit one
+ * would overflow
+ */
+void test_mul_u64_u32_shr_no_overflow(void)
+{
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    for (int i = 0; i < 10000; i++) {
+        uint64_t a;
+        uint32_t mul, shift;
+        u128 ref;
+
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        a = seed >> (seed & 31);
+        mul = (uint32_t)(seed >> 17);
+        shift = (uint32_t)(seed >> 59) + 1;     /* 1..32 */
+
+        ref = ((u128)a * mul) >> shift;
+        if (ref >> 64) {
+            continue;
+        }
+        TEST_ASSERT_EQUAL_UINT64((uint64_t)ref, mul_u64_u32_shr(a, mul, shift));
+    }
+    TEST_ASSERT_EQUAL_UINT64(0xFFFFFFFFULL * 3,
+                             mul_u64_u32_shr(0xFFFFFFFFULL, 3, 0));
+}
+
+/*
+ * Test div_u64_u32 quotient and remainder
+ */
+void test_div_u64_u32(void)
+{
+    uint32_t rem;
+
+    TEST_ASSERT_EQUAL_UINT64(0x500000001ULL / 7,
+                             div_u64_u32(0x500000001ULL, 7, &rem));
+    TEST_ASSERT_EQUAL_UINT32(0x500000001ULL % 7, rem);
+    TEST_ASSERT_EQUAL_UINT64(123456789012345ULL / 1000,
+                             div_u64_u32(123456789012345ULL, 1000, &rem));
+    TEST_ASSERT_EQUAL_UINT32(345, rem);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_mult_shift_3ghz);
+    RUN_TEST(test_mult_shift_slow_counter);
+    RUN_TEST(test_cyc2ns_accuracy);
+    RUN_TEST(test_mul_u64_u32_shr_no_overflow);
+    RUN_TEST(test_div_u64_u32);
+
+    return UNITY_END();
+}
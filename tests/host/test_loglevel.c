@@ -0,0 +1,230 @@
+/*
+ * tests/host/test_loglevel.c - Host-side tests for runtime log levels
+ *
+ * Tests the per-subsystem levels and command-line parsing
+ * (kernel/lib/loglevel.c, with the console options applied through
+ * kernel/lib/console.c) and the jump label patcher
+ * (kernel/lib/jump_label.c) using the ACTUAL kernel code. Patching is
+ * checked on a buffer standing in for kernel text.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <string.h>
+#include <errno.h>
+#include <printk.h>
+#include <console.h>
+
+static const uint8_t nop[JUMP_LABEL_SIZE] = JUMP_LABEL_NOP;
+
+void setUp(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < LOG_SYS_COUNT; i++) {
+        log_set_level(i, LOG_DEFAULT_LEVEL);
+    }
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * =============================================================================
+ * Levels
+ * =============================================================================
+ */
+
+void test_default_level(void)
+{
+    TEST_ASSERT_EQUAL_INT(LOG_INFO, log_get_level(LOG_SYS_MM));
+    TEST_ASSERT_FALSE(static_key_enabled(&log_debug_keys[LOG_SYS_MM]));
+    TEST_ASSERT_TRUE(klog_enabled(LOG_SYS_MM, LOG_INFO));
+    TEST_ASSERT_FALSE(klog_enabled(LOG_SYS_MM, LOG_DEBUG));
+}
+
+void test_set_level_tracks_debug_key(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, log_set_level(LOG_SYS_IRQ, LOG_DEBUG));
+    TEST_ASSERT_TRUE(static_key_enabled(&log_debug_keys[LOG_SYS_IRQ]));
+    TEST_ASSERT_TRUE(klog_enabled(LOG_SYS_IRQ, LOG_DEBUG));
+    TEST_ASSERT_FALSE(klog_enabled(LOG_SYS_MM, LOG_DEBUG));
+
+    TEST_ASSERT_EQUAL_INT(0, log_set_level(LOG_SYS_IRQ, LOG_WARN));
+    TEST_ASSERT_FALSE(static_key_enabled(&log_debug_keys[LOG_SYS_IRQ]));
+    TEST_ASSERT_FALSE(klog_enabled(LOG_SYS_IRQ, LOG_INFO));
+    TEST_ASSERT_TRUE(klog_enabled(LOG_SYS_IRQ, LOG_WARN));
+}
+
+void test_set_level_rejects_bad_args(void)
+{
+    TEST_ASSERT_EQUAL_INT(-EINVAL, log_set_level(LOG_SYS_COUNT, LOG_INFO));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, log_set_level(LOG_SYS_MM, LOG_DEBUG + 1));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, log_set_level(LOG_SYS_MM, -1));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, log_get_level(LOG_SYS_COUNT));
+    TEST_ASSERT_NULL(log_subsys_name(LOG_SYS_COUNT));
+    TEST_ASSERT_EQUAL_STRING("serial", log_subsys_name(LOG_SYS_SERIAL));
+}
+
+/*
+ * =============================================================================
+ * Command line
+ * =============================================================================
+ */
+
+void test_cmdline_global_then_subsystem(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, log_parse_cmdline("loglevel=warn log.mm=debug"));
+
+    TEST_ASSERT_EQUAL_INT(LOG_WARN, log_get_level(LOG_SYS_CORE));
+    TEST_ASSERT_EQUAL_INT(LOG_WARN, log_get_level(LOG_SYS_TIME));
+    TEST_ASSERT_EQUAL_INT(LOG_DEBUG, log_get_level(LOG_SYS_MM));
+    TEST_ASSERT_TRUE(static_key_enabled(&log_debug_keys[LOG_SYS_MM]));
+}
+
+void test_cmdline_numeric_levels_and_spaces(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, log_parse_cmdline("  log.time=0   log.irq=3 "));
+
+    TEST_ASSERT_EQUAL_INT(LOG_ERROR, log_get_level(LOG_SYS_TIME));
+    TEST_ASSERT_EQUAL_INT(LOG_DEBUG, log_get_level(LOG_SYS_IRQ));
+}
+
+void test_cmdline_skips_other_options(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, log_parse_cmdline("quiet root=/dev/hda logx=1"));
+    TEST_ASSERT_EQUAL_INT(0, log_parse_cmdline(""));
+    TEST_ASSERT_EQUAL_INT(LOG_INFO, log_get_level(LOG_SYS_CORE));
+}
+
+void test_cmdline_bad_options_do_not_stop_the_rest(void)
+{
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+        log_parse_cmdline("log.nosuch=debug log.mm=loud log.mmx=warn "
+                          "loglevel=9 log.serial=debug"));
+
+    TEST_ASSERT_EQUAL_INT(LOG_INFO, log_get_level(LOG_SYS_MM));
+    TEST_ASSERT_EQUAL_INT(LOG_INFO, log_get_level(LOG_SYS_CORE));
+    TEST_ASSERT_EQUAL_INT(LOG_DEBUG, log_get_level(LOG_SYS_SERIAL));
+}
+
+static void stub_write(struct console *con, const char *text, size_t len)
+{
+    (void)con;
+    (void)text;
+    (void)len;
+}
+
+void test_cmdline_console_options(void)
+{
+    static struct console vga = {
+        .name = "vga", .write = stub_write, .level = LOG_DEBUG, .enabled = true,
+    };
+    static struct console com1 = {
+        .name = "com1", .write = stub_write, .level = LOG_DEBUG, .enabled = true,
+    };
+
+    console_register(&vga);
+    console_register(&com1);
+
+    TEST_ASSERT_EQUAL_INT(0, log_parse_cmdline("console.vga=error console.com1=off"));
+    TEST_ASSERT_EQUAL_INT(LOG_ERROR, vga.level);
+    TEST_ASSERT_TRUE(vga.enabled);
+    TEST_ASSERT_FALSE(com1.enabled);
+
+    /* A level turns a disabled console back on */
+    TEST_ASSERT_EQUAL_INT(0, log_parse_cmdline("console.com1=warn"));
+    TEST_ASSERT_TRUE(com1.enabled);
+    TEST_ASSERT_EQUAL_INT(LOG_WARN, com1.level);
+
+    /* Unknown consoles and bad levels are errors but leave the rest */
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+        log_parse_cmdline("console.com9=info console.vga=loud console.=off "
+                          "console.vga=2"));
+    TEST_ASSERT_EQUAL_INT(LOG_INFO, vga.level);
+
+    console_unregister(&vga);
+    console_unregister(&com1);
+}
+
+/*
+ * =============================================================================
+ * Jump label patching
+ * =============================================================================
+ */
+
+void test_patch_writes_jmp_rel32_and_nop(void)
+{
+    static uint8_t text[64];
+    static struct static_key key;
+    struct jump_entry entry;
+
+    memcpy(&text[8], nop, JUMP_LABEL_SIZE);
+    entry.code = (uintptr_t)&text[8];
+    entry.target = (uintptr_t)&text[40];
+    entry.key = (uintptr_t)&key;
+
+    key.enabled = true;
+    TEST_ASSERT_EQUAL_UINT32(1, jump_label_apply(&entry, &entry + 1, &key));
+    TEST_ASSERT_EQUAL_HEX8(JUMP_LABEL_JMP, text[8]);
+    /* rel32 = target - end of the JMP = 40 - 13 */
+    TEST_ASSERT_EQUAL_HEX8(27, text[9]);
+    TEST_ASSERT_EQUAL_HEX8(0, text[10]);
+    TEST_ASSERT_EQUAL_HEX8(0, text[12]);
+
+    /* A backward jump is a negative rel32 */
+    entry.target = (uintptr_t)&text[0];
+    jump_label_apply(&entry, &entry + 1, &key);
+    TEST_ASSERT_EQUAL_HEX8(0xF3, text[9]);          /* -13 */
+    TEST_ASSERT_EQUAL_HEX8(0xFF, text[12]);
+
+    key.enabled = false;
+    jump_label_apply(&entry, &entry + 1, &key);
+    TEST_ASSERT_EQUAL_MEMORY(nop, &text[8], JUMP_LABEL_SIZE);
+}
+
+void test_patch_only_touches_the_key(void)
+{
+    static uint8_t text[2][JUMP_LABEL_SIZE];
+    static struct static_key mine, other;
+    struct jump_entry table[2];
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        memcpy(text[i], nop, JUMP_LABEL_SIZE);
+        table[i].code = (uintptr_t)text[i];
+        table[i].target = (uintptr_t)text[i] + 100;
+    }
+    table[0].key = (uintptr_t)&other;
+    table[1].key = (uintptr_t)&mine;
+
+    mine.enabled = true;
+    TEST_ASSERT_EQUAL_UINT32(1, jump_label_apply(table, table + 2, &mine));
+    TEST_ASSERT_EQUAL_MEMORY(nop, text[0], JUMP_LABEL_SIZE);
+    TEST_ASSERT_EQUAL_HEX8(JUMP_LABEL_JMP, text[1][0]);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Levels */
+    RUN_TEST(test_default_level);
+    RUN_TEST(test_set_level_tracks_debug_key);
+    RUN_TEST(test_set_level_rejects_bad_args);
+
+    /* Command line */
+    RUN_TEST(test_cmdline_global_then_subsystem);
+    RUN_TEST(test_cmdline_numeric_levels_and_spaces);
+    RUN_TEST(test_cmdline_skips_other_options);
+    RUN_TEST(test_cmdline_bad_options_do_not_stop_the_rest);
+    RUN_TEST(test_cmdline_console_options);
+
+    /* Jump label patching */
+    RUN_TEST(test_patch_writes_jmp_rel32_and_nop);
+    RUN_TEST(test_patch_only_touches_the_key);
+
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+/*
+ * tests/host/test_memacct.c - Host-side tests for memory accounting
+ *
+ * Tests per-owner counters and OOM victim selection using the ACTUAL
+ * kernel implementations in kernel/mm/memacct.c and kernel/mm/page.c,
+ * over a small simulated machine so exhaustion is quick to reach.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <memacct.h>
+#include <errno.h>
+
+/* 2MB machine: 1MB reserved low memory, 256 usable frames above it */
+static const struct e820_entry mem_map[] = {
+    { 0x00100000, 0x00100000, E820_USABLE, 0 },
+};
+#define MEM_FRAMES  0x200
+#define FREE_FRAMES 0x100
+
+static struct page pages[MEM_FRAMES];
+
+static uint32_t killed_owner;
+static int kill_calls;
+
+/* Test killer: free every block the victim owns, like process exit */
+static int free_all_killer(uint32_t owner)
+{
+    killed_owner = owner;
+    kill_calls++;
+
+    for (uint32_t pfn = 0; pfn < page_count; pfn++) {
+        struct page *pg = &page_array[pfn];
+
+        if (pg->owner == owner && pg->refcount > 0 &&
+            !(pg->flags & PG_TAIL)) {
+            memacct_free(pg);
+        }
+    }
+    return 0;
+}
+
+/* Killer that claims success without freeing anything */
+static int lazy_killer(uint32_t owner)
+{
+    (void)owner;
+    kill_calls++;
+    return 0;
+}
+
+static uint32_t owner_total(uint32_t owner)
+{
+    struct mem_usage u;
+
+    memacct_read(owner, &u);
+    return u.pages[MM_RSS] + u.pages[MM_PGTABLE] + u.pages[MM_KOBJ];
+}
+
+void setUp(void)
+{
+    page_array_build(pages, MEM_FRAMES, mem_map, 1);
+    page_array = pages;
+    page_count = MEM_FRAMES;
+
+    memacct_reset();
+    memacct_set_killer(NULL);
+    killed_owner = MEMACCT_NO_OWNER;
+    kill_calls = 0;
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * =============================================================================
+ * Counter tests
+ * =============================================================================
+ */
+
+void test_alloc_charges_owner_and_type(void)
+{
+    struct mem_usage u;
+
+    TEST_ASSERT_NOT_NULL(memacct_alloc(3, MM_RSS, 0));
+    TEST_ASSERT_NOT_NULL(memacct_alloc(3, MM_RSS, 2));
+    TEST_ASSERT_NOT_NULL(memacct_alloc(3, MM_PGTABLE, 0));
+    TEST_ASSERT_NOT_NULL(memacct_alloc(3, MM_KOBJ, 0));
+
+    TEST_ASSERT_EQUAL_INT(0, memacct_read(3, &u));
+    TEST_ASSERT_EQUAL_UINT32(5, u.pages[MM_RSS]);
+    TEST_ASSERT_EQUAL_UINT32(1, u.pages[MM_PGTABLE]);
+    TEST_ASSERT_EQUAL_UINT32(1, u.pages[MM_KOBJ]);
+    TEST_ASSERT_EQUAL_UINT32(7, u.peak);
+
+    TEST_ASSERT_EQUAL_UINT32(0, owner_total(4));
+}
+
+void test_alloc_tags_struct_page(void)
+{
+    struct page *pt = memacct_alloc(5, MM_PGTABLE, 0);
+    struct page *obj = memacct_alloc(5, MM_KOBJ, 1);
+
+    TEST_ASSERT_EQUAL_UINT32(5, pt->owner);
+    TEST_ASSERT_TRUE(pt->flags & PG_PGTABLE);
+    TEST_ASSERT_TRUE(obj->flags & PG_KERNEL);
+    TEST_ASSERT_TRUE(obj[1].flags & PG_KERNEL);
+    TEST_ASSERT_EQUAL_UINT32(5, obj[1].owner);
+}
+
+void test_free_uncharges_and_keeps_peak(void)
+{
+    struct page *a = memacct_alloc(2, MM_RSS, 1);
+    struct page *b = memacct_alloc(2, MM_PGTABLE, 0);
+    struct mem_usage u;
+
+    memacct_free(a);
+    memacct_free(b);
+
+    memacct_read(2, &u);
+    TEST_ASSERT_EQUAL_UINT32(0, u.pages[MM_RSS]);
+    TEST_ASSERT_EQUAL_UINT32(0, u.pages[MM_PGTABLE]);
+    TEST_ASSERT_EQUAL_UINT32(3, u.peak);
+    TEST_ASSERT_FALSE(b->flags & PG_PGTABLE);
+    TEST_ASSERT_EQUAL_UINT16(0, a->refcount);
+}
+
+void test_free_shared_frame_uncharges_on_last_ref(void)
+{
+    struct page *pg = memacct_alloc(2, MM_RSS, 0);
+
+    pg->refcount++;
+    memacct_free(pg);
+    TEST_ASSERT_EQUAL_UINT32(1, owner_total(2));
+    memacct_free(pg);
+    TEST_ASSERT_EQUAL_UINT32(0, owner_total(2));
+}
+
+void test_split_block_uncharges_per_frame(void)
+{
+    struct page *pg = memacct_alloc(6, MM_RSS, 2);
+
+    page_split_block(pg);
+    memacct_free(&pg[1]);
+    TEST_ASSERT_EQUAL_UINT32(3, owner_total(6));
+    memacct_free(&pg[0]);
+    memacct_free(&pg[2]);
+    memacct_free(&pg[3]);
+    TEST_ASSERT_EQUAL_UINT32(0, owner_total(6));
+}
+
+void test_invalid_owner_rejected(void)
+{
+    struct mem_usage u;
+
+    TEST_ASSERT_NULL(memacct_alloc(MEMACCT_MAX_OWNERS, MM_RSS, 0));
+    TEST_ASSERT_NULL(memacct_alloc(1, MM_NR_COUNTERS, 0));
+    TEST_ASSERT_EQUAL_INT(-ESRCH, memacct_read(MEMACCT_MAX_OWNERS, &u));
+}
+
+/*
+ * =============================================================================
+ * OOM tests
+ * =============================================================================
+ */
+
+void test_oom_select_largest_consumer(void)
+{
+    memacct_alloc(1, MM_RSS, 2);
+    memacct_alloc(2, MM_RSS, 1);
+    memacct_alloc(2, MM_PGTABLE, 0);
+    memacct_alloc(2, MM_KOBJ, 1);
+    memacct_alloc(3, MM_RSS, 0);
+
+    /* Owner 2: 2 + 1 + 2 = 5 frames beats owner 1 with 4 */
+    TEST_ASSERT_EQUAL_UINT32(2, memacct_oom_select());
+}
+
+void test_oom_select_never_kernel(void)
+{
+    memacct_alloc(MEMACCT_KERNEL, MM_KOBJ, 4);
+    TEST_ASSERT_EQUAL_UINT32(MEMACCT_NO_OWNER, memacct_oom_select());
+
+    memacct_alloc(9, MM_RSS, 0);
+    TEST_ASSERT_EQUAL_UINT32(9, memacct_oom_select());
+}
+
+void test_oom_kills_largest_and_retries(void)
+{
+    struct mem_usage u;
+
+    memacct_set_killer(free_all_killer);
+
+    /* Owner 1 takes most of memory, owner 2 the rest */
+    for (uint32_t i = 0; i < FREE_FRAMES - 8; i++) {
+        TEST_ASSERT_NOT_NULL(memacct_alloc(1, MM_RSS, 0));
+    }
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_NOT_NULL(memacct_alloc(2, MM_RSS, 0));
+    }
+
+    /* Memory is full: this allocation must kill owner 1, not panic */
+    TEST_ASSERT_NOT_NULL(memacct_alloc(2, MM_RSS, 0));
+
+    TEST_ASSERT_EQUAL_INT(1, kill_calls);
+    TEST_ASSERT_EQUAL_UINT32(1, killed_owner);
+    TEST_ASSERT_EQUAL_UINT32(0, owner_total(1));
+    TEST_ASSERT_EQUAL_UINT32(9, owner_total(2));
+
+    memacct_read(1, &u);
+    TEST_ASSERT_EQUAL_UINT32(1, u.oom_kills);
+    TEST_ASSERT_EQUAL_UINT32(FREE_FRAMES - 8, u.peak);
+}
+
+void test_oom_without_killer_fails(void)
+{
+    while (memacct_alloc(1, MM_RSS, 0) != NULL) {
+    }
+    TEST_ASSERT_EQUAL_UINT32(FREE_FRAMES, owner_total(1));
+    TEST_ASSERT_EQUAL_INT(0, kill_calls);
+}
+
+void test_oom_killer_that_frees_nothing_fails(void)
+{
+    memacct_set_killer(lazy_killer);
+
+    while (memacct_alloc(1, MM_RSS, 0) != NULL) {
+    }
+    /* One attempt, then give up rather than loop */
+    TEST_ASSERT_EQUAL_INT(1, kill_calls);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Counters */
+    RUN_TEST(test_alloc_charges_owner_and_type);
+    RUN_TEST(test_alloc_tags_struct_page);
+    RUN_TEST(test_free_uncharges_and_keeps_peak);
+    RUN_TEST(test_free_shared_frame_uncharges_on_last_ref);
+    RUN_TEST(test_split_block_uncharges_per_frame);
+    RUN_TEST(test_invalid_owner_rejected);
+
+    /* OOM */
+    RUN_TEST(test_oom_select_largest_consumer);
+    RUN_TEST(test_oom_select_never_kernel);
+    RUN_TEST(test_oom_kills_largest_and_retries);
+    RUN_TEST(test_oom_without_killer_fails);
+    RUN_TEST(test_oom_killer_that_frees_nothing_fails);
+
+    return UNITY_END();
+}
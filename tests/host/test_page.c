@@ -0,0 +1,165 @@
+/*
+ * tests/host/test_page.c - Host-side tests for page frame descriptors
+ *
+ * Asserts the struct page layout (size and hot-field placement) and
+ * tests building the descriptor array from E820 memory maps using the
+ * ACTUAL kernel implementation in kernel/mm/page.c.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <stddef.h>
+#include <page.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * =============================================================================
+ * Layout tests
+ * =============================================================================
+ */
+
+void test_page_size_fits_half_cache_line(void)
+{
+    TEST_ASSERT_EQUAL(32, sizeof(struct page));
+    TEST_ASSERT_EQUAL(0, 64 % sizeof(struct page));
+}
+
+void test_page_hot_fields_in_first_word(void)
+{
+    TEST_ASSERT_EQUAL(0, offsetof(struct page, flags));
+    TEST_ASSERT_EQUAL(2, offsetof(struct page, refcount));
+    TEST_ASSERT_TRUE(offsetof(struct page, refcount) +
+                     sizeof(((struct page *)0)->refcount) <= 4);
+}
+
+void test_page_field_offsets(void)
+{
+    TEST_ASSERT_EQUAL(4, offsetof(struct page, mapcount));
+    TEST_ASSERT_EQUAL(6, offsetof(struct page, order));
+    TEST_ASSERT_EQUAL(8, offsetof(struct page, lru_next));
+    TEST_ASSERT_EQUAL(12, offsetof(struct page, lru_prev));
+    TEST_ASSERT_EQUAL(16, offsetof(struct page, owner));
+    TEST_ASSERT_EQUAL(20, offsetof(struct page, index));
+    TEST_ASSERT_EQUAL(24, offsetof(struct page, private));
+}
+
+void test_e820_entry_size(void)
+{
+    TEST_ASSERT_EQUAL(24, sizeof(struct e820_entry));
+}
+
+/*
+ * =============================================================================
+ * Array build tests
+ * =============================================================================
+ */
+
+/* Typical QEMU map: low RAM, BIOS hole, 1MB-8MB RAM */
+static const struct e820_entry qemu_map[] = {
+    { 0x00000000, 0x0009FC00, E820_USABLE, 0 },
+    { 0x0009FC00, 0x00000400, E820_RESERVED, 0 },
+    { 0x000F0000, 0x00010000, E820_RESERVED, 0 },
+    { 0x00100000, 0x00700000, E820_USABLE, 0 },
+    { 0xFFFC0000, 0x00040000, E820_RESERVED, 0 },
+};
+#define QEMU_MAP_COUNT (sizeof(qemu_map) / sizeof(qemu_map[0]))
+
+static struct page pages[2048];
+
+void test_frames_from_highest_usable(void)
+{
+    /* Reserved region at 4GB - 256KB must not size the array */
+    TEST_ASSERT_EQUAL_UINT32(0x800, page_array_frames(qemu_map, QEMU_MAP_COUNT));
+}
+
+void test_frames_empty_map(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0, page_array_frames(qemu_map, 0));
+}
+
+void test_build_marks_holes_reserved(void)
+{
+    uint32_t usable = page_array_build(pages, 0x800, qemu_map, QEMU_MAP_COUNT);
+
+    /* 0x9F whole frames below 0x9FC00, plus 0x700 frames from 1MB */
+    TEST_ASSERT_EQUAL_UINT32(0x9F + 0x700, usable);
+
+    TEST_ASSERT_FALSE(pages[0].flags & PG_RESERVED);
+    TEST_ASSERT_FALSE(pages[0x9E].flags & PG_RESERVED);
+    /* Partial frame at 0x9F000-0x9FFFF is reserved */
+    TEST_ASSERT_TRUE(pages[0x9F].flags & PG_RESERVED);
+    /* VGA / ROM hole */
+    TEST_ASSERT_TRUE(pages[0xB8].flags & PG_RESERVED);
+    TEST_ASSERT_FALSE(pages[0x100].flags & PG_RESERVED);
+    TEST_ASSERT_FALSE(pages[0x7FF].flags & PG_RESERVED);
+}
+
+void test_build_initializes_fields(void)
+{
+    page_array_build(pages, 0x800, qemu_map, QEMU_MAP_COUNT);
+
+    TEST_ASSERT_EQUAL_UINT16(0, pages[0x200].refcount);
+    TEST_ASSERT_EQUAL_UINT16(0, pages[0x200].mapcount);
+    TEST_ASSERT_EQUAL_HEX32(PAGE_NONE, pages[0x200].lru_next);
+    TEST_ASSERT_EQUAL_HEX32(PAGE_NONE, pages[0x200].lru_prev);
+    TEST_ASSERT_EQUAL_UINT32(0, pages[0x200].owner);
+}
+
+void test_build_overlap_reserved_wins(void)
+{
+    static const struct e820_entry overlap[] = {
+        { 0x00000000, 0x00100000, E820_USABLE, 0 },
+        { 0x00080000, 0x00001000, E820_ACPI_NVS, 0 },
+    };
+
+    page_array_build(pages, 0x100, overlap, 2);
+
+    TEST_ASSERT_FALSE(pages[0x7F].flags & PG_RESERVED);
+    TEST_ASSERT_TRUE(pages[0x80].flags & PG_RESERVED);
+    TEST_ASSERT_FALSE(pages[0x81].flags & PG_RESERVED);
+}
+
+void test_reserve_range_rounds_outward(void)
+{
+    page_array_build(pages, 0x800, qemu_map, QEMU_MAP_COUNT);
+    page_array = pages;
+    page_count = 0x800;
+
+    page_reserve_range(0x200800, 0x202001);
+
+    TEST_ASSERT_FALSE(pages[0x1FF].flags & PG_RESERVED);
+    TEST_ASSERT_TRUE(pages[0x200].flags & PG_RESERVED);
+    TEST_ASSERT_TRUE(pages[0x202].flags & PG_RESERVED);
+    TEST_ASSERT_FALSE(pages[0x203].flags & PG_RESERVED);
+
+    TEST_ASSERT_EQUAL_UINT32(0x102, page_to_pfn(pfn_to_page(0x102)));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Layout */
+    RUN_TEST(test_page_size_fits_half_cache_line);
+    RUN_TEST(test_page_hot_fields_in_first_word);
+    RUN_TEST(test_page_field_offsets);
+    RUN_TEST(test_e820_entry_size);
+
+    /* Array build */
+    RUN_TEST(test_frames_from_highest_usable);
+    RUN_TEST(test_frames_empty_map);
+    RUN_TEST(test_build_marks_holes_reserved);
+    RUN_TEST(test_build_initializes_fields);
+    RUN_TEST(test_build_overlap_reserved_wins);
+    RUN_TEST(test_reserve_range_rounds_outward);
+
+    return UNITY_END();
+}
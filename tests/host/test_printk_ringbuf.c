@@ -0,0 +1,203 @@
+/*
+ * tests/host/test_printk_ringbuf.c - Host-side tests for the log ring
+ *
+ * Tests the printk record ring (kernel/lib/printk_ringbuf.c) using the
+ * ACTUAL kernel code: commit order as seen by readers, a writer nested
+ * inside another, overwrite of the oldest records, detection of a
+ * record reused while it is being copied, and sequence number wrap.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <printk_ringbuf.h>
+
+static struct printk_ringbuf rb;
+
+void setUp(void)
+{
+    prb_init(&rb);
+}
+
+void tearDown(void)
+{
+}
+
+static struct printk_record *reserve_text(const char *text)
+{
+    struct printk_record *rec = prb_reserve(&rb);
+
+    rec->ts_nsec = 1000ULL * rec->seq;
+    rec->level = 2;
+    rec->cpu = 0;
+    rec->len = (uint16_t)strlen(text);
+    strcpy(rec->text, text);
+    return rec;
+}
+
+static void log_text(const char *text)
+{
+    prb_commit(&rb, reserve_text(text));
+}
+
+void test_empty_ring_has_nothing_to_read(void)
+{
+    struct printk_record out;
+    uint32_t seq = 0;
+
+    TEST_ASSERT_EQUAL(-EAGAIN, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_UINT32(0, seq);
+    TEST_ASSERT_EQUAL_UINT32(0, prb_first_seq(&rb));
+}
+
+void test_records_read_back_in_order(void)
+{
+    struct printk_record out;
+    uint32_t seq = 0;
+
+    log_text("one\n");
+    log_text("two\n");
+
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_UINT32(0, seq);
+    TEST_ASSERT_EQUAL_STRING("one\n", out.text);
+    TEST_ASSERT_EQUAL_UINT16(4, out.len);
+    TEST_ASSERT_EQUAL_UINT8(2, out.level);
+
+    seq++;
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_STRING("two\n", out.text);
+    TEST_ASSERT_TRUE(out.ts_nsec == 1000);
+
+    seq++;
+    TEST_ASSERT_EQUAL(-EAGAIN, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_UINT32(prb_head(&rb), seq);
+}
+
+void test_reader_stops_at_uncommitted_record(void)
+{
+    struct printk_record *outer, *inner;
+    struct printk_record out;
+    uint32_t seq = 0;
+
+    /* An interrupt logs a message while another is being formatted */
+    outer = reserve_text("outer\n");
+    inner = reserve_text("inner\n");
+    prb_commit(&rb, inner);
+
+    TEST_ASSERT_EQUAL(-EAGAIN, prb_read(&rb, &seq, NULL));
+    TEST_ASSERT_EQUAL_UINT32(0, seq);
+    TEST_ASSERT_TRUE(seq != prb_head(&rb));
+
+    prb_commit(&rb, outer);
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_STRING("outer\n", out.text);
+    seq++;
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_STRING("inner\n", out.text);
+}
+
+void test_overwritten_reader_skips_to_oldest(void)
+{
+    struct printk_record out;
+    char text[16];
+    uint32_t seq = 0;
+    uint32_t i;
+
+    for (i = 0; i < PRB_RECORDS + 10; i++) {
+        snprintf(text, sizeof(text), "rec %u\n", i);
+        log_text(text);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(10, prb_first_seq(&rb));
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_UINT32(10, seq);
+    TEST_ASSERT_EQUAL_STRING("rec 10\n", out.text);
+
+    seq = PRB_RECORDS + 9;
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_STRING("rec 265\n", out.text);
+}
+
+void test_slot_reused_by_writer_is_not_returned(void)
+{
+    struct printk_record *rec;
+    struct printk_record out;
+    uint32_t seq = 0;
+    uint32_t i;
+
+    for (i = 0; i < PRB_RECORDS; i++) {
+        log_text("old\n");
+    }
+
+    /* Record 0's slot is being rewritten: it is gone, 1 is oldest */
+    rec = reserve_text("new\n");
+    TEST_ASSERT_EQUAL_UINT32(PRB_RECORDS, rec->seq);
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_UINT32(1, seq);
+
+    /* The new record is not readable until committed */
+    seq = PRB_RECORDS;
+    TEST_ASSERT_EQUAL(-EAGAIN, prb_read(&rb, &seq, &out));
+    prb_commit(&rb, rec);
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_STRING("new\n", out.text);
+}
+
+void test_torn_length_is_clamped(void)
+{
+    struct printk_record *rec = reserve_text("x\n");
+    struct printk_record out;
+    uint32_t seq = 0;
+
+    rec->len = 0xFFFF;
+    prb_commit(&rb, rec);
+
+    TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+    TEST_ASSERT_EQUAL_UINT16(PRB_TEXT_MAX - 1, out.len);
+    TEST_ASSERT_EQUAL_CHAR('\0', out.text[PRB_TEXT_MAX - 1]);
+}
+
+void test_sequence_wraps(void)
+{
+    struct printk_record out;
+    uint32_t seq;
+    uint32_t i;
+
+    /* Start a lap short of where (seq << 1) wraps */
+    rb.head = 0x80000000U - 2;
+    for (i = 0; i < 4; i++) {
+        log_text(i == 3 ? "last\n" : "wrap\n");
+    }
+
+    seq = 0x80000000U - 2;
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, prb_read(&rb, &seq, &out));
+        seq++;
+    }
+    TEST_ASSERT_EQUAL_STRING("last\n", out.text);
+    TEST_ASSERT_EQUAL(-EAGAIN, prb_read(&rb, &seq, &out));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Ordering */
+    RUN_TEST(test_empty_ring_has_nothing_to_read);
+    RUN_TEST(test_records_read_back_in_order);
+    RUN_TEST(test_reader_stops_at_uncommitted_record);
+
+    /* Overwrite */
+    RUN_TEST(test_overwritten_reader_skips_to_oldest);
+    RUN_TEST(test_slot_reused_by_writer_is_not_returned);
+    RUN_TEST(test_torn_length_is_clamped);
+
+    /* Limits */
+    RUN_TEST(test_sequence_wraps);
+
+    return UNITY_END();
+}
@@ -0,0 +1,143 @@
+/*
+ * tests/host/test_ratelimit.c - Host-side tests for message rate limiting
+ *
+ * Tests the ACTUAL kernel token bucket (kernel/lib/ratelimit.c) with
+ * explicit timestamps: burst size, refill at the end of the window,
+ * the suppressed count handed back once per refill, and the interval
+ * and burst edge cases.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <ratelimit.h>
+
+#define MS      1000000ULL
+
+static struct ratelimit_state rs;
+
+void setUp(void)
+{
+    struct ratelimit_state init = RATELIMIT_STATE_INIT(100 * MS, 3);
+
+    rs = init;
+}
+
+void tearDown(void)
+{
+}
+
+/* Count the messages let through by @n calls at @now */
+static uint32_t allowed(uint32_t n, uint64_t now, uint32_t *missed)
+{
+    uint32_t ok = 0, m, i;
+
+    *missed = 0;
+    for (i = 0; i < n; i++) {
+        ok += ratelimit_check(&rs, now, &m);
+        *missed += m;
+    }
+    return ok;
+}
+
+void test_burst_then_suppressed(void)
+{
+    uint32_t missed;
+
+    TEST_ASSERT_EQUAL_UINT32(3, allowed(10, 0, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+    TEST_ASSERT_EQUAL_UINT32(7, rs.missed);
+    TEST_ASSERT_EQUAL_UINT32(7, rs.suppressed);
+}
+
+void test_first_use_at_any_time(void)
+{
+    uint32_t missed;
+
+    /* The window starts at the first message, not at ktime 0 */
+    TEST_ASSERT_EQUAL_UINT32(3, allowed(5, 12345 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, allowed(1, 12345 * MS + 99 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(1, allowed(1, 12345 * MS + 100 * MS, &missed));
+}
+
+void test_refill_reports_missed_once(void)
+{
+    uint32_t missed;
+
+    allowed(10, 0, &missed);
+
+    /* Still inside the window */
+    TEST_ASSERT_EQUAL_UINT32(0, allowed(2, 99 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+
+    /* Refilled: the first call hands back all 9 misses */
+    TEST_ASSERT_EQUAL_UINT32(3, allowed(5, 100 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(9, missed);
+    TEST_ASSERT_EQUAL_UINT32(2, rs.missed);
+    TEST_ASSERT_EQUAL_UINT32(11, rs.suppressed);
+
+    /* A quiet window reports nothing */
+    TEST_ASSERT_EQUAL_UINT32(1, allowed(1, 200 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(2, missed);
+    TEST_ASSERT_EQUAL_UINT32(1, allowed(1, 300 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+}
+
+void test_long_idle_refills_once(void)
+{
+    uint32_t missed;
+
+    allowed(3, 0, &missed);
+
+    /* Tokens do not pile up over many windows */
+    TEST_ASSERT_EQUAL_UINT32(3, allowed(10, 10000 * MS, &missed));
+}
+
+void test_zero_interval_never_limits(void)
+{
+    struct ratelimit_state init = RATELIMIT_STATE_INIT(0, 1);
+    uint32_t missed;
+
+    rs = init;
+    TEST_ASSERT_EQUAL_UINT32(100, allowed(100, 5 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, rs.suppressed);
+}
+
+void test_zero_burst_always_limits(void)
+{
+    struct ratelimit_state init = RATELIMIT_STATE_INIT(100 * MS, 0);
+    uint32_t missed;
+
+    rs = init;
+    TEST_ASSERT_EQUAL_UINT32(0, allowed(4, 0, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, allowed(1, 100 * MS, &missed));
+    TEST_ASSERT_EQUAL_UINT32(4, missed);
+    TEST_ASSERT_EQUAL_UINT32(5, rs.suppressed);
+}
+
+void test_defaults(void)
+{
+    DEFINE_RATELIMIT_STATE(def, RATELIMIT_INTERVAL_NS, RATELIMIT_BURST);
+    uint32_t i, ok = 0, m;
+
+    for (i = 0; i < 1000; i++) {
+        ok += ratelimit_check(&def, 1000 * MS + i * MS, &m);
+    }
+    TEST_ASSERT_EQUAL_UINT32(RATELIMIT_BURST, ok);
+    TEST_ASSERT_EQUAL_UINT32(1000 - RATELIMIT_BURST, def.suppressed);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_burst_then_suppressed);
+    RUN_TEST(test_first_use_at_any_time);
+    RUN_TEST(test_refill_reports_missed_once);
+    RUN_TEST(test_long_idle_refills_once);
+    RUN_TEST(test_zero_interval_never_limits);
+    RUN_TEST(test_zero_burst_always_limits);
+    RUN_TEST(test_defaults);
+
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+/*
+ * tests/host/test_serial.c - Host-side tests for the serial RX ring
+ *
+ * Tests the cooked input queue (kernel/drivers/serial.c) using the
+ * ACTUAL kernel code: CR/LF folding, line reads, overflow, and reads
+ * across the wrap of the free-running indexes.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <string.h>
+#include <errno.h>
+#include <serial.h>
+
+static struct serial_rx_ring ring;
+
+void setUp(void)
+{
+    serial_rx_ring_init(&ring);
+}
+
+void tearDown(void)
+{
+}
+
+static void put_str(const char *s)
+{
+    while (*s) {
+        serial_rx_ring_put(&ring, (uint8_t)*s++);
+    }
+}
+
+void test_cr_and_crlf_become_lf(void)
+{
+    char buf[16];
+
+    put_str("a\rb\r\nc\n");
+
+    TEST_ASSERT_EQUAL_UINT32(6, serial_rx_ring_count(&ring));
+    TEST_ASSERT_EQUAL_UINT32(3, ring.lines);
+    TEST_ASSERT_EQUAL(6, (int)serial_rx_ring_read(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_MEMORY("a\nb\nc\n", buf, 6);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.lines);
+}
+
+void test_lf_lf_is_two_lines(void)
+{
+    char buf[8];
+
+    put_str("\n\n");
+
+    TEST_ASSERT_EQUAL(0, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(0, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(-EAGAIN, serial_rx_ring_getline(&ring, buf,
+                                                       sizeof(buf)));
+}
+
+void test_getline_waits_for_end_of_line(void)
+{
+    char buf[16];
+
+    put_str("help");
+    TEST_ASSERT_EQUAL(-EAGAIN, serial_rx_ring_getline(&ring, buf,
+                                                       sizeof(buf)));
+
+    put_str("\r\nls\r");
+    TEST_ASSERT_EQUAL(4, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("help", buf);
+    TEST_ASSERT_EQUAL(2, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("ls", buf);
+    TEST_ASSERT_EQUAL_UINT32(0, serial_rx_ring_count(&ring));
+}
+
+void test_getline_splits_long_line(void)
+{
+    char buf[4];
+
+    put_str("abcdefg\n");
+
+    TEST_ASSERT_EQUAL(3, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("abc", buf);
+    TEST_ASSERT_EQUAL(3, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("def", buf);
+    TEST_ASSERT_EQUAL(1, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("g", buf);
+    TEST_ASSERT_EQUAL_UINT32(0, serial_rx_ring_count(&ring));
+}
+
+void test_getline_exact_fit_consumes_lf(void)
+{
+    char buf[4];
+
+    put_str("abc\nx");
+
+    TEST_ASSERT_EQUAL(3, serial_rx_ring_getline(&ring, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("abc", buf);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.lines);
+    TEST_ASSERT_EQUAL(-EAGAIN, serial_rx_ring_getline(&ring, buf,
+                                                       sizeof(buf)));
+}
+
+void test_getline_rejects_zero_size(void)
+{
+    char buf[1];
+
+    TEST_ASSERT_EQUAL(-EINVAL, serial_rx_ring_getline(&ring, buf, 0));
+}
+
+void test_full_ring_drops_and_returns_partial_line(void)
+{
+    static char line[SERIAL_RX_RING_SIZE + 1];
+    uint32_t i;
+
+    for (i = 0; i < SERIAL_RX_RING_SIZE; i++) {
+        TEST_ASSERT_TRUE(serial_rx_ring_put(&ring, 'x'));
+    }
+    TEST_ASSERT_FALSE(serial_rx_ring_put(&ring, 'y'));
+    TEST_ASSERT_FALSE(serial_rx_ring_put(&ring, '\n'));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.lines);
+
+    /* No LF will ever fit, so the full ring counts as a line */
+    TEST_ASSERT_EQUAL(SERIAL_RX_RING_SIZE,
+                      serial_rx_ring_getline(&ring, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_UINT32(0, serial_rx_ring_count(&ring));
+}
+
+void test_indexes_wrap(void)
+{
+    char buf[8];
+    uint32_t i;
+
+    ring.head = ring.tail = 0xFFFFFFFCu;
+    for (i = 0; i < 100; i++) {
+        put_str("abc\n");
+        TEST_ASSERT_EQUAL(3, serial_rx_ring_getline(&ring, buf,
+                                                    sizeof(buf)));
+        TEST_ASSERT_EQUAL_STRING("abc", buf);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, serial_rx_ring_count(&ring));
+    TEST_ASSERT_TRUE(ring.head < 0x1000);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Cooking */
+    RUN_TEST(test_cr_and_crlf_become_lf);
+    RUN_TEST(test_lf_lf_is_two_lines);
+
+    /* Line reads */
+    RUN_TEST(test_getline_waits_for_end_of_line);
+    RUN_TEST(test_getline_splits_long_line);
+    RUN_TEST(test_getline_exact_fit_consumes_lf);
+    RUN_TEST(test_getline_rejects_zero_size);
+
+    /* Limits */
+    RUN_TEST(test_full_ring_drops_and_returns_partial_line);
+    RUN_TEST(test_indexes_wrap);
+
+    return UNITY_END();
+}
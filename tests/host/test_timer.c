@@ -0,0 +1,383 @@
+/*
+ * tests/host/test_timer.c - Host-side tests for the timer wheel
+ *
+ * Tests the hierarchical timer wheel (kernel/lib/timer.c) using the
+ * ACTUAL kernel code. The clock is driven by hand, so cascading across
+ * every level can be checked without waiting on real time.
+ *
+ * The benchmark times add, cancel and expiry for 100k timers and
+ * compares insertion against a sorted linked list.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <stdio.h>
+#include <time.h>
+#include <timer.h>
+
+static struct timer_base base;
+static struct list_head expired;
+static uint64_t now;
+
+/* Set by the callback: the clock each timer fired at */
+#define POOL    4096
+static struct timer_list pool[POOL];
+static uint64_t fired_at[POOL];
+static uint32_t fired;
+
+static void record(struct timer_list *timer)
+{
+    fired_at[timer - pool] = now;
+    fired++;
+}
+
+/* Advance the clock to @to and run what expired, like run_timers() */
+static void advance(uint64_t to)
+{
+    struct timer_list *timer;
+
+    now = to;
+    timer_base_collect(&base, now, &expired);
+    while (!list_empty(&expired)) {
+        timer = list_entry(expired.next, struct timer_list, entry);
+        list_del(&timer->entry);
+        timer->function(timer);
+    }
+}
+
+static void arm(uint32_t i, uint64_t expires)
+{
+    timer_setup(&pool[i], record);
+    pool[i].expires = expires;
+    fired_at[i] = 0;
+    timer_base_add(&base, &pool[i]);
+}
+
+void setUp(void)
+{
+    now = 1000;
+    fired = 0;
+    timer_base_init(&base, now);
+    INIT_LIST_HEAD(&expired);
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/*
+ * =============================================================================
+ * Basic tests
+ * =============================================================================
+ */
+
+void test_expires_on_exact_jiffy(void)
+{
+    arm(0, now + 1);
+    arm(1, now + 5);
+
+    advance(now);
+    TEST_ASSERT_EQUAL_UINT32(0, fired);
+    advance(1001);
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+    TEST_ASSERT_EQUAL_UINT64(1001, fired_at[0]);
+    TEST_ASSERT_FALSE(timer_pending(&pool[0]));
+    TEST_ASSERT_TRUE(timer_pending(&pool[1]));
+
+    advance(1004);
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+    advance(1010);
+    TEST_ASSERT_EQUAL_UINT64(1010, fired_at[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, base.count);
+}
+
+void test_past_expiry_fires_on_next_jiffy(void)
+{
+    advance(2000);
+    arm(0, 1500);
+    TEST_ASSERT_EQUAL_UINT64(1500, timer_base_next(&base));
+    advance(2001);
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+}
+
+void test_del_prevents_expiry(void)
+{
+    arm(0, now + 3);
+    arm(1, now + 3);
+
+    TEST_ASSERT_TRUE(timer_base_del(&base, &pool[0]));
+    TEST_ASSERT_FALSE(timer_base_del(&base, &pool[0]));
+    TEST_ASSERT_EQUAL_UINT32(1, base.count);
+
+    advance(now + 3);
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+    TEST_ASSERT_EQUAL_UINT64(0, fired_at[0]);
+}
+
+void test_del_after_collect_before_run(void)
+{
+    arm(0, now + 1);
+    arm(1, now + 1);
+
+    now++;
+    TEST_ASSERT_EQUAL_UINT32(2, timer_base_collect(&base, now, &expired));
+    TEST_ASSERT_TRUE(timer_pending(&pool[1]));
+    TEST_ASSERT_TRUE(timer_base_del(&base, &pool[1]));
+
+    advance(now);
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+    TEST_ASSERT_EQUAL_UINT64(0, fired_at[1]);
+}
+
+void test_cascade_through_every_level(void)
+{
+    /* One timer per level; each must fire exactly on time */
+    static const uint64_t delta[] = {
+        200, 300, 20000, 1500000, 70000000
+    };
+    uint32_t i;
+
+    for (i = 0; i < 5; i++) {
+        arm(i, now + delta[i]);
+        TEST_ASSERT_EQUAL_UINT64(now + delta[0], timer_base_next(&base));
+    }
+
+    for (i = 0; i < 5; i++) {
+        advance(1000 + delta[i] - 1);
+        TEST_ASSERT_EQUAL_UINT32(i, fired);
+        TEST_ASSERT_EQUAL_UINT64(1000 + delta[i], timer_base_next(&base));
+        advance(1000 + delta[i]);
+        TEST_ASSERT_EQUAL_UINT32(i + 1, fired);
+        TEST_ASSERT_EQUAL_UINT64(1000 + delta[i], fired_at[i]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(TIMER_IDLE, timer_base_next(&base));
+    TEST_ASSERT_TRUE(base.cascaded >= 4);
+}
+
+void test_callback_can_rearm(void)
+{
+    static uint32_t runs;
+    struct timer_list t;
+
+    runs = 0;
+    timer_setup(&t, NULL);
+    t.expires = now + 10;
+    timer_base_add(&base, &t);
+
+    /* Re-arm by hand from the "callback" position, as run_timers allows */
+    while (runs < 3) {
+        struct timer_list *timer;
+
+        now++;
+        timer_base_collect(&base, now, &expired);
+        while (!list_empty(&expired)) {
+            timer = list_entry(expired.next, struct timer_list, entry);
+            list_del(&timer->entry);
+            runs++;
+            timer->expires = now + 10;
+            timer_base_add(&base, timer);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT64(1030, now);
+    TEST_ASSERT_EQUAL_UINT32(1, base.count);
+}
+
+void test_next_ignores_slot_a_full_turn_away(void)
+{
+    /*
+     * From an unaligned clock, a level-1 timer 64 slots out hashes to
+     * the current level-1 slot; it must not hide a nearer timer.
+     */
+    advance(1000 + 100);
+    arm(0, now + 16300);
+    arm(1, now + 1000);
+    TEST_ASSERT_EQUAL_UINT64(now + 1000, timer_base_next(&base));
+    TEST_ASSERT_TRUE(timer_base_del(&base, &pool[1]));
+    TEST_ASSERT_EQUAL_UINT64(now + 16300, timer_base_next(&base));
+}
+
+/*
+ * =============================================================================
+ * Randomized
+ * =============================================================================
+ */
+
+void test_random_against_reference(void)
+{
+    uint64_t armed_at[POOL];
+    uint64_t prev, ref;
+    uint32_t i, step;
+
+    rng_state = 0xBADC0DE;
+    for (i = 0; i < POOL; i++) {
+        timer_setup(&pool[i], record);
+    }
+
+    for (step = 0; step < 3000; step++) {
+        /* Arm, re-arm or cancel a few timers */
+        for (int n = 0; n < 8; n++) {
+            i = rng() % POOL;
+            if (timer_pending(&pool[i]) && rng() % 3 == 0) {
+                timer_base_del(&base, &pool[i]);
+            } else {
+                timer_base_del(&base, &pool[i]);
+                pool[i].expires = now + rng() % (1U << (rng() % 18));
+                armed_at[i] = now;
+                fired_at[i] = 0;
+                timer_base_add(&base, &pool[i]);
+            }
+        }
+
+        /* Reference earliest expiry */
+        ref = TIMER_IDLE;
+        for (i = 0; i < POOL; i++) {
+            if (timer_pending(&pool[i]) && pool[i].expires < ref) {
+                ref = pool[i].expires;
+            }
+        }
+        TEST_ASSERT_EQUAL_UINT64(ref, timer_base_next(&base));
+
+        /* Everything fires in the step covering its expiry */
+        prev = now;
+        advance(now + 1 + rng() % 64);
+        for (i = 0; i < POOL; i++) {
+            if (fired_at[i] == now) {
+                TEST_ASSERT_TRUE(pool[i].expires <= now);
+                TEST_ASSERT_TRUE(pool[i].expires > prev ||
+                                 armed_at[i] == prev);
+            } else if (timer_pending(&pool[i])) {
+                TEST_ASSERT_TRUE(pool[i].expires > now);
+            }
+        }
+    }
+}
+
+/*
+ * =============================================================================
+ * Benchmark: wheel vs sorted linked list
+ * =============================================================================
+ */
+
+#define BENCH_TIMERS        100000
+#define BENCH_LIST_TIMERS   10000
+#define BENCH_RANGE         100000
+
+static struct timer_list bench[BENCH_TIMERS];
+static uint32_t bench_fired;
+
+static void bench_fn(struct timer_list *timer)
+{
+    (void)timer;
+    bench_fired++;
+}
+
+struct list_timer {
+    uint64_t expires;
+    struct list_timer *next;
+};
+
+static struct list_timer bench_list[BENCH_LIST_TIMERS];
+
+static double elapsed_ns(clock_t start, uint32_t ops)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ops;
+}
+
+void test_benchmark_wheel_vs_list(void)
+{
+    struct list_timer *head = NULL, **link;
+    struct timer_list *timer;
+    double add_ns, del_ns, run_ns, list_add_ns;
+    uint32_t cancelled = 0;
+    clock_t t;
+    uint32_t i;
+
+    rng_state = 4242;
+    for (i = 0; i < BENCH_TIMERS; i++) {
+        timer_setup(&bench[i], bench_fn);
+        bench[i].expires = now + 1 + rng() % BENCH_RANGE;
+    }
+
+    t = clock();
+    for (i = 0; i < BENCH_TIMERS; i++) {
+        timer_base_add(&base, &bench[i]);
+    }
+    add_ns = elapsed_ns(t, BENCH_TIMERS);
+
+    t = clock();
+    for (i = 0; i < BENCH_TIMERS; i += 2) {
+        cancelled += timer_base_del(&base, &bench[i]);
+    }
+    del_ns = elapsed_ns(t, BENCH_TIMERS / 2);
+
+    /* One collect per jiffy, as the tick would drive it */
+    bench_fired = 0;
+    t = clock();
+    while (base.count != 0) {
+        now++;
+        timer_base_collect(&base, now, &expired);
+        while (!list_empty(&expired)) {
+            timer = list_entry(expired.next, struct timer_list, entry);
+            list_del(&timer->entry);
+            timer->function(timer);
+        }
+    }
+    run_ns = elapsed_ns(t, BENCH_TIMERS - cancelled);
+
+    rng_state = 4242;
+    t = clock();
+    for (i = 0; i < BENCH_LIST_TIMERS; i++) {
+        bench_list[i].expires = 1 + rng() % BENCH_RANGE;
+        for (link = &head; *link && (*link)->expires <= bench_list[i].expires;
+             link = &(*link)->next) {
+        }
+        bench_list[i].next = *link;
+        *link = &bench_list[i];
+    }
+    list_add_ns = elapsed_ns(t, BENCH_LIST_TIMERS);
+
+    printf("\n  %d timers over %d jiffies:\n", BENCH_TIMERS, BENCH_RANGE);
+    printf("    wheel: add %.1f ns, cancel %.1f ns, expire %.1f ns "
+           "(%llu cascaded)\n", add_ns, del_ns, run_ns,
+           (unsigned long long)base.cascaded);
+    printf("    sorted list add (%d timers): %.1f ns\n",
+           BENCH_LIST_TIMERS, list_add_ns);
+
+    TEST_ASSERT_EQUAL_UINT32(BENCH_TIMERS / 2, cancelled);
+    TEST_ASSERT_EQUAL_UINT32(BENCH_TIMERS - cancelled, bench_fired);
+    TEST_ASSERT_EQUAL_UINT64(TIMER_IDLE, timer_base_next(&base));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Basic */
+    RUN_TEST(test_expires_on_exact_jiffy);
+    RUN_TEST(test_past_expiry_fires_on_next_jiffy);
+    RUN_TEST(test_del_prevents_expiry);
+    RUN_TEST(test_del_after_collect_before_run);
+    RUN_TEST(test_cascade_through_every_level);
+    RUN_TEST(test_callback_can_rearm);
+    RUN_TEST(test_next_ignores_slot_a_full_turn_away);
+
+    /* Randomized */
+    RUN_TEST(test_random_against_reference);
+
+    /* Benchmark */
+    RUN_TEST(test_benchmark_wheel_vs_list);
+
+    return UNITY_END();
+}
@@ -0,0 +1,153 @@
+/*
+ * tests/host/test_trace.c - Host-side tests for binary tracing
+ *
+ * Tests the TRACE() macro and the trace buffer (kernel/lib/trace.c)
+ * using the ACTUAL kernel code: argument counting, what an event holds,
+ * oldest-first reads across the ring's wrap, and the dump header.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <string.h>
+#include <trace.h>
+
+/*
+ * Events keep only the low 32 bits of the format's address, which is
+ * the whole address in the kernel. The host test binary may be loaded
+ * above 4GB, so take the upper half from a string in the same section.
+ */
+static const char anchor[] __attribute__((section(".trace_fmt"))) = "";
+
+static const char *fmt_string(const struct trace_event *ev)
+{
+    uintptr_t high = (uintptr_t)anchor & ~(uintptr_t)0xFFFFFFFFU;
+
+    return (const char *)(high | ev->fmt);
+}
+
+void setUp(void)
+{
+    trace_buffer_reset(&trace_cpu_buf);
+    trace_enabled = true;
+}
+
+void tearDown(void)
+{
+}
+
+void test_event_is_32_bytes(void)
+{
+    TEST_ASSERT_EQUAL(32, (int)sizeof(struct trace_event));
+    TEST_ASSERT_EQUAL(24, (int)sizeof(struct trace_dump_header));
+}
+
+void test_disabled_records_nothing(void)
+{
+    trace_enabled = false;
+    TRACE("off %u", 1);
+
+    TEST_ASSERT_EQUAL_UINT32(0, trace_buffer_count(&trace_cpu_buf));
+    TEST_ASSERT_NULL(trace_buffer_get(&trace_cpu_buf, 0));
+}
+
+void test_macro_counts_arguments(void)
+{
+    uint32_t i;
+
+    TRACE("zero");
+    TRACE("one %u", 1);
+    TRACE("two %u %u", 1, 2);
+    TRACE("three %u %u %u", 1, 2, 3);
+    TRACE("four %u %u %u %u", 1, 2, 3, 4);
+
+    TEST_ASSERT_EQUAL_UINT32(5, trace_buffer_count(&trace_cpu_buf));
+    for (i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT8(i, trace_buffer_get(&trace_cpu_buf, i)->nargs);
+    }
+}
+
+void test_event_holds_format_and_raw_args(void)
+{
+    const struct trace_event *ev;
+    int x = -7;
+
+    TRACE("irq %u took %d (%x)", 33U, x, 0xDEADBEEFU);
+
+    ev = trace_buffer_get(&trace_cpu_buf, 0);
+    TEST_ASSERT_NOT_NULL(ev);
+    TEST_ASSERT_EQUAL_STRING("irq %u took %d (%x)", fmt_string(ev));
+    TEST_ASSERT_EQUAL_UINT32(33, ev->args[0]);
+    TEST_ASSERT_EQUAL_INT32(-7, (int32_t)ev->args[1]);
+    TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, ev->args[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, ev->args[3]);
+}
+
+void test_same_call_site_same_format(void)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        TRACE("loop %d", i);
+    }
+    TRACE("loop %d", 2);
+
+    TEST_ASSERT_EQUAL_HEX32(trace_buffer_get(&trace_cpu_buf, 0)->fmt,
+                            trace_buffer_get(&trace_cpu_buf, 1)->fmt);
+    TEST_ASSERT_TRUE(trace_buffer_get(&trace_cpu_buf, 1)->fmt !=
+                     trace_buffer_get(&trace_cpu_buf, 2)->fmt);
+}
+
+void test_wrap_keeps_newest_oldest_first(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < TRACE_EVENTS + 5; i++) {
+        trace_buffer_write(&trace_cpu_buf, i, "x", 1, i, 0, 0, 0);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(TRACE_EVENTS, trace_buffer_count(&trace_cpu_buf));
+    TEST_ASSERT_EQUAL_UINT32(5, trace_buffer_get(&trace_cpu_buf, 0)->args[0]);
+    TEST_ASSERT_EQUAL_UINT32(TRACE_EVENTS + 4,
+        trace_buffer_get(&trace_cpu_buf, TRACE_EVENTS - 1)->args[0]);
+    TEST_ASSERT_NULL(trace_buffer_get(&trace_cpu_buf, TRACE_EVENTS));
+}
+
+void test_dump_header(void)
+{
+    struct trace_dump_header hdr;
+    uint32_t i;
+
+    for (i = 0; i < TRACE_EVENTS + 3; i++) {
+        TRACE("fill");
+    }
+    trace_dump_header_init(&hdr, &trace_cpu_buf, 2400000, 0x104000);
+
+    TEST_ASSERT_EQUAL_MEMORY("TRC1", &hdr.magic, 4);
+    TEST_ASSERT_EQUAL_UINT16(TRACE_DUMP_VERSION, hdr.version);
+    TEST_ASSERT_EQUAL_UINT16(32, hdr.event_size);
+    TEST_ASSERT_EQUAL_UINT32(TRACE_EVENTS, hdr.count);
+    TEST_ASSERT_EQUAL_UINT32(3, hdr.lost);
+    TEST_ASSERT_EQUAL_UINT32(2400000, hdr.tsc_khz);
+    TEST_ASSERT_EQUAL_HEX32(0x104000, hdr.fmt_start);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Layout */
+    RUN_TEST(test_event_is_32_bytes);
+
+    /* Recording */
+    RUN_TEST(test_disabled_records_nothing);
+    RUN_TEST(test_macro_counts_arguments);
+    RUN_TEST(test_event_holds_format_and_raw_args);
+    RUN_TEST(test_same_call_site_same_format);
+
+    /* Reading back */
+    RUN_TEST(test_wrap_keeps_newest_oldest_first);
+    RUN_TEST(test_dump_header);
+
+    return UNITY_END();
+}
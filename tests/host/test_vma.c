@@ -0,0 +1,442 @@
+/*
+ * tests/host/test_vma.c - Host-side tests for the VMA tree
+ *
+ * Tests the augmented red-black tree (kernel/lib/rbtree.c) and the VMA
+ * layer on top of it (kernel/lib/vma.c) using the ACTUAL kernel code.
+ * After every mutation the tree is checked for red-black invariants and
+ * correct cached gaps.
+ *
+ * The benchmark compares fault lookup and free-range search against
+ * a sorted linked list of the same regions.
+ *
+ * Uses Unity test framework.
+ */
+
+#include "unity/unity.h"
+#include <stdio.h>
+#include <time.h>
+#include <vma.h>
+#include <errno.h>
+
+#define PAGE    0x1000U
+
+static struct vma_tree tree;
+
+void setUp(void)
+{
+    vma_tree_init(&tree);
+}
+
+void tearDown(void)
+{
+}
+
+/*
+ * =============================================================================
+ * Invariant checker
+ * =============================================================================
+ */
+
+static uint32_t checked_prev_end;
+
+/*
+ * check_subtree - Verify colors, order, gaps and max_gap
+ *
+ * Returns: Black height of the subtree
+ */
+static int check_subtree(const struct rb_node *node,
+                         const struct rb_node *parent)
+{
+    const struct vma *vma;
+    uint32_t max;
+    int lh, rh;
+
+    if (node == NULL) {
+        return 1;
+    }
+
+    TEST_ASSERT_EQUAL_PTR(parent, node->parent);
+    if (node->color == RB_RED) {
+        TEST_ASSERT_TRUE(node->left == NULL || node->left->color == RB_BLACK);
+        TEST_ASSERT_TRUE(node->right == NULL || node->right->color == RB_BLACK);
+    }
+
+    lh = check_subtree(node->left, node);
+
+    /* In-order visit: regions sorted, disjoint, gap matches */
+    vma = rb_entry(node, struct vma, rb);
+    TEST_ASSERT_TRUE(vma->start >= checked_prev_end);
+    TEST_ASSERT_EQUAL_UINT32(vma->start - checked_prev_end, vma->gap);
+    checked_prev_end = vma->end;
+
+    rh = check_subtree(node->right, node);
+    TEST_ASSERT_EQUAL_INT(lh, rh);
+
+    max = vma->gap;
+    if (node->left && rb_entry(node->left, struct vma, rb)->max_gap > max) {
+        max = rb_entry(node->left, struct vma, rb)->max_gap;
+    }
+    if (node->right && rb_entry(node->right, struct vma, rb)->max_gap > max) {
+        max = rb_entry(node->right, struct vma, rb)->max_gap;
+    }
+    TEST_ASSERT_EQUAL_UINT32(max, vma->max_gap);
+
+    return lh + (node->color == RB_BLACK);
+}
+
+static void check_tree(void)
+{
+    uint32_t n = 0;
+
+    if (tree.root.node != NULL) {
+        TEST_ASSERT_EQUAL_INT(RB_BLACK, tree.root.node->color);
+        TEST_ASSERT_NULL(tree.root.node->parent);
+    }
+    checked_prev_end = 0;
+    check_subtree(tree.root.node, NULL);
+
+    for (struct rb_node *rb = rb_first(&tree.root); rb; rb = rb_next(rb)) {
+        n++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(tree.count, n);
+}
+
+/* xorshift32, deterministic across runs */
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/*
+ * =============================================================================
+ * Basic tests
+ * =============================================================================
+ */
+
+void test_insert_and_find(void)
+{
+    static struct vma a = { .start = 0x1000, .end = 0x3000 };
+    static struct vma b = { .start = 0x8000, .end = 0x9000 };
+
+    TEST_ASSERT_EQUAL_INT(0, vma_insert(&tree, &b));
+    TEST_ASSERT_EQUAL_INT(0, vma_insert(&tree, &a));
+    check_tree();
+
+    TEST_ASSERT_EQUAL_PTR(&a, vma_find(&tree, 0x1000));
+    TEST_ASSERT_EQUAL_PTR(&a, vma_find(&tree, 0x2FFF));
+    TEST_ASSERT_NULL(vma_find(&tree, 0x3000));
+    TEST_ASSERT_EQUAL_PTR(&b, vma_find(&tree, 0x8800));
+    TEST_ASSERT_NULL(vma_find(&tree, 0x0FFF));
+
+    TEST_ASSERT_EQUAL_UINT32(0x1000, a.gap);
+    TEST_ASSERT_EQUAL_UINT32(0x5000, b.gap);
+}
+
+void test_insert_rejects_overlap_and_empty(void)
+{
+    static struct vma a = { .start = 0x4000, .end = 0x8000 };
+    static struct vma over = { .start = 0x7000, .end = 0x9000 };
+    static struct vma inside = { .start = 0x5000, .end = 0x6000 };
+    static struct vma empty = { .start = 0x9000, .end = 0x9000 };
+
+    vma_insert(&tree, &a);
+    TEST_ASSERT_EQUAL_INT(-EEXIST, vma_insert(&tree, &over));
+    TEST_ASSERT_EQUAL_INT(-EEXIST, vma_insert(&tree, &inside));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, vma_insert(&tree, &empty));
+    TEST_ASSERT_EQUAL_UINT32(1, tree.count);
+}
+
+void test_remove_merges_gap_into_successor(void)
+{
+    static struct vma v[3] = {
+        { .start = 0x1000, .end = 0x2000 },
+        { .start = 0x3000, .end = 0x4000 },
+        { .start = 0x6000, .end = 0x7000 },
+    };
+
+    for (int i = 0; i < 3; i++) {
+        vma_insert(&tree, &v[i]);
+    }
+    vma_remove(&tree, &v[1]);
+    check_tree();
+
+    TEST_ASSERT_EQUAL_UINT32(0x4000, v[2].gap);
+    TEST_ASSERT_NULL(vma_find(&tree, 0x3000));
+}
+
+void test_find_gap_lowest_fit(void)
+{
+    static struct vma v[3] = {
+        { .start = 0x10000, .end = 0x11000 },   /* gap before: 0x10000 */
+        { .start = 0x12000, .end = 0x13000 },   /* gap before: 0x1000 */
+        { .start = 0x16000, .end = 0x17000 },   /* gap before: 0x3000 */
+    };
+    uint32_t addr;
+
+    for (int i = 0; i < 3; i++) {
+        vma_insert(&tree, &v[i]);
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, vma_find_gap(&tree, 0x2000, 0x11000,
+                                          0x100000, &addr));
+    TEST_ASSERT_EQUAL_HEX32(0x13000, addr);
+
+    TEST_ASSERT_EQUAL_INT(0, vma_find_gap(&tree, 0x1000, 0x10000,
+                                          0x100000, &addr));
+    TEST_ASSERT_EQUAL_HEX32(0x11000, addr);
+
+    /* Nothing inside the tree is big enough: falls past the last VMA */
+    TEST_ASSERT_EQUAL_INT(0, vma_find_gap(&tree, 0x20000, 0x1000,
+                                          0x100000, &addr));
+    TEST_ASSERT_EQUAL_HEX32(0x17000, addr);
+
+    /* Low bound inside a gap clips it */
+    TEST_ASSERT_EQUAL_INT(0, vma_find_gap(&tree, 0x1000, 0x14800,
+                                          0x100000, &addr));
+    TEST_ASSERT_EQUAL_HEX32(0x14800, addr);
+}
+
+void test_find_gap_respects_high(void)
+{
+    static struct vma a = { .start = 0x2000, .end = 0x10000 };
+    uint32_t addr;
+
+    vma_insert(&tree, &a);
+
+    TEST_ASSERT_EQUAL_INT(0, vma_find_gap(&tree, 0x2000, 0, 0x10000, &addr));
+    TEST_ASSERT_EQUAL_HEX32(0, addr);
+    TEST_ASSERT_EQUAL_INT(-ENOMEM, vma_find_gap(&tree, 0x3000, 0, 0x10000,
+                                                &addr));
+    TEST_ASSERT_EQUAL_INT(-ENOMEM, vma_find_gap(&tree, 0x1000, 0x2000,
+                                                0x10000, &addr));
+}
+
+void test_find_gap_empty_tree(void)
+{
+    uint32_t addr;
+
+    TEST_ASSERT_EQUAL_INT(0, vma_find_gap(&tree, PAGE, 0x400000,
+                                          0xC0000000U, &addr));
+    TEST_ASSERT_EQUAL_HEX32(0x400000, addr);
+    TEST_ASSERT_EQUAL_INT(-ENOMEM, vma_find_gap(&tree, 0, 0, 0x1000, &addr));
+}
+
+/*
+ * =============================================================================
+ * Randomized tests against a reference bitmap
+ * =============================================================================
+ */
+
+#define SLOTS   512
+
+static struct vma pool[SLOTS];
+static bool used[SLOTS];
+
+/* Reference: lowest slot run of @len free pages at or above @low */
+static int ref_find_gap(uint32_t len, uint32_t low)
+{
+    for (uint32_t s = low; s + len <= SLOTS; s++) {
+        uint32_t i;
+
+        for (i = 0; i < len && !used[s + i]; i++) {
+        }
+        if (i == len) {
+            return (int)s;
+        }
+    }
+    return -1;
+}
+
+void test_random_insert_remove_keeps_invariants(void)
+{
+    rng_state = 0xC0FFEE;
+    for (int i = 0; i < SLOTS; i++) {
+        used[i] = false;
+    }
+
+    /* Each slot is one page; a VMA occupies a single slot */
+    for (int step = 0; step < 4000; step++) {
+        uint32_t s = rng() % SLOTS;
+
+        if (used[s]) {
+            vma_remove(&tree, &pool[s]);
+            used[s] = false;
+        } else {
+            pool[s].start = s * PAGE;
+            pool[s].end = (s + 1) * PAGE;
+            TEST_ASSERT_EQUAL_INT(0, vma_insert(&tree, &pool[s]));
+            used[s] = true;
+        }
+
+        if (step % 50 == 0) {
+            check_tree();
+        }
+
+        if (step % 10 == 0) {
+            uint32_t len = 1 + rng() % 8;
+            uint32_t low = rng() % SLOTS;
+            uint32_t addr;
+            int expect = ref_find_gap(len, low);
+            int ret = vma_find_gap(&tree, len * PAGE, low * PAGE,
+                                   SLOTS * PAGE, &addr);
+
+            if (expect < 0) {
+                TEST_ASSERT_EQUAL_INT(-ENOMEM, ret);
+            } else {
+                TEST_ASSERT_EQUAL_INT(0, ret);
+                TEST_ASSERT_EQUAL_HEX32((uint32_t)expect * PAGE, addr);
+            }
+
+            s = rng() % SLOTS;
+            TEST_ASSERT_EQUAL_PTR(used[s] ? &pool[s] : NULL,
+                                  vma_find(&tree, s * PAGE + 0x10));
+        }
+    }
+    check_tree();
+
+    /* Drain in order and verify the tree empties cleanly */
+    for (int i = 0; i < SLOTS; i++) {
+        if (used[i]) {
+            vma_remove(&tree, &pool[i]);
+        }
+    }
+    TEST_ASSERT_NULL(tree.root.node);
+    TEST_ASSERT_EQUAL_UINT32(0, tree.count);
+}
+
+/*
+ * =============================================================================
+ * Benchmark: tree vs sorted linked list
+ * =============================================================================
+ */
+
+#define BENCH_VMAS      4096
+#define BENCH_LOOKUPS   200000
+
+struct list_vma {
+    uint32_t start;
+    uint32_t end;
+    struct list_vma *next;
+};
+
+static struct vma bench_vma[BENCH_VMAS];
+static struct list_vma bench_list[BENCH_VMAS];
+
+static const struct list_vma *list_find(const struct list_vma *head,
+                                        uint32_t addr)
+{
+    for (; head != NULL && head->start <= addr; head = head->next) {
+        if (addr < head->end) {
+            return head;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t list_find_gap(const struct list_vma *head, uint32_t size)
+{
+    uint32_t prev_end = 0;
+
+    for (; head != NULL; head = head->next) {
+        if (head->start - prev_end >= size) {
+            return prev_end;
+        }
+        prev_end = head->end;
+    }
+    return prev_end;
+}
+
+static double elapsed_ns(clock_t start, uint32_t ops)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ops;
+}
+
+void test_benchmark_tree_vs_list(void)
+{
+    uint32_t addr = 0;
+    uint32_t hits_tree = 0, hits_list = 0;
+    uint32_t gap_tree = 0, gap_list = 0;
+    clock_t t;
+    double tree_find_ns, list_find_ns, tree_gap_ns, list_gap_ns;
+
+    /* Regions of 1-4 pages separated by 1-page gaps; one 8-page hole late */
+    rng_state = 12345;
+    for (int i = 0; i < BENCH_VMAS; i++) {
+        uint32_t gap = (i == BENCH_VMAS - 16) ? 8 * PAGE : PAGE;
+
+        addr += gap;
+        bench_vma[i].start = addr;
+        addr += (1 + rng() % 4) * PAGE;
+        bench_vma[i].end = addr;
+        TEST_ASSERT_EQUAL_INT(0, vma_insert(&tree, &bench_vma[i]));
+
+        bench_list[i].start = bench_vma[i].start;
+        bench_list[i].end = bench_vma[i].end;
+        bench_list[i].next = (i + 1 < BENCH_VMAS) ? &bench_list[i + 1] : NULL;
+    }
+    check_tree();
+
+    rng_state = 99;
+    t = clock();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        hits_tree += vma_find(&tree, rng() % addr) != NULL;
+    }
+    tree_find_ns = elapsed_ns(t, BENCH_LOOKUPS);
+
+    rng_state = 99;
+    t = clock();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        hits_list += list_find(bench_list, rng() % addr) != NULL;
+    }
+    list_find_ns = elapsed_ns(t, BENCH_LOOKUPS);
+
+    t = clock();
+    for (int i = 0; i < BENCH_LOOKUPS / 100; i++) {
+        uint32_t a;
+        vma_find_gap(&tree, 4 * PAGE, 0, 0xFFFFF000U, &a);
+        gap_tree += a;
+    }
+    tree_gap_ns = elapsed_ns(t, BENCH_LOOKUPS / 100);
+
+    t = clock();
+    for (int i = 0; i < BENCH_LOOKUPS / 100; i++) {
+        gap_list += list_find_gap(bench_list, 4 * PAGE);
+    }
+    list_gap_ns = elapsed_ns(t, BENCH_LOOKUPS / 100);
+
+    printf("\n  %d VMAs:\n", BENCH_VMAS);
+    printf("    fault lookup: tree %.1f ns, list %.1f ns\n",
+           tree_find_ns, list_find_ns);
+    printf("    gap search:   tree %.1f ns, list %.1f ns\n",
+           tree_gap_ns, list_gap_ns);
+
+    /* Both structures must agree; timings are informational only */
+    TEST_ASSERT_EQUAL_UINT32(hits_list, hits_tree);
+    TEST_ASSERT_EQUAL_UINT32(gap_list, gap_tree);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Basic */
+    RUN_TEST(test_insert_and_find);
+    RUN_TEST(test_insert_rejects_overlap_and_empty);
+    RUN_TEST(test_remove_merges_gap_into_successor);
+    RUN_TEST(test_find_gap_lowest_fit);
+    RUN_TEST(test_find_gap_respects_high);
+    RUN_TEST(test_find_gap_empty_tree);
+
+    /* Randomized */
+    RUN_TEST(test_random_insert_remove_keeps_invariants);
+
+    /* Benchmark */
+    RUN_TEST(test_benchmark_tree_vs_list);
+
+    return UNITY_END();
+}